@@ -0,0 +1,165 @@
+// Decision latency of valuing every legal action: sequential rank_actions against
+// analyse_actions fanned out over thread pools of several sizes
+//
+// Positions are taken from random-policy games at turns where the mover has desert tile
+// candidates. Both sides get the position's leg and race odds precomputed, so the times cover
+// the per-candidate work; the budget rows show how many desert candidates were still valued
+// exactly when the decision had to be made within that many microseconds.
+
+#include <algorithm>  // max
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "camelup/analysis/action_values.hpp"
+#include "camelup/analysis/leg_odds.hpp"
+#include "camelup/analysis/race_odds.hpp"
+#include "camelup/engine.hpp"
+#include "camelup/util/thread_pool.hpp"
+
+namespace {
+
+bool parse_int_arg(const char* value, int& out) {
+    char* end = nullptr;
+    const long parsed = std::strtol(value, &end, 10);
+    if (end == value || *end != '\0') {
+        return false;
+    }
+    out = static_cast<int>(parsed);
+    return true;
+}
+
+void print_usage() {
+    std::cout << "Usage: camelup_action_analysis_bench [--seed N] [--players N] [--positions N] [--budget-us N]\n";
+}
+
+struct Position {
+    camelup::GameState state;
+    camelup::analysis::LegOdds leg;
+    camelup::analysis::RaceOdds race;
+};
+
+std::vector<Position> sample_positions(int seed, int players, int count) {
+    camelup::Engine engine(static_cast<std::uint32_t>(seed));
+    std::mt19937 rng(static_cast<std::uint32_t>(seed));
+    std::vector<Position> positions;
+    auto state = engine.new_game(players);
+    while (static_cast<int>(positions.size()) < count) {
+        if (state.terminal) {
+            state = engine.new_game(players);
+        }
+        const auto legal = engine.legal_actions(state);
+        if (state.desert_legal_tiles[state.current_player] != 0 && rng() % 4 == 0) {
+            positions.push_back({state, camelup::analysis::leg_odds(state),
+                                 camelup::analysis::race_odds(state, 200, static_cast<std::uint32_t>(seed))});
+        }
+        const auto pick = std::uniform_int_distribution<std::size_t>(0, legal.size() - 1)(rng);
+        state = engine.apply_action(state, legal[pick]);
+    }
+    return positions;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int seed = 42;
+    int players = 4;
+    int count = 40;
+    int budget_us = 2000;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage();
+            return 1;
+        }
+        int parsed = 0;
+        if (!parse_int_arg(argv[++i], parsed) || parsed <= 0) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--seed") {
+            seed = parsed;
+        } else if (arg == "--players") {
+            players = parsed;
+        } else if (arg == "--positions") {
+            count = parsed;
+        } else if (arg == "--budget-us") {
+            budget_us = parsed;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    try {
+        const auto positions = sample_positions(seed, players, count);
+        std::size_t candidates = 0;
+        for (const auto& position : positions) {
+            candidates += camelup::Engine().legal_actions(position.state).size();
+        }
+        const unsigned hardware = std::max(1U, std::thread::hardware_concurrency());
+        std::cout << "Positions: " << positions.size() << ", " << players << " players, "
+                  << static_cast<double>(candidates) / positions.size() << " candidates each, " << hardware
+                  << " hardware threads\n\n";
+        std::cout << std::left << std::setw(22) << "mode" << std::right << std::setw(14) << "ms_per_move"
+                  << std::setw(10) << "speedup" << std::setw(14) << "exact_desert" << '\n';
+
+        const auto start = std::chrono::steady_clock::now();
+        for (const auto& position : positions) {
+            static_cast<void>(camelup::analysis::rank_actions(position.state, position.leg, position.race));
+        }
+        const double sequential =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() /
+            positions.size();
+        std::cout << std::left << std::setw(22) << "rank_actions" << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(14) << sequential << std::setw(9) << std::setprecision(2) << 1.0 << "x" << std::setw(14)
+                  << "1.00" << '\n';
+
+        std::vector<unsigned> pool_sizes = {1U, 2U, 4U};
+        if (hardware > 4) {
+            pool_sizes.push_back(hardware);
+        }
+        for (const unsigned threads : pool_sizes) {
+            camelup::util::ThreadPool pool(threads);
+            for (const bool budgeted : {false, true}) {
+                std::size_t desert = 0;
+                std::size_t exact = 0;
+                const auto begin = std::chrono::steady_clock::now();
+                for (const auto& position : positions) {
+                    const auto deadline = budgeted
+                                              ? std::chrono::steady_clock::now() + std::chrono::microseconds(budget_us)
+                                              : std::chrono::steady_clock::time_point::max();
+                    for (const auto& estimate : camelup::analysis::analyse_actions(position.state, position.leg,
+                                                                                   position.race, pool, deadline)) {
+                        if (estimate.action.type() == camelup::ActionType::PlaceDesertTile) {
+                            ++desert;
+                            exact += estimate.exact ? 1 : 0;
+                        }
+                    }
+                }
+                const double per_move =
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() /
+                    positions.size();
+                const std::string name = "analyse " + std::to_string(threads) + "t" +
+                                         (budgeted ? " " + std::to_string(budget_us) + "us" : "");
+                std::cout << std::left << std::setw(22) << name << std::right << std::setprecision(3)
+                          << std::setw(14) << per_move << std::setw(9) << std::setprecision(2)
+                          << sequential / per_move << "x" << std::setw(14)
+                          << static_cast<double>(exact) / static_cast<double>(std::max<std::size_t>(desert, 1))
+                          << '\n';
+            }
+        }
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "camelup_action_analysis_bench failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
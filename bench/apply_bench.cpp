@@ -0,0 +1,150 @@
+// Cost of applying actions: copying and validating apply_action against in-place try_apply and
+// apply_unchecked
+//
+// Random-policy games are played once to fix their action sequences, then every mode replays
+// the same sequences from the same seeds, so all modes draw identical dice and end in identical
+// states. Times cover the replay loop only, per applied action.
+
+#include <algorithm>  // min
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "camelup/engine.hpp"
+#include "camelup/sim/batch.hpp"
+#include "camelup/sim/game_record.hpp"
+
+namespace {
+
+bool parse_int_arg(const char* value, int& out) {
+    char* end = nullptr;
+    const long parsed = std::strtol(value, &end, 10);
+    if (end == value || *end != '\0') {
+        return false;
+    }
+    out = static_cast<int>(parsed);
+    return true;
+}
+
+void print_usage() {
+    std::cout << "Usage: camelup_apply_bench [--seed N] [--players N] [--games N] [--repeats N]\n";
+}
+
+enum class Mode { ApplyAction, TryApply, ApplyUnchecked };
+
+camelup::GameState replay(const camelup::sim::GameRecord& record, Mode mode) {
+    camelup::Engine engine(static_cast<std::uint32_t>(record.seed));
+    camelup::GameState state = engine.new_game(record.players);
+    for (const auto& action : record.actions) {
+        switch (mode) {
+            case Mode::ApplyAction:
+                state = engine.apply_action(state, action);
+                break;
+            case Mode::TryApply:
+                if (engine.try_apply(state, action) != camelup::ApplyError::None) {
+                    throw std::runtime_error("recorded action refused");
+                }
+                break;
+            case Mode::ApplyUnchecked:
+                engine.apply_unchecked(state, action);
+                break;
+        }
+    }
+    return state;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int seed = 42;
+    int players = 4;
+    int games = 2000;
+    int repeats = 3;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage();
+            return 1;
+        }
+        int parsed = 0;
+        if (!parse_int_arg(argv[++i], parsed) || parsed <= 0) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--seed") {
+            seed = parsed;
+        } else if (arg == "--players") {
+            players = parsed;
+        } else if (arg == "--games") {
+            games = parsed;
+        } else if (arg == "--repeats") {
+            repeats = parsed;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    try {
+        camelup::sim::BatchOptions options;
+        options.seed = seed;
+        options.players = players;
+        options.policy = camelup::sim::Policy::RandomLegal;
+        std::vector<camelup::sim::GameRecord> records(static_cast<std::size_t>(games));
+        std::vector<camelup::GameState> finals;
+        std::uint64_t actions = 0;
+        std::uint64_t rolls = 0;
+        for (int game = 0; game < games; ++game) {
+            auto& record = records[static_cast<std::size_t>(game)];
+            finals.push_back(camelup::sim::play_game(options, game, {}, &record).final_state);
+            actions += record.actions.size();
+            rolls += record.rolls.size();
+        }
+        std::cout << "Games: " << games << " random-policy, " << players << " players, " << actions << " actions ("
+                  << std::fixed << std::setprecision(1) << 100.0 * static_cast<double>(actions - rolls) / actions
+                  << "% non-roll)\n\n";
+
+        std::cout << std::left << std::setw(18) << "mode" << std::right << std::setw(14) << "ns_per_action"
+                  << std::setw(10) << "speedup" << '\n';
+        const std::vector<std::pair<const char*, Mode>> modes = {
+            {"apply_action", Mode::ApplyAction},
+            {"try_apply", Mode::TryApply},
+            {"apply_unchecked", Mode::ApplyUnchecked},
+        };
+        double reference = 0.0;
+        std::vector<camelup::GameState> replayed(records.size());
+        for (const auto& [name, mode] : modes) {
+            double best = 0.0;
+            for (int repeat = 0; repeat < repeats; ++repeat) {
+                const auto start = std::chrono::steady_clock::now();
+                for (std::size_t game = 0; game < records.size(); ++game) {
+                    replayed[game] = replay(records[game], mode);
+                }
+                const double elapsed = std::chrono::duration<double, std::nano>(
+                                           std::chrono::steady_clock::now() - start).count();
+                best = repeat == 0 ? elapsed : std::min(best, elapsed);
+                if (replayed != finals) {
+                    throw std::runtime_error("replay diverged from the played game");
+                }
+            }
+            const double per_action = best / static_cast<double>(actions);
+            if (reference == 0.0) {
+                reference = per_action;
+            }
+            std::cout << std::left << std::setw(18) << name << std::right << std::setw(14) << std::setprecision(1)
+                      << per_action << std::setw(9) << std::setprecision(2) << reference / per_action << "x\n";
+        }
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "camelup_apply_bench failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,212 @@
+// Variance reduction from common random numbers when ranking actions by simulation
+//
+// Every mode is repeated over independent seeds. For each candidate the spread of its estimated
+// gap to the reference leader across trials is the quantity that decides rankings, so the table
+// reports that variance, how often the trial picked the reference leader, and the variance
+// reduction per rollout relative to independent dice.
+
+#include <algorithm>  // max
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "camelup/analysis/common_random.hpp"
+#include "camelup/engine.hpp"
+#include "camelup/rules/legal_actions.hpp"
+#include "camelup/snapshot/action_notation.hpp"
+#include "camelup/snapshot/state_snapshot.hpp"
+
+namespace {
+
+bool parse_int_arg(const char* value, int& out) {
+    char* end = nullptr;
+    const long parsed = std::strtol(value, &end, 10);
+    if (end == value || *end != '\0') {
+        return false;
+    }
+    out = static_cast<int>(parsed);
+    return true;
+}
+
+void print_usage() {
+    std::cout << "Usage: camelup_crn_bench [--seed N] [--players N] [--position NOTATION] [--trials N]\n"
+              << "                         [--rollouts N] [--reference N]\n";
+}
+
+struct Mode {
+    const char* name;
+    int divisor;  // rollouts per candidate are the base count over this
+    bool common_dice;
+    bool antithetic;
+};
+
+struct ModeResult {
+    int rollouts{0};
+    double gap_variance{0.0};
+    double agreement{0.0};
+    double seconds{0.0};
+};
+
+ModeResult run_mode(const camelup::GameState& state, const std::vector<camelup::Action>& candidates,
+                    std::size_t leader, const Mode& mode, int rollouts, int trials) {
+    ModeResult result;
+    result.rollouts = std::max(2, rollouts / mode.divisor);
+
+    // gaps[t][c] is trial t's estimate of candidate c minus the reference leader
+    std::vector<std::vector<double>> gaps(trials, std::vector<double>(candidates.size()));
+    int agreed = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int trial = 0; trial < trials; ++trial) {
+        camelup::analysis::SimulationOptions options;
+        options.rollouts = result.rollouts;
+        options.common_dice = mode.common_dice;
+        options.antithetic = mode.antithetic;
+        options.seed = static_cast<std::uint32_t>(1000 + trial);
+        const auto values = camelup::analysis::compare_actions(state, candidates, options);
+
+        // Map the ranked output back to candidate order through notation
+        std::vector<double> by_candidate(candidates.size());
+        for (const auto& value : values) {
+            const auto token = camelup::snapshot::to_notation(value.action);
+            for (std::size_t c = 0; c < candidates.size(); ++c) {
+                if (camelup::snapshot::to_notation(candidates[c]) == token) {
+                    by_candidate[c] = value.expected_value;
+                }
+            }
+        }
+        for (std::size_t c = 0; c < candidates.size(); ++c) {
+            gaps[trial][c] = by_candidate[c] - by_candidate[leader];
+        }
+        const auto top = camelup::snapshot::to_notation(values.front().action);
+        if (top == camelup::snapshot::to_notation(candidates[leader])) {
+            ++agreed;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.agreement = static_cast<double>(agreed) / trials;
+
+    // Mean over candidates of the across-trial variance of each gap
+    double total = 0.0;
+    for (std::size_t c = 0; c < candidates.size(); ++c) {
+        if (c == leader) {
+            continue;
+        }
+        double mean = 0.0;
+        for (int trial = 0; trial < trials; ++trial) {
+            mean += gaps[trial][c];
+        }
+        mean /= trials;
+        double variance = 0.0;
+        for (int trial = 0; trial < trials; ++trial) {
+            variance += (gaps[trial][c] - mean) * (gaps[trial][c] - mean);
+        }
+        total += variance / std::max(1, trials - 1);
+    }
+    result.gap_variance = candidates.size() > 1 ? total / (candidates.size() - 1) : 0.0;
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int seed = 42;
+    int players = 3;
+    int trials = 20;
+    int rollouts = 200;
+    int reference = 4000;
+    std::string position;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--position") {
+            position = argv[++i];
+            continue;
+        }
+        int parsed = 0;
+        if (!parse_int_arg(argv[++i], parsed) || parsed <= 0) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--seed") {
+            seed = parsed;
+        } else if (arg == "--players") {
+            players = parsed;
+        } else if (arg == "--trials") {
+            trials = parsed;
+        } else if (arg == "--rollouts") {
+            rollouts = parsed;
+        } else if (arg == "--reference") {
+            reference = parsed;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    try {
+        camelup::Engine engine(static_cast<std::uint32_t>(seed));
+        const auto state = position.empty() ? engine.new_game(players) : camelup::snapshot::from_notation(position);
+        const auto candidates = camelup::rules::legal_actions(state);
+        if (candidates.empty()) {
+            std::cerr << "position has no legal actions\n";
+            return 1;
+        }
+
+        // Reference leader from a long shared-dice antithetic run
+        camelup::analysis::SimulationOptions reference_options;
+        reference_options.rollouts = reference;
+        reference_options.antithetic = true;
+        const auto reference_values = camelup::analysis::compare_actions(state, candidates, reference_options);
+        const auto leader_token = camelup::snapshot::to_notation(reference_values.front().action);
+        std::size_t leader = 0;
+        for (std::size_t c = 0; c < candidates.size(); ++c) {
+            if (camelup::snapshot::to_notation(candidates[c]) == leader_token) {
+                leader = c;
+            }
+        }
+
+        std::cout << "Position: " << camelup::snapshot::to_notation(state) << '\n'
+                  << "Candidates: " << candidates.size() << "  reference leader " << leader_token << '='
+                  << reference_values.front().expected_value << " (" << reference << " rollouts)\n\n";
+
+        const std::vector<Mode> modes = {
+            {"independent", 1, false, false},
+            {"common", 1, true, false},
+            {"common", 5, true, false},
+            {"common", 10, true, false},
+            {"common+antithetic", 5, true, true},
+            {"common+antithetic", 10, true, true},
+        };
+
+        std::cout << std::left << std::setw(20) << "mode" << std::right << std::setw(10) << "rollouts"
+                  << std::setw(14) << "gap_var" << std::setw(12) << "top1_agree" << std::setw(16)
+                  << "var_reduction" << std::setw(10) << "seconds" << '\n';
+        double baseline = 0.0;
+        for (const auto& mode : modes) {
+            const auto result = run_mode(state, candidates, leader, mode, rollouts, trials);
+            // Normalised per rollout so fewer-rollout modes are compared at equal cost
+            const double cost_variance = result.gap_variance * result.rollouts;
+            if (baseline == 0.0) {
+                baseline = cost_variance;
+            }
+            std::cout << std::left << std::setw(20) << mode.name << std::right << std::setw(10) << result.rollouts
+                      << std::setw(14) << std::setprecision(4) << result.gap_variance << std::setw(12)
+                      << result.agreement << std::setw(15) << std::setprecision(3)
+                      << (cost_variance > 0.0 ? baseline / cost_variance : 0.0) << 'x' << std::setw(10)
+                      << result.seconds << '\n';
+        }
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "camelup_crn_bench failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,171 @@
+// Cost of consuming games through the coroutine stream against play_game with an observer
+//
+// Every mode plays the same random-policy games and touches each action, so the difference is
+// the stream itself: creating a coroutine per game and resuming it per action.
+// Heap allocations are counted by replacing the global operator new and reported per step.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "camelup/sim/batch.hpp"
+#include "camelup/sim/game_stream.hpp"
+
+namespace {
+
+std::atomic<std::uint64_t> allocations{0};
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+
+bool parse_int_arg(const char* value, int& out) {
+    char* end = nullptr;
+    const long parsed = std::strtol(value, &end, 10);
+    if (end == value || *end != '\0') {
+        return false;
+    }
+    out = static_cast<int>(parsed);
+    return true;
+}
+
+void print_usage() {
+    std::cout << "Usage: camelup_game_stream_bench [--seed N] [--players N] [--games N] [--width N]\n";
+}
+
+struct Run {
+    std::uint64_t steps{0};
+    std::uint64_t checksum{0};  // keeps the consumer observable
+    std::uint64_t allocations{0};
+    double seconds{0.0};
+};
+
+template <typename Fn>
+Run measure(Fn&& fn) {
+    Run run;
+    const std::uint64_t before = allocations.load(std::memory_order_relaxed);
+    const auto start = std::chrono::steady_clock::now();
+    fn(run);
+    run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    run.allocations = allocations.load(std::memory_order_relaxed) - before;
+    return run;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int seed = 42;
+    int players = 4;
+    int games = 2000;
+    int width = 64;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage();
+            return 1;
+        }
+        int parsed = 0;
+        if (!parse_int_arg(argv[++i], parsed) || parsed <= 0) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--seed") {
+            seed = parsed;
+        } else if (arg == "--players") {
+            players = parsed;
+        } else if (arg == "--games") {
+            games = parsed;
+        } else if (arg == "--width") {
+            width = parsed;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    try {
+        camelup::sim::BatchOptions options;
+        options.seed = seed;
+        options.players = players;
+        options.games = games;
+        options.policy = camelup::sim::Policy::RandomLegal;
+
+        const auto observed = measure([&](Run& run) {
+            for (int game = 0; game < games; ++game) {
+                camelup::sim::play_game(options, game,
+                                        [&](const camelup::GameState& state, const camelup::Action&, int) {
+                                            ++run.steps;
+                                            run.checksum += state.current_player;
+                                        });
+            }
+        });
+        const auto streamed = measure([&](Run& run) {
+            for (int game = 0; game < games; ++game) {
+                for (const auto& step : camelup::sim::game_steps(options, game)) {
+                    if (step.action != nullptr) {
+                        ++run.steps;
+                        run.checksum += step.state->current_player;
+                    }
+                }
+            }
+        });
+        const auto interleaved = measure([&](Run& run) {
+            for (const auto& step : camelup::sim::interleaved_steps(options, width)) {
+                if (step.action != nullptr) {
+                    ++run.steps;
+                    run.checksum += step.state->current_player;
+                }
+            }
+        });
+        if (streamed.steps != observed.steps || streamed.checksum != observed.checksum ||
+            interleaved.steps != observed.steps || interleaved.checksum != observed.checksum) {
+            throw std::runtime_error("streamed games differ from play_game");
+        }
+
+        std::cout << "Games: " << games << " random-policy, " << players << " players, " << observed.steps
+                  << " steps, interleave width " << width << "\n\n";
+        std::cout << std::left << std::setw(14) << "mode" << std::right << std::setw(12) << "ns_per_step"
+                  << std::setw(16) << "allocs_per_game" << std::setw(16) << "allocs_per_step" << '\n';
+        const std::pair<const char*, const Run*> rows[] = {
+            {"play_game", &observed},
+            {"game_steps", &streamed},
+            {"interleaved", &interleaved},
+        };
+        for (const auto& [name, run] : rows) {
+            std::cout << std::left << std::setw(14) << name << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(12) << run->seconds * 1e9 / static_cast<double>(run->steps) << std::setw(16)
+                      << static_cast<double>(run->allocations) / games << std::setw(16) << std::setprecision(3)
+                      << static_cast<double>(run->allocations) / static_cast<double>(run->steps) << '\n';
+        }
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "camelup_game_stream_bench failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
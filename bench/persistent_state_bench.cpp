@@ -0,0 +1,213 @@
+// Memory per search tree node: full GameState copies against structurally shared PersistentState
+//
+// Random games are walked down the tree: every visited state is expanded into one child per
+// non-roll action and one per roll outcome (each die in the pyramid, distances 1..3), the fan an
+// expectimax tree stores, and the walk continues from a random child. Both trees hold the same
+// nodes. Live heap bytes are tracked by replacing the global operator new and
+// delete (glibc malloc_usable_size), so bytes per node are the node object plus the heap it
+// keeps alive, shared blocks counted once.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <malloc.h>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "camelup/engine.hpp"
+#include "camelup/persistent_state.hpp"
+
+namespace {
+
+std::uint64_t live_bytes = 0;
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        live_bytes += malloc_usable_size(memory);
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    if (memory != nullptr) {
+        live_bytes -= malloc_usable_size(memory);
+    }
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    operator delete(memory);
+}
+
+namespace {
+
+bool parse_int_arg(const char* value, int& out) {
+    char* end = nullptr;
+    const long parsed = std::strtol(value, &end, 10);
+    if (end == value || *end != '\0') {
+        return false;
+    }
+    out = static_cast<int>(parsed);
+    return true;
+}
+
+void print_usage() {
+    std::cout << "Usage: camelup_persistent_state_bench [--seed N] [--players N] [--games N]\n";
+}
+
+struct Tree {
+    std::uint64_t nodes{0};
+    std::uint64_t heap_bytes{0};
+    std::size_t node_bytes{0};
+    double seconds{0.0};
+
+    [[nodiscard]] double bytes_per_node() const {
+        return static_cast<double>(heap_bytes) / static_cast<double>(nodes) + static_cast<double>(node_bytes);
+    }
+};
+
+// A child of a tree node: a non-roll action or one outcome of the roll action
+struct Move {
+    camelup::Action action;
+    camelup::DieRoll roll;
+};
+
+std::vector<Move> moves_of(camelup::Engine& engine, const camelup::GameState& state) {
+    std::vector<Move> moves;
+    for (const auto& action : engine.legal_actions(state)) {
+        if (action.type() != camelup::ActionType::RollDie) {
+            moves.push_back({action, {}});
+            continue;
+        }
+        for (camelup::CamelId camel = 0; camel < static_cast<camelup::CamelId>(camelup::kCamelCount); ++camel) {
+            for (int distance = 1; distance <= 3 && state.die_available[camel]; ++distance) {
+                moves.push_back({action, {camel, distance}});
+            }
+        }
+    }
+    return moves;
+}
+
+camelup::GameState play(camelup::Engine& engine, const camelup::GameState& state, const Move& move) {
+    return move.action.type() == camelup::ActionType::RollDie ? camelup::Engine::apply_roll(state, move.roll)
+                                                              : engine.apply_action(state, move.action);
+}
+
+// Expand along `games` random walks, `expand` pushes the child of nodes[parent] for one move
+template <typename Node, typename Expand>
+Tree build(int seed, int players, int games, std::vector<Node>& nodes, Expand&& expand) {
+    Tree tree;
+    tree.node_bytes = sizeof(Node);
+    const std::uint64_t before = live_bytes;
+    const auto start = std::chrono::steady_clock::now();
+    camelup::Engine engine(static_cast<std::uint32_t>(seed));
+    camelup::Engine walk(static_cast<std::uint32_t>(seed));
+    std::mt19937 rng(static_cast<std::uint32_t>(seed));
+    for (int game = 0; game < games; ++game) {
+        auto state = walk.new_game(players);
+        std::size_t parent = nodes.size();
+        nodes.push_back(Node(state));
+        while (!state.terminal) {
+            const auto moves = moves_of(walk, state);
+            const std::size_t first = nodes.size();
+            for (const auto& move : moves) {
+                expand(engine, nodes, parent, move);
+            }
+            const auto pick = std::uniform_int_distribution<std::size_t>(0, moves.size() - 1)(rng);
+            state = play(walk, state, moves[pick]);
+            parent = first + pick;
+        }
+    }
+    tree.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    tree.nodes = nodes.size();
+    // The node array itself is counted as sizeof per node
+    tree.heap_bytes = live_bytes - before - malloc_usable_size(nodes.data());
+    return tree;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int seed = 42;
+    int players = 4;
+    int games = 20;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage();
+            return 1;
+        }
+        int parsed = 0;
+        if (!parse_int_arg(argv[++i], parsed) || parsed <= 0) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--seed") {
+            seed = parsed;
+        } else if (arg == "--players") {
+            players = parsed;
+        } else if (arg == "--games") {
+            games = parsed;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    try {
+        std::vector<camelup::GameState> full;
+        const auto full_tree = build(seed, players, games, full,
+                                     [](camelup::Engine& engine, std::vector<camelup::GameState>& nodes,
+                                        std::size_t parent, const Move& move) {
+                                         nodes.push_back(play(engine, nodes[parent], move));
+                                     });
+
+        std::vector<camelup::PersistentState> shared;
+        const auto shared_tree = build(seed, players, games, shared,
+                                       [](camelup::Engine& engine, std::vector<camelup::PersistentState>& nodes,
+                                          std::size_t parent, const Move& move) {
+                                           const auto& node = nodes[parent];
+                                           nodes.push_back(
+                                               move.action.type() == camelup::ActionType::RollDie
+                                                   ? node.derive(camelup::Engine::apply_roll(node.materialise(),
+                                                                                             move.roll))
+                                                   : node.apply(engine, move.action));
+                                       });
+
+        if (full.size() != shared.size()) {
+            throw std::runtime_error("trees differ in size");
+        }
+        for (std::size_t i = 0; i < full.size(); ++i) {
+            if (shared[i].materialise() != full[i]) {
+                throw std::runtime_error("persistent node differs from its full state");
+            }
+        }
+
+        std::cout << "Tree: " << full_tree.nodes << " nodes from " << games << " random walks, " << players
+                  << " players\n\n";
+        std::cout << std::left << std::setw(18) << "node" << std::right << std::setw(12) << "sizeof"
+                  << std::setw(16) << "bytes_per_node" << std::setw(14) << "ns_per_node" << std::setw(10) << "ratio"
+                  << '\n';
+        for (const auto* tree : {&full_tree, &shared_tree}) {
+            std::cout << std::left << std::setw(18) << (tree == &full_tree ? "GameState" : "PersistentState")
+                      << std::right << std::setw(12) << tree->node_bytes << std::fixed << std::setprecision(1)
+                      << std::setw(16) << tree->bytes_per_node() << std::setw(14)
+                      << tree->seconds * 1e9 / static_cast<double>(tree->nodes) << std::setw(9)
+                      << std::setprecision(2) << full_tree.bytes_per_node() / tree->bytes_per_node() << "x\n";
+        }
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "camelup_persistent_state_bench failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,158 @@
+// Policy memo hit rates and time per game on typical rollout workloads
+//
+// Each workload plays the same games with the memo off and on: seeded openings, rollouts from
+// a mid-game position and rollouts from a late position where one camel is near the finish.
+// Rollouts from one position with a deterministic policy only branch on the dice, so they
+// revisit states; independent openings rarely do. Outcomes must match with the memo on.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "camelup/engine.hpp"
+#include "camelup/sim/batch.hpp"
+#include "camelup/sim/policy_memo.hpp"
+
+namespace {
+
+bool parse_int_arg(const char* value, int& out) {
+    char* end = nullptr;
+    const long parsed = std::strtol(value, &end, 10);
+    if (end == value || *end != '\0') {
+        return false;
+    }
+    out = static_cast<int>(parsed);
+    return true;
+}
+
+void print_usage() {
+    std::cout << "Usage: camelup_policy_memo_bench [--seed N] [--players N] [--games N]\n";
+}
+
+int leading_tile(const camelup::GameState& state) {
+    for (int tile = camelup::kBoardTiles - 1; tile >= 0; --tile) {
+        if (!state.board[tile].empty()) {
+            return tile;
+        }
+    }
+    return 0;
+}
+
+// First state of a random game where the leader has reached `tile`
+camelup::GameState position_at(int seed, int players, int tile) {
+    camelup::Engine engine(static_cast<std::uint32_t>(seed));
+    std::mt19937 rng(static_cast<std::uint32_t>(seed));
+    while (true) {
+        auto state = engine.new_game(players);
+        while (!state.terminal) {
+            if (leading_tile(state) >= tile) {
+                return state;
+            }
+            const auto legal = engine.legal_actions(state);
+            const auto pick = std::uniform_int_distribution<std::size_t>(0, legal.size() - 1)(rng);
+            state = engine.apply_action(state, legal[pick]);
+        }
+    }
+}
+
+struct Run {
+    double ms_per_game{0.0};
+    std::vector<camelup::GameState> finals;
+};
+
+Run play(const camelup::sim::BatchOptions& options) {
+    Run run;
+    const auto start = std::chrono::steady_clock::now();
+    for (int game = 0; game < options.games; ++game) {
+        run.finals.push_back(camelup::sim::play_game(options, game).final_state);
+    }
+    run.ms_per_game = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() /
+                      options.games;
+    return run;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int seed = 42;
+    int players = 4;
+    int games = 20;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage();
+            return 1;
+        }
+        int parsed = 0;
+        if (!parse_int_arg(argv[++i], parsed) || parsed <= 0) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--seed") {
+            seed = parsed;
+        } else if (arg == "--players") {
+            players = parsed;
+        } else if (arg == "--games") {
+            games = parsed;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    try {
+        struct Workload {
+            const char* name;
+            std::optional<camelup::GameState> start;
+        };
+        const Workload workloads[] = {
+            {"openings", std::nullopt},
+            {"mid-game", position_at(seed, players, 8)},
+            {"endgame", position_at(seed, players, 13)},
+        };
+
+        std::cout << "Games: " << games << " per workload, " << players << " players\n\n";
+        std::cout << std::left << std::setw(10) << "workload" << std::setw(8) << "policy" << std::right
+                  << std::setw(10) << "hit_rate" << std::setw(12) << "ms_off" << std::setw(12) << "ms_on"
+                  << std::setw(10) << "speedup" << '\n';
+        for (const auto& workload : workloads) {
+            for (const auto policy : {camelup::sim::Policy::FirstLegal, camelup::sim::Policy::Greedy}) {
+                camelup::sim::BatchOptions options;
+                options.seed = seed;
+                options.players = players;
+                options.games = games;
+                options.policy = policy;
+                options.start = workload.start;
+
+                camelup::sim::policy_memo::disable();
+                const auto off = play(options);
+                camelup::sim::policy_memo::enable();
+                const auto on = play(options);
+                const auto memo = camelup::sim::policy_memo::stats();
+                camelup::sim::policy_memo::disable();
+                if (on.finals != off.finals) {
+                    throw std::runtime_error("memoised games differ");
+                }
+
+                std::cout << std::left << std::setw(10) << workload.name << std::setw(8)
+                          << camelup::sim::policy_name(policy) << std::right << std::fixed << std::setprecision(3)
+                          << std::setw(10) << memo.hit_rate() << std::setw(12) << off.ms_per_game << std::setw(12)
+                          << on.ms_per_game << std::setw(9) << std::setprecision(2)
+                          << off.ms_per_game / on.ms_per_game << "x\n";
+            }
+        }
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "camelup_policy_memo_bench failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,121 @@
+// Convergence of race winner and loser probabilities, Monte Carlo against randomised QMC
+//
+// Each sampler runs at several sample counts over independent seeds. The error of one run is
+// the RMS over camels of its winner and loser probabilities against a long QMC reference run,
+// so the table shows error against CPU time for both samplers.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "camelup/analysis/race_odds.hpp"
+#include "camelup/engine.hpp"
+#include "camelup/snapshot/state_snapshot.hpp"
+
+namespace {
+
+bool parse_int_arg(const char* value, int& out) {
+    char* end = nullptr;
+    const long parsed = std::strtol(value, &end, 10);
+    if (end == value || *end != '\0') {
+        return false;
+    }
+    out = static_cast<int>(parsed);
+    return true;
+}
+
+void print_usage() {
+    std::cout << "Usage: camelup_qmc_bench [--seed N] [--players N] [--position NOTATION] [--trials N]\n"
+              << "                         [--reference N]\n";
+}
+
+double rms_error(const camelup::analysis::RaceOdds& odds, const camelup::analysis::RaceOdds& reference) {
+    double total = 0.0;
+    for (int camel = 0; camel < camelup::kCamelCount; ++camel) {
+        total += std::pow(odds.winner[camel] - reference.winner[camel], 2.0);
+        total += std::pow(odds.loser[camel] - reference.loser[camel], 2.0);
+    }
+    return std::sqrt(total / (2 * camelup::kCamelCount));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int seed = 42;
+    int players = 3;
+    int trials = 16;
+    int reference_samples = 1 << 16;
+    std::string position;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--position") {
+            position = argv[++i];
+            continue;
+        }
+        int parsed = 0;
+        if (!parse_int_arg(argv[++i], parsed) || parsed <= 0) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--seed") {
+            seed = parsed;
+        } else if (arg == "--players") {
+            players = parsed;
+        } else if (arg == "--trials") {
+            trials = parsed;
+        } else if (arg == "--reference") {
+            reference_samples = parsed;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    try {
+        camelup::Engine engine(static_cast<std::uint32_t>(seed));
+        const auto state = position.empty() ? engine.new_game(players) : camelup::snapshot::from_notation(position);
+        const auto reference = camelup::analysis::race_odds(state, reference_samples, 7,
+                                                            camelup::analysis::RaceSampler::Qmc);
+        std::cout << "Position: " << camelup::snapshot::to_notation(state) << '\n'
+                  << "Reference: " << reference_samples << " QMC samples\n\n";
+
+        std::cout << std::left << std::setw(10) << "sampler" << std::right << std::setw(10) << "samples"
+                  << std::setw(14) << "rms_error" << std::setw(14) << "ms_per_run" << '\n';
+        const std::vector<std::pair<const char*, camelup::analysis::RaceSampler>> samplers = {
+            {"random", camelup::analysis::RaceSampler::Random},
+            {"qmc", camelup::analysis::RaceSampler::Qmc},
+        };
+        for (const int samples : {256, 1024, 4096}) {
+            for (const auto& [name, sampler] : samplers) {
+                double squared = 0.0;
+                const auto start = std::chrono::steady_clock::now();
+                for (int trial = 0; trial < trials; ++trial) {
+                    const auto odds = camelup::analysis::race_odds(state, samples,
+                                                                   static_cast<std::uint32_t>(1000 + trial), sampler);
+                    squared += std::pow(rms_error(odds, reference), 2.0);
+                }
+                const double elapsed = std::chrono::duration<double, std::milli>(
+                                           std::chrono::steady_clock::now() - start).count();
+                std::cout << std::left << std::setw(10) << name << std::right << std::setw(10) << samples
+                          << std::setw(14) << std::setprecision(4) << std::sqrt(squared / trials) << std::setw(14)
+                          << elapsed / trials << '\n';
+            }
+        }
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "camelup_qmc_bench failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,163 @@
+// Size and speed of the game record codec against raw byte-packed records
+//
+// Games of each policy are recorded once, then encoded and decoded in blocks of the pipeline's
+// batch size. Sizes are bytes per game, speeds are per game and as raw-record bytes per second,
+// next to a plain memcpy of the raw records as the memory bandwidth reference.
+
+#include <algorithm>  // max
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "camelup/sim/batch.hpp"
+#include "camelup/sim/game_record.hpp"
+#include "camelup/sim/record_codec.hpp"
+
+namespace {
+
+bool parse_int_arg(const char* value, int& out) {
+    char* end = nullptr;
+    const long parsed = std::strtol(value, &end, 10);
+    if (end == value || *end != '\0') {
+        return false;
+    }
+    out = static_cast<int>(parsed);
+    return true;
+}
+
+void print_usage() {
+    std::cout << "Usage: camelup_record_codec_bench [--seed N] [--players N] [--games N] [--block N]\n";
+}
+
+// Run `fn` until at least 0.2 s passed, return seconds per call
+template <typename Fn>
+double time_per_call(Fn&& fn) {
+    int calls = 0;
+    const auto start = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    do {
+        fn();
+        ++calls;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < 0.2);
+    return elapsed / calls;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int seed = 42;
+    int players = 4;
+    int games = 20000;
+    int block = 256;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage();
+            return 1;
+        }
+        int parsed = 0;
+        if (!parse_int_arg(argv[++i], parsed) || parsed <= 0) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--seed") {
+            seed = parsed;
+        } else if (arg == "--players") {
+            players = parsed;
+        } else if (arg == "--games") {
+            games = parsed;
+        } else if (arg == "--block") {
+            block = parsed;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    try {
+        std::cout << "Games: " << games << " per policy, " << players << " players, blocks of " << block << "\n\n";
+        std::cout << std::left << std::setw(8) << "policy" << std::right << std::setw(10) << "actions" << std::setw(10)
+                  << "raw_B" << std::setw(10) << "codec_B" << std::setw(8) << "ratio" << std::setw(12) << "enc_ns"
+                  << std::setw(12) << "dec_ns" << std::setw(12) << "dec_MB/s" << std::setw(12) << "copy_MB/s"
+                  << '\n';
+
+        for (const auto policy :
+             {camelup::sim::Policy::RollOnly, camelup::sim::Policy::FirstLegal, camelup::sim::Policy::RandomLegal}) {
+            camelup::sim::BatchOptions options;
+            options.seed = seed;
+            options.players = players;
+            options.policy = policy;
+            std::vector<std::vector<camelup::sim::GameRecord>> blocks;
+            std::uint64_t actions = 0;
+            for (int game = 0; game < games; ++game) {
+                if (game % block == 0) {
+                    blocks.emplace_back();
+                }
+                camelup::sim::GameRecord record;
+                camelup::sim::play_game(options, game, {}, &record);
+                actions += record.actions.size();
+                blocks.back().push_back(std::move(record));
+            }
+
+            std::vector<std::uint8_t> raw;
+            for (const auto& records : blocks) {
+                for (const auto& record : records) {
+                    camelup::sim::append_record(raw, record);
+                }
+            }
+            std::vector<std::vector<std::uint8_t>> encoded(blocks.size());
+            const double encode_seconds = time_per_call([&]() {
+                for (std::size_t i = 0; i < blocks.size(); ++i) {
+                    encoded[i].clear();
+                    camelup::sim::encode_records(blocks[i], encoded[i]);
+                }
+            });
+            std::uint64_t codec_bytes = 0;
+            for (const auto& bytes : encoded) {
+                codec_bytes += bytes.size();
+            }
+
+            std::vector<camelup::sim::GameRecord> decoded;
+            const double decode_seconds = time_per_call([&]() {
+                for (const auto& bytes : encoded) {
+                    camelup::sim::decode_records(bytes.data(), bytes.size(), decoded);
+                }
+            });
+            for (std::size_t i = 0; i < blocks.size(); ++i) {
+                camelup::sim::decode_records(encoded[i].data(), encoded[i].size(), decoded);
+                if (decoded != blocks[i]) {
+                    throw std::runtime_error("codec round trip mismatch");
+                }
+            }
+
+            std::vector<std::uint8_t> copy(raw.size());
+            const double copy_seconds = time_per_call([&]() {
+                std::memcpy(copy.data(), raw.data(), raw.size());
+                // Keep the copy observable
+                copy[0] = static_cast<std::uint8_t>(copy[0] + 1);
+            });
+
+            const double raw_mb = static_cast<double>(raw.size()) / 1e6;
+            std::cout << std::left << std::setw(8) << camelup::sim::policy_name(policy) << std::right << std::fixed
+                      << std::setprecision(1) << std::setw(10) << static_cast<double>(actions) / games << std::setw(10)
+                      << static_cast<double>(raw.size()) / games << std::setw(10)
+                      << static_cast<double>(codec_bytes) / games << std::setw(8)
+                      << static_cast<double>(raw.size()) / static_cast<double>(std::max<std::uint64_t>(codec_bytes, 1))
+                      << std::setw(12) << encode_seconds * 1e9 / games << std::setw(12)
+                      << decode_seconds * 1e9 / games << std::setw(12) << std::setprecision(0)
+                      << raw_mb / decode_seconds << std::setw(12) << raw_mb / copy_seconds << '\n';
+        }
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "camelup_record_codec_bench failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
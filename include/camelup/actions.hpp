@@ -14,28 +14,48 @@ enum class ActionType {
     BetLoser
 };
 
+inline constexpr int kActionTypeCount = static_cast<int>(ActionType::BetLoser) + 1;
+
 // Roll one available die and move the corresponding camel stack
-struct RollDiePayload {};
+struct RollDiePayload {
+    bool operator==(const RollDiePayload&) const = default;
+};
 
 // Place a desert tile at `tile` with movement effect `move_delta` (+1 or -1 in full rules)
 struct PlaceDesertTilePayload {
     int tile{-1};
     int move_delta{1};
+
+    bool operator==(const PlaceDesertTilePayload&) const = default;
 };
 
 // Take a leg betting ticket for the specified camel
 struct TakeLegTicketPayload {
     CamelId camel{0};
+
+    bool operator==(const TakeLegTicketPayload&) const = default;
 };
 
 // Place a game winner bet card for the specified camel
 struct BetWinnerPayload {
     CamelId camel{0};
+
+    bool operator==(const BetWinnerPayload&) const = default;
 };
 
 // Place a game loser bet card for the specified camel
 struct BetLoserPayload {
     CamelId camel{0};
+
+    bool operator==(const BetLoserPayload&) const = default;
+};
+
+// Outcome of one die roll: the camel whose die left the pyramid and the 1..3 distance shown
+struct DieRoll {
+    CamelId camel{0};
+    int distance{1};
+
+    bool operator==(const DieRoll&) const = default;
 };
 
 // Tagged payload for all action-specific data
@@ -88,6 +108,8 @@ struct Action {
     }
     static Action bet_winner(CamelId camel) noexcept { return Action(BetWinnerPayload{camel}); }
     static Action bet_loser(CamelId camel) noexcept { return Action(BetLoserPayload{camel}); }
+
+    bool operator==(const Action&) const = default;
 };
 
 }  // namespace camelup
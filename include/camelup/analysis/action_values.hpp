@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "camelup/actions.hpp"
+#include "camelup/analysis/anytime.hpp"
+#include "camelup/analysis/leg_odds.hpp"
+#include "camelup/analysis/race_odds.hpp"
+#include "camelup/game_state.hpp"
+#include "camelup/util/thread_pool.hpp"
+
+namespace camelup::analysis {
+
+// Immediate expected coin gain of one action for the player about to move
+struct ActionValue {
+    Action action;
+    double expected_value{0.0};
+};
+
+// Value a single legal action
+// Ticket and bet values come from the supplied odds, desert tiles re-enumerate the leg with the
+// tile in place and report the change in the mover's expected desert coins
+ActionValue evaluate_action(const GameState& state, const Action& action, const LegOdds& leg, const RaceOdds& race);
+
+// Value every legal action in turn and sort best first, ties keep legal generator order
+std::vector<ActionValue> rank_actions(const GameState& state, const LegOdds& leg, const RaceOdds& race);
+
+// Action value with the spread of the coins it pays
+struct ActionEstimate {
+    Action action;
+    double expected_value{0.0};
+    double variance{0.0};
+    bool exact{true};  // false for a desert tile valued from landing odds after the deadline passed
+};
+
+// Value every legal action with its variance, best first, ties keep legal generator order
+//
+// `leg` is the shared prefix: rolls, tickets and bets are valued from it on the calling thread.
+// Each desert tile candidate re-enumerates the leg with its tile in place, fanned out over
+// `pool` with the calling thread pulling candidates too, so a busy pool only costs parallelism.
+// A candidate not started by `deadline` is estimated from `leg.landings` instead; started
+// enumerations run to completion, a few milliseconds at most.
+//
+// Variances are over the leg outcomes for tickets, the race winner or loser for bets and the
+// mover's desert coins for the leg with the tile placed.
+std::vector<ActionEstimate> analyse_actions(
+    const GameState& state, const LegOdds& leg, const RaceOdds& race, util::ThreadPool& pool,
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+// Anytime action ranking for callers with a per-move time budget
+//
+// Leg odds and every value that does not depend on the race are computed once up front. Only
+// winner and loser bets depend on sampled race odds, so refining extends the race estimator and
+// the decision is settled once the best action's interval clears every other action's interval.
+class AnytimeActionSearch final : public AnytimeEstimator {
+public:
+    AnytimeActionSearch(const GameState& state, std::uint32_t seed);
+    // Same, reusing leg odds the caller already has for `state`
+    AnytimeActionSearch(const GameState& state, const LegOdds& leg, std::uint32_t seed);
+
+    void refine(int samples) override;
+    [[nodiscard]] int samples() const override;
+    // Interval width on the value of the currently best action
+    [[nodiscard]] double ci_width(double z) const override;
+    [[nodiscard]] bool decided(double z) const override;
+
+    // Current ranking, best first
+    [[nodiscard]] std::vector<ActionValue> interim() const;
+    // The race estimator behind the bet values
+    [[nodiscard]] const RaceOddsEstimator& race() const noexcept { return race_; }
+
+private:
+    struct Candidate {
+        Action action;
+        double exact_value{0.0};  // used when the value does not depend on race odds
+        bool race_dependent{false};
+        bool loser_bet{false};
+        CamelId camel{0};
+        int payout{0};
+    };
+
+    struct Bounds {
+        double value{0.0};
+        double low{0.0};
+        double high{0.0};
+    };
+
+    GameState root_;
+    RaceOddsEstimator race_;
+    std::vector<Candidate> candidates_;
+
+    [[nodiscard]] std::vector<Bounds> bounds(double z) const;
+};
+
+}  // namespace camelup::analysis
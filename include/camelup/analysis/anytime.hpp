@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+namespace camelup::analysis {
+
+// Common interface for sampling estimators that improve the longer they run
+//
+// refine() adds samples and may run on a worker thread while other threads read interim
+// results, implementations guard their accumulators so polling is always safe.
+class AnytimeEstimator {
+public:
+    virtual ~AnytimeEstimator() = default;
+
+    virtual void refine(int samples) = 0;
+    [[nodiscard]] virtual int samples() const = 0;
+
+    // Width of the confidence interval on the quantity the caller decides on, at normal quantile z
+    [[nodiscard]] virtual double ci_width(double z) const = 0;
+
+    // True once more samples cannot change the decision at this confidence
+    [[nodiscard]] virtual bool decided(double /*z*/) const { return false; }
+};
+
+struct AnytimeBudget {
+    std::chrono::steady_clock::time_point deadline{std::chrono::steady_clock::time_point::max()};
+    int max_samples{100000};
+    int min_samples{100};     // intervals from fewer samples are not trusted for stopping
+    int batch_samples{64};    // samples per refine call, also the deadline check granularity
+    double target_ci_width{0.0};  // 0 disables width-based stopping
+    double z{1.96};
+};
+
+enum class AnytimeStop {
+    TargetWidth,
+    Decided,
+    SampleBudget,
+    Deadline,
+    Cancelled
+};
+
+struct AnytimeReport {
+    AnytimeStop reason{AnytimeStop::SampleBudget};
+    int samples{0};
+    double ci_width{0.0};
+};
+
+// Budget ending `time_budget` from now
+AnytimeBudget budget_within(std::chrono::nanoseconds time_budget, int max_samples = 100000);
+
+// Refine in batches until the interval is tight enough, the decision is settled, the sample
+// budget or deadline is reached, or `cancel` is raised
+AnytimeReport run_anytime(AnytimeEstimator& estimator, const AnytimeBudget& budget,
+                          const std::atomic<bool>* cancel = nullptr);
+
+struct Interval {
+    double low{0.0};
+    double high{1.0};
+
+    [[nodiscard]] double width() const noexcept { return high - low; }
+};
+
+// Wilson score interval for a proportion, well behaved near 0 and 1, [0, 1] without samples
+Interval wilson_interval(double successes, double samples, double z);
+
+}  // namespace camelup::analysis
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "camelup/actions.hpp"
+#include "camelup/game_state.hpp"
+#include "camelup/types.hpp"
+
+namespace camelup::analysis {
+
+// Pre-drawn dice for one leg: the order camels leave the pyramid and each camel's distance
+//
+// A partly played leg takes the first still-available camels in `order`, so states that
+// diverge inside a leg still see the same distance for the same camel.
+struct LegDice {
+    std::array<CamelId, kCamelCount> order{};
+    std::array<int, kCamelCount> distance{};
+};
+
+// Shared dice for one simulated race, leg by leg, reused cyclically if a race outlasts it
+using DiceStream = std::vector<LegDice>;
+
+// Enough legs for any race, every camel moves at least one tile per leg without desert tiles
+inline constexpr int kDiceStreamLegs = kBoardTiles;
+
+DiceStream draw_dice_stream(std::mt19937& rng, int legs = kDiceStreamLegs);
+
+// Mirror stream: reversed leave order and distance 4 - d, negatively correlated with `stream`
+DiceStream antithetic(const DiceStream& stream);
+
+// The roll `leg` dictates next for `state`
+DieRoll next_roll(const GameState& state, const LegDice& leg);
+
+// Roll only until the race ends, taking every outcome from `stream`
+GameState play_out(const GameState& state, const DiceStream& stream);
+
+// Coins the mover gains by taking `action` and letting the race play out on `stream`
+// A roll action takes its outcome from the stream as well
+double simulate_action(const GameState& state, const Action& action, const DiceStream& stream);
+
+struct SimulationOptions {
+    int rollouts{200};          // rollouts per candidate, antithetic pairs count as two
+    bool common_dice{true};     // every candidate sees the same streams
+    bool antithetic{false};     // average each stream with its mirror, one sample per pair
+    std::uint32_t seed{1};
+};
+
+struct SimulatedValue {
+    Action action;
+    double expected_value{0.0};
+    // Standard error of (this value - leader value), paired when the dice are shared
+    double gap_std_error{0.0};
+};
+
+// Simulated values for `candidates`, best first, ties keep candidate order
+std::vector<SimulatedValue> compare_actions(const GameState& state, const std::vector<Action>& candidates,
+                                            const SimulationOptions& options);
+
+// compare_actions over every legal action
+std::vector<SimulatedValue> rank_actions_simulated(const GameState& state, const SimulationOptions& options);
+
+}  // namespace camelup::analysis
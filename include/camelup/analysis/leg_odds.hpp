@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "camelup/game_state.hpp"
+#include "camelup/types.hpp"
+
+namespace camelup::analysis {
+
+// Exact outcome distribution for the rest of the current leg
+//
+// Every order of the remaining dice and every 1..3 distance is enumerated with equal weight.
+// Leg tickets are only scored when the leg completes, so `first` and `second` cover completed
+// legs and `race_end` is the probability that a camel finishes before the pyramid is empty.
+struct LegOdds {
+    std::array<double, kCamelCount> first{};
+    std::array<double, kCamelCount> second{};
+    std::array<double, kCamelCount> race_winner{};  // leader when the race ends inside this leg
+    double race_end{0.0};
+    // Expected desert tile coins each player collects before the leg ends
+    std::array<double, kMaxPlayers> desert_coins{};
+    // Expected number of stack landings on each tile before the leg ends, after desert moves
+    std::array<double, kBoardTiles> landings{};
+    std::uint64_t outcomes{0};
+};
+
+LegOdds leg_odds(const GameState& state);
+
+// Mean and variance of the desert coins one player collects over the rest of the leg
+struct CoinMoments {
+    double mean{0.0};
+    double variance{0.0};
+};
+
+// Same enumeration as leg_odds, carrying the player's coin count down to every outcome
+CoinMoments desert_coin_moments(const GameState& state, PlayerId player);
+
+}  // namespace camelup::analysis
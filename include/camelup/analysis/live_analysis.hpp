@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "camelup/analysis/action_values.hpp"
+#include "camelup/analysis/leg_odds.hpp"
+#include "camelup/analysis/race_odds.hpp"
+#include "camelup/game_state.hpp"
+
+namespace camelup::analysis {
+
+// One published stage of a live analysis
+struct LiveSnapshot {
+    std::uint64_t generation{0};  // the analyse() call this belongs to
+    LegOdds leg;
+    RaceOdds race;                     // zero samples until the first race stage
+    std::vector<ActionValue> actions;  // best first, empty in the leg-only first stage
+    double race_ci_width{1.0};         // widest winner or loser interval at 95%
+    bool final{false};                 // nothing more comes for this generation
+};
+
+struct LiveAnalysisOptions {
+    std::uint32_t seed{0x11FE};
+    int first_race_samples{512};  // first race stage, each later stage has `stage_growth` times more
+    int stage_growth{8};
+    int max_race_samples{32768};  // the final stage
+    int batch_samples{128};       // race samples between cancellation checks
+};
+
+// Background analysis of the position a player is looking at
+//
+// analyse() hands a state to a worker thread and returns at once. The worker publishes the
+// exact leg odds first, then per-action values with race odds from a growing number of
+// rollouts (AnytimeActionSearch), one stage at a time until max_race_samples. A later
+// analyse() or cancel() abandons the running analysis at its next check: between stages,
+// after each race batch, or once the exact action values of the new state are complete.
+//
+// `publish` runs on the worker thread without any LiveAnalysis lock held. A snapshot can
+// still arrive just after analyse() or cancel() returned, so callers that must not show a
+// stale one compare its generation with generation() under their own lock.
+class LiveAnalysis {
+public:
+    using Publish = std::function<void(const LiveSnapshot&)>;
+
+    explicit LiveAnalysis(Publish publish, LiveAnalysisOptions options = {});
+    // Cancels and joins, waiting at most for the step in progress
+    ~LiveAnalysis();
+
+    LiveAnalysis(const LiveAnalysis&) = delete;
+    LiveAnalysis& operator=(const LiveAnalysis&) = delete;
+
+    // Start analysing `state` in place of anything running, returns its generation
+    std::uint64_t analyse(const GameState& state);
+    // Stop the running analysis and stay idle
+    void cancel();
+
+    [[nodiscard]] std::uint64_t generation() const noexcept { return generation_.load(); }
+    // Latest stage published for the current generation
+    [[nodiscard]] std::optional<LiveSnapshot> latest() const;
+
+private:
+    Publish publish_;
+    LiveAnalysisOptions options_;
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::optional<GameState> pending_;
+    bool stop_{false};
+    std::atomic<std::uint64_t> generation_{0};
+    std::atomic<bool> cancel_{false};
+    std::optional<LiveSnapshot> latest_;
+    std::thread worker_;  // last, starts once everything above is ready
+
+    void run();
+    void analyse_state(const GameState& state, std::uint64_t generation);
+    // False once the generation is stale
+    bool offer(LiveSnapshot snapshot);
+};
+
+}  // namespace camelup::analysis
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#include "camelup/analysis/leg_odds.hpp"
+#include "camelup/analysis/race_odds.hpp"
+#include "camelup/game_state.hpp"
+
+namespace camelup::analysis {
+
+// Everything leg and race odds depend on: camel positions, dice, desert tiles and terminal flag
+// Money, tickets and bets do not move camels and are left out so those states share entries
+struct OddsKey {
+    std::uint64_t camels{0};  // per camel tile:5 height:3, then die mask:5, terminal:1
+    std::uint64_t desert{0};  // per player desert tile+1:5 mirage:1
+
+    bool operator==(const OddsKey&) const = default;
+};
+
+OddsKey odds_key(const GameState& state);
+
+struct OddsKeyHash {
+    std::size_t operator()(const OddsKey& key) const noexcept {
+        std::uint64_t mixed = key.camels * 0x9E3779B97F4A7C15ULL ^ (key.desert + 0x632BE59BD9B4E019ULL);
+        mixed ^= mixed >> 29;
+        mixed *= 0xBF58476D1CE4E5B9ULL;
+        mixed ^= mixed >> 32;
+        return static_cast<std::size_t>(mixed);
+    }
+};
+
+// Thread-safe bounded memo of leg and race odds, kept warm across queries
+// Entries are computed outside the shard lock, a shard is cleared when it reaches its share of capacity
+class OddsCache {
+public:
+    struct Stats {
+        std::uint64_t hits{0};
+        std::uint64_t misses{0};
+    };
+
+    explicit OddsCache(std::size_t capacity = 1 << 16);
+
+    LegOdds leg_odds(const GameState& state);
+    RaceOdds race_odds(const GameState& state, int samples, std::uint32_t seed);
+
+    [[nodiscard]] Stats stats() const noexcept;
+
+private:
+    static constexpr std::size_t kShards = 16;
+
+    struct RaceKey {
+        OddsKey odds;
+        int samples{0};
+        std::uint32_t seed{0};
+
+        bool operator==(const RaceKey&) const = default;
+    };
+
+    struct RaceKeyHash {
+        std::size_t operator()(const RaceKey& key) const noexcept {
+            return OddsKeyHash{}(key.odds) ^ (static_cast<std::size_t>(key.samples) * 0x9E3779B1U) ^ key.seed;
+        }
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<OddsKey, LegOdds, OddsKeyHash> leg;
+        std::unordered_map<RaceKey, RaceOdds, RaceKeyHash> race;
+    };
+
+    std::size_t shard_capacity_;
+    std::array<Shard, kShards> shards_;
+    std::atomic<std::uint64_t> hits_{0};
+    std::atomic<std::uint64_t> misses_{0};
+};
+
+}  // namespace camelup::analysis
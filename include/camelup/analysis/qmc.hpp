@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "camelup/analysis/common_random.hpp"
+
+namespace camelup::analysis {
+
+// Unit cube coordinates consumed per leg: four for the leave order, one distance per camel
+inline constexpr int kQmcDimensionsPerLeg = 4 + kCamelCount;
+
+// Map kQmcDimensionsPerLeg coordinates of [0, 1) to one leg of dice
+// The leave order is a Fisher-Yates shuffle driven by the first four coordinates, so every
+// coordinate box maps to one order and uniform points give uniform dice.
+LegDice dice_from_point(const double* coordinates);
+
+// Generating vector of a rank-1 lattice with `points` points, a power of two
+// Built component by component against the weighted P2 criterion, early legs weigh most.
+// Vectors are cached per size, the first call for a size pays the construction.
+const std::vector<std::uint32_t>& lattice_generator(int points, int dimensions);
+
+// Randomised quasi-Monte Carlo dice: independent random shifts of one rank-1 lattice
+//
+// Sample `index` is point index % points of replicate index / points. Points run in radical
+// inverse order, so every power-of-two prefix of a replicate is itself a lattice and partial
+// replicates stay well spread. Each replicate is an unbiased estimate on its own, the spread
+// across complete replicates gives the error estimate.
+class QmcDiceSampler {
+public:
+    QmcDiceSampler(int points_per_replicate, std::uint32_t seed, int legs = kDiceStreamLegs);
+
+    [[nodiscard]] DiceStream stream(std::int64_t index);
+    // play_out(state, stream(index)) without materialising legs the race never reaches
+    [[nodiscard]] GameState play_out(const GameState& state, std::int64_t index);
+    [[nodiscard]] int points_per_replicate() const noexcept { return points_; }
+    [[nodiscard]] int legs() const noexcept { return legs_; }
+
+    // Lower level access for rollouts on other board representations: select() picks the
+    // lattice point of sample `index` and its replicate shift, leg_dice() reads one leg of it
+    std::uint32_t select(std::int64_t index);
+    [[nodiscard]] LegDice leg_dice(std::uint32_t point, int leg) const;
+
+private:
+    int points_;
+    int bits_;
+    int legs_;
+    std::uint32_t seed_;
+    const std::vector<std::uint32_t>* generator_;
+    std::int64_t shift_replicate_{-1};
+    std::vector<double> shift_;
+};
+
+}  // namespace camelup::analysis
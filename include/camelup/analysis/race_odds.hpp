@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "camelup/analysis/anytime.hpp"
+#include "camelup/analysis/qmc.hpp"
+#include "camelup/game_state.hpp"
+#include "camelup/types.hpp"
+
+namespace camelup::analysis {
+
+// Monte Carlo estimate of the overall race winner and loser
+// Rollouts only roll dice, betting actions do not move camels
+struct RaceOdds {
+    std::array<double, kCamelCount> winner{};
+    std::array<double, kCamelCount> loser{};
+    int samples{0};
+};
+
+// How rollouts draw their dice
+//   Random  engine RNG, one independent draw per roll
+//   Qmc     randomised rank-1 lattice over whole dice streams, intervals come from the spread of
+//           kQmcReplicatePoints-sample replicates once two are complete
+enum class RaceSampler {
+    Random,
+    Qmc
+};
+
+inline constexpr int kQmcReplicatePoints = 256;
+
+// Fixed sample count, identical to refining a RaceOddsEstimator with the same seed once
+RaceOdds race_odds(const GameState& state, int samples, std::uint32_t seed,
+                   RaceSampler sampler = RaceSampler::Random);
+
+// Anytime race estimator, the decision quantity is the widest winner or loser probability interval
+class RaceOddsEstimator final : public AnytimeEstimator {
+public:
+    RaceOddsEstimator(const GameState& state, std::uint32_t seed, RaceSampler sampler = RaceSampler::Random);
+
+    void refine(int samples) override;
+    [[nodiscard]] int samples() const override;
+    [[nodiscard]] double ci_width(double z) const override;
+
+    [[nodiscard]] RaceOdds interim() const;
+    // Per camel intervals for callers that weigh specific probabilities
+    [[nodiscard]] Interval winner_interval(CamelId camel, double z) const;
+    [[nodiscard]] Interval loser_interval(CamelId camel, double z) const;
+
+private:
+    struct Counts {
+        std::array<int, kCamelCount> winner{};
+        std::array<int, kCamelCount> loser{};
+        int samples{0};
+    };
+
+    GameState root_;
+    std::mt19937 rng_;  // drawn exactly as Engine::apply_action draws a roll
+    std::optional<QmcDiceSampler> qmc_;
+    mutable std::mutex mutex_;
+    std::array<int, kCamelCount> winner_counts_{};
+    std::array<int, kCamelCount> loser_counts_{};
+    int samples_{0};
+    std::vector<Counts> replicates_;  // Qmc only, indexed by replicate
+
+    // Caller holds mutex_
+    [[nodiscard]] Interval interval(const std::array<int, kCamelCount>& counts, bool loser, CamelId camel,
+                                    double z) const;
+};
+
+}  // namespace camelup::analysis
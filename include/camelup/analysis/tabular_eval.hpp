@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "camelup/game_state.hpp"
+#include "camelup/packed_camels.hpp"
+#include "camelup/types.hpp"
+
+namespace camelup::analysis {
+
+// Lookup tables distilled from simulated games, for search leaves that cannot afford leg
+// enumeration or race rollouts
+//
+// Each camel is reduced to one cell of quantised features, seen from that camel:
+//   tiles to finish    1..16                                16
+//   gap to the leader  0..4 tiles, 5 or more                 6
+//   stack              camels above 0..4, any camel below   10
+//   dice               own die in the pyramid, others 0..4  10
+//   desert ahead       nearest within 3 tiles: none, oasis,  3
+//                      mirage
+// Three tables hold, per cell, the chance that the camel wins the race, comes last, and
+// leads when the leg (or the race, if it ends first) is over. Evaluation looks up the five
+// cells of each table and normalises, ignoring how the camels' cells interact.
+inline constexpr std::uint32_t kTabularCells = 16 * 6 * 10 * 10 * 3;
+inline constexpr std::uint32_t kTabularColumns = 3;
+
+// Table file layout (little-endian host order)
+//
+//   TabularHeader
+//   uint16 records[kTabularCells][kTabularColumns]  winner, loser, leg
+//
+// Probabilities are stored scaled to 1..65535. The tables are interleaved so a camel's
+// three values share one cache line.
+inline constexpr char kTabularMagic[8] = {'C', 'A', 'M', 'T', 'A', 'B', 'L', '1'};
+inline constexpr std::uint32_t kTabularVersion = 1;
+
+struct TabularHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t cells;
+    std::uint64_t samples;  // camel positions behind the tables
+    std::uint64_t games;
+};
+
+static_assert(sizeof(TabularHeader) == 32);
+
+// Cell of `camel` in every table
+std::uint32_t tabular_cell(const PackedCamels& camels, std::uint8_t dice, const DesertDeltas& desert,
+                           CamelId camel) noexcept;
+
+// Bit c set while camel c's die is in the pyramid
+std::uint8_t dice_mask(const GameState& state) noexcept;
+
+struct TabularOdds {
+    std::array<double, kCamelCount> winner{};
+    std::array<double, kCamelCount> loser{};
+    std::array<double, kCamelCount> leg{};  // leader once the leg or the race ends
+};
+
+// Counts outcomes per cell from finished games and writes smoothed tables
+class TabularTrainer {
+public:
+    TabularTrainer();
+
+    // One finished game: the states it passed through, in order, and its terminal final state
+    // A state's leg outcome is the race order of the first later state in a new leg, or of
+    // the final state. Games that did not finish are skipped, returns whether it was used.
+    bool add_game(const std::vector<GameState>& states, const GameState& final_state);
+
+    // Each cell's win, loss and leg rates shrunk towards the rate of all cells with the same
+    // tiles to finish and leader gap, so sparsely seen cells stay sensible
+    // Throws std::runtime_error when the file cannot be written
+    void write(const std::string& path) const;
+
+    [[nodiscard]] std::uint64_t samples() const noexcept { return samples_; }
+    [[nodiscard]] std::uint64_t games() const noexcept { return games_; }
+
+private:
+    std::vector<std::uint32_t> seen_;
+    std::vector<std::uint32_t> winner_;
+    std::vector<std::uint32_t> loser_;
+    std::vector<std::uint32_t> leg_;
+    std::uint64_t samples_{0};
+    std::uint64_t games_{0};
+};
+
+// Read-only memory-mapped table file
+class TabularEvaluator {
+public:
+    // Throws std::runtime_error for a missing, truncated or foreign file
+    explicit TabularEvaluator(const std::string& path);
+    ~TabularEvaluator();
+
+    TabularEvaluator(const TabularEvaluator&) = delete;
+    TabularEvaluator& operator=(const TabularEvaluator&) = delete;
+
+    [[nodiscard]] TabularOdds evaluate(const PackedCamels& camels, std::uint8_t dice,
+                                       const DesertDeltas& desert) const noexcept;
+    // Converts the board first, slower than the packed overload
+    [[nodiscard]] TabularOdds evaluate(const GameState& state) const;
+
+    [[nodiscard]] std::uint64_t samples() const noexcept { return header_->samples; }
+    [[nodiscard]] std::uint64_t games() const noexcept { return header_->games; }
+    [[nodiscard]] std::size_t file_bytes() const noexcept { return size_; }
+
+private:
+    const std::byte* data_{nullptr};
+    std::size_t size_{0};
+    const TabularHeader* header_{nullptr};
+    const std::uint16_t* records_{nullptr};
+};
+
+}  // namespace camelup::analysis
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "camelup/game_state.hpp"
+#include "camelup/types.hpp"
+
+namespace camelup::data {
+
+// Columnar feature file layout (little-endian host order)
+//
+//   FeatureDatasetHeader
+//   FeatureColumnDesc[column_count]
+//   padding to kFeatureDatasetAlignment
+//   row group 0: column 0 block, column 1 block, ...
+//   row group 1: ...
+//
+// Every row group reserves `rows_per_group` slots per column so any row can be
+// addressed directly as data_offset + group * group_bytes + column offset + slot * stride.
+// The final group may be partially filled, `row_count` says how many rows are valid.
+inline constexpr char kFeatureDatasetMagic[8] = {'C', 'A', 'M', 'F', 'E', 'A', 'T', '1'};
+inline constexpr std::uint32_t kFeatureDatasetVersion = 1;
+inline constexpr std::uint32_t kFeatureDatasetAlignment = 64;
+inline constexpr std::uint32_t kDefaultRowsPerGroup = 4096;
+inline constexpr std::uint8_t kNoCamel = 0xFF;
+
+enum class FeatureDType : std::uint8_t {
+    Int8 = 0,
+    UInt8 = 1,
+    Int16 = 2,
+    UInt16 = 3,
+    UInt32 = 4
+};
+
+struct FeatureDatasetHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t column_count;
+    std::uint64_t row_count;
+    std::uint32_t rows_per_group;
+    std::uint32_t data_offset;
+    std::uint64_t group_bytes;
+};
+
+struct FeatureColumnDesc {
+    char name[24];
+    FeatureDType dtype;
+    std::uint8_t element_bytes;
+    std::uint16_t width;
+    std::uint32_t group_offset;
+};
+
+static_assert(sizeof(FeatureDatasetHeader) == 40);
+static_assert(sizeof(FeatureColumnDesc) == 32);
+
+// One decision point of one game
+// Features describe the state before the current player acts, labels are filled at game end
+struct FeatureRow {
+    // Features
+    std::int8_t camel_tile[kCamelCount];
+    std::int8_t camel_height[kCamelCount];  // 0 is bottom of stack
+    std::uint8_t die_mask;                  // bit c set while camel c die is still in the pyramid
+    std::int8_t leg_tickets_remaining[kCamelCount];
+    std::int8_t desert_tile[kMaxPlayers];   // -1 when not placed
+    std::int8_t desert_delta[kMaxPlayers];
+    std::int16_t money[kMaxPlayers];
+    std::uint8_t current_player;
+    std::uint8_t player_count;
+    std::uint8_t leg_number;
+
+    // Bookkeeping
+    std::uint32_t game_index;
+    std::uint16_t turn;
+
+    // Labels
+    std::int16_t final_money[kMaxPlayers];
+    std::uint8_t race_winner;  // kNoCamel when the game stopped before a camel finished
+    std::uint8_t race_loser;
+};
+
+// Static schema describing FeatureRow fields as columns
+const std::vector<FeatureColumnDesc>& feature_columns();
+
+// Fill feature fields of a row from state, labels are left zeroed
+FeatureRow extract_features(const GameState& state);
+
+// Streams rows from a simulation loop into a columnar feature file
+// Rows of the running game are held until finish_game supplies the labels
+class FeatureDatasetWriter {
+public:
+    explicit FeatureDatasetWriter(const std::string& path, std::uint32_t rows_per_group = kDefaultRowsPerGroup);
+    ~FeatureDatasetWriter();
+
+    FeatureDatasetWriter(const FeatureDatasetWriter&) = delete;
+    FeatureDatasetWriter& operator=(const FeatureDatasetWriter&) = delete;
+
+    // Record the state a player is about to act in
+    void record_turn(const GameState& state, std::uint32_t game_index, std::uint16_t turn);
+    // Attach final money and race result labels to every pending row of the game
+    void finish_game(const GameState& final_state);
+    // Flush remaining rows and patch the header, safe to call more than once
+    void close();
+
+    [[nodiscard]] std::uint64_t rows_written() const noexcept { return row_count_; }
+
+private:
+    std::ofstream out_;
+    std::vector<FeatureRow> pending_;
+    std::vector<std::byte> group_;
+    std::uint32_t rows_per_group_;
+    std::uint32_t rows_in_group_{0};
+    std::uint64_t row_count_{0};
+    bool closed_{false};
+
+    void append_row(const FeatureRow& row);
+    void flush_group();
+    void write_header();
+};
+
+// Read-only memory-mapped view of a feature file
+class FeatureDatasetView {
+public:
+    explicit FeatureDatasetView(const std::string& path);
+    ~FeatureDatasetView();
+
+    FeatureDatasetView(const FeatureDatasetView&) = delete;
+    FeatureDatasetView& operator=(const FeatureDatasetView&) = delete;
+
+    [[nodiscard]] std::uint64_t row_count() const noexcept { return header_->row_count; }
+    [[nodiscard]] std::uint32_t rows_per_group() const noexcept { return header_->rows_per_group; }
+    [[nodiscard]] std::uint32_t column_count() const noexcept { return header_->column_count; }
+    [[nodiscard]] const FeatureColumnDesc& column(int index) const { return columns_[index]; }
+
+    // Column index by name, -1 when the file has no such column
+    [[nodiscard]] int find_column(std::string_view name) const;
+
+    // Pointer to the first element of `row` in `column`, elements of one row are contiguous
+    [[nodiscard]] const void* cell(int column, std::uint64_t row) const;
+
+    template <typename T>
+    [[nodiscard]] T value(int column, std::uint64_t row, int element = 0) const {
+        return static_cast<const T*>(cell(column, row))[element];
+    }
+
+    // Gather one full row, mostly for tests and debugging
+    [[nodiscard]] FeatureRow row(std::uint64_t index) const;
+
+private:
+    const std::byte* data_{nullptr};
+    std::size_t size_{0};
+    const FeatureDatasetHeader* header_{nullptr};
+    const FeatureColumnDesc* columns_{nullptr};
+};
+
+}  // namespace camelup::data
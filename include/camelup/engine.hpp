@@ -10,19 +10,58 @@
 
 namespace camelup {
 
+// Why an action was refused, each matches the std::invalid_argument apply_action throws
+enum class ApplyError {
+    None,
+    IllegalDesertTile,
+    IllegalLegTicket,
+    IllegalWinnerBet,
+    IllegalLoserBet
+};
+
+const char* apply_error_message(ApplyError error) noexcept;
+
 class Engine {
 public:
     explicit Engine(std::uint32_t seed = std::random_device{}());
 
     GameState new_game(int player_count);
     std::vector<Action> legal_actions(const GameState& state) const;
-    GameState apply_action(const GameState& state, const Action& action);
+    void legal_actions(const GameState& state, std::vector<Action>& actions) const;
+    // A roll stores the outcome it drew in `rolled` when given, so the game can be replayed with apply_roll
+    GameState apply_action(const GameState& state, const Action& action, DieRoll* rolled = nullptr);
+
+    // Apply in place without copying the state, an illegal action leaves it untouched and
+    // returns the reason instead of throwing
+    [[nodiscard]] ApplyError try_apply(GameState& state, const Action& action, DieRoll* rolled = nullptr);
+
+    // Apply in place an action known to be legal, e.g. straight from legal_actions
+    // Skips validation, asserts legality in debug builds; an illegal action is undefined behaviour
+    void apply_unchecked(GameState& state, const Action& action, DieRoll* rolled = nullptr);
+
+    // Apply a roll action whose outcome is already known instead of drawing it from the engine RNG
+    // Throws std::invalid_argument when that die is already spent or the distance is not 1..3
+    static GameState apply_roll(const GameState& state, DieRoll roll);
+    // Same, in place
+    static void apply_roll_in_place(GameState& state, DieRoll roll);
+
+    // Draw the outcome a roll action on `state` would get, advancing the RNG exactly as that
+    // roll would, so applying it with apply_roll_in_place continues the seeded game unchanged
+    // Throws std::runtime_error when every die of the leg is spent
+    DieRoll draw_roll(const GameState& state);
+
+    // Close the leg of a state whose dice are all spent, as every roll does before it draws
+    // Such states only come from outside the engine, e.g. a pasted position
+    static void settle_spent_leg(GameState& state);
 
 private:
     std::mt19937 rng_;
 
     static void reset_leg_dice(GameState& state);
     std::pair<CamelId, int> roll_die(GameState& state);
+    void apply_valid(GameState& state, const Action& action, DieRoll* rolled);
+    static void settle_roll(GameState& state, CamelId camel, int distance);
+    static void resolve_after_action(GameState& state, ActionType type);
     static void move_camel_stack(GameState& state, CamelId camel, int distance);
 };
 
@@ -1,25 +1,39 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <vector>
 
 #include "camelup/types.hpp"
 
 namespace camelup {
 
+inline constexpr int kStartingMoney = 3;
+
+// Leg ticket values in the order they are handed out for each camel
+inline constexpr std::array<int, kLegTicketCount> kLegTicketDefaults = {5, 3, 2};
+// Final bet rewards in play order for correct guesses
+inline constexpr std::array<int, 5> kFinalBetPayouts = {8, 5, 3, 2, 1};
+
 struct DesertTilePlacement {
     int tile{-1};
     int move_delta{1};
+
+    bool operator==(const DesertTilePlacement&) const = default;
 };
 
 struct LegTicket {
     CamelId camel{0};
     int value{0};
+
+    bool operator==(const LegTicket&) const = default;
 };
 
 struct FinalBetCard {
     PlayerId player{0};
     CamelId camel{0};
+
+    bool operator==(const FinalBetCard&) const = default;
 };
 
 struct GameState {
@@ -28,6 +42,9 @@ struct GameState {
     std::array<bool, kCamelCount> die_available{};
     std::array<DesertTilePlacement, kMaxPlayers> desert_tiles{};
     std::array<int, kBoardTiles> desert_tile_owner{};
+    // Derived: bit t is set when that player may place their desert tile on tile t
+    // Kept current by the engine, states edited by hand need rules::refresh_desert_legality
+    std::array<std::uint32_t, kMaxPlayers> desert_legal_tiles{};
 
     std::array<int, kCamelCount> leg_tickets_remaining{};
     std::array<std::array<int, kLegTicketCount>, kCamelCount> leg_ticket_values{};
@@ -42,6 +59,8 @@ struct GameState {
     int player_count{2};
     int leg_number{1};
     bool terminal{false};
+
+    bool operator==(const GameState&) const = default;
 };
 
 }  // namespace camelup
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>  // max, min
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "camelup/game_state.hpp"
+#include "camelup/types.hpp"
+
+namespace camelup {
+
+// Desert tile effect per tile: 0 for no tile, +1 oasis, -1 mirage
+using DesertDeltas = std::array<std::int8_t, kBoardTiles>;
+
+// Desert tile effects of the current leg, taken from the tile owners' placements
+DesertDeltas desert_deltas(const GameState& state);
+
+// All five camels in one 64-bit word, one byte lane per camel
+//
+// A lane holds tile << 3 | height, so comparing lanes orders camels by tile and then by
+// height: the byte value is the camel's global order key. The 17 tiles need 5 bits and a
+// stack of five camels needs 3, and five lanes leave the top three bytes empty.
+// Moving a stack rewrites the tile and height of every carried lane with one masked add
+// instead of copying and inserting vectors.
+class PackedCamels {
+public:
+    PackedCamels() = default;
+
+    // Requires every camel on the board exactly once
+    static PackedCamels from_board(const std::array<std::vector<CamelId>, kBoardTiles>& board);
+    void to_board(std::array<std::vector<CamelId>, kBoardTiles>& board) const;
+
+    [[nodiscard]] std::uint64_t word() const noexcept { return bits_; }
+    [[nodiscard]] int key(CamelId camel) const noexcept { return static_cast<int>((bits_ >> (8 * camel)) & 0xFFu); }
+    [[nodiscard]] int tile(CamelId camel) const noexcept { return key(camel) >> 3; }
+    [[nodiscard]] int height(CamelId camel) const noexcept { return key(camel) & 7; }
+
+    // Camel on top of the leading stack, and at the bottom of the rearmost one
+    [[nodiscard]] CamelId leader() const noexcept;
+    [[nodiscard]] CamelId last() const noexcept;
+    // Leader first
+    [[nodiscard]] std::array<CamelId, kCamelCount> race_order() const noexcept;
+    [[nodiscard]] bool finished() const noexcept { return tile(leader()) == kBoardTiles - 1; }
+
+    // Move `camel` and every camel above it, mirroring Engine::move_camel_stack
+    // Returns the landing tile so the caller can pay a desert tile owner there.
+    int move(CamelId camel, int distance, const DesertDeltas& desert) noexcept;
+
+    bool operator==(const PackedCamels&) const = default;
+
+private:
+    std::uint64_t bits_{0};
+};
+
+namespace packed_detail {
+
+// kLaneOnes[m] has a 1 in the low bit of every byte lane set in the five bit lane mask m
+inline constexpr std::array<std::uint64_t, 1 << kCamelCount> kLaneOnes = [] {
+    std::array<std::uint64_t, 1 << kCamelCount> table{};
+    for (int mask = 0; mask < (1 << kCamelCount); ++mask) {
+        for (int lane = 0; lane < kCamelCount; ++lane) {
+            if ((mask >> lane) & 1) {
+                table[mask] |= std::uint64_t{1} << (8 * lane);
+            }
+        }
+    }
+    return table;
+}();
+
+// Add `delta` to every lane in `mask`, each lane stays inside 0..255 so nothing carries across
+inline std::uint64_t add_to_lanes(std::uint64_t bits, int mask, int delta) noexcept {
+    const std::uint64_t ones = kLaneOnes[mask];
+    return delta >= 0 ? bits + ones * static_cast<std::uint64_t>(delta)
+                      : bits - ones * static_cast<std::uint64_t>(-delta);
+}
+
+}  // namespace packed_detail
+
+inline CamelId PackedCamels::leader() const noexcept {
+    CamelId best = 0;
+    for (CamelId camel = 1; camel < kCamelCount; ++camel) {
+        if (key(camel) > key(best)) {
+            best = camel;
+        }
+    }
+    return best;
+}
+
+inline CamelId PackedCamels::last() const noexcept {
+    CamelId worst = 0;
+    for (CamelId camel = 1; camel < kCamelCount; ++camel) {
+        if (key(camel) < key(worst)) {
+            worst = camel;
+        }
+    }
+    return worst;
+}
+
+inline int PackedCamels::move(CamelId camel, int distance, const DesertDeltas& desert) noexcept {
+    const int moving_key = key(camel);
+    const int from = moving_key >> 3;
+    const int from_height = moving_key & 7;
+    const int landing = std::min(from + distance, kBoardTiles - 1);
+    const int delta = desert[landing];
+    const int to = std::max(0, std::min(landing + delta, kBoardTiles - 1));
+
+    // Carried lanes share the tile at or above the moving camel, resting lanes already sit on `to`
+    int carried = 0;
+    int carried_count = 0;
+    int resting = 0;
+    int resting_count = 0;
+    for (int lane = 0; lane < kCamelCount; ++lane) {
+        const int lane_key = static_cast<int>((bits_ >> (8 * lane)) & 0xFFu);
+        if ((lane_key >> 3) == from && lane_key >= moving_key) {
+            carried |= 1 << lane;
+            ++carried_count;
+        } else if ((lane_key >> 3) == to) {
+            resting |= 1 << lane;
+            ++resting_count;
+        }
+    }
+
+    if (delta < 0) {
+        // Mirage slides the carried stack underneath whatever rests on the destination
+        bits_ = packed_detail::add_to_lanes(bits_, carried, (to - from) * 8 - from_height);
+        bits_ = packed_detail::add_to_lanes(bits_, resting, carried_count);
+    } else {
+        bits_ = packed_detail::add_to_lanes(bits_, carried, (to - from) * 8 + resting_count - from_height);
+    }
+    return landing;
+}
+
+}  // namespace camelup
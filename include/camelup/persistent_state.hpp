@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "camelup/actions.hpp"
+#include "camelup/engine.hpp"
+#include "camelup/game_state.hpp"
+#include "camelup/packed_camels.hpp"
+#include "camelup/types.hpp"
+
+namespace camelup {
+
+// Structurally shared GameState for search trees
+//
+// What changes on nearly every action (camels, dice, money, turn, desert tiles) is stored
+// inline and packed. Held leg tickets and final bets sit in immutable blocks behind shared_ptr.
+// A state derived from a parent shares every block the action left unchanged, so roll and
+// desert children cost only the inline part and a ticket or bet child copies one small block.
+// Desert tile owners and legality masks are derived and rebuilt by materialise().
+class PersistentState {
+public:
+    struct HeldTicket {
+        PlayerId player{0};
+        CamelId camel{0};
+        std::int8_t value{0};
+
+        bool operator==(const HeldTicket&) const = default;
+    };
+
+    struct Tickets {
+        std::array<std::int8_t, kCamelCount> remaining{};
+        std::array<std::array<std::int8_t, kLegTicketCount>, kCamelCount> values{};
+        std::vector<HeldTicket> held;  // grouped by player, each player's tickets in taking order
+
+        bool operator==(const Tickets&) const = default;
+    };
+
+    struct Bets {
+        std::vector<FinalBetCard> winner_stack;
+        std::vector<FinalBetCard> loser_stack;
+        std::uint64_t winner_cards{0};  // bit player * kCamelCount + camel while that card is in hand
+        std::uint64_t loser_cards{0};
+
+        bool operator==(const Bets&) const = default;
+    };
+
+    // Root of a tree, every block is fresh
+    // Throws std::invalid_argument for a state the engine cannot reach, such as a desert tile
+    // owner that does not match the placements, money outside int16 or a ticket value outside int8
+    explicit PersistentState(const GameState& state);
+
+    // `child` as a successor of this state, sharing each block whose contents did not change
+    [[nodiscard]] PersistentState derive(const GameState& child) const;
+
+    // Apply through the engine and derive the successor
+    // Throws std::invalid_argument for an illegal action, like Engine::apply_action
+    [[nodiscard]] PersistentState apply(Engine& engine, const Action& action, DieRoll* rolled = nullptr) const;
+
+    // The full state, equal to the GameState this one was built from
+    [[nodiscard]] GameState materialise() const;
+
+    [[nodiscard]] const PackedCamels& camels() const noexcept { return camels_; }
+    [[nodiscard]] int money(PlayerId player) const noexcept { return money_[player]; }
+    [[nodiscard]] bool die_available(CamelId camel) const noexcept { return (dice_ >> camel) & 1U; }
+    [[nodiscard]] DesertTilePlacement desert_tile(PlayerId player) const noexcept;
+    [[nodiscard]] PlayerId current_player() const noexcept { return current_player_; }
+    [[nodiscard]] int player_count() const noexcept { return player_count_; }
+    [[nodiscard]] int leg_number() const noexcept { return leg_number_; }
+    [[nodiscard]] bool terminal() const noexcept { return terminal_; }
+
+    // Shared blocks, states that share a block return the same object
+    [[nodiscard]] const Tickets& tickets() const noexcept { return *tickets_; }
+    [[nodiscard]] const Bets& bets() const noexcept { return *bets_; }
+
+    bool operator==(const PersistentState& other) const;
+
+private:
+    PackedCamels camels_;
+    std::array<std::int16_t, kMaxPlayers> money_{};
+    std::uint64_t desert_{0};  // byte per player: tile + 1 in bits 0-4, bit 5 set for a mirage
+    std::uint8_t dice_{0};     // bit c set while camel c's die is in the pyramid
+    PlayerId current_player_{0};
+    std::uint8_t player_count_{2};
+    bool terminal_{false};
+    int leg_number_{1};
+    std::shared_ptr<const Tickets> tickets_;
+    std::shared_ptr<const Bets> bets_;
+
+    PersistentState() = default;
+    void set_inline(const GameState& state);
+};
+
+}  // namespace camelup
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+
+#include "camelup/actions.hpp"
+#include "camelup/game_state.hpp"
+
+// Straightforward Camel Up v1 rules, kept as the reference the optimised Engine is checked against
+//
+// Written for obviousness over speed: legality is evaluated on the board every time instead of
+// from the maintained masks, every action works on a copy, stacks move through plain vectors,
+// and the derived fields (desert tile owners and placement masks) are rebuilt from scratch after
+// each action. Nothing here is shared with Engine apart from the placement rule itself.
+
+namespace camelup::reference {
+
+// Same actions in the same order as rules::legal_actions
+std::vector<Action> legal_actions(const GameState& state);
+
+// The state after `action`, a roll moves camel `roll.camel` by `roll.distance`
+// Throws std::invalid_argument for an action not in legal_actions(state) or a spent die
+GameState apply(const GameState& state, const Action& action, DieRoll roll = {});
+
+}  // namespace camelup::reference
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 #include "camelup/actions.hpp"
@@ -8,5 +9,17 @@
 namespace camelup::rules {
 
 std::vector<Action> legal_actions(const GameState& state);
+// Same list written into `actions`, reusing its storage
+void legal_actions(const GameState& state, std::vector<Action>& actions);
+
+// Desert tile placement rule evaluated directly on the board, the reference for the masks
+bool is_legal_desert_tile_placement(const GameState& state, int tile, PlayerId player);
+
+// Recompute every player's desert placement mask from scratch
+void refresh_desert_legality(GameState& state);
+
+// Recompute the placement bits of tiles first_tile..last_tile for every player after a change
+// that can only affect those tiles (a camel leaving a tile, a desert tile placed or lifted)
+void update_desert_legality(GameState& state, int first_tile, int last_tile);
 
 }  // namespace camelup::rules
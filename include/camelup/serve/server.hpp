@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <list>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "camelup/analysis/odds_cache.hpp"
+#include "camelup/util/thread_pool.hpp"
+
+namespace camelup::serve {
+
+// Line protocol, one request per line and one response line per request in request order
+//
+//   <query> [argument] | <position notation>
+//
+//   legal            ok <action> <action> ...
+//   apply <action>   ok <position>  (a bare roll draws its outcome from a per-request seed,
+//                                    roll:B2 applies a known outcome)
+//   leg              ok first <p x5> second <p x5> race_end <p> coins <per player>
+//   race [samples]   ok winner <p x5> loser <p x5> samples <n>
+//   best             ok <action>=<ev> ... ranked best first
+//   best <ms>        ok <action>=<ev> ... samples <n>  (anytime search, stops at the deadline or once
+//                                                      the best action is settled)
+//
+// Probabilities are in camel order B G Y O W. Failures answer `error <message>`.
+// Actions and positions use the snapshot notations.
+enum class QueryKind {
+    Legal,
+    Apply,
+    Leg,
+    Race,
+    Best,
+    Invalid
+};
+
+inline constexpr int kQueryKindCount = 6;
+
+struct ServerOptions {
+    std::size_t threads{0};         // 0 picks hardware concurrency
+    std::size_t max_in_flight{256}; // pipelined requests queued or running per connection, at least 1
+    std::size_t cache_capacity{1 << 16};
+    int race_samples{2000};         // default Monte Carlo samples for race and best queries
+    std::uint32_t seed{1};
+};
+
+struct LatencySummary {
+    std::uint64_t count{0};
+    std::uint64_t p50_us{0};
+    std::uint64_t p99_us{0};
+    std::uint64_t max_us{0};
+};
+
+class Server {
+public:
+    // Throws std::invalid_argument when max_in_flight is 0
+    explicit Server(ServerOptions options = {});
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // Answer one request line, safe to call from many threads
+    std::string handle(std::string_view request);
+
+    // Read requests until end of input, answer them concurrently on the pool and write answers in order
+    void serve(std::istream& in, std::ostream& out);
+
+    // Accept connections on a Unix domain socket until stop(), each connection is served like a stream
+    // Throws std::runtime_error when the socket cannot be set up or accept fails for good
+    void serve_unix_socket(const std::string& path);
+    // Stop accepting and shut down every open connection, requests not yet answered are dropped
+    void stop();
+
+    // Connection threads not joined yet, finished ones are joined on the next accept
+    [[nodiscard]] std::size_t connection_threads();
+
+    [[nodiscard]] LatencySummary latency(QueryKind kind) const;
+    [[nodiscard]] analysis::OddsCache::Stats cache_stats() const noexcept { return cache_.stats(); }
+
+private:
+    // Microsecond buckets, the last one collects everything slower
+    static constexpr std::size_t kLatencyBuckets = 4096;
+
+    struct LatencyHistogram {
+        std::array<std::atomic<std::uint64_t>, kLatencyBuckets> buckets{};
+        std::atomic<std::uint64_t> max_us{0};
+    };
+
+    struct Connection {
+        int fd{-1};  // -1 once the connection thread has closed it
+        bool done{false};
+        std::thread thread;
+    };
+
+    ServerOptions options_;
+    analysis::OddsCache cache_;
+    util::ThreadPool pool_;
+    std::array<LatencyHistogram, kQueryKindCount> latency_{};
+    std::atomic<bool> stopping_{false};
+    std::atomic<int> listen_fd_{-1};
+    std::mutex connections_mutex_;
+    std::list<Connection> connections_;  // nodes stay put while their threads run
+
+    std::string answer(QueryKind& kind, std::string_view request);
+    // Join finished connection threads, the caller holds connections_mutex_
+    void reap_connections();
+    void record_latency(QueryKind kind, std::uint64_t micros);
+};
+
+}  // namespace camelup::serve
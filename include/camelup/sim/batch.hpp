@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "camelup/actions.hpp"
+#include "camelup/game_state.hpp"
+#include "camelup/sim/game_record.hpp"
+#include "camelup/sim/policy.hpp"
+#include "camelup/sim/sketch.hpp"
+
+namespace camelup::sim {
+
+struct BatchOptions {
+    int seed{42};
+    int players{2};
+    int games{1};
+    int turn_limit{500};
+    Policy policy{Policy::RollOnly};
+    std::optional<GameState> start;  // replaces the seeded opening setup when set
+
+    bool operator==(const BatchOptions&) const = default;
+};
+
+struct GameOutcome {
+    GameState final_state;
+    int turns{0};
+    std::array<std::uint32_t, kActionTypeCount> actions{};
+};
+
+// Called before each action is applied
+using TurnObserver = std::function<void(const GameState& state, const Action& action, int turn)>;
+
+// Game `game` of a batch, identical to a single game run with seed options.seed + game
+// Fills `record` for replay when given
+GameOutcome play_game(const BatchOptions& options, int game, const TurnObserver& observer = {},
+                      GameRecord* record = nullptr);
+
+// Mergeable aggregate of many games, its size does not grow with the game count
+struct RunSummary {
+    static constexpr std::size_t kTurnBuckets = 64;
+    static constexpr int kTurnBucketWidth = 10;
+    static constexpr std::size_t kLegBuckets = 32;
+
+    std::uint64_t games{0};
+    std::uint64_t finished{0};
+    Histogram turns{kTurnBuckets, kTurnBucketWidth};
+    Histogram legs{kLegBuckets, 1};
+    std::array<KllSketch, kMaxPlayers> money{};  // final money per seat
+    std::array<std::uint64_t, kCamelCount> winners{};
+    std::array<std::uint64_t, kCamelCount> losers{};
+    std::array<std::array<std::uint64_t, kActionTypeCount>, kPolicyCount> actions{};
+
+    void record(const GameOutcome& outcome, Policy policy);
+    void merge(const RunSummary& other);
+
+    bool operator==(const RunSummary&) const = default;
+};
+
+// Games are summarised in fixed blocks of kSummaryBlockGames. Block summaries combine along
+// one fixed binary tree over block indices: a node covering 2^h blocks starting at a multiple
+// of 2^h is its left half merged with its right half. Any set of nodes tiling the blocks
+// reduces to the same result, so summaries are bit-identical for every thread and shard count.
+inline constexpr int kSummaryBlockGames = 256;
+
+int summary_blocks(int games);
+
+// A finished tree node: `blocks` blocks from `first_block`, a power of two aligned to itself
+struct SummaryNode {
+    int first_block{0};
+    int blocks{1};
+    RunSummary summary;
+
+    bool operator==(const SummaryNode&) const = default;
+};
+
+// Shard `index` of `count` owns a contiguous range of blocks
+struct ShardSpec {
+    int index{0};
+    int count{1};
+
+    bool operator==(const ShardSpec&) const = default;
+};
+
+// Block range [first, last) of one shard
+std::pair<int, int> shard_blocks(int blocks, ShardSpec shard);
+
+struct ShardResult {
+    BatchOptions options;
+    ShardSpec shard;
+    std::vector<SummaryNode> nodes;  // tree nodes tiling the shard's blocks, in block order
+};
+
+// Checkpoints are the finished tree nodes of a shard so far. Blocks are seeded by their index,
+// so a resumed run replays only the blocks no node covers and reduces to the same summary.
+struct Checkpointing {
+    const ShardResult* resume{nullptr};  // checkpoint of an interrupted run of the same shard
+    // Receives a checkpoint on a worker thread, at most once per interval, must not block
+    std::function<void(ShardResult)> save;
+    std::chrono::milliseconds interval{std::chrono::seconds(60)};
+};
+
+// Zero threads picks std::thread::hardware_concurrency
+// Throws std::invalid_argument for a negative game count, a shard outside 0..count-1 or a resume
+// checkpoint from other options, another shard or with misaligned nodes
+ShardResult run_shard(const BatchOptions& options, ShardSpec shard, std::size_t threads = 1,
+                      const Checkpointing& checkpointing = {});
+
+// Combine shards into the whole-run summary
+// Throws std::invalid_argument unless the shards share options and tile every block exactly once
+RunSummary merge_shards(const std::vector<ShardResult>& shards);
+
+RunSummary run_batch(const BatchOptions& options, std::size_t threads = 1);
+
+void print_report(std::ostream& out, const RunSummary& summary);
+
+}  // namespace camelup::sim
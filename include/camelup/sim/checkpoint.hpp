@@ -0,0 +1,55 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "camelup/sim/batch.hpp"
+
+namespace camelup::sim {
+
+// Background writer of batch checkpoints
+//
+// submit only replaces the pending checkpoint, a dedicated thread writes it with save_shard.
+// A checkpoint submitted while an older one still waits supersedes it, so a slow disk costs
+// checkpoint frequency rather than worker time.
+class CheckpointWriter {
+public:
+    struct Stats {
+        std::uint64_t written{0};
+        std::uint64_t superseded{0};
+    };
+
+    explicit CheckpointWriter(std::string path);
+    // Writes the last pending checkpoint, a failure there is dropped
+    ~CheckpointWriter();
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    void submit(ShardResult checkpoint);
+    // Wait until everything submitted so far is on disk, rethrows the first failed write
+    void flush();
+
+    [[nodiscard]] const std::string& path() const noexcept { return path_; }
+    [[nodiscard]] Stats stats() const;
+
+private:
+    void run();
+
+    std::string path_;
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::optional<ShardResult> pending_;
+    bool writing_{false};
+    bool stopping_{false};
+    Stats stats_;
+    std::exception_ptr failure_;
+    std::thread thread_;
+};
+
+}  // namespace camelup::sim
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "camelup/game_state.hpp"
+#include "camelup/sim/game_record.hpp"
+
+namespace camelup::sim {
+
+// Ways the optimised engine applies an action: apply_unchecked, try_apply, apply_action,
+// draw_roll with apply_roll_in_place, and PersistentState::apply
+enum class ApplyPath : std::uint8_t { Unchecked, TryApply, ApplyAction, KnownRoll, Persistent };
+inline constexpr int kApplyPathCount = 5;
+
+const char* apply_path_name(ApplyPath path) noexcept;
+
+// Random games played through Engine and camelup::reference in lockstep
+//
+// Both start from the seeded opening of Engine(seed + game). Each turn the legal action lists
+// are compared, a uniformly random legal action is applied to both, a roll takes the outcome
+// the optimised side drew, and the full states are compared. The optimised side rotates
+// through every ApplyPath so each one is covered by the same games.
+struct DifferentialOptions {
+    std::int32_t seed{1};
+    int players{0};      // zero cycles 2..8 by game index
+    int turn_limit{0};   // actions per game, zero plays every game to its end
+    // Replay a diverging game without each of its actions in turn, keeping the removals after
+    // which it still diverges, so the reported record holds only the actions that matter
+    bool shrink{true};
+    // Test hook run on the optimised state after each action it applied, to plant a bug in
+    // one apply path and check that it is found, shrunk and replayed
+    std::function<void(GameState& state, const Action& action, ApplyPath path)> after_apply;
+};
+
+// The first action where the two engines disagree
+struct Divergence {
+    // Replays with sim::replay up to and including the divergent action, so the last action
+    // of the record is the one the reference disagrees with. When the legal action lists
+    // already differ the record stops at `before`. Shrunk records replay from the same seed
+    // with their recorded roll outcomes.
+    GameRecord record;
+    std::vector<ApplyPath> paths;  // how the optimised engine applied each action of the record
+    GameState before;              // the state both engines agreed on before that action
+    std::string what;              // the first differing field
+};
+
+std::optional<Divergence> check_game(const DifferentialOptions& options, std::uint32_t game);
+
+// Play `record` through both engines again, each action on its recorded path and each roll
+// with its recorded outcome, returning the divergence it ends in, if any
+// Records that stop replaying (an action no longer legal, a die already spent, actions after
+// the end of the game) count as not diverging.
+std::optional<Divergence> replay_divergence(const DifferentialOptions& options, const GameRecord& record,
+                                            const std::vector<ApplyPath>& paths);
+
+struct DifferentialReport {
+    std::uint64_t games{0};
+    std::uint64_t actions{0};
+    std::optional<Divergence> divergence;  // the lowest diverging game index, if any
+};
+
+// Games first_game .. first_game + count - 1 spread over `threads` (zero picks
+// std::thread::hardware_concurrency), stopping early once a game diverges
+DifferentialReport check_games(const DifferentialOptions& options, std::uint32_t first_game, std::size_t count,
+                               std::size_t threads = 1);
+
+// Name of the first field where `expected` and `actual` differ, empty when they are equal
+std::string first_difference(const GameState& expected, const GameState& actual);
+
+}  // namespace camelup::sim
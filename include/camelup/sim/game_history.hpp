@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "camelup/actions.hpp"
+#include "camelup/engine.hpp"
+#include "camelup/game_state.hpp"
+#include "camelup/persistent_state.hpp"
+
+namespace camelup::sim {
+
+// Undo and redo history of one game line with bounded memory
+//
+// Each action is kept as two bytes, its raw record code and the roll outcome it got (see
+// pack_action / pack_roll), in a ring buffer of `capacity` steps. Every `snapshot_interval`
+// turns the state is also kept as a PersistentState, so any kept turn is restored from the
+// nearest snapshot at or before it plus fewer than `snapshot_interval` replayed steps. Once
+// the ring is full the oldest `snapshot_interval` steps and their snapshot are dropped, so
+// the first kept turn moves forward and very long sessions stay within capacity.
+//
+// Turns count actions since `start`, dropped turns keep their numbers.
+class GameHistory {
+public:
+    static constexpr std::size_t kDefaultCapacity = std::size_t{1} << 16;
+    static constexpr std::size_t kDefaultSnapshotInterval = 32;
+
+    // Throws std::invalid_argument unless capacity is a non-zero multiple of snapshot_interval
+    explicit GameHistory(const GameState& start, std::size_t capacity = kDefaultCapacity,
+                         std::size_t snapshot_interval = kDefaultSnapshotInterval);
+
+    [[nodiscard]] const GameState& state() const noexcept { return state_; }
+    [[nodiscard]] std::size_t turn() const noexcept { return turn_; }
+    [[nodiscard]] std::size_t first_turn() const noexcept { return first_turn_; }
+    [[nodiscard]] std::size_t last_turn() const noexcept { return first_turn_ + count_; }
+    [[nodiscard]] bool can_undo() const noexcept { return turn_ > first_turn_; }
+    [[nodiscard]] bool can_redo() const noexcept { return turn_ < last_turn(); }
+
+    // Apply `action` with `engine` at the current turn and record it with the roll it drew
+    // Any redo steps after the current turn are dropped, the new action starts the line again
+    // Throws std::invalid_argument for an illegal action, leaving the history unchanged
+    void apply(Engine& engine, const Action& action);
+
+    // The action that left turn `turn` and the roll it got, nullopt for turns not kept
+    [[nodiscard]] std::optional<Action> action_at(std::size_t turn) const;
+    [[nodiscard]] std::optional<DieRoll> roll_at(std::size_t turn) const;
+
+    // Step one turn back or forward, false when there is nothing to undo or redo
+    bool undo();
+    bool redo();
+
+    // Restore any kept turn first_turn() .. last_turn(), throws std::invalid_argument otherwise
+    void seek(std::size_t turn);
+
+    // Bytes held by steps and snapshots, not counting the current state
+    [[nodiscard]] std::size_t memory_bytes() const;
+
+private:
+    struct Step {
+        std::uint8_t action{0};
+        std::uint8_t roll{0};
+    };
+
+    std::size_t capacity_;
+    std::size_t snapshot_interval_;
+    std::vector<Step> ring_;
+    std::size_t head_{0};   // ring slot of the step leaving first_turn_
+    std::size_t count_{0};  // steps kept after first_turn_
+    std::size_t first_turn_{0};
+    std::size_t turn_{0};
+    // snapshots_[i] is the state at turn first_turn_ + i * snapshot_interval_
+    std::deque<PersistentState> snapshots_;
+    GameState state_;
+    Engine replayer_;
+
+    [[nodiscard]] const Step& step_at(std::size_t turn) const;
+    void replay_step(const Step& step);
+};
+
+}  // namespace camelup::sim
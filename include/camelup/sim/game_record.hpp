@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "camelup/actions.hpp"
+#include "camelup/game_state.hpp"
+
+namespace camelup::sim {
+
+// Everything needed to replay one simulated game: the seed of its opening setup, the chosen
+// actions and the outcome the engine drew for each roll
+struct GameRecord {
+    std::uint32_t game{0};
+    std::int32_t seed{0};  // engine seed, the batch seed plus the game index
+    std::uint8_t players{2};
+    bool terminal{false};
+    std::vector<Action> actions;
+    std::vector<DieRoll> rolls;  // one per roll action, in order
+
+    bool operator==(const GameRecord&) const = default;
+};
+
+// Final state of a recorded game, rebuilt without drawing any dice
+// `start` must be the batch start position when the game was played from one
+// Throws std::runtime_error when the actions do not replay
+GameState replay(const GameRecord& record, const std::optional<GameState>& start = std::nullopt);
+
+// Raw byte-packed record, the plain reference format, little-endian
+//
+//   game:4 seed:4 players:1 terminal:1 action count:2 roll count:2
+//   per action: type:3 argument:5 (desert tile * 2 + mirage, or camel)
+//   per roll: camel * 3 + distance - 1
+//
+// Throws std::invalid_argument when a game has more than 65535 actions
+void append_record(std::vector<std::uint8_t>& out, const GameRecord& record);
+// Decode one record at `cursor` and advance it, throws std::runtime_error on truncated or bad data
+GameRecord read_record(const std::uint8_t*& cursor, const std::uint8_t* end);
+
+// Single action and roll bytes of the raw format, unpacking throws std::runtime_error on bad data
+std::uint8_t pack_action(const Action& action);
+Action unpack_action(std::uint8_t packed);
+std::uint8_t pack_roll(DieRoll roll);
+DieRoll unpack_roll(std::uint8_t packed);
+
+// Record shard file
+//
+//   magic "CAMRECS1", version
+//   batches until end of file: record count, payload bytes, payload
+//
+// Each payload is one block of the record codec (camelup/sim/record_codec.hpp)
+inline constexpr char kRecordShardMagic[8] = {'C', 'A', 'M', 'R', 'E', 'C', 'S', '1'};
+inline constexpr std::uint64_t kRecordShardVersion = 2;
+
+// All records of a shard file in file order
+std::vector<GameRecord> load_record_shard(const std::string& path);
+
+}  // namespace camelup::sim
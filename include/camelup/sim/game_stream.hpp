@@ -0,0 +1,33 @@
+#pragma once
+
+#include "camelup/actions.hpp"
+#include "camelup/game_state.hpp"
+#include "camelup/sim/batch.hpp"
+#include "camelup/util/generator.hpp"
+
+namespace camelup::sim {
+
+// One action of a streamed game with its outcome, or the end of the game
+//
+// A roll's outcome is drawn before the step is yielded and the action is applied once the
+// stream resumes, so `state` is the state the action was chosen in and no state is copied.
+// After its last action every game yields one more step with no action whose `state` is the
+// final state. The pointers refer into the generator and stay valid until it resumes.
+struct GameStep {
+    int game{0};
+    int turn{0};                      // actions applied so far
+    const GameState* state{nullptr};
+    const Action* action{nullptr};    // nullptr on the final step
+    DieRoll roll;                     // the die a roll action draws, meaningful for rolls only
+};
+
+// Lazily play game `game` of a batch, the same game play_game plays
+// Beyond the coroutine frame and the state's own growth, stepping allocates nothing.
+util::Generator<GameStep> game_steps(BatchOptions options, int game);
+
+// All options.games games, `width` of them in flight at once, one step of each in turn
+// A finished game hands its slot to the next game, so the steps of each game arrive in order
+// and match game_steps. Throws std::invalid_argument when `width` is not positive.
+util::Generator<GameStep> interleaved_steps(BatchOptions options, int width);
+
+}  // namespace camelup::sim
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "camelup/actions.hpp"
+#include "camelup/game_state.hpp"
+
+namespace camelup::sim {
+
+// Exhaustive expansion of the game tree from a state, for validating the move generator and
+// apply paths and for measuring their throughput
+//
+// Every legal action is a child, except that a roll expands into one child per die still in
+// the pyramid and distance 1..3. Terminal states are not expanded further.
+struct PerftOptions {
+    int depth{1};
+    // Count each distinct state once per depth and expand it once. States are told apart by
+    // policy_memo::state_hash, collisions between distinct states are ignored.
+    bool dedupe{false};
+    std::size_t threads{1};  // zero picks std::thread::hardware_concurrency
+};
+
+struct PerftCounts {
+    std::uint64_t nodes{0};  // states at exactly `depth`
+    // Moves into those states by the action that made them, a roll outcome counts as a roll.
+    // With dedupe these are the moves out of the distinct states one ply up, so they may sum
+    // to more than `nodes`.
+    std::array<std::uint64_t, kActionTypeCount> moves{};
+    std::uint64_t terminal{0};  // finished games reached at any depth up to `depth`
+
+    bool operator==(const PerftCounts&) const = default;
+};
+
+// Subtrees a few plies below `root` are spread over per-thread deques; a thread that runs out
+// steals the oldest subtree of another, so uneven subtrees still keep every thread busy.
+// Counts do not depend on the thread count.
+// Throws std::invalid_argument for a negative depth
+PerftCounts perft(const GameState& root, const PerftOptions& options);
+
+}  // namespace camelup::sim
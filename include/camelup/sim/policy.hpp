@@ -0,0 +1,37 @@
+#pragma once
+
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "camelup/actions.hpp"
+#include "camelup/game_state.hpp"
+
+namespace camelup::sim {
+
+enum class Policy {
+    RollOnly,
+    FirstLegal,
+    RandomLegal,
+    Greedy  // best immediate expected value by analysis::rank_actions
+};
+
+inline constexpr int kPolicyCount = static_cast<int>(Policy::Greedy) + 1;
+
+// Race samples behind the winner and loser bet values Greedy compares, drawn with a fixed seed
+inline constexpr int kGreedyRaceSamples = 64;
+
+// Command line names: roll, first, random, greedy
+bool parse_policy(std::string_view value, Policy& out);
+const char* policy_name(Policy policy);
+
+// Every policy but RandomLegal picks the same action whenever it sees the same state
+[[nodiscard]] constexpr bool deterministic_policy(Policy policy) noexcept { return policy != Policy::RandomLegal; }
+
+// Pick one of `legal_actions` for `state`, only RandomLegal draws from `chooser_rng`
+// Deterministic choices go through the calling thread's policy memo while it is enabled
+// Throws std::runtime_error when there is nothing to choose from
+const Action& choose_action(const GameState& state, const std::vector<Action>& legal_actions, Policy policy,
+                            std::mt19937& chooser_rng);
+
+}  // namespace camelup::sim
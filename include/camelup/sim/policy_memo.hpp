@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "camelup/game_state.hpp"
+
+// Per-thread memo of deterministic policy choices, off until enable() is called at run time
+//
+// choose_action asks the calling thread's table before running a deterministic policy and
+// stores the index of the legal action it picked. Tables are never shared, so lookups take no
+// lock, and a table is cleared when it reaches its entry cap. A policy's choice depends only on
+// the state, so the memo never changes a game; only the time spent choosing.
+
+namespace camelup::sim::policy_memo {
+
+inline constexpr std::size_t kDefaultEntriesPerThread = 1 << 16;
+
+// Hash of every stored GameState field, skipping those derived from others (desert tile owners,
+// desert legality and bet card availability); collisions between distinct states are ignored
+std::uint64_t state_hash(const GameState& state) noexcept;
+
+// Clear earlier entries and statistics and begin memoising, `entries_per_thread` must be positive
+void enable(std::size_t entries_per_thread = kDefaultEntriesPerThread);
+void disable() noexcept;
+[[nodiscard]] bool enabled() noexcept;
+
+// The calling thread's remembered index for `hash`, counted as a hit or a miss
+std::optional<std::size_t> find(std::uint64_t hash);
+void insert(std::uint64_t hash, std::size_t index);
+
+struct Stats {
+    std::uint64_t hits{0};
+    std::uint64_t misses{0};
+    std::uint64_t clears{0};  // tables emptied at their cap
+
+    [[nodiscard]] double hit_rate() const noexcept {
+        return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(hits + misses);
+    }
+};
+
+// Summed over every thread since the last enable()
+[[nodiscard]] Stats stats();
+
+}  // namespace camelup::sim::policy_memo
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "camelup/sim/game_record.hpp"
+
+namespace camelup::sim {
+
+// Compact codec for blocks of game records
+//
+//   block: record count (varint), records
+//   record: flags byte, optional header fields, nibble stream padded to a byte
+//
+// Flags say which header fields repeat the previous record, only the others follow as varints
+//
+//   bit 0  game is the previous game + 1, else zigzag delta from that follows
+//   bit 1  seed - game matches the previous record, else zigzag delta of it follows
+//   bit 2  player count matches the previous record, else one byte follows
+//   bit 3  game reached a terminal state
+//
+// Rolls are the common case, so a roll costs one nibble holding its outcome (camel * 3 +
+// distance - 1) and carries no action type. Nibble 15 escapes to a run of other actions:
+//
+//   15 0            end of game
+//   15 n a1 .. an   n = 1..15 non-roll actions, two nibbles each (low nibble first)
+//
+// Non-roll action codes: desert tile t as oasis (t - 1) * 2 or mirage (t - 1) * 2 + 1,
+// leg ticket 30 + c, winner bet 35 + c, loser bet 40 + c.
+//
+// A roll-only game fits in about a dozen bytes, seeded batches cost one header byte per game.
+// Policies that rarely roll cost about a byte per action, close to the raw format.
+
+// Append one encoded block to `out`
+// Throws std::invalid_argument when a record's rolls do not match its roll actions
+void encode_records(const std::vector<GameRecord>& records, std::vector<std::uint8_t>& out);
+
+// Decode one block into `out`, reusing its storage, and return the bytes consumed
+// Throws std::runtime_error on truncated or corrupt input
+std::size_t decode_records(const std::uint8_t* data, std::size_t size, std::vector<GameRecord>& out);
+
+}  // namespace camelup::sim
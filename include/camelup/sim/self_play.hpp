@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "camelup/sim/batch.hpp"
+#include "camelup/sim/game_record.hpp"
+#include "camelup/util/mpsc_queue.hpp"
+
+namespace camelup::sim {
+
+struct SelfPlayOptions {
+    BatchOptions batch;
+    std::string output_prefix;          // shards are <prefix>-00000.rec, <prefix>-00001.rec, ...
+    std::size_t producers{0};           // zero picks std::thread::hardware_concurrency
+    std::size_t queue_capacity{1024};   // finished games in flight, rounded up to a power of two
+    std::size_t batch_records{256};     // records encoded and written together
+    std::size_t shard_records{1 << 16}; // records per shard file
+};
+
+struct SelfPlayStats {
+    std::uint64_t games{0};  // records taken off the queue, all written once the run is over
+    std::uint64_t finished{0};
+    std::uint64_t turns{0};
+    std::uint64_t bytes{0};  // shard bytes written
+    std::uint64_t shards{0};
+    std::uint64_t producer_waits{0};  // pushes that found the queue full and backed off
+    std::size_t queue_capacity{0};
+    std::size_t max_queue_depth{0};
+    double mean_queue_depth{0.0};  // sampled by the writer at every record
+    double seconds{0.0};
+
+    [[nodiscard]] double games_per_second() const noexcept {
+        return seconds > 0.0 ? static_cast<double>(games) / seconds : 0.0;
+    }
+};
+
+// Self-play data pipeline
+//
+// Producer threads claim game indices from a shared counter, play them with the batch policy and
+// push finished records into a bounded lock-free queue. One writer thread drains the queue,
+// packs records in batches and writes them to record shards. A full queue makes producers back
+// off, so memory stays bounded by the queue capacity however slow the disk is.
+// Records arrive in completion order, every record carries its game index.
+class SelfPlayPipeline {
+public:
+    // Starts the threads, throws std::invalid_argument for a negative game count or missing prefix
+    explicit SelfPlayPipeline(SelfPlayOptions options);
+    // Waits for the run, a failure there is dropped
+    ~SelfPlayPipeline();
+
+    SelfPlayPipeline(const SelfPlayPipeline&) = delete;
+    SelfPlayPipeline& operator=(const SelfPlayPipeline&) = delete;
+
+    // Live metrics, safe to call from any thread while the pipeline runs
+    [[nodiscard]] SelfPlayStats stats() const;
+
+    // Join every thread and return the final metrics, rethrows the first producer or writer failure
+    SelfPlayStats wait();
+
+    // Shard files written so far
+    [[nodiscard]] std::vector<std::string> shard_paths() const;
+
+private:
+    SelfPlayOptions options_;
+    util::MpscQueue<GameRecord> queue_;
+    std::chrono::steady_clock::time_point started_;
+
+    std::atomic<int> next_game_{0};
+    std::atomic<std::size_t> producers_running_{0};
+    std::atomic<bool> aborted_{false};
+
+    std::atomic<std::uint64_t> games_{0};
+    std::atomic<std::uint64_t> finished_{0};
+    std::atomic<std::uint64_t> turns_{0};
+    std::atomic<std::uint64_t> bytes_{0};
+    std::atomic<std::uint64_t> producer_waits_{0};
+    std::atomic<std::uint64_t> depth_sum_{0};
+    std::atomic<std::size_t> max_depth_{0};
+    std::atomic<double> seconds_{0.0};
+
+    mutable std::mutex mutex_;
+    std::vector<std::string> shard_paths_;
+    std::exception_ptr failure_;
+
+    std::vector<std::thread> producers_;
+    std::thread writer_;
+    bool joined_{false};
+
+    void run_producer();
+    void run_writer();
+    void fail(std::exception_ptr failure);
+};
+
+}  // namespace camelup::sim
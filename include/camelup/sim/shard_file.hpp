@@ -0,0 +1,31 @@
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include "camelup/sim/batch.hpp"
+
+namespace camelup::sim {
+
+// Binary shard result file, little-endian 64-bit fields throughout
+//
+//   magic "CAMSHRD1", version
+//   batch options (seed, players, games, turn limit, policy, optional start snapshot)
+//   shard index and count, node count
+//   per node: first block, block count, run summary
+//
+// Summaries keep their sketch state, so merging files matches merging in memory exactly.
+inline constexpr char kShardFileMagic[8] = {'C', 'A', 'M', 'S', 'H', 'R', 'D', '1'};
+inline constexpr std::uint64_t kShardFileVersion = 2;
+
+void write_shard(std::ostream& out, const ShardResult& shard);
+// Throws std::runtime_error on a wrong magic, unknown version or truncated data
+ShardResult read_shard(std::istream& in);
+
+// Writes a temporary file next to `path` and renames it over `path`, so readers and crashes
+// see either the old file or the complete new one
+void save_shard(const std::string& path, const ShardResult& shard);
+ShardResult load_shard(const std::string& path);
+
+}  // namespace camelup::sim
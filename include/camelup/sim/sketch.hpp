@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace camelup::sim {
+
+// Fixed-width bucket counts of non-negative integers, the last bucket also takes overflow
+class Histogram {
+public:
+    Histogram(std::size_t buckets, int bucket_width);
+
+    void record(int value);
+    // Throws std::invalid_argument unless both histograms have the same buckets
+    void merge(const Histogram& other);
+
+    [[nodiscard]] std::uint64_t count() const noexcept { return count_; }
+    [[nodiscard]] double mean() const noexcept;
+    [[nodiscard]] int bucket_width() const noexcept { return bucket_width_; }
+    [[nodiscard]] const std::vector<std::uint64_t>& buckets() const noexcept { return buckets_; }
+    // Lower edge of the bucket holding the value of rank `rank` in 0..1
+    [[nodiscard]] int quantile(double rank) const;
+
+    // Little-endian binary form, read throws std::runtime_error on truncated or corrupt input
+    void write(std::ostream& out) const;
+    static Histogram read(std::istream& in);
+
+    bool operator==(const Histogram&) const = default;
+
+private:
+    int bucket_width_;
+    std::vector<std::uint64_t> buckets_;
+    std::uint64_t count_{0};
+    std::int64_t sum_{0};
+};
+
+// KLL quantile sketch: levels of retained items, an item on level h stands for 2^h inputs
+//
+// A level over its capacity is sorted and every other item is promoted, so memory is
+// O(k log(n / k)) and rank error about 1.7 / k. Compactions alternate which half they keep
+// instead of flipping a coin, so a sketch is a pure function of its inputs and merge order.
+class KllSketch {
+public:
+    static constexpr int kDefaultK = 200;
+
+    KllSketch() : KllSketch(kDefaultK) {}
+    explicit KllSketch(int k);
+
+    void update(double value);
+    // Throws std::invalid_argument when the sketches use different k
+    void merge(const KllSketch& other);
+
+    [[nodiscard]] std::uint64_t count() const noexcept { return count_; }
+    [[nodiscard]] double min() const noexcept { return min_; }
+    [[nodiscard]] double max() const noexcept { return max_; }
+    [[nodiscard]] std::size_t retained() const noexcept;
+    // Value of approximate rank `rank` in 0..1, throws std::runtime_error on an empty sketch
+    [[nodiscard]] double quantile(double rank) const;
+
+    // Binary form keeps the compaction state, a read sketch continues exactly like the original
+    void write(std::ostream& out) const;
+    static KllSketch read(std::istream& in);
+
+    bool operator==(const KllSketch&) const = default;
+
+private:
+    int k_;
+    std::uint64_t count_{0};
+    double min_{0.0};
+    double max_{0.0};
+    std::vector<std::vector<double>> levels_;
+    std::uint64_t keep_odd_{0};  // per level, which half the next compaction keeps
+
+    [[nodiscard]] std::size_t capacity(std::size_t level) const noexcept;
+    void compress();
+};
+
+}  // namespace camelup::sim
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "camelup/actions.hpp"
+
+namespace camelup::snapshot {
+
+// Single-token action notation, no spaces so lists can be space separated
+//
+//   roll          roll a die, outcome drawn by whoever applies it
+//   roll:B2       roll with a known outcome (camel letter and distance), parsed by parse_roll
+//   desert:5+     place desert tile on tile 5 as oasis, desert:5- for mirage
+//   ticket:B      take a leg ticket
+//   winner:B      bet on the race winner
+//   loser:B       bet on the race loser
+std::string to_notation(const Action& action);
+std::string to_notation(const DieRoll& roll);
+
+// Parse an action token, throws std::invalid_argument on malformed input
+// A roll with an outcome parses as the plain roll action
+Action action_from_notation(std::string_view token);
+
+// True when the token names a roll with an explicit outcome, which is stored in `roll`
+bool parse_roll(std::string_view token, DieRoll& roll);
+
+}  // namespace camelup::snapshot
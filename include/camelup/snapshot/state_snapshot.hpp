@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "camelup/game_state.hpp"
+
+namespace camelup::snapshot {
+
+// Fixed-size binary snapshot of a GameState
+//
+// Fields are bit-packed LSB first into a byte array, so the encoding does not depend on host
+// endianness. The first 4 bits hold kSnapshotVersion. Layout of version 1 in order:
+//
+//   version:4  player_count-2:3  current_player:3  terminal:1  leg_number-1:8
+//   per camel: tile:5 height:3
+//   die mask:5  leg tickets remaining per camel:2
+//   per active player: desert tile+1:5 (0 = none) mirage:1  money:8 (two's complement)
+//   held ticket count:4  per ticket: player:3 camel:3 value index:2
+//   winner stack size:6  loser stack size:6  per card: player:3 camel:3
+//
+// Fields that follow from others are rebuilt on decode rather than stored
+// - desert_tile_owner from desert_tiles
+// - final bet card availability from the bet stacks
+// - leg ticket values, which are always kLegTicketDefaults
+inline constexpr std::size_t kSnapshotBytes = 64;
+inline constexpr std::uint8_t kSnapshotVersion = 1;
+
+using StateSnapshot = std::array<std::uint8_t, kSnapshotBytes>;
+
+// Pack a state, throws std::length_error when held tickets, bet cards or money exceed the
+// fixed layout and std::invalid_argument for states the layout cannot describe
+StateSnapshot encode(const GameState& state);
+
+// Unpack a snapshot, throws std::invalid_argument on unknown version, inconsistent data or a
+// position from_notation would refuse
+GameState decode(const StateSnapshot& snapshot);
+
+// FEN-style text notation, eleven space separated fields
+//
+//   board      tiles 0..16 separated by '/', a number is a run of empty tiles,
+//              letters are a stack bottom to top (B G Y O W)
+//   dice       letters of dice still in the pyramid, '-' for none
+//   tickets    leg tickets remaining per camel, one digit each in camel order
+//   desert     per player, tile followed by '+' or '-', or '-' for none, comma separated
+//   money      per player, comma separated, also fixes the player count
+//   held       per player leg tickets as camel letter and value (e.g. B5G3), '-' for none
+//   winner     winner bet stack bottom to top as player digit and camel letter, '-' for none
+//   loser      loser bet stack, same format
+//   player     current player
+//   leg        leg number
+//   status     '-' while running, 'T' once terminal
+//
+// Example opening position: 1/B/GY/OW/13 BGYOW 33333 -,- 3,3 -,- - - 0 1 -
+std::string to_notation(const GameState& state);
+
+// Parse notation, throws std::invalid_argument with a description of the bad field
+GameState from_notation(std::string_view notation);
+
+}  // namespace camelup::snapshot
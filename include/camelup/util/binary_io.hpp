@@ -0,0 +1,42 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+// Little-endian fixed-width fields on streams, independent of host byte order
+
+namespace camelup::util {
+
+inline void write_u64(std::ostream& out, std::uint64_t value) {
+    char bytes[8];
+    for (int i = 0; i < 8; ++i) {
+        bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFFu);
+    }
+    out.write(bytes, sizeof(bytes));
+}
+
+// Throws std::runtime_error when the stream ends early
+inline std::uint64_t read_u64(std::istream& in) {
+    unsigned char bytes[8];
+    if (!in.read(reinterpret_cast<char*>(bytes), sizeof(bytes))) {
+        throw std::runtime_error("unexpected end of binary stream");
+    }
+    std::uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= static_cast<std::uint64_t>(bytes[i]) << (8 * i);
+    }
+    return value;
+}
+
+inline void write_f64(std::ostream& out, double value) {
+    write_u64(out, std::bit_cast<std::uint64_t>(value));
+}
+
+inline double read_f64(std::istream& in) {
+    return std::bit_cast<double>(read_u64(in));
+}
+
+}  // namespace camelup::util
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+namespace camelup::util {
+
+// Lazy single-pass sequence produced by a coroutine, a minimal std::generator
+//
+// `co_yield value` hands the consumer a const reference to an object living in the coroutine
+// frame, valid until the generator resumes, so yielding copies nothing. The frame is allocated
+// once when the coroutine is called; resuming it allocates nothing. Exceptions thrown in the
+// body surface from the iterator increment that resumed it.
+template <typename T>
+class Generator {
+public:
+    struct promise_type {
+        const T* current{nullptr};
+        std::exception_ptr error;
+
+        Generator get_return_object() noexcept {
+            return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(const T& value) noexcept {
+            current = std::addressof(value);
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { error = std::current_exception(); }
+
+        // Generators are consumed with range-for, co_await has no meaning inside them
+        void await_transform() = delete;
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = T;
+
+        iterator() = default;
+        explicit iterator(Handle handle) : handle_(handle) {}
+
+        const T& operator*() const { return *handle_.promise().current; }
+        const T* operator->() const { return handle_.promise().current; }
+
+        iterator& operator++() {
+            resume(handle_);
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+
+        bool operator==(std::default_sentinel_t) const { return !handle_ || handle_.done(); }
+
+    private:
+        Handle handle_;
+    };
+
+    Generator() = default;
+    Generator(Generator&& other) noexcept
+        : handle_(std::exchange(other.handle_, {})), started_(std::exchange(other.started_, false)) {}
+    Generator& operator=(Generator&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle_ = std::exchange(other.handle_, {});
+            started_ = std::exchange(other.started_, false);
+        }
+        return *this;
+    }
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+    ~Generator() { reset(); }
+
+    // Runs the body up to its first co_yield, so begin() may throw
+    iterator begin() {
+        if (handle_ && !started_) {
+            started_ = true;
+            resume(handle_);
+        }
+        return iterator(handle_);
+    }
+    std::default_sentinel_t end() const noexcept { return {}; }
+
+    // Advance to the next value and return it, nullptr once the body has finished
+    const T* next() {
+        if (!handle_ || handle_.done()) {
+            return nullptr;
+        }
+        started_ = true;
+        resume(handle_);
+        return handle_.done() ? nullptr : handle_.promise().current;
+    }
+
+private:
+    explicit Generator(Handle handle) : handle_(handle) {}
+
+    static void resume(Handle handle) {
+        handle.resume();
+        if (handle.done() && handle.promise().error) {
+            std::rethrow_exception(std::exchange(handle.promise().error, {}));
+        }
+    }
+
+    void reset() {
+        if (handle_) {
+            handle_.destroy();
+            handle_ = {};
+        }
+    }
+
+    Handle handle_;
+    bool started_{false};
+};
+
+}  // namespace camelup::util
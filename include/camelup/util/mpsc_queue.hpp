@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>  // min
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+namespace camelup::util {
+
+// Bounded lock-free queue for many producers and one consumer
+//
+// A ring of cells, each with a sequence number saying whose turn the cell is (Vyukov's bounded
+// queue). Producers claim a slot with one CAS on the tail, the consumer owns the head outright.
+// A full queue makes try_push fail instead of allocating, callers decide how to back off.
+template <typename T>
+class MpscQueue {
+public:
+    // Capacity is rounded up to a power of two
+    explicit MpscQueue(std::size_t capacity) {
+        if (capacity == 0) {
+            throw std::invalid_argument("queue capacity must be positive");
+        }
+        std::size_t size = 1;
+        while (size < capacity) {
+            size *= 2;
+        }
+        mask_ = size - 1;
+        cells_ = std::make_unique<Cell[]>(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Any thread, false when the queue is full and `value` is left untouched
+    bool try_push(T& value) {
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells_[tail & mask_];
+            const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const auto lag = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(tail);
+            if (lag == 0) {
+                if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(tail + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (lag < 0) {
+                return false;
+            } else {
+                tail = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer thread only
+    std::optional<T> try_pop() {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        Cell& cell = cells_[head & mask_];
+        if (cell.sequence.load(std::memory_order_acquire) != head + 1) {
+            return std::nullopt;
+        }
+        std::optional<T> value(std::move(cell.value));
+        cell.sequence.store(head + mask_ + 1, std::memory_order_release);
+        head_.store(head + 1, std::memory_order_relaxed);
+        return value;
+    }
+
+    // Items pushed and not yet popped, racy by nature but never above capacity
+    [[nodiscard]] std::size_t size_approx() const noexcept {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        return tail > head ? std::min(tail - head, capacity()) : 0;
+    }
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return mask_ + 1; }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence{0};
+        T value{};
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    std::size_t mask_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    alignas(64) std::atomic<std::size_t> head_{0};
+};
+
+}  // namespace camelup::util
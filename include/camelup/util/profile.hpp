@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Per-phase wall time counters, switched on at run time with profile::set_enabled
+//
+// Instrumentation compiles to nothing unless the build defines CAMELUP_PROFILING
+// (cmake -DCAMELUP_ENABLE_PROFILING=ON, the default). When compiled in but not enabled a
+// scope costs one relaxed atomic load.
+
+namespace camelup::util::profile {
+
+#ifdef CAMELUP_PROFILING
+inline constexpr bool kCompiledIn = true;
+#else
+inline constexpr bool kCompiledIn = false;
+#endif
+
+// Phases nest: apply times include the roll, move and resolution phases they trigger
+enum class Phase : std::uint8_t {
+    LegalActions,
+    PolicySelect,
+    ApplyRollDie,
+    ApplyPlaceDesertTile,
+    ApplyTakeLegTicket,
+    ApplyBetWinner,
+    ApplyBetLoser,
+    RollDie,
+    MoveCamelStack,
+    LegEnd,
+    GamePayouts,
+};
+
+inline constexpr std::size_t kPhaseCount = static_cast<std::size_t>(Phase::GamePayouts) + 1;
+
+const char* phase_name(Phase phase);
+
+struct PhaseTotals {
+    std::uint64_t count{0};
+    std::uint64_t nanoseconds{0};
+};
+
+using Profile = std::array<PhaseTotals, kPhaseCount>;
+
+void set_enabled(bool enabled) noexcept;
+[[nodiscard]] bool enabled() noexcept;
+
+// Totals of every thread so far, threads that exited included
+[[nodiscard]] Profile collect();
+void reset();
+
+// Aligned table with mean nanoseconds per call, phases never entered are skipped
+void print_table(std::ostream& out, const Profile& profile);
+// One JSON object keyed by phase name
+void write_json(std::ostream& out, const Profile& profile);
+
+namespace detail {
+
+// Counters of the calling thread, single writer so plain relaxed load and store suffice
+void record(Phase phase, std::uint64_t nanoseconds) noexcept;
+
+}  // namespace detail
+
+// Times the enclosing scope into `phase` when profiling is enabled
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Phase phase) noexcept : phase_(phase), active_(enabled()) {
+        if (active_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+    ~ScopedTimer() {
+        if (active_) {
+            const auto elapsed = std::chrono::steady_clock::now() - start_;
+            detail::record(phase_,
+                           static_cast<std::uint64_t>(
+                               std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Phase phase_;
+    bool active_;
+    std::chrono::steady_clock::time_point start_{};
+};
+
+}  // namespace camelup::util::profile
+
+#define CAMELUP_PROFILE_CONCAT_INNER(lhs, rhs) lhs##rhs
+#define CAMELUP_PROFILE_CONCAT(lhs, rhs) CAMELUP_PROFILE_CONCAT_INNER(lhs, rhs)
+
+#ifdef CAMELUP_PROFILING
+#define CAMELUP_PROFILE_SCOPE(phase) \
+    const ::camelup::util::profile::ScopedTimer CAMELUP_PROFILE_CONCAT(camelup_profile_scope_, __LINE__)(phase)
+#else
+#define CAMELUP_PROFILE_SCOPE(phase) static_cast<void>(0)
+#endif
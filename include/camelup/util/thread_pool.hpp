@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace camelup::util {
+
+// Fixed set of worker threads draining one FIFO task queue
+class ThreadPool {
+public:
+    // Zero threads picks std::thread::hardware_concurrency
+    explicit ThreadPool(std::size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    [[nodiscard]] std::size_t size() const noexcept { return workers_.size(); }
+
+    // Queue a callable and get a future for its result, exceptions propagate through the future
+    template <typename Fn>
+    auto submit(Fn&& fn) -> std::future<std::invoke_result_t<std::decay_t<Fn>>> {
+        using Result = std::invoke_result_t<std::decay_t<Fn>>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+        auto future = task->get_future();
+        enqueue([task]() { (*task)(); });
+        return future;
+    }
+
+private:
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    bool stopping_{false};
+
+    void enqueue(std::function<void()> task);
+    void run_worker();
+};
+
+}  // namespace camelup::util
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "camelup/util/profile.hpp"  // CAMELUP_PROFILE_CONCAT
+
+// Chrome / Perfetto trace-event recorder, off until start() is called at run time
+//
+// Every thread records finished spans into its own ring buffer, so recording takes no lock
+// and memory stays bounded: a thread keeps its most recent events_per_thread spans. The
+// buffers are only read by stats and write_json, which expect recording to have stopped.
+
+namespace camelup::util::trace {
+
+inline constexpr std::size_t kDefaultEventsPerThread = 1 << 16;
+
+// Clear earlier spans and begin recording, `events_per_thread` must be positive
+void start(std::size_t events_per_thread = kDefaultEventsPerThread);
+void stop() noexcept;
+[[nodiscard]] bool enabled() noexcept;
+
+// Label the calling thread in the trace viewer, while recording this also sizes its ring
+// buffer so that its first span does not allocate
+void set_thread_name(const std::string& name);
+
+struct Stats {
+    std::uint64_t recorded{0};
+    std::uint64_t dropped{0};  // overwritten when a ring buffer wrapped
+};
+
+// Expects recording to have stopped, like write_json
+[[nodiscard]] Stats stats();
+
+// {"traceEvents":[...]} with one complete ("X") event per kept span plus thread names
+void write_json(std::ostream& out);
+// Throws std::runtime_error when the file cannot be written
+void write_file(const std::string& path);
+
+namespace detail {
+
+std::int64_t now_ns() noexcept;
+void record(const char* name, const char* category, std::int64_t start_ns, std::int64_t end_ns) noexcept;
+
+}  // namespace detail
+
+// Records the enclosing scope as one span, `name` and `category` must be string literals
+class Span {
+public:
+    Span(const char* name, const char* category) noexcept
+        : name_(name), category_(category), start_ns_(enabled() ? detail::now_ns() : -1) {}
+    ~Span() {
+        if (start_ns_ >= 0) {
+            detail::record(name_, category_, start_ns_, detail::now_ns());
+        }
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    const char* name_;
+    const char* category_;
+    std::int64_t start_ns_;
+};
+
+}  // namespace camelup::util::trace
+
+#define CAMELUP_TRACE_SPAN(name, category) \
+    const ::camelup::util::trace::Span CAMELUP_PROFILE_CONCAT(camelup_trace_span_, __LINE__)(name, category)
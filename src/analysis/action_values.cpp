@@ -0,0 +1,344 @@
+#include "camelup/analysis/action_values.hpp"
+
+#include <algorithm>  // max, max_element, min, stable_sort
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <variant>
+
+#include "camelup/rules/legal_actions.hpp"
+
+namespace camelup::analysis {
+
+namespace {
+
+// Roll reward paid to the mover
+constexpr double kRollValue = 1.0;
+
+double leg_ticket_value(const GameState& state, CamelId camel, const LegOdds& leg) {
+    const int remaining = state.leg_tickets_remaining[camel];
+    if (remaining <= 0 || remaining > kLegTicketCount) {
+        return 0.0;
+    }
+    const int ticket = state.leg_ticket_values[camel][kLegTicketCount - remaining];
+    const double completed = 1.0 - leg.race_end;
+    const double other = completed - leg.first[camel] - leg.second[camel];
+    return ticket * leg.first[camel] + leg.second[camel] - other;
+}
+
+// Payout for a correct bet placed now, by position among earlier cards on the same camel
+int final_bet_payout(const std::vector<FinalBetCard>& stack, CamelId camel) {
+    int earlier_correct = 0;
+    for (const auto& card : stack) {
+        if (card.camel == camel) {
+            ++earlier_correct;
+        }
+    }
+    return earlier_correct < static_cast<int>(kFinalBetPayouts.size()) ? kFinalBetPayouts[earlier_correct] : 1;
+}
+
+// Correct bets pay by position among correct cards, wrong bets cost one coin
+double final_bet_value(int payout, double probability) {
+    return payout * probability - (1.0 - probability);
+}
+
+// The state with the mover's desert tile moved to `payload`, before the turn passes
+GameState with_desert_tile(const GameState& state, const PlaceDesertTilePayload& payload) {
+    const PlayerId player = state.current_player;
+    GameState placed = state;
+    const int previous_tile = placed.desert_tiles[player].tile;
+    if (previous_tile >= 0 && previous_tile < kBoardTiles && placed.desert_tile_owner[previous_tile] == player) {
+        placed.desert_tile_owner[previous_tile] = -1;
+    }
+    placed.desert_tiles[player] = {payload.tile, payload.move_delta};
+    placed.desert_tile_owner[payload.tile] = player;
+    rules::refresh_desert_legality(placed);
+    return placed;
+}
+
+double desert_tile_value(const GameState& state, const PlaceDesertTilePayload& payload, const LegOdds& leg) {
+    // Placing uses the turn, so the enumeration starts from the same dice as the current leg
+    const PlayerId player = state.current_player;
+    const auto with_tile = leg_odds(with_desert_tile(state, payload));
+    return with_tile.desert_coins[player] - leg.desert_coins[player];
+}
+
+// Ticket payoff over leg outcomes: its value when first, 1 when second, -1 for any other
+// completed leg and nothing when the race ends first
+double leg_ticket_variance(const GameState& state, CamelId camel, const LegOdds& leg, double value) {
+    const int remaining = state.leg_tickets_remaining[camel];
+    if (remaining <= 0 || remaining > kLegTicketCount) {
+        return 0.0;
+    }
+    const int ticket = state.leg_ticket_values[camel][kLegTicketCount - remaining];
+    const double other = 1.0 - leg.race_end - leg.first[camel] - leg.second[camel];
+    return std::max(0.0, ticket * ticket * leg.first[camel] + leg.second[camel] + other - value * value);
+}
+
+// Two-point payoff: `payout` with `probability`, -1 otherwise
+double final_bet_variance(int payout, double probability) {
+    return (payout + 1.0) * (payout + 1.0) * probability * (1.0 - probability);
+}
+
+ActionEstimate estimate_action(const GameState& state, const Action& action, const LegOdds& leg,
+                               const RaceOdds& race) {
+    ActionEstimate estimate{action, evaluate_action(state, action, leg, race).expected_value};
+    switch (action.type()) {
+        case ActionType::TakeLegTicket:
+            estimate.variance = leg_ticket_variance(state, std::get<TakeLegTicketPayload>(action.payload).camel, leg,
+                                                    estimate.expected_value);
+            break;
+        case ActionType::BetWinner: {
+            const CamelId camel = std::get<BetWinnerPayload>(action.payload).camel;
+            estimate.variance = final_bet_variance(final_bet_payout(state.winner_bet_stack, camel), race.winner[camel]);
+            break;
+        }
+        case ActionType::BetLoser: {
+            const CamelId camel = std::get<BetLoserPayload>(action.payload).camel;
+            estimate.variance = final_bet_variance(final_bet_payout(state.loser_bet_stack, camel), race.loser[camel]);
+            break;
+        }
+        case ActionType::RollDie:
+        case ActionType::PlaceDesertTile:
+            break;
+    }
+    return estimate;
+}
+
+// Desert tile enumerations shared by the calling thread and pool helpers
+// Helpers hold it by shared_ptr, so one starting after the caller returned finds no work left
+struct DesertWork {
+    std::vector<GameState> placed;
+    std::vector<std::optional<CoinMoments>> moments;  // empty when skipped at the deadline
+    PlayerId player{0};
+    std::chrono::steady_clock::time_point deadline;
+    std::atomic<std::size_t> next{0};
+    std::mutex mutex;
+    std::condition_variable done;
+    std::size_t finished{0};
+    std::exception_ptr error;
+
+    // Claim and evaluate candidates until none are left
+    void drain() {
+        for (std::size_t index = next++; index < placed.size(); index = next++) {
+            std::exception_ptr failure;
+            try {
+                if (std::chrono::steady_clock::now() < deadline) {
+                    moments[index] = desert_coin_moments(placed[index], player);
+                }
+            } catch (...) {
+                failure = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (failure && !error) {
+                error = failure;
+            }
+            if (++finished == placed.size()) {
+                done.notify_all();
+            }
+        }
+    }
+};
+
+}  // namespace
+
+ActionValue evaluate_action(const GameState& state, const Action& action, const LegOdds& leg, const RaceOdds& race) {
+    ActionValue value{action, 0.0};
+    switch (action.type()) {
+        case ActionType::RollDie:
+            value.expected_value = kRollValue;
+            break;
+        case ActionType::PlaceDesertTile:
+            value.expected_value = desert_tile_value(state, std::get<PlaceDesertTilePayload>(action.payload), leg);
+            break;
+        case ActionType::TakeLegTicket:
+            value.expected_value = leg_ticket_value(state, std::get<TakeLegTicketPayload>(action.payload).camel, leg);
+            break;
+        case ActionType::BetWinner: {
+            const CamelId camel = std::get<BetWinnerPayload>(action.payload).camel;
+            value.expected_value = final_bet_value(final_bet_payout(state.winner_bet_stack, camel), race.winner[camel]);
+            break;
+        }
+        case ActionType::BetLoser: {
+            const CamelId camel = std::get<BetLoserPayload>(action.payload).camel;
+            value.expected_value = final_bet_value(final_bet_payout(state.loser_bet_stack, camel), race.loser[camel]);
+            break;
+        }
+    }
+    return value;
+}
+
+std::vector<ActionValue> rank_actions(const GameState& state, const LegOdds& leg, const RaceOdds& race) {
+    std::vector<ActionValue> ranked;
+    for (const auto& action : rules::legal_actions(state)) {
+        ranked.push_back(evaluate_action(state, action, leg, race));
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), [](const ActionValue& lhs, const ActionValue& rhs) {
+        return lhs.expected_value > rhs.expected_value;
+    });
+    return ranked;
+}
+
+std::vector<ActionEstimate> analyse_actions(const GameState& state, const LegOdds& leg, const RaceOdds& race,
+                                            util::ThreadPool& pool, std::chrono::steady_clock::time_point deadline) {
+    const auto legal = rules::legal_actions(state);
+    auto work = std::make_shared<DesertWork>();
+    work->player = state.current_player;
+    work->deadline = deadline;
+    std::vector<std::size_t> desert_index;
+    for (std::size_t i = 0; i < legal.size(); ++i) {
+        if (legal[i].type() == ActionType::PlaceDesertTile) {
+            work->placed.push_back(with_desert_tile(state, std::get<PlaceDesertTilePayload>(legal[i].payload)));
+            desert_index.push_back(i);
+        }
+    }
+    work->moments.resize(work->placed.size());
+
+    // Helpers start on the expensive candidates while the cheap ones are valued here
+    const std::size_t helpers = std::min(pool.size(), work->placed.size());
+    for (std::size_t i = 0; i < helpers; ++i) {
+        static_cast<void>(pool.submit([work]() { work->drain(); }));
+    }
+
+    std::vector<ActionEstimate> ranked;
+    ranked.reserve(legal.size());
+    for (const auto& action : legal) {
+        ranked.push_back(action.type() == ActionType::PlaceDesertTile ? ActionEstimate{action}
+                                                                       : estimate_action(state, action, leg, race));
+    }
+
+    work->drain();
+    {
+        std::unique_lock<std::mutex> lock(work->mutex);
+        work->done.wait(lock, [&]() { return work->finished == work->placed.size(); });
+        if (work->error) {
+            std::rethrow_exception(work->error);
+        }
+    }
+
+    const PlayerId player = state.current_player;
+    const int previous_tile = state.desert_tiles[player].tile;
+    const bool has_tile = previous_tile >= 0 && previous_tile < kBoardTiles;
+    for (std::size_t i = 0; i < desert_index.size(); ++i) {
+        auto& estimate = ranked[desert_index[i]];
+        if (const auto& moments = work->moments[i]) {
+            estimate.expected_value = moments->mean - leg.desert_coins[player];
+            estimate.variance = moments->variance;
+            continue;
+        }
+        // First order: every landing on the new tile pays, none on the tile it leaves, and
+        // the count of landings is treated as Poisson
+        const int tile = std::get<PlaceDesertTilePayload>(estimate.action.payload).tile;
+        estimate.expected_value = leg.landings[tile] - (has_tile ? leg.landings[previous_tile] : 0.0);
+        estimate.variance = leg.landings[tile];
+        estimate.exact = false;
+    }
+
+    std::stable_sort(ranked.begin(), ranked.end(), [](const ActionEstimate& lhs, const ActionEstimate& rhs) {
+        return lhs.expected_value > rhs.expected_value;
+    });
+    return ranked;
+}
+
+AnytimeActionSearch::AnytimeActionSearch(const GameState& state, std::uint32_t seed)
+    : AnytimeActionSearch(state, leg_odds(state), seed) {}
+
+AnytimeActionSearch::AnytimeActionSearch(const GameState& state, const LegOdds& leg, std::uint32_t seed)
+    : root_(state), race_(state, seed) {
+    const RaceOdds no_race;
+    for (const auto& action : rules::legal_actions(state)) {
+        Candidate candidate{action};
+        switch (action.type()) {
+            case ActionType::BetWinner:
+                candidate.race_dependent = true;
+                candidate.camel = std::get<BetWinnerPayload>(action.payload).camel;
+                candidate.payout = final_bet_payout(state.winner_bet_stack, candidate.camel);
+                break;
+            case ActionType::BetLoser:
+                candidate.race_dependent = true;
+                candidate.loser_bet = true;
+                candidate.camel = std::get<BetLoserPayload>(action.payload).camel;
+                candidate.payout = final_bet_payout(state.loser_bet_stack, candidate.camel);
+                break;
+            default:
+                candidate.exact_value = evaluate_action(state, action, leg, no_race).expected_value;
+                break;
+        }
+        candidates_.push_back(candidate);
+    }
+}
+
+void AnytimeActionSearch::refine(int samples) {
+    race_.refine(samples);
+}
+
+int AnytimeActionSearch::samples() const {
+    return race_.samples();
+}
+
+std::vector<AnytimeActionSearch::Bounds> AnytimeActionSearch::bounds(double z) const {
+    const auto odds = race_.interim();
+    std::vector<Bounds> out;
+    out.reserve(candidates_.size());
+    for (const auto& candidate : candidates_) {
+        if (!candidate.race_dependent) {
+            out.push_back({candidate.exact_value, candidate.exact_value, candidate.exact_value});
+            continue;
+        }
+        // Bet value is increasing in the probability, so interval ends map directly
+        const double p = candidate.loser_bet ? odds.loser[candidate.camel] : odds.winner[candidate.camel];
+        const auto interval = candidate.loser_bet ? race_.loser_interval(candidate.camel, z)
+                                                  : race_.winner_interval(candidate.camel, z);
+        out.push_back({final_bet_value(candidate.payout, p), final_bet_value(candidate.payout, interval.low),
+                       final_bet_value(candidate.payout, interval.high)});
+    }
+    return out;
+}
+
+double AnytimeActionSearch::ci_width(double z) const {
+    const auto all = bounds(z);
+    if (all.empty()) {
+        return 0.0;
+    }
+    const auto best = std::max_element(all.begin(), all.end(), [](const Bounds& lhs, const Bounds& rhs) {
+        return lhs.value < rhs.value;
+    });
+    return best->high - best->low;
+}
+
+bool AnytimeActionSearch::decided(double z) const {
+    const auto all = bounds(z);
+    if (all.size() < 2) {
+        return true;
+    }
+    std::size_t best = 0;
+    for (std::size_t i = 1; i < all.size(); ++i) {
+        if (all[i].value > all[best].value) {
+            best = i;
+        }
+    }
+    for (std::size_t i = 0; i < all.size(); ++i) {
+        if (i != best && all[i].high > all[best].low) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<ActionValue> AnytimeActionSearch::interim() const {
+    const auto all = bounds(0.0);
+    std::vector<ActionValue> ranked;
+    ranked.reserve(candidates_.size());
+    for (std::size_t i = 0; i < candidates_.size(); ++i) {
+        ranked.push_back({candidates_[i].action, all[i].value});
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), [](const ActionValue& lhs, const ActionValue& rhs) {
+        return lhs.expected_value > rhs.expected_value;
+    });
+    return ranked;
+}
+
+}  // namespace camelup::analysis
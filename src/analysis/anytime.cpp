@@ -0,0 +1,65 @@
+#include "camelup/analysis/anytime.hpp"
+
+#include <algorithm>  // max, min
+#include <cmath>
+
+#include "camelup/util/trace.hpp"
+
+namespace camelup::analysis {
+
+AnytimeBudget budget_within(std::chrono::nanoseconds time_budget, int max_samples) {
+    AnytimeBudget budget;
+    budget.deadline = std::chrono::steady_clock::now() + time_budget;
+    budget.max_samples = max_samples;
+    return budget;
+}
+
+AnytimeReport run_anytime(AnytimeEstimator& estimator, const AnytimeBudget& budget, const std::atomic<bool>* cancel) {
+    AnytimeReport report;
+    const int batch = std::max(1, budget.batch_samples);
+
+    while (true) {
+        report.samples = estimator.samples();
+        report.ci_width = estimator.ci_width(budget.z);
+
+        if (report.samples >= budget.min_samples) {
+            if (estimator.decided(budget.z)) {
+                report.reason = AnytimeStop::Decided;
+                return report;
+            }
+            if (budget.target_ci_width > 0.0 && report.ci_width <= budget.target_ci_width) {
+                report.reason = AnytimeStop::TargetWidth;
+                return report;
+            }
+        }
+        if (report.samples >= budget.max_samples) {
+            report.reason = AnytimeStop::SampleBudget;
+            return report;
+        }
+        if (cancel != nullptr && cancel->load(std::memory_order_relaxed)) {
+            report.reason = AnytimeStop::Cancelled;
+            return report;
+        }
+        if (std::chrono::steady_clock::now() >= budget.deadline) {
+            report.reason = AnytimeStop::Deadline;
+            return report;
+        }
+
+        CAMELUP_TRACE_SPAN("refine", "search");
+        estimator.refine(std::min(batch, budget.max_samples - report.samples));
+    }
+}
+
+Interval wilson_interval(double successes, double samples, double z) {
+    if (samples <= 0.0) {
+        return {};
+    }
+    const double p = successes / samples;
+    const double z2 = z * z;
+    const double denominator = 1.0 + z2 / samples;
+    const double centre = (p + z2 / (2.0 * samples)) / denominator;
+    const double half = z / denominator * std::sqrt(p * (1.0 - p) / samples + z2 / (4.0 * samples * samples));
+    return {std::max(0.0, centre - half), std::min(1.0, centre + half)};
+}
+
+}  // namespace camelup::analysis
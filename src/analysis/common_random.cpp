@@ -0,0 +1,171 @@
+#include "camelup/analysis/common_random.hpp"
+
+#include <algorithm>  // max, reverse, shuffle, stable_sort
+#include <cmath>
+#include <numeric>    // iota
+
+#include "camelup/engine.hpp"
+#include "camelup/rules/legal_actions.hpp"
+
+namespace camelup::analysis {
+
+namespace {
+
+double mean_of(const std::vector<double>& values) {
+    return values.empty() ? 0.0 : std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+}
+
+// Unbiased sample variance
+double variance_of(const std::vector<double>& values) {
+    if (values.size() < 2) {
+        return 0.0;
+    }
+    const double mean = mean_of(values);
+    double total = 0.0;
+    for (const double value : values) {
+        total += (value - mean) * (value - mean);
+    }
+    return total / (values.size() - 1);
+}
+
+// Streams for one candidate, or for all of them when the dice are shared
+std::vector<DiceStream> draw_streams(std::uint32_t seed, std::uint32_t candidate, int count) {
+    std::seed_seq sequence{seed, candidate};
+    std::mt19937 rng(sequence);
+    std::vector<DiceStream> streams;
+    streams.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        streams.push_back(draw_dice_stream(rng));
+    }
+    return streams;
+}
+
+}  // namespace
+
+DiceStream draw_dice_stream(std::mt19937& rng, int legs) {
+    std::uniform_int_distribution<int> distance_roll(1, 3);
+    DiceStream stream(std::max(legs, 1));
+    for (auto& leg : stream) {
+        std::iota(leg.order.begin(), leg.order.end(), CamelId{0});
+        std::shuffle(leg.order.begin(), leg.order.end(), rng);
+        for (auto& distance : leg.distance) {
+            distance = distance_roll(rng);
+        }
+    }
+    return stream;
+}
+
+DiceStream antithetic(const DiceStream& stream) {
+    DiceStream mirror = stream;
+    for (auto& leg : mirror) {
+        std::reverse(leg.order.begin(), leg.order.end());
+        for (auto& distance : leg.distance) {
+            distance = 4 - distance;
+        }
+    }
+    return mirror;
+}
+
+DieRoll next_roll(const GameState& state, const LegDice& leg) {
+    // With no die left apply_roll starts a fresh leg first, any camel is then available
+    CamelId camel = leg.order[0];
+    for (const CamelId candidate : leg.order) {
+        if (state.die_available[candidate]) {
+            camel = candidate;
+            break;
+        }
+    }
+    return {camel, leg.distance[camel]};
+}
+
+GameState play_out(const GameState& state, const DiceStream& stream) {
+    GameState current = state;
+    const int first_leg = state.leg_number;
+    while (!current.terminal) {
+        const auto leg_index = static_cast<std::size_t>(current.leg_number - first_leg) % stream.size();
+        current = Engine::apply_roll(current, next_roll(current, stream[leg_index]));
+    }
+    return current;
+}
+
+double simulate_action(const GameState& state, const Action& action, const DiceStream& stream) {
+    const PlayerId mover = state.current_player;
+    if (action.type() == ActionType::RollDie) {
+        return play_out(state, stream).money[mover] - state.money[mover];
+    }
+    // Non-roll actions never draw from the engine RNG, the seed is irrelevant
+    Engine engine(0);
+    return play_out(engine.apply_action(state, action), stream).money[mover] - state.money[mover];
+}
+
+std::vector<SimulatedValue> compare_actions(const GameState& state, const std::vector<Action>& candidates,
+                                            const SimulationOptions& options) {
+    const int streams_per_candidate =
+        options.antithetic ? std::max(1, options.rollouts / 2) : std::max(1, options.rollouts);
+
+    // samples[c][i] is candidate c's value on stream i, or on pair i when antithetic
+    std::vector<std::vector<double>> samples(candidates.size());
+    std::vector<DiceStream> shared;
+    if (options.common_dice) {
+        shared = draw_streams(options.seed, 0, streams_per_candidate);
+    }
+    for (std::size_t c = 0; c < candidates.size(); ++c) {
+        const auto own = options.common_dice ? std::vector<DiceStream>{}
+                                             : draw_streams(options.seed, static_cast<std::uint32_t>(c + 1),
+                                                            streams_per_candidate);
+        const auto& streams = options.common_dice ? shared : own;
+        samples[c].reserve(streams.size());
+        for (const auto& stream : streams) {
+            double value = simulate_action(state, candidates[c], stream);
+            if (options.antithetic) {
+                value = 0.5 * (value + simulate_action(state, candidates[c], antithetic(stream)));
+            }
+            samples[c].push_back(value);
+        }
+    }
+
+    std::vector<SimulatedValue> values;
+    values.reserve(candidates.size());
+    for (std::size_t c = 0; c < candidates.size(); ++c) {
+        values.push_back({candidates[c], mean_of(samples[c]), 0.0});
+    }
+    if (values.empty()) {
+        return values;
+    }
+
+    std::size_t leader = 0;
+    for (std::size_t c = 1; c < values.size(); ++c) {
+        if (values[c].expected_value > values[leader].expected_value) {
+            leader = c;
+        }
+    }
+    for (std::size_t c = 0; c < values.size(); ++c) {
+        if (c == leader) {
+            continue;
+        }
+        const double n = static_cast<double>(samples[c].size());
+        double variance = 0.0;
+        if (options.common_dice) {
+            // Shared dice pair the samples, only the variance of the difference counts
+            std::vector<double> gaps(samples[c].size());
+            for (std::size_t i = 0; i < gaps.size(); ++i) {
+                gaps[i] = samples[c][i] - samples[leader][i];
+            }
+            variance = variance_of(gaps) / n;
+        } else {
+            variance = (variance_of(samples[c]) + variance_of(samples[leader])) / n;
+        }
+        values[c].gap_std_error = std::sqrt(variance);
+    }
+
+    std::stable_sort(values.begin(), values.end(), [](const SimulatedValue& lhs, const SimulatedValue& rhs) {
+        return lhs.expected_value > rhs.expected_value;
+    });
+    return values;
+}
+
+std::vector<SimulatedValue> rank_actions_simulated(const GameState& state, const SimulationOptions& options) {
+    return compare_actions(state, rules::legal_actions(state), options);
+}
+
+}  // namespace camelup::analysis
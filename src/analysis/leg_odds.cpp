@@ -0,0 +1,177 @@
+#include "camelup/analysis/leg_odds.hpp"
+
+#include <algorithm>  // max
+#include <utility>    // swap
+
+#include "camelup/packed_camels.hpp"
+
+namespace camelup::analysis {
+
+namespace {
+
+constexpr int kDieFaces = 3;
+
+// Desert tiles do not change during a leg, so their effect is resolved once per tile
+struct DesertLayout {
+    std::array<int, kBoardTiles> paid_player{};  // -1 when nobody is paid
+    DesertDeltas move_delta{};
+};
+
+struct Enumeration {
+    DesertLayout desert;
+    LegOdds odds;
+};
+
+DesertLayout make_desert(const GameState& state) {
+    DesertLayout desert;
+    desert.paid_player.fill(-1);
+    desert.move_delta = desert_deltas(state);
+    for (int tile = 0; tile < kBoardTiles; ++tile) {
+        const int owner = state.desert_tile_owner[tile];
+        if (owner >= 0 && owner < state.player_count) {
+            desert.paid_player[tile] = owner;
+        }
+    }
+    return desert;
+}
+
+// Expected coins are linear in landings, so each landing is credited with its branch weight
+// instead of carrying per-player coin counts down to the leaves
+void move_stack(Enumeration& run, PackedCamels& camels, CamelId camel, int distance, double weight) {
+    const int landing = camels.move(camel, distance, run.desert.move_delta);
+    run.odds.landings[landing] += weight;
+    if (run.desert.paid_player[landing] >= 0) {
+        run.odds.desert_coins[run.desert.paid_player[landing]] += weight;
+    }
+}
+
+void record_leg_end(Enumeration& run, const PackedCamels& camels, double weight) {
+    // Leader and runner-up are the two largest lane keys
+    CamelId first = 0;
+    CamelId second = 1;
+    if (camels.key(second) > camels.key(first)) {
+        std::swap(first, second);
+    }
+    for (CamelId camel = 2; camel < kCamelCount; ++camel) {
+        if (camels.key(camel) > camels.key(first)) {
+            second = first;
+            first = camel;
+        } else if (camels.key(camel) > camels.key(second)) {
+            second = camel;
+        }
+    }
+    run.odds.first[first] += weight;
+    run.odds.second[second] += weight;
+    ++run.odds.outcomes;
+}
+
+void enumerate(Enumeration& run, PackedCamels camels, std::uint8_t dice, double weight) {
+    int available = 0;
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        available += (dice >> camel) & 1U;
+    }
+    if (available == 0) {
+        record_leg_end(run, camels, weight);
+        return;
+    }
+
+    const double branch_weight = weight / (available * kDieFaces);
+    for (CamelId camel = 0; camel < static_cast<CamelId>(kCamelCount); ++camel) {
+        if (((dice >> camel) & 1U) == 0) {
+            continue;
+        }
+        const auto remaining = static_cast<std::uint8_t>(dice & ~(1U << camel));
+        for (int distance = 1; distance <= kDieFaces; ++distance) {
+            PackedCamels next = camels;
+            move_stack(run, next, camel, distance, branch_weight);
+
+            if (next.finished()) {
+                run.odds.race_end += branch_weight;
+                run.odds.race_winner[next.leader()] += branch_weight;
+                ++run.odds.outcomes;
+                continue;
+            }
+            enumerate(run, next, remaining, branch_weight);
+        }
+    }
+}
+
+// Coins are not linear in their square, so the count travels with each branch
+struct CoinEnumeration {
+    DesertLayout desert;
+    int player{0};
+    double first{0.0};   // weighted sum of coin counts
+    double second{0.0};  // weighted sum of squared coin counts
+};
+
+void record_coins(CoinEnumeration& run, int coins, double weight) {
+    run.first += weight * coins;
+    run.second += weight * coins * coins;
+}
+
+void enumerate_coins(CoinEnumeration& run, PackedCamels camels, std::uint8_t dice, int coins, double weight) {
+    int available = 0;
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        available += (dice >> camel) & 1U;
+    }
+    if (available == 0) {
+        record_coins(run, coins, weight);
+        return;
+    }
+
+    const double branch_weight = weight / (available * kDieFaces);
+    for (CamelId camel = 0; camel < static_cast<CamelId>(kCamelCount); ++camel) {
+        if (((dice >> camel) & 1U) == 0) {
+            continue;
+        }
+        const auto remaining = static_cast<std::uint8_t>(dice & ~(1U << camel));
+        for (int distance = 1; distance <= kDieFaces; ++distance) {
+            PackedCamels next = camels;
+            const int landing = next.move(camel, distance, run.desert.move_delta);
+            const int paid = coins + (run.desert.paid_player[landing] == run.player ? 1 : 0);
+            if (next.finished()) {
+                record_coins(run, paid, branch_weight);
+                continue;
+            }
+            enumerate_coins(run, next, remaining, paid, branch_weight);
+        }
+    }
+}
+
+std::uint8_t available_dice(const GameState& state) {
+    std::uint8_t dice = 0;
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        if (state.die_available[camel]) {
+            dice = static_cast<std::uint8_t>(dice | (1U << camel));
+        }
+    }
+    return dice;
+}
+
+}  // namespace
+
+LegOdds leg_odds(const GameState& state) {
+    Enumeration run{make_desert(state), {}};
+    const auto camels = PackedCamels::from_board(state.board);
+    if (state.terminal) {
+        run.odds.race_winner[camels.leader()] = 1.0;
+        run.odds.race_end = 1.0;
+        run.odds.outcomes = 1;
+        return run.odds;
+    }
+
+    enumerate(run, camels, available_dice(state), 1.0);
+    return run.odds;
+}
+
+CoinMoments desert_coin_moments(const GameState& state, PlayerId player) {
+    if (state.terminal) {
+        return {};
+    }
+    CoinEnumeration run{make_desert(state), static_cast<int>(player)};
+    enumerate_coins(run, PackedCamels::from_board(state.board), available_dice(state), 0, 1.0);
+    // Clamped, the subtraction can dip just below zero when every outcome pays the same
+    return {run.first, std::max(0.0, run.second - run.first * run.first)};
+}
+
+}  // namespace camelup::analysis
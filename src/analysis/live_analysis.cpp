@@ -0,0 +1,120 @@
+#include "camelup/analysis/live_analysis.hpp"
+
+#include <algorithm>  // max, min
+#include <limits>
+#include <utility>
+
+#include "camelup/util/trace.hpp"
+
+namespace camelup::analysis {
+
+LiveAnalysis::LiveAnalysis(Publish publish, LiveAnalysisOptions options)
+    : publish_(std::move(publish)), options_(options), worker_([this] { run(); }) {}
+
+LiveAnalysis::~LiveAnalysis() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        cancel_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();
+}
+
+std::uint64_t LiveAnalysis::analyse(const GameState& state) {
+    std::uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        generation = ++generation_;
+        pending_ = state;
+        latest_.reset();
+        cancel_ = true;
+    }
+    wake_.notify_one();
+    return generation;
+}
+
+void LiveAnalysis::cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++generation_;
+    pending_.reset();
+    latest_.reset();
+    cancel_ = true;
+}
+
+std::optional<LiveSnapshot> LiveAnalysis::latest() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return latest_;
+}
+
+void LiveAnalysis::run() {
+    util::trace::set_thread_name("live analysis");
+    while (true) {
+        GameState state;
+        std::uint64_t generation = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stop_ || pending_.has_value(); });
+            if (stop_) {
+                return;
+            }
+            state = std::move(*pending_);
+            pending_.reset();
+            generation = generation_;
+            cancel_ = false;
+        }
+        analyse_state(state, generation);
+    }
+}
+
+void LiveAnalysis::analyse_state(const GameState& state, std::uint64_t generation) {
+    CAMELUP_TRACE_SPAN("live_analysis", "analysis");
+    LiveSnapshot snapshot;
+    snapshot.generation = generation;
+    snapshot.leg = leg_odds(state);
+    snapshot.final = state.terminal;
+    if (!offer(snapshot) || state.terminal) {
+        return;
+    }
+
+    // Exact action values, the one step that does not check for cancellation
+    AnytimeActionSearch search(state, snapshot.leg, options_.seed);
+    if (cancel_) {
+        return;
+    }
+
+    // Race odds keep tightening after the best action is settled, so only the sample budget stops a stage
+    AnytimeBudget budget;
+    budget.batch_samples = options_.batch_samples;
+    budget.min_samples = std::numeric_limits<int>::max();
+    const int growth = std::max(options_.stage_growth, 2);
+    for (int stage = std::max(options_.first_race_samples, 1);; stage *= growth) {
+        budget.max_samples = std::min(stage, options_.max_race_samples);
+        if (run_anytime(search, budget, &cancel_).reason == AnytimeStop::Cancelled) {
+            return;
+        }
+        snapshot.race = search.race().interim();
+        snapshot.race_ci_width = search.race().ci_width(budget.z);
+        snapshot.actions = search.interim();
+        snapshot.final = budget.max_samples >= options_.max_race_samples;
+        if (!offer(snapshot) || snapshot.final) {
+            return;
+        }
+    }
+}
+
+bool LiveAnalysis::offer(LiveSnapshot snapshot) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cancel_ || generation_ != snapshot.generation) {
+            return false;
+        }
+        latest_ = snapshot;
+    }
+    if (publish_) {
+        publish_(snapshot);
+    }
+    return true;
+}
+
+}  // namespace camelup::analysis
@@ -0,0 +1,88 @@
+#include "camelup/analysis/odds_cache.hpp"
+
+#include <algorithm>  // max
+
+#include "camelup/util/trace.hpp"
+
+namespace camelup::analysis {
+
+OddsKey odds_key(const GameState& state) {
+    OddsKey key;
+    for (int tile = 0; tile < kBoardTiles; ++tile) {
+        const auto& stack = state.board[tile];
+        for (std::size_t idx = 0; idx < stack.size(); ++idx) {
+            const std::uint64_t packed = static_cast<std::uint64_t>(tile) | (static_cast<std::uint64_t>(idx) << 5);
+            key.camels |= packed << (stack[idx] * 8);
+        }
+    }
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        if (state.die_available[camel]) {
+            key.camels |= 1ULL << (kCamelCount * 8 + camel);
+        }
+    }
+    if (state.terminal) {
+        key.camels |= 1ULL << (kCamelCount * 9);
+    }
+
+    for (int player = 0; player < kMaxPlayers; ++player) {
+        const auto& placement = state.desert_tiles[player];
+        const std::uint64_t packed =
+            static_cast<std::uint64_t>(placement.tile + 1) | (placement.move_delta < 0 ? 1ULL << 5 : 0ULL);
+        key.desert |= packed << (player * 6);
+    }
+    return key;
+}
+
+OddsCache::OddsCache(std::size_t capacity) : shard_capacity_(std::max<std::size_t>(1, capacity / kShards)) {}
+
+LegOdds OddsCache::leg_odds(const GameState& state) {
+    const auto key = odds_key(state);
+    auto& shard = shards_[OddsKeyHash{}(key) % kShards];
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const auto found = shard.leg.find(key);
+        if (found != shard.leg.end()) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return found->second;
+        }
+    }
+
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    CAMELUP_TRACE_SPAN("leg_odds_fill", "cache");
+    const auto odds = analysis::leg_odds(state);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.leg.size() >= shard_capacity_) {
+        shard.leg.clear();
+    }
+    shard.leg.emplace(key, odds);
+    return odds;
+}
+
+RaceOdds OddsCache::race_odds(const GameState& state, int samples, std::uint32_t seed) {
+    const RaceKey key{odds_key(state), samples, seed};
+    auto& shard = shards_[RaceKeyHash{}(key) % kShards];
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const auto found = shard.race.find(key);
+        if (found != shard.race.end()) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return found->second;
+        }
+    }
+
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    CAMELUP_TRACE_SPAN("race_odds_fill", "cache");
+    const auto odds = analysis::race_odds(state, samples, seed);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.race.size() >= shard_capacity_) {
+        shard.race.clear();
+    }
+    shard.race.emplace(key, odds);
+    return odds;
+}
+
+OddsCache::Stats OddsCache::stats() const noexcept {
+    return {hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed)};
+}
+
+}  // namespace camelup::analysis
@@ -0,0 +1,172 @@
+#include "camelup/analysis/qmc.hpp"
+
+#include <algorithm>  // min
+#include <array>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <numeric>    // iota
+#include <random>
+#include <stdexcept>
+#include <utility>  // pair, swap
+
+#include "camelup/engine.hpp"
+
+namespace camelup::analysis {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Product weight of coordinate d, later legs matter less because most races are decided early
+// Small weights favour low-order projections, which is where race outcomes vary
+double coordinate_weight(int dimension) {
+    return 0.02 * std::pow(0.7, dimension / kQmcDimensionsPerLeg);
+}
+
+// Periodic kernel for the P2 criterion, 2 pi^2 B2(x)
+double p2_kernel(double x) {
+    return 2.0 * kPi * kPi * (x * x - x + 1.0 / 6.0);
+}
+
+std::vector<std::uint32_t> build_generator(int points, int dimensions) {
+    std::vector<std::uint32_t> generator;
+    generator.reserve(dimensions);
+    // products[k] carries the criterion product of the chosen coordinates at lattice point k
+    std::vector<double> products(points, 1.0);
+    std::vector<double> kernel(points);
+    for (int k = 0; k < points; ++k) {
+        kernel[k] = p2_kernel(static_cast<double>(k) / points);
+    }
+
+    for (int dimension = 0; dimension < dimensions; ++dimension) {
+        const double weight = coordinate_weight(dimension);
+        std::uint32_t best = 1;
+        double best_error = std::numeric_limits<double>::infinity();
+        // Odd components keep every one-dimensional projection a full lattice
+        for (int candidate = 1; candidate < points; candidate += 2) {
+            double error = 0.0;
+            // Point 0 adds the same term for every candidate and would swamp the others
+            for (int k = 1; k < points; ++k) {
+                const auto index = static_cast<std::size_t>((static_cast<std::uint64_t>(k) * candidate) % points);
+                error += products[k] * (1.0 + weight * kernel[index]);
+            }
+            if (error < best_error) {
+                best_error = error;
+                best = static_cast<std::uint32_t>(candidate);
+            }
+        }
+        for (int k = 0; k < points; ++k) {
+            const auto index = static_cast<std::size_t>((static_cast<std::uint64_t>(k) * best) % points);
+            products[k] *= 1.0 + weight * kernel[index];
+        }
+        generator.push_back(best);
+    }
+    return generator;
+}
+
+std::uint32_t reverse_bits(std::uint32_t value, int bits) {
+    std::uint32_t reversed = 0;
+    for (int bit = 0; bit < bits; ++bit) {
+        reversed = (reversed << 1) | (value & 1u);
+        value >>= 1;
+    }
+    return reversed;
+}
+
+}  // namespace
+
+LegDice dice_from_point(const double* coordinates) {
+    LegDice dice;
+    std::iota(dice.order.begin(), dice.order.end(), CamelId{0});
+    for (int slot = 0; slot + 1 < kCamelCount; ++slot) {
+        const int remaining = kCamelCount - slot;
+        const int pick = std::min(remaining - 1, static_cast<int>(coordinates[slot] * remaining));
+        std::swap(dice.order[slot], dice.order[slot + pick]);
+    }
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        dice.distance[camel] = 1 + std::min(2, static_cast<int>(coordinates[4 + camel] * 3.0));
+    }
+    return dice;
+}
+
+const std::vector<std::uint32_t>& lattice_generator(int points, int dimensions) {
+    if (points < 2 || (points & (points - 1)) != 0) {
+        throw std::invalid_argument("lattice size must be a power of two");
+    }
+    static std::mutex mutex;
+    static std::map<std::pair<int, int>, std::vector<std::uint32_t>> cache;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = cache.find({points, dimensions});
+    if (found == cache.end()) {
+        found = cache.emplace(std::make_pair(points, dimensions), build_generator(points, dimensions)).first;
+    }
+    return found->second;
+}
+
+QmcDiceSampler::QmcDiceSampler(int points_per_replicate, std::uint32_t seed, int legs)
+    : points_(points_per_replicate),
+      bits_(0),
+      legs_(legs),
+      seed_(seed),
+      generator_(&lattice_generator(points_per_replicate, legs * kQmcDimensionsPerLeg)),
+      shift_(static_cast<std::size_t>(legs) * kQmcDimensionsPerLeg) {
+    while ((1 << bits_) < points_) {
+        ++bits_;
+    }
+}
+
+std::uint32_t QmcDiceSampler::select(std::int64_t index) {
+    const std::int64_t replicate = index / points_;
+    if (replicate != shift_replicate_) {
+        // Cranley-Patterson shift, one per replicate, reproducible from the seed alone
+        std::seed_seq sequence{seed_, static_cast<std::uint32_t>(replicate),
+                               static_cast<std::uint32_t>(replicate >> 32)};
+        std::mt19937 rng(sequence);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        for (auto& shift : shift_) {
+            shift = unit(rng);
+        }
+        shift_replicate_ = replicate;
+    }
+    return reverse_bits(static_cast<std::uint32_t>(index % points_), bits_);
+}
+
+LegDice QmcDiceSampler::leg_dice(std::uint32_t point, int leg) const {
+    std::array<double, kQmcDimensionsPerLeg> coordinates{};
+    for (int i = 0; i < kQmcDimensionsPerLeg; ++i) {
+        const auto dimension = static_cast<std::size_t>(leg) * kQmcDimensionsPerLeg + i;
+        const auto lattice = static_cast<std::uint64_t>(point) * (*generator_)[dimension] % points_;
+        const double coordinate = static_cast<double>(lattice) / points_ + shift_[dimension];
+        coordinates[i] = coordinate - std::floor(coordinate);
+    }
+    return dice_from_point(coordinates.data());
+}
+
+DiceStream QmcDiceSampler::stream(std::int64_t index) {
+    const auto point = select(index);
+    DiceStream stream(legs_);
+    for (int leg = 0; leg < legs_; ++leg) {
+        stream[leg] = leg_dice(point, leg);
+    }
+    return stream;
+}
+
+GameState QmcDiceSampler::play_out(const GameState& state, std::int64_t index) {
+    const auto point = select(index);
+    GameState current = state;
+    int built_leg = -1;
+    LegDice dice;
+    while (!current.terminal) {
+        const int leg = (current.leg_number - state.leg_number) % legs_;
+        if (leg != built_leg) {
+            dice = leg_dice(point, leg);
+            built_leg = leg;
+        }
+        current = Engine::apply_roll(current, next_roll(current, dice));
+    }
+    return current;
+}
+
+}  // namespace camelup::analysis
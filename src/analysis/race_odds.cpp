@@ -0,0 +1,235 @@
+#include "camelup/analysis/race_odds.hpp"
+
+#include <algorithm>  // max, min
+#include <cmath>
+
+#include "camelup/packed_camels.hpp"
+
+namespace camelup::analysis {
+
+namespace {
+
+struct Finish {
+    CamelId winner{0};
+    CamelId loser{0};
+};
+
+constexpr std::uint8_t kAllDice = (1U << kCamelCount) - 1;
+
+// Roll-only rollouts on packed camels, both samplers follow the engine's leg handling:
+// a leg ends once every die is spent and takes the desert tiles with it
+struct RolloutStart {
+    PackedCamels camels;
+    std::uint8_t dice{kAllDice};
+    DesertDeltas desert{};
+    bool terminal{false};
+};
+
+RolloutStart rollout_start(const GameState& state) {
+    RolloutStart start{PackedCamels::from_board(state.board), 0, desert_deltas(state), state.terminal};
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        if (state.die_available[camel]) {
+            start.dice = static_cast<std::uint8_t>(start.dice | (1U << camel));
+        }
+    }
+    return start;
+}
+
+// `next_roll(dice, leg)` chooses the camel and distance from the available dice
+template <typename NextRoll>
+Finish roll_out(const RolloutStart& start, NextRoll&& next_roll) {
+    PackedCamels camels = start.camels;
+    std::uint8_t dice = start.dice;
+    DesertDeltas desert = start.desert;
+    int leg = 0;
+    if (!start.terminal) {
+        while (true) {
+            // Defensive recovery for a pyramid that starts empty, as in the engine
+            if (dice == 0) {
+                dice = kAllDice;
+                desert = {};
+            }
+            const auto [camel, distance] = next_roll(dice, leg);
+            dice = static_cast<std::uint8_t>(dice & ~(1U << camel));
+            camels.move(camel, distance, desert);
+            if (camels.finished()) {
+                break;
+            }
+            if (dice == 0) {
+                dice = kAllDice;
+                desert = {};
+                ++leg;
+            }
+        }
+    }
+    return {camels.leader(), camels.last()};
+}
+
+// Same draws as Engine::roll_die: an available die by index, then the distance
+DieRoll engine_roll(std::uint8_t dice, std::mt19937& rng) {
+    std::array<CamelId, kCamelCount> available{};
+    int count = 0;
+    for (CamelId camel = 0; camel < kCamelCount; ++camel) {
+        if ((dice >> camel) & 1U) {
+            available[count++] = camel;
+        }
+    }
+    std::uniform_int_distribution<int> camel_pick(0, count - 1);
+    const CamelId camel = available[camel_pick(rng)];
+    std::uniform_int_distribution<int> distance_roll(1, 3);
+    return {camel, distance_roll(rng)};
+}
+
+// First still-available camel in the leg's leave order, as common_random::next_roll
+DieRoll stream_roll(std::uint8_t dice, const LegDice& leg) {
+    for (const CamelId camel : leg.order) {
+        if ((dice >> camel) & 1U) {
+            return {camel, leg.distance[camel]};
+        }
+    }
+    return {leg.order[0], leg.distance[leg.order[0]]};
+}
+
+}  // namespace
+
+RaceOdds race_odds(const GameState& state, int samples, std::uint32_t seed, RaceSampler sampler) {
+    RaceOddsEstimator estimator(state, seed, sampler);
+    estimator.refine(samples);
+    return estimator.interim();
+}
+
+RaceOddsEstimator::RaceOddsEstimator(const GameState& state, std::uint32_t seed, RaceSampler sampler)
+    : root_(state), rng_(seed) {
+    if (sampler == RaceSampler::Qmc) {
+        qmc_.emplace(kQmcReplicatePoints, seed);
+    }
+}
+
+void RaceOddsEstimator::refine(int samples) {
+    // Rollouts run outside the lock so interim results stay readable while sampling
+    std::vector<Counts> batch;
+    std::int64_t first_index = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        first_index = samples_;
+    }
+    const auto start = rollout_start(root_);
+    for (int sample = 0; sample < samples; ++sample) {
+        Finish finish;
+        std::size_t replicate = 0;
+        if (qmc_) {
+            const std::int64_t index = first_index + sample;
+            replicate = static_cast<std::size_t>(index / kQmcReplicatePoints);
+            const auto point = qmc_->select(index);
+            int built_leg = -1;
+            LegDice dice;
+            finish = roll_out(start, [&](std::uint8_t available, int leg) {
+                if (leg != built_leg) {
+                    dice = qmc_->leg_dice(point, leg % qmc_->legs());
+                    built_leg = leg;
+                }
+                return stream_roll(available, dice);
+            });
+        } else {
+            finish = roll_out(start, [&](std::uint8_t available, int) { return engine_roll(available, rng_); });
+        }
+        // Random sampling keeps everything in one bucket
+        const std::size_t slot = qmc_ ? replicate - static_cast<std::size_t>(first_index / kQmcReplicatePoints) : 0;
+        if (batch.size() <= slot) {
+            batch.resize(slot + 1);
+        }
+        ++batch[slot].winner[finish.winner];
+        ++batch[slot].loser[finish.loser];
+        ++batch[slot].samples;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto first_replicate = static_cast<std::size_t>(first_index / kQmcReplicatePoints);
+    for (std::size_t slot = 0; slot < batch.size(); ++slot) {
+        for (int camel = 0; camel < kCamelCount; ++camel) {
+            winner_counts_[camel] += batch[slot].winner[camel];
+            loser_counts_[camel] += batch[slot].loser[camel];
+        }
+        samples_ += batch[slot].samples;
+        if (qmc_) {
+            if (replicates_.size() <= first_replicate + slot) {
+                replicates_.resize(first_replicate + slot + 1);
+            }
+            auto& replicate = replicates_[first_replicate + slot];
+            for (int camel = 0; camel < kCamelCount; ++camel) {
+                replicate.winner[camel] += batch[slot].winner[camel];
+                replicate.loser[camel] += batch[slot].loser[camel];
+            }
+            replicate.samples += batch[slot].samples;
+        }
+    }
+}
+
+int RaceOddsEstimator::samples() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return samples_;
+}
+
+double RaceOddsEstimator::ci_width(double z) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    double widest = 0.0;
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        widest = std::max(widest, interval(winner_counts_, false, static_cast<CamelId>(camel), z).width());
+        widest = std::max(widest, interval(loser_counts_, true, static_cast<CamelId>(camel), z).width());
+    }
+    return widest;
+}
+
+RaceOdds RaceOddsEstimator::interim() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    RaceOdds odds;
+    odds.samples = samples_;
+    if (samples_ > 0) {
+        for (int camel = 0; camel < kCamelCount; ++camel) {
+            odds.winner[camel] = static_cast<double>(winner_counts_[camel]) / samples_;
+            odds.loser[camel] = static_cast<double>(loser_counts_[camel]) / samples_;
+        }
+    }
+    return odds;
+}
+
+Interval RaceOddsEstimator::winner_interval(CamelId camel, double z) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return interval(winner_counts_, false, camel, z);
+}
+
+Interval RaceOddsEstimator::loser_interval(CamelId camel, double z) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return interval(loser_counts_, true, camel, z);
+}
+
+Interval RaceOddsEstimator::interval(const std::array<int, kCamelCount>& counts, bool loser, CamelId camel,
+                                     double z) const {
+    // Lattice points are not independent, so Wilson would overstate the error, use the
+    // replicate spread once there is one
+    std::vector<double> estimates;
+    for (const auto& replicate : replicates_) {
+        if (replicate.samples == kQmcReplicatePoints) {
+            estimates.push_back(static_cast<double>(loser ? replicate.loser[camel] : replicate.winner[camel]) /
+                                replicate.samples);
+        }
+    }
+    if (estimates.size() < 2) {
+        return wilson_interval(counts[camel], samples_, z);
+    }
+    double mean = 0.0;
+    for (const double estimate : estimates) {
+        mean += estimate;
+    }
+    mean /= estimates.size();
+    double variance = 0.0;
+    for (const double estimate : estimates) {
+        variance += (estimate - mean) * (estimate - mean);
+    }
+    variance /= estimates.size() - 1;
+    const double half = z * std::sqrt(variance / estimates.size());
+    const double centre = static_cast<double>(counts[camel]) / samples_;
+    return {std::max(0.0, centre - half), std::min(1.0, centre + half)};
+}
+
+}  // namespace camelup::analysis
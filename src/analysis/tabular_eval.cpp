@@ -0,0 +1,257 @@
+#include "camelup/analysis/tabular_eval.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>  // clamp, min, max
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace camelup::analysis {
+
+namespace {
+
+constexpr int kFinishTile = kBoardTiles - 1;
+constexpr int kGapBuckets = 6;
+constexpr int kDesertLookahead = 3;
+
+// Coarse back-off cells: tiles to finish and leader gap only
+constexpr std::uint32_t kCoarseCells = 16 * kGapBuckets;
+constexpr std::uint32_t kFineCellsPerCoarse = kTabularCells / kCoarseCells;
+
+// Pseudo-counts of the smoothing, see TabularTrainer::write
+constexpr double kCellPrior = 4.0;
+constexpr double kCoarsePrior = 1.0;
+constexpr double kCoarseBase = 1.0 / kCamelCount;
+
+std::uint16_t quantise(double probability) {
+    // Never zero so normalising always has something to divide by
+    const double scaled = std::round(std::clamp(probability, 0.0, 1.0) * 65535.0);
+    return static_cast<std::uint16_t>(std::max(scaled, 1.0));
+}
+
+// Column `column` of the interleaved cell records, scaled to sum to one
+void normalise(std::array<double, kCamelCount>& odds, const std::uint16_t* records, int column,
+               const std::array<std::uint32_t, kCamelCount>& cells) noexcept {
+    std::uint32_t total = 0;
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        total += records[cells[camel] * kTabularColumns + column];
+    }
+    const double scale = 1.0 / total;
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        odds[camel] = records[cells[camel] * kTabularColumns + column] * scale;
+    }
+}
+
+// Features shared by every camel of one position
+struct Position {
+    int lead_tile{0};
+    int dice{0};                                    // dice left in the pyramid
+    std::uint32_t oasis{0};                         // bit t set for an oasis on tile t
+    std::uint32_t desert{0};                        // bit t set for any desert tile on tile t
+    std::array<std::uint8_t, kBoardTiles> stack{};  // camels per tile
+};
+
+Position position_of(const PackedCamels& camels, std::uint8_t dice, const DesertDeltas& desert) noexcept {
+    Position position;
+    int lead_key = 0;
+    for (CamelId camel = 0; camel < kCamelCount; ++camel) {
+        lead_key = std::max(lead_key, camels.key(camel));
+        ++position.stack[camels.tile(camel)];
+    }
+    position.lead_tile = lead_key >> 3;
+    position.dice = std::popcount(static_cast<unsigned>(dice & 0x1Fu));
+    for (int tile = 0; tile < kBoardTiles; ++tile) {
+        position.oasis |= static_cast<std::uint32_t>(desert[tile] > 0) << tile;
+        position.desert |= static_cast<std::uint32_t>(desert[tile] != 0) << tile;
+    }
+    return position;
+}
+
+std::uint32_t cell_of(const Position& position, const PackedCamels& camels, std::uint8_t dice, CamelId camel) noexcept {
+    const int tile = camels.tile(camel);
+    const int height = camels.height(camel);
+
+    const int to_finish = std::clamp(kFinishTile - tile, 1, 16) - 1;
+    const int gap = std::min(position.lead_tile - tile, kGapBuckets - 1);
+    const int above = position.stack[tile] - 1 - height;
+    const int stacking = above * 2 + (height > 0 ? 1 : 0);
+    const int own_die = (dice >> camel) & 1;
+    const int die = own_die * kCamelCount + position.dice - own_die;
+
+    // Nearest desert tile among the next kDesertLookahead
+    const std::uint32_t window = (position.desert >> (tile + 1)) & ((1U << kDesertLookahead) - 1);
+    const std::uint32_t nearest = window & (0U - window);
+    const int ahead = window == 0 ? 0 : ((position.oasis >> (tile + 1)) & nearest) != 0 ? 1 : 2;
+
+    return static_cast<std::uint32_t>((((to_finish * kGapBuckets + gap) * 10 + stacking) * 10 + die) * 3 + ahead);
+}
+
+}  // namespace
+
+std::uint32_t tabular_cell(const PackedCamels& camels, std::uint8_t dice, const DesertDeltas& desert,
+                           CamelId camel) noexcept {
+    return cell_of(position_of(camels, dice, desert), camels, dice, camel);
+}
+
+std::uint8_t dice_mask(const GameState& state) noexcept {
+    std::uint8_t dice = 0;
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        if (state.die_available[camel]) {
+            dice |= static_cast<std::uint8_t>(1U << camel);
+        }
+    }
+    return dice;
+}
+
+TabularTrainer::TabularTrainer()
+    : seen_(kTabularCells, 0), winner_(kTabularCells, 0), loser_(kTabularCells, 0), leg_(kTabularCells, 0) {}
+
+bool TabularTrainer::add_game(const std::vector<GameState>& states, const GameState& final_state) {
+    if (!final_state.terminal) {
+        return false;
+    }
+    const auto final_order = PackedCamels::from_board(final_state.board).race_order();
+    const CamelId winner = final_order.front();
+    const CamelId loser = final_order.back();
+
+    // Walk backwards so each state knows the leader at the end of its leg
+    CamelId leg_leader = winner;
+    const GameState* later = &final_state;
+    for (auto it = states.rbegin(); it != states.rend(); ++it) {
+        const auto camels = PackedCamels::from_board(it->board);
+        if (it->leg_number < later->leg_number) {
+            // The first state of the next leg still shows where this one ended
+            leg_leader = PackedCamels::from_board(later->board).leader();
+        }
+        later = &*it;
+        const auto dice = dice_mask(*it);
+        const auto desert = desert_deltas(*it);
+        const auto position = position_of(camels, dice, desert);
+        for (CamelId camel = 0; camel < kCamelCount; ++camel) {
+            const auto cell = cell_of(position, camels, dice, camel);
+            ++seen_[cell];
+            winner_[cell] += camel == winner ? 1 : 0;
+            loser_[cell] += camel == loser ? 1 : 0;
+            leg_[cell] += camel == leg_leader ? 1 : 0;
+        }
+        ++samples_;
+    }
+    ++games_;
+    return true;
+}
+
+void TabularTrainer::write(const std::string& path) const {
+    // Empirical Bayes in two levels: each coarse rate is pulled towards 1/5, and each cell
+    // towards its coarse rate with kCellPrior pseudo-samples
+    const auto smooth = [this](const std::vector<std::uint32_t>& hits) {
+        std::vector<double> coarse_hits(kCoarseCells, 0.0);
+        std::vector<double> coarse_seen(kCoarseCells, 0.0);
+        for (std::uint32_t cell = 0; cell < kTabularCells; ++cell) {
+            coarse_hits[cell / kFineCellsPerCoarse] += hits[cell];
+            coarse_seen[cell / kFineCellsPerCoarse] += seen_[cell];
+        }
+        std::vector<std::uint16_t> table(kTabularCells);
+        for (std::uint32_t cell = 0; cell < kTabularCells; ++cell) {
+            const std::uint32_t coarse = cell / kFineCellsPerCoarse;
+            const double base =
+                (coarse_hits[coarse] + kCoarsePrior * kCoarseBase) / (coarse_seen[coarse] + kCoarsePrior);
+            table[cell] = quantise((hits[cell] + kCellPrior * base) / (seen_[cell] + kCellPrior));
+        }
+        return table;
+    };
+
+    TabularHeader header{};
+    std::memcpy(header.magic, kTabularMagic, sizeof(header.magic));
+    header.version = kTabularVersion;
+    header.cells = kTabularCells;
+    header.samples = samples_;
+    header.games = games_;
+
+    const auto winner = smooth(winner_);
+    const auto loser = smooth(loser_);
+    const auto leg = smooth(leg_);
+    std::vector<std::uint16_t> records;
+    records.reserve(std::size_t{kTabularCells} * kTabularColumns);
+    for (std::uint32_t cell = 0; cell < kTabularCells; ++cell) {
+        records.insert(records.end(), {winner[cell], loser[cell], leg[cell]});
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("cannot open tabular evaluator for writing: " + path);
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(records.data()),
+              static_cast<std::streamsize>(records.size() * sizeof(std::uint16_t)));
+    out.close();
+    if (!out) {
+        throw std::runtime_error("failed to write tabular evaluator: " + path);
+    }
+}
+
+TabularEvaluator::TabularEvaluator(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open tabular evaluator: " + path);
+    }
+    struct stat info {};
+    if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(TabularHeader)) {
+        ::close(fd);
+        throw std::runtime_error("tabular evaluator is truncated: " + path);
+    }
+    size_ = static_cast<std::size_t>(info.st_size);
+    void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("cannot mmap tabular evaluator: " + path);
+    }
+    data_ = static_cast<const std::byte*>(mapped);
+    header_ = reinterpret_cast<const TabularHeader*>(data_);
+
+    const auto fail = [this](const char* message) {
+        ::munmap(const_cast<std::byte*>(data_), size_);
+        throw std::runtime_error(message);
+    };
+    if (std::memcmp(header_->magic, kTabularMagic, sizeof(header_->magic)) != 0) {
+        fail("not a tabular evaluator file");
+    }
+    if (header_->version != kTabularVersion || header_->cells != kTabularCells) {
+        fail("unsupported tabular evaluator version");
+    }
+    if (size_ != sizeof(TabularHeader) + std::size_t{kTabularCells} * kTabularColumns * sizeof(std::uint16_t)) {
+        fail("tabular evaluator is truncated");
+    }
+    records_ = reinterpret_cast<const std::uint16_t*>(data_ + sizeof(TabularHeader));
+}
+
+TabularEvaluator::~TabularEvaluator() {
+    if (data_ != nullptr) {
+        ::munmap(const_cast<std::byte*>(data_), size_);
+    }
+}
+
+TabularOdds TabularEvaluator::evaluate(const PackedCamels& camels, std::uint8_t dice,
+                                       const DesertDeltas& desert) const noexcept {
+    const auto position = position_of(camels, dice, desert);
+    std::array<std::uint32_t, kCamelCount> cells{};
+    for (CamelId camel = 0; camel < kCamelCount; ++camel) {
+        cells[camel] = cell_of(position, camels, dice, camel);
+    }
+    TabularOdds odds;
+    normalise(odds.winner, records_, 0, cells);
+    normalise(odds.loser, records_, 1, cells);
+    normalise(odds.leg, records_, 2, cells);
+    return odds;
+}
+
+TabularOdds TabularEvaluator::evaluate(const GameState& state) const {
+    return evaluate(PackedCamels::from_board(state.board), dice_mask(state), desert_deltas(state));
+}
+
+}  // namespace camelup::analysis
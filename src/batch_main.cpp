@@ -0,0 +1,232 @@
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "camelup/sim/batch.hpp"
+#include "camelup/sim/checkpoint.hpp"
+#include "camelup/sim/policy_memo.hpp"
+#include "camelup/sim/shard_file.hpp"
+#include "camelup/snapshot/state_snapshot.hpp"
+#include "camelup/util/profile.hpp"
+#include "camelup/util/trace.hpp"
+
+namespace {
+
+bool parse_int_arg(const char* value, int& out) {
+    char* end = nullptr;
+    const long parsed = std::strtol(value, &end, 10);
+    if (end == value || *end != '\0') {
+        return false;
+    }
+    out = static_cast<int>(parsed);
+    return true;
+}
+
+// "i/N" with 0 <= i < N
+bool parse_shard_arg(const std::string& value, camelup::sim::ShardSpec& out) {
+    const auto slash = value.find('/');
+    if (slash == std::string::npos) {
+        return false;
+    }
+    camelup::sim::ShardSpec shard;
+    if (!parse_int_arg(value.substr(0, slash).c_str(), shard.index) ||
+        !parse_int_arg(value.substr(slash + 1).c_str(), shard.count) || shard.count < 1 || shard.index < 0 ||
+        shard.index >= shard.count) {
+        return false;
+    }
+    out = shard;
+    return true;
+}
+
+void print_usage() {
+    std::cout << "Usage: camelup_batch [--seed N] [--players N] [--turn-limit N] [--policy roll|first|random|greedy]\n"
+              << "                     [--games N] [--threads N] [--position NOTATION] [--profile]\n"
+              << "                     [--policy-memo ENTRIES]\n"
+              << "                     [--trace PATH] [--shard I/N] [--output PATH] [--checkpoint PATH]\n"
+              << "                     [--checkpoint-interval SECONDS]\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    camelup::sim::BatchOptions options;
+    options.games = 10000;
+    int threads = 0;
+    bool profile = false;
+    std::string position;
+    std::string trace_path;
+    camelup::sim::ShardSpec shard;
+    std::string output_path;
+    std::string checkpoint_path;
+    int checkpoint_interval = 60;
+    int policy_memo = 0;
+    bool players_given = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--profile") {
+            profile = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--position") {
+            position = argv[++i];
+            continue;
+        }
+        if (arg == "--trace") {
+            trace_path = argv[++i];
+            continue;
+        }
+        if (arg == "--output") {
+            output_path = argv[++i];
+            continue;
+        }
+        if (arg == "--checkpoint") {
+            checkpoint_path = argv[++i];
+            continue;
+        }
+        if (arg == "--shard") {
+            if (!parse_shard_arg(argv[++i], shard)) {
+                print_usage();
+                return 1;
+            }
+            continue;
+        }
+        if (arg == "--policy") {
+            if (!camelup::sim::parse_policy(argv[++i], options.policy)) {
+                print_usage();
+                return 1;
+            }
+            continue;
+        }
+
+        int parsed = 0;
+        if (!parse_int_arg(argv[++i], parsed) || parsed < 0) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--seed") {
+            options.seed = parsed;
+        } else if (arg == "--players") {
+            options.players = parsed;
+            players_given = true;
+        } else if (arg == "--turn-limit") {
+            options.turn_limit = parsed;
+        } else if (arg == "--games") {
+            options.games = parsed;
+        } else if (arg == "--threads") {
+            threads = parsed;
+        } else if (arg == "--checkpoint-interval") {
+            checkpoint_interval = parsed;
+        } else if (arg == "--policy-memo") {
+            policy_memo = parsed;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (players_given && !position.empty()) {
+        std::cerr << "camelup_batch failed: --players cannot be combined with --position, "
+                  << "which sets the player count\n";
+        return 1;
+    }
+    if (shard.count > 1 && output_path.empty()) {
+        std::cerr << "camelup_batch failed: --shard needs --output for the shard result file\n";
+        return 1;
+    }
+    if (profile && !camelup::util::profile::kCompiledIn) {
+        std::cerr << "camelup_batch failed: --profile needs a build with -DCAMELUP_ENABLE_PROFILING=ON\n";
+        return 1;
+    }
+    camelup::util::profile::set_enabled(profile);
+
+    try {
+        if (!position.empty()) {
+            options.start = camelup::snapshot::from_notation(position);
+        }
+        if (!trace_path.empty()) {
+            camelup::util::trace::start();
+            camelup::util::trace::set_thread_name("main");
+        }
+        if (policy_memo > 0) {
+            camelup::sim::policy_memo::enable(static_cast<std::size_t>(policy_memo));
+        }
+
+        // An existing checkpoint resumes the interrupted run, it is removed once the run completes
+        std::optional<camelup::sim::ShardResult> resume;
+        std::optional<camelup::sim::CheckpointWriter> checkpoint_writer;
+        camelup::sim::Checkpointing checkpointing;
+        if (!checkpoint_path.empty()) {
+            if (std::filesystem::exists(checkpoint_path)) {
+                resume = camelup::sim::load_shard(checkpoint_path);
+                checkpointing.resume = &*resume;
+                int done = 0;
+                for (const auto& node : resume->nodes) {
+                    done += node.blocks;
+                }
+                const auto [first, last] =
+                    camelup::sim::shard_blocks(camelup::sim::summary_blocks(options.games), shard);
+                std::cout << "Resuming from " << checkpoint_path << ": " << done << " of " << last - first
+                          << " blocks done\n";
+            }
+            checkpoint_writer.emplace(checkpoint_path);
+            checkpointing.save = [&checkpoint_writer](camelup::sim::ShardResult checkpoint) {
+                checkpoint_writer->submit(std::move(checkpoint));
+            };
+            checkpointing.interval = std::chrono::seconds(checkpoint_interval);
+        }
+
+        const auto result =
+            camelup::sim::run_shard(options, shard, static_cast<std::size_t>(threads), checkpointing);
+        if (checkpoint_writer) {
+            checkpoint_writer->flush();
+            checkpoint_writer.reset();
+            std::filesystem::remove(checkpoint_path);
+        }
+        if (!output_path.empty()) {
+            camelup::sim::save_shard(output_path, result);
+        }
+        if (shard.count == 1) {
+            camelup::sim::print_report(std::cout, camelup::sim::merge_shards({result}));
+        } else {
+            const auto [first, last] = camelup::sim::shard_blocks(camelup::sim::summary_blocks(options.games), shard);
+            std::cout << "Shard " << shard.index << '/' << shard.count << ": blocks [" << first << ", " << last << ") of "
+                      << camelup::sim::kSummaryBlockGames << " games each\n";
+        }
+        if (!output_path.empty()) {
+            std::cout << "Shard file: " << output_path << '\n';
+        }
+        if (policy_memo > 0) {
+            const auto memo = camelup::sim::policy_memo::stats();
+            std::cout << "Policy memo: " << memo.hits << " hits of " << memo.hits + memo.misses << " lookups ("
+                      << static_cast<int>(memo.hit_rate() * 100.0 + 0.5) << "%), " << memo.clears
+                      << " table clears\n";
+        }
+
+        if (!trace_path.empty()) {
+            camelup::util::trace::stop();
+            camelup::util::trace::write_file(trace_path);
+            std::cout << "Trace: " << trace_path << '\n';
+        }
+        if (profile) {
+            const auto totals = camelup::util::profile::collect();
+            std::cout << "Profile\n";
+            camelup::util::profile::print_table(std::cout, totals);
+            camelup::util::profile::write_json(std::cout, totals);
+            std::cout << '\n';
+        }
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "camelup_batch failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
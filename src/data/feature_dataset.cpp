@@ -0,0 +1,349 @@
+#include "camelup/data/feature_dataset.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>  // fill, min
+#include <cstddef>    // offsetof
+#include <cstring>
+#include <stdexcept>
+
+#include "camelup/util/trace.hpp"
+
+namespace camelup::data {
+
+namespace {
+
+// Field offset inside FeatureRow for a schema column
+struct ColumnSource {
+    std::size_t row_offset;
+};
+
+FeatureColumnDesc make_column(const char* name, FeatureDType dtype, std::uint8_t element_bytes, std::uint16_t width) {
+    FeatureColumnDesc desc{};
+    std::strncpy(desc.name, name, sizeof(desc.name) - 1);
+    desc.dtype = dtype;
+    desc.element_bytes = element_bytes;
+    desc.width = width;
+    return desc;
+}
+
+std::uint32_t align_up(std::uint64_t value) {
+    return static_cast<std::uint32_t>((value + kFeatureDatasetAlignment - 1) / kFeatureDatasetAlignment *
+                                      kFeatureDatasetAlignment);
+}
+
+// Column table and FeatureRow offsets in matching order
+struct Schema {
+    std::vector<FeatureColumnDesc> columns;
+    std::vector<ColumnSource> sources;
+};
+
+const Schema& schema() {
+    static const Schema instance = [] {
+        Schema built;
+        const auto add = [&built](const char* name, FeatureDType dtype, std::uint8_t bytes, std::uint16_t width,
+                                  std::size_t offset) {
+            built.columns.push_back(make_column(name, dtype, bytes, width));
+            built.sources.push_back({offset});
+        };
+        add("camel_tile", FeatureDType::Int8, 1, kCamelCount, offsetof(FeatureRow, camel_tile));
+        add("camel_height", FeatureDType::Int8, 1, kCamelCount, offsetof(FeatureRow, camel_height));
+        add("die_mask", FeatureDType::UInt8, 1, 1, offsetof(FeatureRow, die_mask));
+        add("leg_tickets_remaining", FeatureDType::Int8, 1, kCamelCount, offsetof(FeatureRow, leg_tickets_remaining));
+        add("desert_tile", FeatureDType::Int8, 1, kMaxPlayers, offsetof(FeatureRow, desert_tile));
+        add("desert_delta", FeatureDType::Int8, 1, kMaxPlayers, offsetof(FeatureRow, desert_delta));
+        add("money", FeatureDType::Int16, 2, kMaxPlayers, offsetof(FeatureRow, money));
+        add("current_player", FeatureDType::UInt8, 1, 1, offsetof(FeatureRow, current_player));
+        add("player_count", FeatureDType::UInt8, 1, 1, offsetof(FeatureRow, player_count));
+        add("leg_number", FeatureDType::UInt8, 1, 1, offsetof(FeatureRow, leg_number));
+        add("game_index", FeatureDType::UInt32, 4, 1, offsetof(FeatureRow, game_index));
+        add("turn", FeatureDType::UInt16, 2, 1, offsetof(FeatureRow, turn));
+        add("final_money", FeatureDType::Int16, 2, kMaxPlayers, offsetof(FeatureRow, final_money));
+        add("race_winner", FeatureDType::UInt8, 1, 1, offsetof(FeatureRow, race_winner));
+        add("race_loser", FeatureDType::UInt8, 1, 1, offsetof(FeatureRow, race_loser));
+        return built;
+    }();
+    return instance;
+}
+
+std::size_t column_stride(const FeatureColumnDesc& desc) {
+    return static_cast<std::size_t>(desc.element_bytes) * desc.width;
+}
+
+// Assign per-group column offsets and return bytes per row group
+std::uint64_t layout_columns(std::vector<FeatureColumnDesc>& columns, std::uint32_t rows_per_group) {
+    std::uint64_t offset = 0;
+    for (auto& desc : columns) {
+        desc.group_offset = static_cast<std::uint32_t>(offset);
+        offset = align_up(offset + column_stride(desc) * rows_per_group);
+    }
+    return offset;
+}
+
+std::uint32_t data_offset_for(std::size_t column_count) {
+    return align_up(sizeof(FeatureDatasetHeader) + column_count * sizeof(FeatureColumnDesc));
+}
+
+}  // namespace
+
+const std::vector<FeatureColumnDesc>& feature_columns() {
+    return schema().columns;
+}
+
+FeatureRow extract_features(const GameState& state) {
+    FeatureRow row{};
+    for (int tile = 0; tile < kBoardTiles; ++tile) {
+        const auto& stack = state.board[tile];
+        for (std::size_t idx = 0; idx < stack.size(); ++idx) {
+            row.camel_tile[stack[idx]] = static_cast<std::int8_t>(tile);
+            row.camel_height[stack[idx]] = static_cast<std::int8_t>(idx);
+        }
+    }
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        if (state.die_available[camel]) {
+            row.die_mask = static_cast<std::uint8_t>(row.die_mask | (1U << camel));
+        }
+        row.leg_tickets_remaining[camel] = static_cast<std::int8_t>(state.leg_tickets_remaining[camel]);
+    }
+    for (int player = 0; player < kMaxPlayers; ++player) {
+        row.desert_tile[player] = static_cast<std::int8_t>(state.desert_tiles[player].tile);
+        row.desert_delta[player] = static_cast<std::int8_t>(state.desert_tiles[player].move_delta);
+        row.money[player] = static_cast<std::int16_t>(state.money[player]);
+    }
+    row.current_player = state.current_player;
+    row.player_count = static_cast<std::uint8_t>(state.player_count);
+    row.leg_number = static_cast<std::uint8_t>(std::min(state.leg_number, 255));
+    row.race_winner = kNoCamel;
+    row.race_loser = kNoCamel;
+    return row;
+}
+
+FeatureDatasetWriter::FeatureDatasetWriter(const std::string& path, std::uint32_t rows_per_group)
+    : out_(path, std::ios::binary | std::ios::trunc), rows_per_group_(rows_per_group) {
+    if (rows_per_group_ == 0) {
+        throw std::invalid_argument("rows_per_group must be positive");
+    }
+    if (!out_) {
+        throw std::runtime_error("cannot open feature dataset for writing: " + path);
+    }
+
+    auto columns = feature_columns();
+    group_.assign(layout_columns(columns, rows_per_group_), std::byte{0});
+    write_header();
+}
+
+FeatureDatasetWriter::~FeatureDatasetWriter() {
+    try {
+        close();
+    } catch (...) {
+        // Destructor must not throw, callers wanting errors should close explicitly
+    }
+}
+
+void FeatureDatasetWriter::record_turn(const GameState& state, std::uint32_t game_index, std::uint16_t turn) {
+    auto row = extract_features(state);
+    row.game_index = game_index;
+    row.turn = turn;
+    pending_.push_back(row);
+}
+
+void FeatureDatasetWriter::finish_game(const GameState& final_state) {
+    // Race order from the furthest tile down, top of each stack first
+    std::uint8_t winner = kNoCamel;
+    std::uint8_t loser = kNoCamel;
+    if (final_state.terminal) {
+        for (int tile = kBoardTiles - 1; tile >= 0 && winner == kNoCamel; --tile) {
+            if (!final_state.board[tile].empty()) {
+                winner = final_state.board[tile].back();
+            }
+        }
+        for (int tile = 0; tile < kBoardTiles && loser == kNoCamel; ++tile) {
+            if (!final_state.board[tile].empty()) {
+                loser = final_state.board[tile].front();
+            }
+        }
+    }
+
+    for (auto& row : pending_) {
+        for (int player = 0; player < kMaxPlayers; ++player) {
+            row.final_money[player] = static_cast<std::int16_t>(final_state.money[player]);
+        }
+        row.race_winner = winner;
+        row.race_loser = loser;
+        append_row(row);
+    }
+    pending_.clear();
+}
+
+void FeatureDatasetWriter::close() {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+    // Rows of an unfinished game have no labels and are dropped
+    pending_.clear();
+    if (rows_in_group_ > 0) {
+        flush_group();
+    }
+    write_header();
+    out_.close();
+    if (!out_) {
+        throw std::runtime_error("failed to finalise feature dataset");
+    }
+}
+
+void FeatureDatasetWriter::append_row(const FeatureRow& row) {
+    const auto& active = schema();
+    const auto* row_bytes = reinterpret_cast<const std::byte*>(&row);
+    std::uint64_t group_offset = 0;
+    for (std::size_t col = 0; col < active.columns.size(); ++col) {
+        const std::size_t stride = column_stride(active.columns[col]);
+        std::memcpy(group_.data() + group_offset + rows_in_group_ * stride, row_bytes + active.sources[col].row_offset,
+                    stride);
+        group_offset = align_up(group_offset + stride * rows_per_group_);
+    }
+    ++row_count_;
+    if (++rows_in_group_ == rows_per_group_) {
+        flush_group();
+    }
+}
+
+void FeatureDatasetWriter::flush_group() {
+    CAMELUP_TRACE_SPAN("row_group_flush", "io");
+    // Partial final group is still written at full size to keep addressing uniform
+    out_.write(reinterpret_cast<const char*>(group_.data()), static_cast<std::streamsize>(group_.size()));
+    if (!out_) {
+        throw std::runtime_error("failed to write feature dataset row group");
+    }
+    std::fill(group_.begin(), group_.end(), std::byte{0});
+    rows_in_group_ = 0;
+}
+
+void FeatureDatasetWriter::write_header() {
+    auto columns = feature_columns();
+
+    FeatureDatasetHeader header{};
+    std::memcpy(header.magic, kFeatureDatasetMagic, sizeof(header.magic));
+    header.version = kFeatureDatasetVersion;
+    header.column_count = static_cast<std::uint32_t>(columns.size());
+    header.row_count = row_count_;
+    header.rows_per_group = rows_per_group_;
+    header.data_offset = data_offset_for(columns.size());
+    header.group_bytes = layout_columns(columns, rows_per_group_);
+
+    // Header is rewritten in place on close with the final row count
+    const auto resume = out_.tellp();
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out_.write(reinterpret_cast<const char*>(columns.data()),
+               static_cast<std::streamsize>(columns.size() * sizeof(FeatureColumnDesc)));
+    if (resume > 0) {
+        out_.seekp(resume);
+    } else {
+        const std::vector<char> padding(header.data_offset - sizeof(header) - columns.size() * sizeof(FeatureColumnDesc),
+                                        0);
+        out_.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+    }
+    if (!out_) {
+        throw std::runtime_error("failed to write feature dataset header");
+    }
+}
+
+FeatureDatasetView::FeatureDatasetView(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open feature dataset: " + path);
+    }
+    struct stat info {};
+    if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(FeatureDatasetHeader)) {
+        ::close(fd);
+        throw std::runtime_error("feature dataset is truncated: " + path);
+    }
+    size_ = static_cast<std::size_t>(info.st_size);
+    void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("cannot mmap feature dataset: " + path);
+    }
+    data_ = static_cast<const std::byte*>(mapped);
+    header_ = reinterpret_cast<const FeatureDatasetHeader*>(data_);
+    columns_ = reinterpret_cast<const FeatureColumnDesc*>(data_ + sizeof(FeatureDatasetHeader));
+
+    const auto fail = [this](const char* message) {
+        ::munmap(const_cast<std::byte*>(data_), size_);
+        throw std::runtime_error(message);
+    };
+    if (std::memcmp(header_->magic, kFeatureDatasetMagic, sizeof(header_->magic)) != 0) {
+        fail("not a feature dataset file");
+    }
+    if (header_->version != kFeatureDatasetVersion) {
+        fail("unsupported feature dataset version");
+    }
+    if (header_->rows_per_group == 0) {
+        fail("feature dataset has no rows per group");
+    }
+    // Column table must fit between the header and the data, and the data inside the file
+    const std::uint64_t table_end =
+        sizeof(FeatureDatasetHeader) + std::uint64_t{header_->column_count} * sizeof(FeatureColumnDesc);
+    if (table_end > header_->data_offset || header_->data_offset > size_) {
+        fail("feature dataset column table is truncated");
+    }
+    const std::uint64_t groups = header_->row_count / header_->rows_per_group +
+                                 (header_->row_count % header_->rows_per_group != 0 ? 1 : 0);
+    if (groups > 0 && (header_->group_bytes == 0 || groups > (size_ - header_->data_offset) / header_->group_bytes)) {
+        fail("feature dataset is truncated");
+    }
+    for (std::uint32_t col = 0; col < header_->column_count; ++col) {
+        const std::uint64_t column_bytes = column_stride(columns_[col]) * std::uint64_t{header_->rows_per_group};
+        if (columns_[col].group_offset + column_bytes > header_->group_bytes) {
+            fail("feature dataset column lies outside its row group");
+        }
+    }
+}
+
+FeatureDatasetView::~FeatureDatasetView() {
+    if (data_ != nullptr) {
+        ::munmap(const_cast<std::byte*>(data_), size_);
+    }
+}
+
+int FeatureDatasetView::find_column(std::string_view name) const {
+    for (std::uint32_t col = 0; col < header_->column_count; ++col) {
+        const std::string_view column_name(columns_[col].name, strnlen(columns_[col].name, sizeof(columns_[col].name)));
+        if (column_name == name) {
+            return static_cast<int>(col);
+        }
+    }
+    return -1;
+}
+
+const void* FeatureDatasetView::cell(int column, std::uint64_t row) const {
+    const auto& desc = columns_[column];
+    const std::uint64_t group = row / header_->rows_per_group;
+    const std::uint64_t slot = row % header_->rows_per_group;
+    return data_ + header_->data_offset + group * header_->group_bytes + desc.group_offset +
+           slot * column_stride(desc);
+}
+
+FeatureRow FeatureDatasetView::row(std::uint64_t index) const {
+    if (index >= row_count()) {
+        throw std::out_of_range("feature row index out of range");
+    }
+    FeatureRow out{};
+    auto* out_bytes = reinterpret_cast<std::byte*>(&out);
+    const auto& active = schema();
+    for (std::size_t col = 0; col < active.columns.size(); ++col) {
+        const int file_col = find_column(active.columns[col].name);
+        if (file_col < 0) {
+            continue;
+        }
+        std::memcpy(out_bytes + active.sources[col].row_offset, cell(file_col, index),
+                    std::min(column_stride(active.columns[col]), column_stride(columns_[file_col])));
+    }
+    return out;
+}
+
+}  // namespace camelup::data
@@ -0,0 +1,153 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "camelup/sim/differential.hpp"
+#include "camelup/sim/game_record.hpp"
+#include "camelup/snapshot/action_notation.hpp"
+#include "camelup/snapshot/state_snapshot.hpp"
+
+namespace {
+
+// Games per batch between deadline checks in soak mode
+constexpr std::size_t kSoakBatchGames = 512;
+
+bool parse_int_arg(const char* value, int& out) {
+    char* end = nullptr;
+    const long parsed = std::strtol(value, &end, 10);
+    if (end == value || *end != '\0') {
+        return false;
+    }
+    out = static_cast<int>(parsed);
+    return true;
+}
+
+void print_usage() {
+    std::cout << "Usage: camelup_differential [--seed N] [--games N] [--players N] [--turn-limit N] [--soak SECONDS]\n"
+              << "                            [--threads N] [--record PATH]\n";
+}
+
+void report_divergence(const camelup::sim::Divergence& divergence, const std::string& record_path) {
+    const auto& record = divergence.record;
+    std::cout << "DIVERGENCE in game " << record.game << " (seed " << record.seed << ", "
+              << static_cast<int>(record.players) << " players) after " << record.actions.size() << " actions\n";
+    std::cout << "  " << divergence.what << '\n';
+    std::cout << "  agreed state: " << camelup::snapshot::to_notation(divergence.before) << '\n';
+
+    std::cout << "  record:";
+    std::size_t roll = 0;
+    for (const auto& action : record.actions) {
+        // Rolls show the outcome they were given
+        if (action.type() == camelup::ActionType::RollDie && roll < record.rolls.size()) {
+            std::cout << ' ' << camelup::snapshot::to_notation(record.rolls[roll++]);
+        } else {
+            std::cout << ' ' << camelup::snapshot::to_notation(action);
+        }
+    }
+    std::cout << '\n';
+    // The record file holds no paths, each action replays on the one listed here
+    std::cout << "  apply paths:";
+    for (const auto path : divergence.paths) {
+        std::cout << ' ' << camelup::sim::apply_path_name(path);
+    }
+    std::cout << '\n';
+
+    if (!record_path.empty()) {
+        std::vector<std::uint8_t> bytes;
+        camelup::sim::append_record(bytes, record);
+        std::ofstream out(record_path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!out) {
+            throw std::runtime_error("failed to write " + record_path);
+        }
+        std::cout << "  record written to " << record_path << '\n';
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int seed = 1;
+    int games = 200;
+    int players = 0;
+    int turn_limit = 0;
+    int soak_seconds = 0;
+    int threads = 0;
+    std::string record_path;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--record") {
+            record_path = argv[++i];
+            continue;
+        }
+
+        int parsed = 0;
+        if (!parse_int_arg(argv[++i], parsed) || parsed < 0) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--seed") {
+            seed = parsed;
+        } else if (arg == "--games") {
+            games = parsed;
+        } else if (arg == "--players") {
+            players = parsed;
+        } else if (arg == "--turn-limit") {
+            turn_limit = parsed;
+        } else if (arg == "--soak") {
+            soak_seconds = parsed;
+        } else if (arg == "--threads") {
+            threads = parsed;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+    if (players != 0 && (players < 2 || players > camelup::kMaxPlayers)) {
+        print_usage();
+        return 1;
+    }
+
+    try {
+        camelup::sim::DifferentialOptions options;
+        options.seed = seed;
+        options.players = players;
+        options.turn_limit = turn_limit;
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto deadline = start + std::chrono::seconds(soak_seconds);
+        std::uint64_t total_games = 0;
+        std::uint64_t total_actions = 0;
+        std::uint32_t next_game = 0;
+        do {
+            const std::size_t batch = soak_seconds > 0 ? kSoakBatchGames : static_cast<std::size_t>(games);
+            const auto report = camelup::sim::check_games(options, next_game, batch, static_cast<std::size_t>(threads));
+            total_games += report.games;
+            total_actions += report.actions;
+            next_game += static_cast<std::uint32_t>(batch);
+            if (report.divergence) {
+                report_divergence(*report.divergence, record_path);
+                return 1;
+            }
+        } while (soak_seconds > 0 && std::chrono::steady_clock::now() < deadline);
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "No divergence in " << total_games << " games, " << total_actions << " actions ("
+                  << seconds << " s)\n";
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "camelup_differential failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
@@ -1,17 +1,17 @@
 #include "camelup/engine.hpp"
 #include "camelup/rules/legal_actions.hpp"
+#include "camelup/util/profile.hpp"
+#include "camelup/util/trace.hpp"
 
-#include <algorithm> // any_of, min
+#include <algorithm> // any_of, copy, min
+#include <array>
+#include <cassert>
 #include <stdexcept>
 
 namespace camelup {
 
 namespace {
 
-constexpr std::array<int, kLegTicketCount> kLegTicketDefaults = {5, 3, 2};
-// Final bet rewards in play order for correct guesses
-constexpr std::array<int, 5> kFinalBetPayouts = {8, 5, 3, 2, 1};
-
 // Locate a camel anywhere on the board and return {tile_index, stack_index}
 // stack_index is measured bottom->top within that tile
 std::pair<int, int> find_camel(const GameState& state, CamelId camel) {
@@ -33,51 +33,59 @@ bool has_available_die(const GameState& state) {
     });
 }
 
-// Validate placement by matching against generated legal actions
+// Validate placement against the maintained legality mask of the current player
 bool is_legal_place_desert_tile_action(const GameState& state, const PlaceDesertTilePayload& payload) {
-    const auto legal = rules::legal_actions(state);
-    return std::any_of(legal.begin(), legal.end(), [&payload](const Action& action) {
-        if (action.type() != ActionType::PlaceDesertTile) {
-            return false;
-        }
-        const auto& legal_payload = std::get<PlaceDesertTilePayload>(action.payload);
-        return legal_payload.tile == payload.tile && legal_payload.move_delta == payload.move_delta;
-    });
+    if (payload.move_delta != 1 && payload.move_delta != -1) {
+        return false;
+    }
+    if (payload.tile <= 0 || payload.tile >= kBoardTiles - 1 || state.current_player >= state.player_count) {
+        return false;
+    }
+    return (state.desert_legal_tiles[state.current_player] >> payload.tile) & 1u;
 }
 
+// Tickets and bets mirror rules::legal_actions: a seated player, a real camel and a ticket or card left
 bool is_legal_take_leg_ticket_action(const GameState& state, const TakeLegTicketPayload& payload) {
-    const auto legal = rules::legal_actions(state);
-    return std::any_of(legal.begin(), legal.end(), [&payload](const Action& action) {
-        if (action.type() != ActionType::TakeLegTicket) {
-            return false;
-        }
-        const auto& legal_payload = std::get<TakeLegTicketPayload>(action.payload);
-        return legal_payload.camel == payload.camel;
-    });
+    return state.current_player < state.player_count && payload.camel < kCamelCount &&
+           state.leg_tickets_remaining[payload.camel] > 0;
 }
 
-// Validate winner bet by checking generated legal actions
 bool is_legal_bet_winner_action(const GameState& state, const BetWinnerPayload& payload) {
-    const auto legal = rules::legal_actions(state);
-    return std::any_of(legal.begin(), legal.end(), [&payload](const Action& action) {
-        if (action.type() != ActionType::BetWinner) {
-            return false;
-        }
-        const auto& legal_payload = std::get<BetWinnerPayload>(action.payload);
-        return legal_payload.camel == payload.camel;
-    });
+    return state.current_player < state.player_count && payload.camel < kCamelCount &&
+           state.winner_bet_card_available[state.current_player][payload.camel];
 }
 
-// Validate loser bet by checking generated legal actions
 bool is_legal_bet_loser_action(const GameState& state, const BetLoserPayload& payload) {
-    const auto legal = rules::legal_actions(state);
-    return std::any_of(legal.begin(), legal.end(), [&payload](const Action& action) {
-        if (action.type() != ActionType::BetLoser) {
-            return false;
-        }
-        const auto& legal_payload = std::get<BetLoserPayload>(action.payload);
-        return legal_payload.camel == payload.camel;
-    });
+    return state.current_player < state.player_count && payload.camel < kCamelCount &&
+           state.loser_bet_card_available[state.current_player][payload.camel];
+}
+
+// Rolls are always legal, terminal states ignore every action
+ApplyError validate_action(const GameState& state, const Action& action) {
+    if (state.terminal) {
+        return ApplyError::None;
+    }
+    switch (action.type()) {
+        case ActionType::RollDie:
+            return ApplyError::None;
+        case ActionType::PlaceDesertTile:
+            return is_legal_place_desert_tile_action(state, std::get<PlaceDesertTilePayload>(action.payload))
+                       ? ApplyError::None
+                       : ApplyError::IllegalDesertTile;
+        case ActionType::TakeLegTicket:
+            return is_legal_take_leg_ticket_action(state, std::get<TakeLegTicketPayload>(action.payload))
+                       ? ApplyError::None
+                       : ApplyError::IllegalLegTicket;
+        case ActionType::BetWinner:
+            return is_legal_bet_winner_action(state, std::get<BetWinnerPayload>(action.payload))
+                       ? ApplyError::None
+                       : ApplyError::IllegalWinnerBet;
+        case ActionType::BetLoser:
+            return is_legal_bet_loser_action(state, std::get<BetLoserPayload>(action.payload))
+                       ? ApplyError::None
+                       : ApplyError::IllegalLoserBet;
+    }
+    return ApplyError::None;
 }
 
 int clamp_tile_index(int tile) {
@@ -142,11 +150,21 @@ void reset_for_next_leg(GameState& state) {
     for (int player = 0; player < kMaxPlayers; ++player) {
         state.desert_tiles[player] = {-1, 1};
     }
+    // With every desert tile lifted any empty inner tile is legal for everyone
+    std::uint32_t empty_tiles = 0;
+    for (int tile = 1; tile < kBoardTiles - 1; ++tile) {
+        if (state.board[tile].empty()) {
+            empty_tiles |= 1u << tile;
+        }
+    }
+    state.desert_legal_tiles.fill(empty_tiles);
     state.die_available.fill(true);
     ++state.leg_number;
 }
 
 void resolve_leg_end(GameState& state) {
+    CAMELUP_PROFILE_SCOPE(util::profile::Phase::LegEnd);
+    CAMELUP_TRACE_SPAN("leg_end", "engine");
     const auto race_order = build_race_order(state);
     resolve_leg_tickets(state, race_order);
     reset_for_next_leg(state);
@@ -173,6 +191,7 @@ void resolve_final_bet_stack(std::array<int, kMaxPlayers>& money,
 
 // Resolve both final bet stacks when race ends
 void resolve_end_of_game_payouts(GameState& state) {
+    CAMELUP_PROFILE_SCOPE(util::profile::Phase::GamePayouts);
     const auto race_order = build_race_order(state);
     const CamelId winner = race_order.front();
     const CamelId loser = race_order.back();
@@ -180,8 +199,40 @@ void resolve_end_of_game_payouts(GameState& state) {
     resolve_final_bet_stack(state.money, state.loser_bet_stack, loser);
 }
 
+[[maybe_unused]] util::profile::Phase apply_phase(ActionType type) {
+    switch (type) {
+        case ActionType::RollDie:
+            return util::profile::Phase::ApplyRollDie;
+        case ActionType::PlaceDesertTile:
+            return util::profile::Phase::ApplyPlaceDesertTile;
+        case ActionType::TakeLegTicket:
+            return util::profile::Phase::ApplyTakeLegTicket;
+        case ActionType::BetWinner:
+            return util::profile::Phase::ApplyBetWinner;
+        case ActionType::BetLoser:
+            return util::profile::Phase::ApplyBetLoser;
+    }
+    return util::profile::Phase::ApplyRollDie;
+}
+
 }  // namespace
 
+const char* apply_error_message(ApplyError error) noexcept {
+    switch (error) {
+        case ApplyError::None:
+            return "no error";
+        case ApplyError::IllegalDesertTile:
+            return "illegal place desert tile action";
+        case ApplyError::IllegalLegTicket:
+            return "illegal take leg ticket action";
+        case ApplyError::IllegalWinnerBet:
+            return "illegal winner bet action";
+        case ApplyError::IllegalLoserBet:
+            return "illegal loser bet action";
+    }
+    return "unknown apply error";
+}
+
 Engine::Engine(std::uint32_t seed) : rng_(seed) {}
 
 GameState Engine::new_game(int player_count) {
@@ -195,7 +246,7 @@ GameState Engine::new_game(int player_count) {
     state.current_player = 0;
     state.leg_number = 1;
     state.terminal = false;
-    state.money.fill(3);
+    state.money.fill(kStartingMoney);
     state.desert_tile_owner.fill(-1);
     state.leg_tickets_remaining.fill(kLegTicketCount);
 
@@ -220,6 +271,7 @@ GameState Engine::new_game(int player_count) {
     }
     // Leg 1 starts with all dice available after opening setup
     reset_leg_dice(state);
+    rules::refresh_desert_legality(state);
 
     return state;
 }
@@ -228,11 +280,38 @@ std::vector<Action> Engine::legal_actions(const GameState& state) const {
     return rules::legal_actions(state);
 }
 
-GameState Engine::apply_action(const GameState& state, const Action& action) {
+void Engine::legal_actions(const GameState& state, std::vector<Action>& actions) const {
+    rules::legal_actions(state, actions);
+}
+
+GameState Engine::apply_action(const GameState& state, const Action& action, DieRoll* rolled) {
     GameState next = state;
+    if (const auto error = try_apply(next, action, rolled); error != ApplyError::None) {
+        throw std::invalid_argument(apply_error_message(error));
+    }
+    return next;
+}
+
+ApplyError Engine::try_apply(GameState& state, const Action& action, DieRoll* rolled) {
+    CAMELUP_PROFILE_SCOPE(apply_phase(action.type()));
+    if (const auto error = validate_action(state, action); error != ApplyError::None) {
+        return error;
+    }
+    apply_valid(state, action, rolled);
+    return ApplyError::None;
+}
+
+void Engine::apply_unchecked(GameState& state, const Action& action, DieRoll* rolled) {
+    CAMELUP_PROFILE_SCOPE(apply_phase(action.type()));
+    assert(validate_action(state, action) == ApplyError::None);
+    apply_valid(state, action, rolled);
+}
+
+// Callers have validated the action, nothing below may fail on a legal one
+void Engine::apply_valid(GameState& next, const Action& action, DieRoll* rolled) {
     // Preserve terminal states (no further mutation once game is over)
     if (next.terminal) {
-        return next;
+        return;
     }
 
     switch (action.type()) {
@@ -244,21 +323,14 @@ GameState Engine::apply_action(const GameState& state, const Action& action) {
 
             // Roll one available camel die and move that camel stack
             const auto [camel, distance] = roll_die(next);
-            move_camel_stack(next, camel, distance);
-
-            // Current player receives 1 coin for rolling
-            next.money[next.current_player] += 1;
-
-            // End of turn: pass to next player in seating order
-            next.current_player = static_cast<PlayerId>((next.current_player + 1) % next.player_count);
+            settle_roll(next, camel, distance);
+            if (rolled != nullptr) {
+                *rolled = DieRoll{camel, distance};
+            }
             break;
         }
         case ActionType::PlaceDesertTile: {
-            // Extract and validate placement intent before mutating state
             const auto payload = std::get<PlaceDesertTilePayload>(action.payload);
-            if (!is_legal_place_desert_tile_action(next, payload)) {
-                throw std::invalid_argument("illegal place desert tile action");
-            }
 
             const PlayerId current_player = next.current_player;
             const int previous_tile = next.desert_tiles[current_player].tile;
@@ -272,16 +344,18 @@ GameState Engine::apply_action(const GameState& state, const Action& action) {
             next.desert_tiles[current_player] = {payload.tile, payload.move_delta};
             next.desert_tile_owner[payload.tile] = static_cast<int>(current_player);
 
+            // Only the neighbourhoods of the lifted and the placed tile change legality
+            if (previous_tile >= 0) {
+                rules::update_desert_legality(next, previous_tile - 1, previous_tile + 1);
+            }
+            rules::update_desert_legality(next, payload.tile - 1, payload.tile + 1);
+
             // End turn after successful placement
             next.current_player = static_cast<PlayerId>((next.current_player + 1) % next.player_count);
             break;
         }
         case ActionType::TakeLegTicket: {
-            // Validate ticket request for current state
             const auto payload = std::get<TakeLegTicketPayload>(action.payload);
-            if (!is_legal_take_leg_ticket_action(next, payload)) {
-                throw std::invalid_argument("illegal take leg ticket action");
-            }
 
             // Determine ticket value from remaining count
             const CamelId camel = payload.camel;
@@ -300,11 +374,7 @@ GameState Engine::apply_action(const GameState& state, const Action& action) {
             break;
         }
         case ActionType::BetWinner: {
-            // Validate that current player still has this winner card
             const auto payload = std::get<BetWinnerPayload>(action.payload);
-            if (!is_legal_bet_winner_action(next, payload)) {
-                throw std::invalid_argument("illegal winner bet action");
-            }
 
             const PlayerId current_player = next.current_player;
             // Push bet in play order then mark card as used
@@ -314,11 +384,7 @@ GameState Engine::apply_action(const GameState& state, const Action& action) {
             break;
         }
         case ActionType::BetLoser: {
-            // Validate that current player still has this loser card
             const auto payload = std::get<BetLoserPayload>(action.payload);
-            if (!is_legal_bet_loser_action(next, payload)) {
-                throw std::invalid_argument("illegal loser bet action");
-            }
 
             const PlayerId current_player = next.current_player;
             // Push bet in play order then mark card as used
@@ -329,19 +395,37 @@ GameState Engine::apply_action(const GameState& state, const Action& action) {
         }
     }
 
-    // Race ends as soon as a camel reaches the final tile
-    if (!next.board[kBoardTiles - 1].empty()) {
-        next.terminal = true;
-        // Final winner and loser bets are settled once on transition to terminal
-        resolve_end_of_game_payouts(next);
+    resolve_after_action(next, action.type());
+}
+
+GameState Engine::apply_roll(const GameState& state, DieRoll roll) {
+    GameState next = state;
+    apply_roll_in_place(next, roll);
+    return next;
+}
+
+void Engine::settle_spent_leg(GameState& state) {
+    if (!state.terminal && !has_available_die(state)) {
+        resolve_leg_end(state);
     }
+}
 
-    // Leg ends when all dice are consumed and race is not terminal
-    if (!next.terminal && action.type() == ActionType::RollDie && !has_available_die(next)) {
-        resolve_leg_end(next);
+void Engine::apply_roll_in_place(GameState& state, DieRoll roll) {
+    CAMELUP_PROFILE_SCOPE(util::profile::Phase::ApplyRollDie);
+    if (state.terminal) {
+        return;
+    }
+    // Same defensive recovery as a random roll
+    if (!has_available_die(state)) {
+        resolve_leg_end(state);
+    }
+    if (roll.camel >= kCamelCount || !state.die_available[roll.camel] || roll.distance < 1 || roll.distance > 3) {
+        throw std::invalid_argument("illegal die roll outcome");
     }
 
-    return next;
+    state.die_available[roll.camel] = false;
+    settle_roll(state, roll.camel, roll.distance);
+    resolve_after_action(state, ActionType::RollDie);
 }
 
 void Engine::reset_leg_dice(GameState& state) {
@@ -349,35 +433,66 @@ void Engine::reset_leg_dice(GameState& state) {
     state.die_available.fill(true);
 }
 
-std::pair<CamelId, int> Engine::roll_die(GameState& state) {
-    std::vector<CamelId> available;
-    available.reserve(kCamelCount);
+DieRoll Engine::draw_roll(const GameState& state) {
+    CAMELUP_PROFILE_SCOPE(util::profile::Phase::RollDie);
+    std::array<CamelId, kCamelCount> available{};
+    int available_count = 0;
 
     // Gather only dice that have not been rolled in this leg
     for (CamelId camel = 0; camel < static_cast<CamelId>(kCamelCount); ++camel) {
         if (state.die_available[camel]) {
-            available.push_back(camel);
+            available[available_count++] = camel;
         }
     }
 
-    if (available.empty()) {
+    if (available_count == 0) {
         throw std::runtime_error("no available dice to roll");
     }
 
     // Randomly choose one available camel die
-    std::uniform_int_distribution<int> camel_pick(0, static_cast<int>(available.size() - 1));
+    std::uniform_int_distribution<int> camel_pick(0, available_count - 1);
     const CamelId camel = available[camel_pick(rng_)];
 
     // Camel Up movement distance is 1 to 3
     std::uniform_int_distribution<int> distance_roll(1, 3);
-    const int distance = distance_roll(rng_);
+    return DieRoll{camel, distance_roll(rng_)};
+}
 
+std::pair<CamelId, int> Engine::roll_die(GameState& state) {
+    const auto [camel, distance] = draw_roll(state);
     // Mark chosen die as consumed for this leg
     state.die_available[camel] = false;
     return {camel, distance};
 }
 
+// Move the rolled camel stack, pay the roller and pass the turn
+void Engine::settle_roll(GameState& state, CamelId camel, int distance) {
+    move_camel_stack(state, camel, distance);
+
+    // Current player receives 1 coin for rolling
+    state.money[state.current_player] += 1;
+
+    // End of turn: pass to next player in seating order
+    state.current_player = static_cast<PlayerId>((state.current_player + 1) % state.player_count);
+}
+
+// Race and leg resolution shared by every action after its own effects are applied
+void Engine::resolve_after_action(GameState& state, ActionType type) {
+    // Race ends as soon as a camel reaches the final tile
+    if (!state.board[kBoardTiles - 1].empty()) {
+        state.terminal = true;
+        // Final winner and loser bets are settled once on transition to terminal
+        resolve_end_of_game_payouts(state);
+    }
+
+    // Leg ends when all dice are consumed and race is not terminal
+    if (!state.terminal && type == ActionType::RollDie && !has_available_die(state)) {
+        resolve_leg_end(state);
+    }
+}
+
 void Engine::move_camel_stack(GameState& state, CamelId camel, int distance) {
+    CAMELUP_PROFILE_SCOPE(util::profile::Phase::MoveCamelStack);
     // Moving camel carries every camel above it on the stack
     const auto [tile, idx] = find_camel(state, camel);
     if (tile < 0 || idx < 0) {
@@ -385,7 +500,9 @@ void Engine::move_camel_stack(GameState& state, CamelId camel, int distance) {
     }
 
     auto& source = state.board[tile];
-    std::vector<CamelId> carried(source.begin() + idx, source.end());
+    // At most every camel rides along, a fixed buffer keeps rolls allocation free
+    std::array<CamelId, kCamelCount> carried{};
+    const auto carried_end = std::copy(source.begin() + idx, source.end(), carried.begin());
     source.erase(source.begin() + idx, source.end());
 
     // Base landing tile from die roll
@@ -412,9 +529,17 @@ void Engine::move_camel_stack(GameState& state, CamelId camel, int distance) {
     // Oasis stacks on top and mirage stacks underneath
     auto& destination = state.board[final_tile];
     if (place_under_stack) {
-        destination.insert(destination.begin(), carried.begin(), carried.end());
+        destination.insert(destination.begin(), carried.begin(), carried_end);
     } else {
-        destination.insert(destination.end(), carried.begin(), carried.end());
+        destination.insert(destination.end(), carried.begin(), carried_end);
+    }
+
+    // An occupied tile is closed to everyone, a vacated one may reopen
+    for (auto& mask : state.desert_legal_tiles) {
+        mask &= ~(1u << final_tile);
+    }
+    if (source.empty()) {
+        rules::update_desert_legality(state, tile, tile);
     }
 }
 
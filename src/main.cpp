@@ -2,22 +2,21 @@
 #include <cstdlib>
 #include <exception>
 #include <iostream>
-#include <random>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "camelup/actions.hpp"
-#include "camelup/engine.hpp"
+#include "camelup/data/feature_dataset.hpp"
+#include "camelup/sim/batch.hpp"
+#include "camelup/sim/self_play.hpp"
+#include "camelup/snapshot/state_snapshot.hpp"
 #include "camelup/types.hpp"
+#include "camelup/util/profile.hpp"
+#include "camelup/util/trace.hpp"
 
 namespace {
 
-enum class Policy {
-    RollOnly,
-    FirstLegal,
-    RandomLegal
-};
-
 char camel_symbol(camelup::CamelId camel) {
     switch (static_cast<camelup::Camel>(camel)) {
         case camelup::Camel::Blue:
@@ -85,25 +84,11 @@ bool parse_int_arg(const char* value, int& out) {
     return true;
 }
 
-bool parse_policy(const std::string& value, Policy& out) {
-    if (value == "roll") {
-        out = Policy::RollOnly;
-        return true;
-    }
-    if (value == "first") {
-        out = Policy::FirstLegal;
-        return true;
-    }
-    if (value == "random") {
-        out = Policy::RandomLegal;
-        return true;
-    }
-    return false;
-}
-
 void print_usage() {
     std::cout
-        << "Usage: camelup [--seed N] [--players N] [--turn-limit N] [--policy roll|first|random] [--verbose]\n";
+        << "Usage: camelup [--seed N] [--players N] [--turn-limit N] [--policy roll|first|random|greedy] [--games N]\n"
+        << "               [--dataset PATH] [--position NOTATION] [--verbose] [--profile]\n"
+        << "               [--trace PATH] [--records PREFIX] [--threads N]\n";
 }
 
 std::vector<camelup::CamelId> build_race_order(const camelup::GameState& state) {
@@ -142,6 +127,8 @@ void print_summary(const camelup::GameState& state, int turns_played) {
     }
     std::cout << '\n';
 
+    std::cout << "Position: " << camelup::snapshot::to_notation(state) << '\n';
+
     std::cout << "Board\n";
     for (int tile = 0; tile < camelup::kBoardTiles; ++tile) {
         if (state.board[tile].empty()) {
@@ -158,28 +145,55 @@ void print_summary(const camelup::GameState& state, int turns_played) {
     }
 }
 
-const camelup::Action& choose_action(const std::vector<camelup::Action>& legal_actions,
-                                     Policy policy,
-                                     std::mt19937& chooser_rng) {
-    if (legal_actions.empty()) {
-        throw std::runtime_error("no legal actions available");
+// Single-threaded game loop with per-turn output and the optional feature dataset
+void run_games(const camelup::sim::BatchOptions& options, bool verbose, const std::string& dataset_path) {
+    std::unique_ptr<camelup::data::FeatureDatasetWriter> dataset;
+    if (!dataset_path.empty()) {
+        dataset = std::make_unique<camelup::data::FeatureDatasetWriter>(dataset_path);
     }
 
-    if (policy == Policy::RollOnly) {
-        for (const auto& action : legal_actions) {
-            if (action.type() == camelup::ActionType::RollDie) {
-                return action;
+    long long total_turns = 0;
+    int finished_games = 0;
+    const int games = options.games;
+    for (int game = 0; game < games; ++game) {
+        // Game g replays exactly as a single run with --seed (seed + g)
+        const auto outcome = camelup::sim::play_game(
+            options, game, [&](const camelup::GameState& state, const camelup::Action& action, int turn) {
+                if (verbose) {
+                    std::cout << "Turn " << turn << " P" << static_cast<int>(state.current_player) << " -> "
+                              << action_label(action) << '\n';
+                }
+                if (dataset) {
+                    dataset->record_turn(state, static_cast<std::uint32_t>(game),
+                                         static_cast<std::uint16_t>(turn));
+                }
+            });
+        const auto& state = outcome.final_state;
+        if (dataset) {
+            dataset->finish_game(state);
+        }
+
+        total_turns += outcome.turns;
+        if (state.terminal) {
+            ++finished_games;
+        }
+        if (games == 1) {
+            print_summary(state, outcome.turns);
+            if (!state.terminal && outcome.turns >= options.turn_limit) {
+                std::cout << "Stopped at turn limit\n";
             }
         }
-        return legal_actions.front();
     }
 
-    if (policy == Policy::FirstLegal) {
-        return legal_actions.front();
+    if (games > 1) {
+        std::cout << "Games played: " << games << '\n';
+        std::cout << "Games finished: " << finished_games << '\n';
+        std::cout << "Turns played: " << total_turns << '\n';
+    }
+    if (dataset) {
+        dataset->close();
+        std::cout << "Dataset rows: " << dataset->rows_written() << " -> " << dataset_path << '\n';
     }
-
-    std::uniform_int_distribution<std::size_t> pick(0, legal_actions.size() - 1);
-    return legal_actions[pick(chooser_rng)];
 }
 
 }  // namespace
@@ -187,9 +201,17 @@ const camelup::Action& choose_action(const std::vector<camelup::Action>& legal_a
 int main(int argc, char** argv) {
     int seed = 42;
     int players = 2;
+    bool players_given = false;
     int turn_limit = 500;
+    int games = 1;
     bool verbose = false;
-    Policy policy = Policy::RollOnly;
+    bool profile = false;
+    std::string dataset_path;
+    std::string trace_path;
+    std::string position;
+    std::string records_prefix;
+    int threads = 0;
+    camelup::sim::Policy policy = camelup::sim::Policy::RollOnly;
 
     for (int i = 1; i < argc; ++i) {
         const std::string arg = argv[i];
@@ -197,14 +219,37 @@ int main(int argc, char** argv) {
             verbose = true;
             continue;
         }
-        if (arg == "--seed" || arg == "--players" || arg == "--turn-limit" || arg == "--policy") {
+        if (arg == "--profile") {
+            profile = true;
+            continue;
+        }
+        if (arg == "--seed" || arg == "--players" || arg == "--turn-limit" || arg == "--policy" || arg == "--games" ||
+            arg == "--dataset" || arg == "--position" || arg == "--trace" || arg == "--records" ||
+            arg == "--threads") {
             if (i + 1 >= argc) {
                 print_usage();
                 return 1;
             }
 
+            if (arg == "--dataset") {
+                dataset_path = argv[++i];
+                continue;
+            }
+            if (arg == "--position") {
+                position = argv[++i];
+                continue;
+            }
+            if (arg == "--trace") {
+                trace_path = argv[++i];
+                continue;
+            }
+            if (arg == "--records") {
+                records_prefix = argv[++i];
+                continue;
+            }
+
             if (arg == "--policy") {
-                if (!parse_policy(argv[++i], policy)) {
+                if (!camelup::sim::parse_policy(argv[++i], policy)) {
                     print_usage();
                     return 1;
                 }
@@ -220,6 +265,11 @@ int main(int argc, char** argv) {
                 seed = parsed;
             } else if (arg == "--players") {
                 players = parsed;
+                players_given = true;
+            } else if (arg == "--games") {
+                games = parsed;
+            } else if (arg == "--threads") {
+                threads = parsed;
             } else {
                 turn_limit = parsed;
             }
@@ -230,28 +280,72 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    try {
-        camelup::Engine engine(static_cast<std::uint32_t>(seed));
-        auto state = engine.new_game(players);
-        std::mt19937 chooser_rng(static_cast<std::uint32_t>(seed ^ 0x9e3779b9U));
-
-        int turn = 0;
-        while (!state.terminal && turn < turn_limit) {
-            const auto legal_actions = engine.legal_actions(state);
-            const auto& action = choose_action(legal_actions, policy, chooser_rng);
+    if (games < 1 || threads < 0) {
+        print_usage();
+        return 1;
+    }
+    if (players_given && !position.empty()) {
+        std::cerr << "camelup failed: --players cannot be combined with --position, which sets the player count\n";
+        return 1;
+    }
+    if (!records_prefix.empty() && (verbose || !dataset_path.empty())) {
+        std::cerr << "camelup failed: --records cannot be combined with --verbose or --dataset\n";
+        return 1;
+    }
+    if (profile && !camelup::util::profile::kCompiledIn) {
+        std::cerr << "camelup failed: --profile needs a build with -DCAMELUP_ENABLE_PROFILING=ON\n";
+        return 1;
+    }
+    camelup::util::profile::set_enabled(profile);
+    if (!trace_path.empty()) {
+        camelup::util::trace::start();
+        camelup::util::trace::set_thread_name("main");
+    }
 
-            if (verbose) {
-                std::cout << "Turn " << turn << " P" << static_cast<int>(state.current_player)
-                          << " -> " << action_label(action) << '\n';
-            }
+    try {
+        // A pasted position replaces the seeded opening setup for every game
+        camelup::sim::BatchOptions options;
+        options.seed = seed;
+        options.players = players;
+        options.games = games;
+        options.turn_limit = turn_limit;
+        options.policy = policy;
+        if (!position.empty()) {
+            options.start = camelup::snapshot::from_notation(position);
+        }
 
-            state = engine.apply_action(state, action);
-            ++turn;
+        if (!records_prefix.empty()) {
+            // Producers play games on their own threads, one writer streams the records to shards
+            camelup::sim::SelfPlayOptions self_play;
+            self_play.batch = options;
+            self_play.output_prefix = records_prefix;
+            self_play.producers = static_cast<std::size_t>(threads);
+            camelup::sim::SelfPlayPipeline pipeline(self_play);
+            const auto stats = pipeline.wait();
+            std::cout << "Games played: " << stats.games << '\n';
+            std::cout << "Games finished: " << stats.finished << '\n';
+            std::cout << "Turns played: " << stats.turns << '\n';
+            std::cout << "Records: " << stats.bytes << " bytes in " << stats.shards << " shard(s) -> "
+                      << records_prefix << "-*.rec\n";
+            std::cout << "Throughput: " << static_cast<long long>(stats.games_per_second())
+                      << " games/s, queue depth mean " << stats.mean_queue_depth << " max " << stats.max_queue_depth
+                      << " of " << stats.queue_capacity << ", producer waits " << stats.producer_waits << '\n';
+        } else {
+            run_games(options, verbose, dataset_path);
         }
 
-        print_summary(state, turn);
-        if (!state.terminal && turn >= turn_limit) {
-            std::cout << "Stopped at turn limit\n";
+        if (!trace_path.empty()) {
+            camelup::util::trace::stop();
+            camelup::util::trace::write_file(trace_path);
+            std::cout << "Trace: " << trace_path << '\n';
+        }
+        if (profile) {
+            // Inclusive times, an apply phase contains the roll, move and leg phases it triggers
+            const auto totals = camelup::util::profile::collect();
+            std::cout << "Profile\n";
+            camelup::util::profile::print_table(std::cout, totals);
+            camelup::util::profile::write_json(std::cout, totals);
+            std::cout << '\n';
         }
         return 0;
     } catch (const std::exception& ex) {
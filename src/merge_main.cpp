@@ -0,0 +1,34 @@
+#include <exception>
+#include <iostream>
+#include <vector>
+
+#include "camelup/sim/batch.hpp"
+#include "camelup/sim/shard_file.hpp"
+
+namespace {
+
+void print_usage() {
+    std::cout << "Usage: camelup_merge SHARD_FILE...\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+
+    try {
+        std::vector<camelup::sim::ShardResult> shards;
+        shards.reserve(static_cast<std::size_t>(argc - 1));
+        for (int i = 1; i < argc; ++i) {
+            shards.push_back(camelup::sim::load_shard(argv[i]));
+        }
+        camelup::sim::print_report(std::cout, camelup::sim::merge_shards(shards));
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "camelup_merge failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,70 @@
+#include "camelup/packed_camels.hpp"
+
+#include <stdexcept>
+
+namespace camelup {
+
+DesertDeltas desert_deltas(const GameState& state) {
+    DesertDeltas desert{};
+    for (int tile = 0; tile < kBoardTiles; ++tile) {
+        const int owner = state.desert_tile_owner[tile];
+        if (owner < 0 || owner >= kMaxPlayers) {
+            continue;
+        }
+        // Same sanitising as the engine, anything but a mirage acts as an oasis
+        desert[tile] = static_cast<std::int8_t>(state.desert_tiles[owner].move_delta == -1 ? -1 : 1);
+    }
+    return desert;
+}
+
+PackedCamels PackedCamels::from_board(const std::array<std::vector<CamelId>, kBoardTiles>& board) {
+    PackedCamels packed;
+    int seen = 0;
+    for (int tile = 0; tile < kBoardTiles; ++tile) {
+        const auto& stack = board[tile];
+        for (std::size_t height = 0; height < stack.size(); ++height) {
+            const CamelId camel = stack[height];
+            if (camel >= kCamelCount || ((seen >> camel) & 1)) {
+                throw std::invalid_argument("board must hold every camel exactly once");
+            }
+            seen |= 1 << camel;
+            const auto lane_key = static_cast<std::uint64_t>((tile << 3) | static_cast<int>(height));
+            packed.bits_ |= lane_key << (8 * camel);
+        }
+    }
+    if (seen != (1 << kCamelCount) - 1) {
+        throw std::invalid_argument("board must hold every camel exactly once");
+    }
+    return packed;
+}
+
+void PackedCamels::to_board(std::array<std::vector<CamelId>, kBoardTiles>& board) const {
+    for (auto& stack : board) {
+        stack.clear();
+    }
+    // Walking camels in key order fills every stack bottom to top
+    auto order = race_order();
+    for (int i = kCamelCount - 1; i >= 0; --i) {
+        board[tile(order[i])].push_back(order[i]);
+    }
+}
+
+std::array<CamelId, kCamelCount> PackedCamels::race_order() const noexcept {
+    std::array<CamelId, kCamelCount> order{};
+    for (CamelId camel = 0; camel < kCamelCount; ++camel) {
+        order[camel] = camel;
+    }
+    // Insertion sort by descending key, five elements
+    for (int i = 1; i < kCamelCount; ++i) {
+        const CamelId camel = order[i];
+        int j = i - 1;
+        while (j >= 0 && key(order[j]) < key(camel)) {
+            order[j + 1] = order[j];
+            --j;
+        }
+        order[j + 1] = camel;
+    }
+    return order;
+}
+
+}  // namespace camelup
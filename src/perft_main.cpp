@@ -0,0 +1,137 @@
+#include <algorithm>  // max
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "camelup/engine.hpp"
+#include "camelup/sim/perft.hpp"
+#include "camelup/snapshot/state_snapshot.hpp"
+#include "camelup/util/trace.hpp"
+
+namespace {
+
+constexpr const char* kActionNames[camelup::kActionTypeCount] = {"roll", "desert", "ticket", "winner", "loser"};
+
+bool parse_int_arg(const char* value, int& out) {
+    char* end = nullptr;
+    const long parsed = std::strtol(value, &end, 10);
+    if (end == value || *end != '\0') {
+        return false;
+    }
+    out = static_cast<int>(parsed);
+    return true;
+}
+
+void print_usage() {
+    std::cout << "Usage: camelup_perft [--depth N] [--seed N] [--players N] [--position NOTATION] [--dedupe]\n"
+              << "                     [--threads N] [--trace PATH]\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int depth = 3;
+    int seed = 42;
+    int players = 2;
+    bool players_given = false;
+    int threads = 0;
+    bool dedupe = false;
+    std::string position;
+    std::string trace_path;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--dedupe") {
+            dedupe = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--position") {
+            position = argv[++i];
+            continue;
+        }
+        if (arg == "--trace") {
+            trace_path = argv[++i];
+            continue;
+        }
+
+        int parsed = 0;
+        if (!parse_int_arg(argv[++i], parsed) || parsed < 0) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--depth") {
+            depth = parsed;
+        } else if (arg == "--seed") {
+            seed = parsed;
+        } else if (arg == "--players") {
+            players = parsed;
+            players_given = true;
+        } else if (arg == "--threads") {
+            threads = parsed;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (players_given && !position.empty()) {
+        std::cerr << "camelup_perft failed: --players cannot be combined with --position, "
+                  << "which sets the player count\n";
+        return 1;
+    }
+
+    try {
+        // A pasted position replaces the seeded opening setup
+        const auto root = position.empty() ? camelup::Engine(static_cast<std::uint32_t>(seed)).new_game(players)
+                                           : camelup::snapshot::from_notation(position);
+        if (!trace_path.empty()) {
+            camelup::util::trace::start();
+            camelup::util::trace::set_thread_name("main");
+        }
+
+        std::cout << "Root: " << camelup::snapshot::to_notation(root) << '\n';
+        std::cout << "Dedupe: " << (dedupe ? "yes" : "no") << "\n\n";
+        std::cout << std::setw(5) << "depth" << std::setw(14) << "nodes";
+        for (const auto* name : kActionNames) {
+            std::cout << std::setw(12) << name;
+        }
+        std::cout << std::setw(10) << "terminal" << std::setw(10) << "seconds" << std::setw(14) << "nodes/s" << '\n';
+
+        // Each depth is a separate run, the last one dominates the time
+        for (int d = 1; d <= depth; ++d) {
+            camelup::sim::PerftOptions options;
+            options.depth = d;
+            options.dedupe = dedupe;
+            options.threads = static_cast<std::size_t>(threads);
+            const auto start = std::chrono::steady_clock::now();
+            const auto counts = camelup::sim::perft(root, options);
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << std::setw(5) << d << std::setw(14) << counts.nodes;
+            for (const auto moves : counts.moves) {
+                std::cout << std::setw(12) << moves;
+            }
+            std::cout << std::setw(10) << counts.terminal << std::fixed << std::setprecision(3) << std::setw(10)
+                      << seconds << std::setw(14) << static_cast<long long>(counts.nodes / std::max(seconds, 1e-9))
+                      << '\n';
+        }
+
+        if (!trace_path.empty()) {
+            camelup::util::trace::stop();
+            camelup::util::trace::write_file(trace_path);
+            std::cout << "Trace: " << trace_path << '\n';
+        }
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "camelup_perft failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,207 @@
+#include "camelup/persistent_state.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+
+#include "camelup/rules/legal_actions.hpp"
+
+namespace camelup {
+
+namespace {
+
+constexpr std::uint64_t kMirageBit = 0x20;
+
+std::int8_t narrow(int value) {
+    if (value < -128 || value > 127) {
+        throw std::invalid_argument("ticket value out of range for a persistent state");
+    }
+    return static_cast<std::int8_t>(value);
+}
+
+std::uint64_t card_bit(int player, CamelId camel) {
+    return std::uint64_t{1} << (player * kCamelCount + camel);
+}
+
+// Card availability as bits, every seat including the empty ones
+std::uint64_t pack_cards(const std::array<std::array<bool, kCamelCount>, kMaxPlayers>& cards) {
+    std::uint64_t bits = 0;
+    for (int player = 0; player < kMaxPlayers; ++player) {
+        for (CamelId camel = 0; camel < static_cast<CamelId>(kCamelCount); ++camel) {
+            bits |= cards[player][camel] ? card_bit(player, camel) : 0;
+        }
+    }
+    return bits;
+}
+
+void unpack_cards(std::uint64_t bits, std::array<std::array<bool, kCamelCount>, kMaxPlayers>& cards) {
+    for (int player = 0; player < kMaxPlayers; ++player) {
+        for (CamelId camel = 0; camel < static_cast<CamelId>(kCamelCount); ++camel) {
+            cards[player][camel] = (bits & card_bit(player, camel)) != 0;
+        }
+    }
+}
+
+// Blocks are compared against the state's fields without packing them first
+bool same_tickets(const PersistentState::Tickets& tickets, const GameState& state) {
+    for (CamelId camel = 0; camel < static_cast<CamelId>(kCamelCount); ++camel) {
+        if (tickets.remaining[camel] != state.leg_tickets_remaining[camel]) {
+            return false;
+        }
+        for (int i = 0; i < kLegTicketCount; ++i) {
+            if (tickets.values[camel][i] != state.leg_ticket_values[camel][i]) {
+                return false;
+            }
+        }
+    }
+    std::size_t next = 0;
+    for (int player = 0; player < kMaxPlayers; ++player) {
+        for (const auto& ticket : state.player_leg_tickets[player]) {
+            if (next == tickets.held.size()) {
+                return false;
+            }
+            const auto& held = tickets.held[next++];
+            if (held.player != player || held.camel != ticket.camel || held.value != ticket.value) {
+                return false;
+            }
+        }
+    }
+    return next == tickets.held.size();
+}
+
+bool same_bets(const PersistentState::Bets& bets, const GameState& state) {
+    return bets.winner_stack == state.winner_bet_stack && bets.loser_stack == state.loser_bet_stack &&
+           bets.winner_cards == pack_cards(state.winner_bet_card_available) &&
+           bets.loser_cards == pack_cards(state.loser_bet_card_available);
+}
+
+std::shared_ptr<const PersistentState::Tickets> make_tickets(const GameState& state) {
+    auto tickets = std::make_shared<PersistentState::Tickets>();
+    for (CamelId camel = 0; camel < static_cast<CamelId>(kCamelCount); ++camel) {
+        tickets->remaining[camel] = narrow(state.leg_tickets_remaining[camel]);
+        for (int i = 0; i < kLegTicketCount; ++i) {
+            tickets->values[camel][i] = narrow(state.leg_ticket_values[camel][i]);
+        }
+    }
+    for (int player = 0; player < kMaxPlayers; ++player) {
+        for (const auto& ticket : state.player_leg_tickets[player]) {
+            tickets->held.push_back({static_cast<PlayerId>(player), ticket.camel, narrow(ticket.value)});
+        }
+    }
+    tickets->held.shrink_to_fit();
+    return tickets;
+}
+
+std::shared_ptr<const PersistentState::Bets> make_bets(const GameState& state) {
+    return std::make_shared<const PersistentState::Bets>(
+        PersistentState::Bets{state.winner_bet_stack, state.loser_bet_stack,
+                              pack_cards(state.winner_bet_card_available),
+                              pack_cards(state.loser_bet_card_available)});
+}
+
+}  // namespace
+
+PersistentState::PersistentState(const GameState& state) : tickets_(make_tickets(state)), bets_(make_bets(state)) {
+    set_inline(state);
+}
+
+void PersistentState::set_inline(const GameState& state) {
+    camels_ = PackedCamels::from_board(state.board);
+    for (int player = 0; player < kMaxPlayers; ++player) {
+        if (state.money[player] < INT16_MIN || state.money[player] > INT16_MAX) {
+            throw std::invalid_argument("money out of range for a persistent state");
+        }
+        money_[player] = static_cast<std::int16_t>(state.money[player]);
+    }
+    desert_ = 0;
+    std::array<int, kBoardTiles> owners{};
+    owners.fill(-1);
+    for (int player = 0; player < kMaxPlayers; ++player) {
+        const auto placement = state.desert_tiles[player];
+        if (placement.tile < -1 || placement.tile >= kBoardTiles || (placement.move_delta != 1 &&
+                                                                      placement.move_delta != -1)) {
+            throw std::invalid_argument("desert tile out of range for a persistent state");
+        }
+        const std::uint64_t packed = static_cast<std::uint64_t>(placement.tile + 1) |
+                                     (placement.move_delta < 0 ? kMirageBit : 0);
+        desert_ |= packed << (8 * player);
+        if (placement.tile >= 0) {
+            owners[placement.tile] = player;
+        }
+    }
+    if (owners != state.desert_tile_owner) {
+        throw std::invalid_argument("desert tile owners do not match the placements");
+    }
+    dice_ = 0;
+    for (CamelId camel = 0; camel < static_cast<CamelId>(kCamelCount); ++camel) {
+        dice_ = static_cast<std::uint8_t>(dice_ | (state.die_available[camel] ? 1U << camel : 0U));
+    }
+    current_player_ = state.current_player;
+    player_count_ = static_cast<std::uint8_t>(state.player_count);
+    terminal_ = state.terminal;
+    leg_number_ = state.leg_number;
+}
+
+PersistentState PersistentState::derive(const GameState& child) const {
+    PersistentState next;
+    next.set_inline(child);
+    next.tickets_ = same_tickets(*tickets_, child) ? tickets_ : make_tickets(child);
+    next.bets_ = same_bets(*bets_, child) ? bets_ : make_bets(child);
+    return next;
+}
+
+PersistentState PersistentState::apply(Engine& engine, const Action& action, DieRoll* rolled) const {
+    return derive(engine.apply_action(materialise(), action, rolled));
+}
+
+DesertTilePlacement PersistentState::desert_tile(PlayerId player) const noexcept {
+    const auto packed = (desert_ >> (8 * player)) & 0xFF;
+    return {static_cast<int>(packed & 0x1F) - 1, (packed & kMirageBit) != 0 ? -1 : 1};
+}
+
+GameState PersistentState::materialise() const {
+    GameState state;
+    camels_.to_board(state.board);
+    for (int player = 0; player < kMaxPlayers; ++player) {
+        state.money[player] = money_[player];
+    }
+    for (CamelId camel = 0; camel < static_cast<CamelId>(kCamelCount); ++camel) {
+        state.die_available[camel] = die_available(camel);
+    }
+    state.desert_tile_owner.fill(-1);
+    for (int player = 0; player < kMaxPlayers; ++player) {
+        state.desert_tiles[player] = desert_tile(static_cast<PlayerId>(player));
+        if (state.desert_tiles[player].tile >= 0) {
+            state.desert_tile_owner[state.desert_tiles[player].tile] = player;
+        }
+    }
+    for (CamelId camel = 0; camel < static_cast<CamelId>(kCamelCount); ++camel) {
+        state.leg_tickets_remaining[camel] = tickets_->remaining[camel];
+        for (int i = 0; i < kLegTicketCount; ++i) {
+            state.leg_ticket_values[camel][i] = tickets_->values[camel][i];
+        }
+    }
+    for (const auto& ticket : tickets_->held) {
+        state.player_leg_tickets[ticket.player].push_back({ticket.camel, ticket.value});
+    }
+    state.winner_bet_stack = bets_->winner_stack;
+    state.loser_bet_stack = bets_->loser_stack;
+    unpack_cards(bets_->winner_cards, state.winner_bet_card_available);
+    unpack_cards(bets_->loser_cards, state.loser_bet_card_available);
+    state.current_player = current_player_;
+    state.player_count = player_count_;
+    state.leg_number = leg_number_;
+    state.terminal = terminal_;
+    rules::refresh_desert_legality(state);
+    return state;
+}
+
+bool PersistentState::operator==(const PersistentState& other) const {
+    // Shared blocks compare by identity first
+    return camels_ == other.camels_ && money_ == other.money_ && desert_ == other.desert_ && dice_ == other.dice_ &&
+           current_player_ == other.current_player_ && player_count_ == other.player_count_ &&
+           terminal_ == other.terminal_ && leg_number_ == other.leg_number_ &&
+           (tickets_ == other.tickets_ || *tickets_ == *other.tickets_) &&
+           (bets_ == other.bets_ || *bets_ == *other.bets_);
+}
+
+}  // namespace camelup
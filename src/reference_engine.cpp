@@ -0,0 +1,207 @@
+#include "camelup/reference_engine.hpp"
+
+#include <algorithm>  // find, min
+#include <stdexcept>
+
+#include "camelup/rules/legal_actions.hpp"
+
+namespace camelup::reference {
+
+namespace {
+
+// First to last: higher tiles lead, within a stack the top camel leads
+std::vector<CamelId> race_order(const GameState& state) {
+    std::vector<CamelId> order;
+    for (int tile = kBoardTiles - 1; tile >= 0; --tile) {
+        const auto& stack = state.board[tile];
+        order.insert(order.end(), stack.rbegin(), stack.rend());
+    }
+    if (order.size() != kCamelCount) {
+        throw std::invalid_argument("board does not hold every camel");
+    }
+    return order;
+}
+
+void pass_turn(GameState& state) {
+    state.current_player = static_cast<PlayerId>((state.current_player + 1) % state.player_count);
+}
+
+// The player whose desert tile lies on `tile`, or -1
+int desert_tile_player(const GameState& state, int tile) {
+    for (int player = 0; player < state.player_count; ++player) {
+        if (state.desert_tiles[player].tile == tile) {
+            return player;
+        }
+    }
+    return -1;
+}
+
+// The camel and every camel on top of it move together
+void move_camel(GameState& state, CamelId camel, int distance) {
+    for (int tile = 0; tile < kBoardTiles; ++tile) {
+        auto& stack = state.board[tile];
+        const auto found = std::find(stack.begin(), stack.end(), camel);
+        if (found == stack.end()) {
+            continue;
+        }
+        const std::vector<CamelId> carried(found, stack.end());
+        stack.erase(found, stack.end());
+
+        // Moves past the finish stop on the last tile
+        int target = std::min(tile + distance, kBoardTiles - 1);
+        bool underneath = false;
+        if (const int owner = desert_tile_player(state, target); owner >= 0) {
+            // Oasis moves one on and lands on top, mirage moves one back and slides under
+            state.money[owner] += 1;
+            underneath = state.desert_tiles[owner].move_delta < 0;
+            target = std::min(target + state.desert_tiles[owner].move_delta, kBoardTiles - 1);
+        }
+        auto& destination = state.board[target];
+        destination.insert(underneath ? destination.begin() : destination.end(), carried.begin(), carried.end());
+        return;
+    }
+    throw std::invalid_argument("camel is not on the board");
+}
+
+// Leg tickets pay their value for the leader, 1 for second place and cost 1 otherwise
+void score_leg(GameState& state) {
+    const auto order = race_order(state);
+    for (int player = 0; player < kMaxPlayers; ++player) {
+        for (const auto& ticket : state.player_leg_tickets[player]) {
+            if (player >= state.player_count) {
+                continue;
+            }
+            if (ticket.camel == order[0]) {
+                state.money[player] += ticket.value;
+            } else if (ticket.camel == order[1]) {
+                state.money[player] += 1;
+            } else {
+                state.money[player] -= 1;
+            }
+        }
+        state.player_leg_tickets[player].clear();
+    }
+    state.leg_tickets_remaining.fill(kLegTicketCount);
+    for (auto& placement : state.desert_tiles) {
+        placement = {-1, 1};
+    }
+    state.die_available.fill(true);
+    ++state.leg_number;
+}
+
+// Correct final bets pay 8, 5, 3, 2, 1 and then 1 in the order they were placed, wrong ones cost 1
+void score_final_bets(GameState& state, const std::vector<FinalBetCard>& stack, CamelId camel) {
+    std::size_t correct = 0;
+    for (const auto& card : stack) {
+        if (card.camel != camel) {
+            state.money[card.player] -= 1;
+            continue;
+        }
+        state.money[card.player] += correct < kFinalBetPayouts.size() ? kFinalBetPayouts[correct] : 1;
+        ++correct;
+    }
+}
+
+void rebuild_derived(GameState& state) {
+    state.desert_tile_owner.fill(-1);
+    for (int player = 0; player < kMaxPlayers; ++player) {
+        if (state.desert_tiles[player].tile >= 0) {
+            state.desert_tile_owner[state.desert_tiles[player].tile] = player;
+        }
+    }
+    rules::refresh_desert_legality(state);
+}
+
+}  // namespace
+
+std::vector<Action> legal_actions(const GameState& state) {
+    std::vector<Action> actions;
+    if (state.terminal) {
+        return actions;
+    }
+    actions.push_back(Action::roll_die());
+    const PlayerId player = state.current_player;
+    if (player >= state.player_count) {
+        return actions;
+    }
+    for (int tile = 0; tile < kBoardTiles; ++tile) {
+        if (rules::is_legal_desert_tile_placement(state, tile, player)) {
+            actions.push_back(Action::place_desert_tile(tile, 1));
+            actions.push_back(Action::place_desert_tile(tile, -1));
+        }
+    }
+    for (CamelId camel = 0; camel < static_cast<CamelId>(kCamelCount); ++camel) {
+        if (state.leg_tickets_remaining[camel] > 0) {
+            actions.push_back(Action::take_leg_ticket(camel));
+        }
+    }
+    for (CamelId camel = 0; camel < static_cast<CamelId>(kCamelCount); ++camel) {
+        if (state.winner_bet_card_available[player][camel]) {
+            actions.push_back(Action::bet_winner(camel));
+        }
+        if (state.loser_bet_card_available[player][camel]) {
+            actions.push_back(Action::bet_loser(camel));
+        }
+    }
+    return actions;
+}
+
+GameState apply(const GameState& state, const Action& action, DieRoll roll) {
+    const auto legal = legal_actions(state);
+    if (std::find(legal.begin(), legal.end(), action) == legal.end()) {
+        throw std::invalid_argument("action is not legal in this state");
+    }
+
+    GameState next = state;
+    const PlayerId player = next.current_player;
+    switch (action.type()) {
+        case ActionType::RollDie:
+            if (roll.camel >= kCamelCount || !next.die_available[roll.camel] || roll.distance < 1 ||
+                roll.distance > 3) {
+                throw std::invalid_argument("die roll outcome is not possible in this state");
+            }
+            next.die_available[roll.camel] = false;
+            move_camel(next, roll.camel, roll.distance);
+            next.money[player] += 1;
+            break;
+        case ActionType::PlaceDesertTile: {
+            const auto& place = std::get<PlaceDesertTilePayload>(action.payload);
+            next.desert_tiles[player] = {place.tile, place.move_delta};
+            break;
+        }
+        case ActionType::TakeLegTicket: {
+            const CamelId camel = std::get<TakeLegTicketPayload>(action.payload).camel;
+            const int taken = kLegTicketCount - next.leg_tickets_remaining[camel];
+            next.player_leg_tickets[player].push_back({camel, next.leg_ticket_values[camel][taken]});
+            --next.leg_tickets_remaining[camel];
+            break;
+        }
+        case ActionType::BetWinner: {
+            const CamelId camel = std::get<BetWinnerPayload>(action.payload).camel;
+            next.winner_bet_stack.push_back({player, camel});
+            next.winner_bet_card_available[player][camel] = false;
+            break;
+        }
+        case ActionType::BetLoser: {
+            const CamelId camel = std::get<BetLoserPayload>(action.payload).camel;
+            next.loser_bet_stack.push_back({player, camel});
+            next.loser_bet_card_available[player][camel] = false;
+            break;
+        }
+    }
+    pass_turn(next);
+
+    // The race ends once a camel reaches the last tile, otherwise the leg ends with its last die
+    if (!next.board[kBoardTiles - 1].empty()) {
+        next.terminal = true;
+        const auto order = race_order(next);
+        score_final_bets(next, next.winner_bet_stack, order.front());
+        score_final_bets(next, next.loser_bet_stack, order.back());
+    } else if (std::find(next.die_available.begin(), next.die_available.end(), true) == next.die_available.end()) {
+        score_leg(next);
+    }
+    rebuild_derived(next);
+    return next;
+}
+
+}  // namespace camelup::reference
@@ -1,5 +1,10 @@
 #include "camelup/rules/legal_actions.hpp"
 
+#include <algorithm>  // max, min
+#include <bit>        // countr_zero, popcount
+
+#include "camelup/util/profile.hpp"
+
 namespace camelup::rules {
 
 namespace {
@@ -23,6 +28,8 @@ bool has_blocking_desert_tile(const GameState& state, int tile, PlayerId current
     return true;
 }
 
+}  // namespace
+
 // Placement limits for desert tiles in this engine
 bool is_legal_desert_tile_placement(const GameState& state, int tile, PlayerId current_player) {
     // Cannot place on start or finish tile
@@ -46,33 +53,60 @@ bool is_legal_desert_tile_placement(const GameState& state, int tile, PlayerId c
     return true;
 }
 
-}  // namespace
+void refresh_desert_legality(GameState& state) {
+    state.desert_legal_tiles.fill(0);
+    update_desert_legality(state, 1, kBoardTiles - 2);
+}
+
+void update_desert_legality(GameState& state, int first_tile, int last_tile) {
+    first_tile = std::max(first_tile, 1);
+    last_tile = std::min(last_tile, kBoardTiles - 2);
+    for (int player = 0; player < kMaxPlayers; ++player) {
+        auto& mask = state.desert_legal_tiles[player];
+        for (int tile = first_tile; tile <= last_tile; ++tile) {
+            const std::uint32_t bit = 1u << tile;
+            if (is_legal_desert_tile_placement(state, tile, static_cast<PlayerId>(player))) {
+                mask |= bit;
+            } else {
+                mask &= ~bit;
+            }
+        }
+    }
+}
 
 // Build full legal action list for the current player in current state
 std::vector<Action> legal_actions(const GameState& state) {
+    std::vector<Action> actions;
+    legal_actions(state, actions);
+    return actions;
+}
+
+void legal_actions(const GameState& state, std::vector<Action>& actions) {
+    CAMELUP_PROFILE_SCOPE(util::profile::Phase::LegalActions);
+    actions.clear();
     // No actions once game is terminal
     if (state.terminal) {
-        return {};
+        return;
     }
 
-    std::vector<Action> actions;
-    // Reserve near upper bound to avoid repeated reallocations
-    actions.reserve(1 + ((kBoardTiles - 2) * 2) + kCamelCount * 3);
+    const PlayerId current_player = state.current_player;
+    const std::uint32_t desert_tiles =
+        static_cast<int>(current_player) < kMaxPlayers ? state.desert_legal_tiles[current_player] : 0;
+
+    // Exact desert count from the mask, bets and tickets at their upper bound
+    actions.reserve(1 + std::popcount(desert_tiles) * 2 + kCamelCount * 3);
 
     // Rolling is always offered
     actions.push_back(Action::roll_die());
 
-    const PlayerId current_player = state.current_player;
     // Defensive guard for malformed state
     if (static_cast<int>(current_player) >= state.player_count) {
-        return actions;
+        return;
     }
 
-    // For each legal tile add both oasis (+1) and mirage (-1) options
-    for (int tile = 1; tile < kBoardTiles - 1; ++tile) {
-        if (!is_legal_desert_tile_placement(state, tile, current_player)) {
-            continue;
-        }
+    // For each legal tile add both oasis (+1) and mirage (-1) options, lowest tile first
+    for (std::uint32_t mask = desert_tiles; mask != 0; mask &= mask - 1) {
+        const int tile = std::countr_zero(mask);
         actions.push_back(Action::place_desert_tile(tile, 1));
         actions.push_back(Action::place_desert_tile(tile, -1));
     }
@@ -93,8 +127,6 @@ std::vector<Action> legal_actions(const GameState& state) {
             actions.push_back(Action::bet_loser(camel));
         }
     }
-
-    return actions;
 }
 
 }  // namespace camelup::rules
@@ -0,0 +1,464 @@
+#include "camelup/serve/server.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+
+#include "camelup/analysis/action_values.hpp"
+#include "camelup/engine.hpp"
+#include "camelup/rules/legal_actions.hpp"
+#include "camelup/snapshot/action_notation.hpp"
+#include "camelup/snapshot/state_snapshot.hpp"
+#include "camelup/util/trace.hpp"
+
+namespace camelup::serve {
+
+namespace {
+
+// Pause before accepting again while the process is out of descriptors
+constexpr auto kAcceptBackoff = std::chrono::milliseconds(50);
+
+// Minimal buffered streambuf over a socket descriptor
+class FdStreamBuf : public std::streambuf {
+public:
+    explicit FdStreamBuf(int fd) : fd_(fd) {
+        setg(input_, input_, input_);
+        setp(output_, output_ + sizeof(output_));
+    }
+
+    ~FdStreamBuf() override { sync(); }
+
+protected:
+    int_type underflow() override {
+        const ssize_t got = ::read(fd_, input_, sizeof(input_));
+        if (got <= 0) {
+            return traits_type::eof();
+        }
+        setg(input_, input_, input_ + got);
+        return traits_type::to_int_type(input_[0]);
+    }
+
+    int_type overflow(int_type ch) override {
+        if (sync() != 0) {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int sync() override {
+        const char* data = pbase();
+        while (data < pptr()) {
+            const ssize_t sent = ::send(fd_, data, static_cast<std::size_t>(pptr() - data), MSG_NOSIGNAL);
+            if (sent <= 0) {
+                return -1;
+            }
+            data += sent;
+        }
+        setp(output_, output_ + sizeof(output_));
+        return 0;
+    }
+
+private:
+    int fd_;
+    char input_[4096];
+    char output_[4096];
+};
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t' || text.front() == '\r')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+std::vector<std::string_view> words(std::string_view text) {
+    std::vector<std::string_view> out;
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+        while (pos < text.size() && text[pos] == ' ') {
+            ++pos;
+        }
+        const auto start = pos;
+        while (pos < text.size() && text[pos] != ' ') {
+            ++pos;
+        }
+        if (pos > start) {
+            out.push_back(text.substr(start, pos - start));
+        }
+    }
+    return out;
+}
+
+QueryKind parse_kind(std::string_view name) {
+    if (name == "legal") {
+        return QueryKind::Legal;
+    }
+    if (name == "apply") {
+        return QueryKind::Apply;
+    }
+    if (name == "leg") {
+        return QueryKind::Leg;
+    }
+    if (name == "race") {
+        return QueryKind::Race;
+    }
+    if (name == "best") {
+        return QueryKind::Best;
+    }
+    return QueryKind::Invalid;
+}
+
+void append_probabilities(std::ostringstream& out, const char* label, const std::array<double, kCamelCount>& values) {
+    out << ' ' << label;
+    for (const double value : values) {
+        out << ' ' << value;
+    }
+}
+
+}  // namespace
+
+Server::Server(ServerOptions options)
+    : options_(options), cache_(options.cache_capacity), pool_(options.threads) {
+    if (options_.max_in_flight == 0) {
+        throw std::invalid_argument("max_in_flight must be at least 1");
+    }
+}
+
+Server::~Server() {
+    stop();
+    // Join outside the lock, connection threads take it once more to close their descriptor
+    std::list<Connection> connections;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        connections.swap(connections_);
+    }
+    for (auto& connection : connections) {
+        connection.thread.join();
+    }
+}
+
+std::string Server::handle(std::string_view request) {
+    CAMELUP_TRACE_SPAN("request", "serve");
+    const auto started = std::chrono::steady_clock::now();
+    QueryKind kind = QueryKind::Invalid;
+    std::string response;
+    try {
+        response = answer(kind, request);
+    } catch (const std::exception& ex) {
+        response = std::string("error ") + ex.what();
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - started;
+    record_latency(kind, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+    return response;
+}
+
+std::string Server::answer(QueryKind& kind, std::string_view request) {
+    const auto bar = request.find('|');
+    if (bar == std::string_view::npos) {
+        throw std::invalid_argument("request must be '<query> [argument] | <position>'");
+    }
+    const auto query = words(request.substr(0, bar));
+    if (query.empty()) {
+        throw std::invalid_argument("missing query");
+    }
+    kind = parse_kind(query[0]);
+    if (kind == QueryKind::Invalid) {
+        throw std::invalid_argument("unknown query '" + std::string(query[0]) + "'");
+    }
+    const auto state = snapshot::from_notation(trim(request.substr(bar + 1)));
+
+    std::ostringstream out;
+    out << std::setprecision(6) << "ok";
+    switch (kind) {
+        case QueryKind::Legal:
+            for (const auto& action : rules::legal_actions(state)) {
+                out << ' ' << snapshot::to_notation(action);
+            }
+            break;
+        case QueryKind::Apply: {
+            if (query.size() != 2) {
+                throw std::invalid_argument("apply needs exactly one action");
+            }
+            DieRoll roll;
+            if (snapshot::parse_roll(query[1], roll)) {
+                out << ' ' << snapshot::to_notation(Engine::apply_roll(state, roll));
+                break;
+            }
+            // Random outcomes are seeded from the request text so answers are reproducible
+            const auto request_seed =
+                static_cast<std::uint32_t>(std::hash<std::string_view>{}(request)) ^ options_.seed;
+            Engine engine(request_seed);
+            out << ' ' << snapshot::to_notation(engine.apply_action(state, snapshot::action_from_notation(query[1])));
+            break;
+        }
+        case QueryKind::Leg: {
+            const auto odds = cache_.leg_odds(state);
+            append_probabilities(out, "first", odds.first);
+            append_probabilities(out, "second", odds.second);
+            out << " race_end " << odds.race_end << " coins";
+            for (int player = 0; player < state.player_count; ++player) {
+                out << ' ' << odds.desert_coins[player];
+            }
+            break;
+        }
+        case QueryKind::Race: {
+            int samples = options_.race_samples;
+            if (query.size() == 2) {
+                samples = std::stoi(std::string(query[1]));
+            }
+            if (samples <= 0 || query.size() > 2) {
+                throw std::invalid_argument("race takes an optional positive sample count");
+            }
+            const auto odds = cache_.race_odds(state, samples, options_.seed);
+            append_probabilities(out, "winner", odds.winner);
+            append_probabilities(out, "loser", odds.loser);
+            out << " samples " << odds.samples;
+            break;
+        }
+        case QueryKind::Best: {
+            if (query.size() > 2) {
+                throw std::invalid_argument("best takes an optional time budget in milliseconds");
+            }
+            if (query.size() == 2) {
+                // Deadline variant stops sampling as soon as the best action is settled
+                const int milliseconds = std::stoi(std::string(query[1]));
+                if (milliseconds <= 0) {
+                    throw std::invalid_argument("best takes an optional time budget in milliseconds");
+                }
+                analysis::AnytimeActionSearch search(state, options_.seed);
+                auto budget = analysis::budget_within(std::chrono::milliseconds(milliseconds), options_.race_samples);
+                const auto report = analysis::run_anytime(search, budget);
+                for (const auto& value : search.interim()) {
+                    out << ' ' << snapshot::to_notation(value.action) << '=' << value.expected_value;
+                }
+                out << " samples " << report.samples;
+                break;
+            }
+            const auto leg = cache_.leg_odds(state);
+            const auto race = cache_.race_odds(state, options_.race_samples, options_.seed);
+            for (const auto& value : analysis::rank_actions(state, leg, race)) {
+                out << ' ' << snapshot::to_notation(value.action) << '=' << value.expected_value;
+            }
+            break;
+        }
+        case QueryKind::Invalid:
+            break;
+    }
+    return out.str();
+}
+
+void Server::serve(std::istream& in, std::ostream& out) {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::future<std::string>> pending;
+    bool input_done = false;
+
+    // Writer drains answers strictly in request order, flushing whenever it catches up
+    // An answer keeps its slot until written, push_back leaves the front element in place
+    std::thread writer([&]() {
+        util::trace::set_thread_name("serve writer");
+        while (true) {
+            std::future<std::string>* next = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&]() { return input_done || !pending.empty(); });
+                if (pending.empty()) {
+                    break;
+                }
+                next = &pending.front();
+            }
+            out << next->get() << '\n';
+
+            bool caught_up = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending.pop_front();
+                caught_up = pending.empty() ||
+                            pending.front().wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+            }
+            changed.notify_all();
+            if (caught_up) {
+                CAMELUP_TRACE_SPAN("flush", "io");
+                out.flush();
+            }
+        }
+        out.flush();
+    });
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (trim(line).empty()) {
+            continue;
+        }
+        // Wait for a free slot before submitting, so at most max_in_flight requests are queued or running
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return pending.size() < options_.max_in_flight; });
+        pending.push_back(pool_.submit([this, request = std::move(line)]() { return handle(request); }));
+        lock.unlock();
+        changed.notify_all();
+        line.clear();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        input_done = true;
+    }
+    changed.notify_all();
+    writer.join();
+}
+
+void Server::serve_unix_socket(const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("socket path too long");
+    }
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error("cannot create unix socket");
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 16) != 0) {
+        ::close(fd);
+        throw std::runtime_error("cannot listen on " + path);
+    }
+    listen_fd_.store(fd);
+
+    while (!stopping_.load()) {
+        const int client = ::accept(fd, nullptr, nullptr);
+        if (client < 0) {
+            if (stopping_.load()) {
+                break;
+            }
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                // Retrying at once would spin until a connection closes and frees its descriptor
+                {
+                    std::lock_guard<std::mutex> lock(connections_mutex_);
+                    reap_connections();
+                }
+                std::this_thread::sleep_for(kAcceptBackoff);
+            } else if (errno != EINTR && errno != ECONNABORTED) {
+                ::close(fd);
+                ::unlink(path.c_str());
+                throw std::runtime_error("cannot accept connections on " + path + ": " + std::strerror(errno));
+            }
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        reap_connections();
+        if (stopping_.load()) {
+            // stop() has already shut down the connections it could see
+            ::close(client);
+            break;
+        }
+        auto& connection = connections_.emplace_back();
+        connection.fd = client;
+        connection.thread = std::thread([this, client, &connection]() {
+            {
+                FdStreamBuf buffer(client);
+                std::istream in(&buffer);
+                std::ostream out(&buffer);
+                serve(in, out);
+            }
+            std::lock_guard<std::mutex> done_lock(connections_mutex_);
+            ::close(client);
+            connection.fd = -1;
+            connection.done = true;
+        });
+    }
+
+    ::close(fd);
+    ::unlink(path.c_str());
+}
+
+void Server::stop() {
+    stopping_.store(true);
+    const int fd = listen_fd_.exchange(-1);
+    if (fd >= 0) {
+        // Wakes the blocked accept, the accept loop closes the descriptor
+        ::shutdown(fd, SHUT_RDWR);
+    }
+    // Clients that stay connected would otherwise keep their threads, and ~Server, waiting on reads
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    for (const auto& connection : connections_) {
+        if (connection.fd >= 0) {
+            ::shutdown(connection.fd, SHUT_RDWR);
+        }
+    }
+}
+
+std::size_t Server::connection_threads() {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    return connections_.size();
+}
+
+void Server::reap_connections() {
+    for (auto it = connections_.begin(); it != connections_.end();) {
+        if (it->done) {
+            it->thread.join();
+            it = connections_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+LatencySummary Server::latency(QueryKind kind) const {
+    const auto& histogram = latency_[static_cast<int>(kind)];
+    LatencySummary summary;
+    for (const auto& bucket : histogram.buckets) {
+        summary.count += bucket.load(std::memory_order_relaxed);
+    }
+    summary.max_us = histogram.max_us.load(std::memory_order_relaxed);
+    if (summary.count == 0) {
+        return summary;
+    }
+
+    const std::uint64_t p50_rank = (summary.count * 50 + 99) / 100;
+    const std::uint64_t p99_rank = (summary.count * 99 + 99) / 100;
+    std::uint64_t seen = 0;
+    bool p50_found = false;
+    for (std::size_t us = 0; us < kLatencyBuckets; ++us) {
+        seen += histogram.buckets[us].load(std::memory_order_relaxed);
+        if (!p50_found && seen >= p50_rank) {
+            summary.p50_us = us;
+            p50_found = true;
+        }
+        if (seen >= p99_rank) {
+            summary.p99_us = us == kLatencyBuckets - 1 ? summary.max_us : us;
+            break;
+        }
+    }
+    return summary;
+}
+
+void Server::record_latency(QueryKind kind, std::uint64_t micros) {
+    auto& histogram = latency_[static_cast<int>(kind)];
+    const std::size_t bucket = micros < kLatencyBuckets ? micros : kLatencyBuckets - 1;
+    histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    std::uint64_t seen = histogram.max_us.load(std::memory_order_relaxed);
+    while (micros > seen && !histogram.max_us.compare_exchange_weak(seen, micros, std::memory_order_relaxed)) {
+    }
+}
+
+}  // namespace camelup::serve
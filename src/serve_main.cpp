@@ -0,0 +1,131 @@
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "camelup/serve/server.hpp"
+#include "camelup/util/trace.hpp"
+
+namespace {
+
+bool parse_int_arg(const char* value, int& out) {
+    char* end = nullptr;
+    const long parsed = std::strtol(value, &end, 10);
+    if (end == value || *end != '\0') {
+        return false;
+    }
+    out = static_cast<int>(parsed);
+    return true;
+}
+
+void print_usage() {
+    std::cout << "Usage: camelup_serve [--threads N] [--samples N] [--seed N] [--socket PATH] [--stats]\n"
+              << "                     [--trace PATH]\n";
+}
+
+const char* query_name(camelup::serve::QueryKind kind) {
+    switch (kind) {
+        case camelup::serve::QueryKind::Legal:
+            return "legal";
+        case camelup::serve::QueryKind::Apply:
+            return "apply";
+        case camelup::serve::QueryKind::Leg:
+            return "leg";
+        case camelup::serve::QueryKind::Race:
+            return "race";
+        case camelup::serve::QueryKind::Best:
+            return "best";
+        case camelup::serve::QueryKind::Invalid:
+            return "invalid";
+    }
+    return "unknown";
+}
+
+void print_stats(const camelup::serve::Server& server) {
+    std::cerr << "query    count    p50_us   p99_us   max_us\n";
+    for (int kind = 0; kind < camelup::serve::kQueryKindCount; ++kind) {
+        const auto summary = server.latency(static_cast<camelup::serve::QueryKind>(kind));
+        if (summary.count == 0) {
+            continue;
+        }
+        std::cerr << query_name(static_cast<camelup::serve::QueryKind>(kind)) << '\t' << summary.count << '\t'
+                  << summary.p50_us << '\t' << summary.p99_us << '\t' << summary.max_us << '\n';
+    }
+    const auto cache = server.cache_stats();
+    std::cerr << "odds cache hits=" << cache.hits << " misses=" << cache.misses << '\n';
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    camelup::serve::ServerOptions options;
+    std::string socket_path;
+    std::string trace_path;
+    bool stats = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--stats") {
+            stats = true;
+            continue;
+        }
+        if (arg == "--threads" || arg == "--samples" || arg == "--seed" || arg == "--socket" ||
+            arg == "--trace") {
+            if (i + 1 >= argc) {
+                print_usage();
+                return 1;
+            }
+            if (arg == "--socket") {
+                socket_path = argv[++i];
+                continue;
+            }
+            if (arg == "--trace") {
+                trace_path = argv[++i];
+                continue;
+            }
+
+            int parsed = 0;
+            if (!parse_int_arg(argv[++i], parsed) || parsed < 0) {
+                print_usage();
+                return 1;
+            }
+            if (arg == "--threads") {
+                options.threads = static_cast<std::size_t>(parsed);
+            } else if (arg == "--samples") {
+                options.race_samples = parsed;
+            } else {
+                options.seed = static_cast<std::uint32_t>(parsed);
+            }
+            continue;
+        }
+
+        print_usage();
+        return 1;
+    }
+
+    try {
+        if (!trace_path.empty()) {
+            camelup::util::trace::start();
+            camelup::util::trace::set_thread_name("main");
+        }
+        camelup::serve::Server server(options);
+        if (socket_path.empty()) {
+            std::ios::sync_with_stdio(false);
+            server.serve(std::cin, std::cout);
+        } else {
+            server.serve_unix_socket(socket_path);
+        }
+        if (stats) {
+            print_stats(server);
+        }
+        if (!trace_path.empty()) {
+            camelup::util::trace::stop();
+            camelup::util::trace::write_file(trace_path);
+        }
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "camelup_serve failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,420 @@
+#include "camelup/sim/batch.hpp"
+
+#include <algorithm>  // max, min, sort
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "camelup/engine.hpp"
+#include "camelup/util/trace.hpp"
+
+namespace camelup::sim {
+
+namespace {
+
+constexpr char kCamelSymbols[kCamelCount] = {'B', 'G', 'Y', 'O', 'W'};
+constexpr const char* kActionNames[kActionTypeCount] = {"roll", "desert", "ticket", "winner", "loser"};
+
+// Winner on top of the leading stack, loser at the bottom of the rearmost one
+std::pair<CamelId, CamelId> finish_order(const GameState& state) {
+    CamelId winner = 0;
+    CamelId loser = 0;
+    for (int tile = kBoardTiles - 1; tile >= 0; --tile) {
+        if (!state.board[tile].empty()) {
+            winner = state.board[tile].back();
+            break;
+        }
+    }
+    for (const auto& stack : state.board) {
+        if (!stack.empty()) {
+            loser = stack.front();
+            break;
+        }
+    }
+    return {winner, loser};
+}
+
+RunSummary summarise_block(const BatchOptions& options, int block) {
+    CAMELUP_TRACE_SPAN("summary_block", "sim");
+    RunSummary summary;
+    const int first = block * kSummaryBlockGames;
+    const int last = std::min(options.games, first + kSummaryBlockGames);
+    for (int game = first; game < last; ++game) {
+        summary.record(play_game(options, game), options.policy);
+    }
+    return summary;
+}
+
+// Finished nodes waiting for their sibling, a node and its sibling merge as soon as both exist
+class SummaryTree {
+public:
+    void add(SummaryNode node) {
+        while (true) {
+            const bool left_half = (node.first_block / node.blocks) % 2 == 0;
+            const int sibling_first = left_half ? node.first_block + node.blocks : node.first_block - node.blocks;
+            const auto sibling = nodes_.find(sibling_first);
+            if (sibling == nodes_.end() || sibling->second.blocks != node.blocks) {
+                break;
+            }
+            if (left_half) {
+                node.summary.merge(sibling->second.summary);
+            } else {
+                sibling->second.summary.merge(node.summary);
+                node.first_block = sibling_first;
+                node.summary = std::move(sibling->second.summary);
+            }
+            node.blocks *= 2;
+            nodes_.erase(sibling);
+        }
+        const int first = node.first_block;
+        nodes_.emplace(first, std::move(node));
+    }
+
+    // Copy of the nodes in block order
+    [[nodiscard]] std::vector<SummaryNode> nodes() const {
+        std::vector<SummaryNode> nodes;
+        nodes.reserve(nodes_.size());
+        for (const auto& [first, node] : nodes_) {
+            nodes.push_back(node);
+        }
+        return nodes;
+    }
+
+    // Remaining nodes in block order
+    std::vector<SummaryNode> take() {
+        std::vector<SummaryNode> nodes;
+        nodes.reserve(nodes_.size());
+        for (auto& [first, node] : nodes_) {
+            nodes.push_back(std::move(node));
+        }
+        nodes_.clear();
+        return nodes;
+    }
+
+private:
+    std::map<int, SummaryNode> nodes_;
+};
+
+// Tree nodes cover a power of two of blocks starting at a multiple of their size
+bool aligned_node(const SummaryNode& node) {
+    const bool power_of_two = node.blocks > 0 && (node.blocks & (node.blocks - 1)) == 0;
+    return power_of_two && node.first_block >= 0 && node.first_block % node.blocks == 0;
+}
+
+}  // namespace
+
+GameOutcome play_game(const BatchOptions& options, int game, const TurnObserver& observer, GameRecord* record) {
+    CAMELUP_TRACE_SPAN("game", "sim");
+    const int game_seed = options.seed + game;
+    Engine engine(static_cast<std::uint32_t>(game_seed));
+    GameOutcome outcome{options.start ? *options.start : engine.new_game(options.players)};
+    std::mt19937 chooser_rng(static_cast<std::uint32_t>(game_seed ^ 0x9e3779b9U));
+    if (record != nullptr) {
+        *record = GameRecord{};
+        record->game = static_cast<std::uint32_t>(game);
+        record->seed = game_seed;
+        record->players = static_cast<std::uint8_t>(outcome.final_state.player_count);
+    }
+
+    auto& state = outcome.final_state;
+    std::vector<Action> legal_actions;
+    while (!state.terminal && outcome.turns < options.turn_limit) {
+        engine.legal_actions(state, legal_actions);
+        const auto& action = choose_action(state, legal_actions, options.policy, chooser_rng);
+        if (observer) {
+            observer(state, action, outcome.turns);
+        }
+        ++outcome.actions[static_cast<std::size_t>(action.type())];
+        // Actions come straight from the legal generator, so they apply in place unchecked
+        DieRoll rolled;
+        engine.apply_unchecked(state, action, record != nullptr ? &rolled : nullptr);
+        if (record != nullptr) {
+            record->actions.push_back(action);
+            if (action.type() == ActionType::RollDie) {
+                record->rolls.push_back(rolled);
+            }
+        }
+        ++outcome.turns;
+    }
+    if (record != nullptr) {
+        record->terminal = state.terminal;
+    }
+    return outcome;
+}
+
+void RunSummary::record(const GameOutcome& outcome, Policy policy) {
+    const auto& state = outcome.final_state;
+    ++games;
+    turns.record(outcome.turns);
+    legs.record(state.leg_number);
+    for (int seat = 0; seat < state.player_count; ++seat) {
+        money[seat].update(state.money[seat]);
+    }
+    if (state.terminal) {
+        ++finished;
+        const auto [winner, loser] = finish_order(state);
+        ++winners[winner];
+        ++losers[loser];
+    }
+    auto& counts = actions[static_cast<std::size_t>(policy)];
+    for (int type = 0; type < kActionTypeCount; ++type) {
+        counts[type] += outcome.actions[type];
+    }
+}
+
+void RunSummary::merge(const RunSummary& other) {
+    games += other.games;
+    finished += other.finished;
+    turns.merge(other.turns);
+    legs.merge(other.legs);
+    for (int seat = 0; seat < kMaxPlayers; ++seat) {
+        money[seat].merge(other.money[seat]);
+    }
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        winners[camel] += other.winners[camel];
+        losers[camel] += other.losers[camel];
+    }
+    for (int policy = 0; policy < kPolicyCount; ++policy) {
+        for (int type = 0; type < kActionTypeCount; ++type) {
+            actions[policy][type] += other.actions[policy][type];
+        }
+    }
+}
+
+int summary_blocks(int games) {
+    return (std::max(games, 0) + kSummaryBlockGames - 1) / kSummaryBlockGames;
+}
+
+std::pair<int, int> shard_blocks(int blocks, ShardSpec shard) {
+    if (shard.count < 1 || shard.index < 0 || shard.index >= shard.count) {
+        throw std::invalid_argument("shard index must be in 0..count-1");
+    }
+    const auto bound = [blocks, &shard](int index) {
+        return static_cast<int>(static_cast<std::int64_t>(blocks) * index / shard.count);
+    };
+    return {bound(shard.index), bound(shard.index + 1)};
+}
+
+ShardResult run_shard(const BatchOptions& options, ShardSpec shard, std::size_t threads,
+                      const Checkpointing& checkpointing) {
+    if (options.games < 0) {
+        throw std::invalid_argument("game count must not be negative");
+    }
+    const auto [first, last] = shard_blocks(summary_blocks(options.games), shard);
+    if (threads == 0) {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    threads = std::min<std::size_t>(threads, static_cast<std::size_t>(std::max(last - first, 1)));
+    // A worker may run at most `window` blocks past the oldest unfinished one, so nodes waiting
+    // for a slow sibling stay bounded
+    const int window = static_cast<int>(2 * threads);
+
+    SummaryTree tree;
+    std::mutex mutex;
+    std::condition_variable progressed;
+    std::vector<bool> done(static_cast<std::size_t>(last - first), false);
+    if (const auto* resume = checkpointing.resume) {
+        if (!(resume->options == options) || !(resume->shard == shard)) {
+            throw std::invalid_argument("checkpoint belongs to a run with other options or another shard");
+        }
+        for (const auto& node : resume->nodes) {
+            if (!aligned_node(node) || node.first_block < first || node.first_block + node.blocks > last) {
+                throw std::invalid_argument("checkpoint node outside the shard's blocks");
+            }
+            for (int block = node.first_block; block < node.first_block + node.blocks; ++block) {
+                if (done[static_cast<std::size_t>(block - first)]) {
+                    throw std::invalid_argument("checkpoint nodes overlap");
+                }
+                done[static_cast<std::size_t>(block - first)] = true;
+            }
+            tree.add(node);
+        }
+    }
+    const auto skip_done = [&](int block) {
+        while (block < last && done[static_cast<std::size_t>(block - first)]) {
+            ++block;
+        }
+        return block;
+    };
+    int next_block = skip_done(first);
+    int oldest_unfinished = next_block;
+    std::exception_ptr failure;
+    auto next_checkpoint = std::chrono::steady_clock::now() + checkpointing.interval;
+
+    const auto worker = [&]() {
+        util::trace::set_thread_name("batch worker");
+        while (true) {
+            int block = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                progressed.wait(lock, [&]() { return failure || next_block < oldest_unfinished + window; });
+                if (failure || next_block >= last) {
+                    return;
+                }
+                block = next_block;
+                next_block = skip_done(next_block + 1);
+            }
+            try {
+                SummaryNode node{block, 1, summarise_block(options, block)};
+                std::optional<ShardResult> checkpoint;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    tree.add(std::move(node));
+                    done[static_cast<std::size_t>(block - first)] = true;
+                    oldest_unfinished = skip_done(oldest_unfinished);
+                    const auto now = std::chrono::steady_clock::now();
+                    if (checkpointing.save && now >= next_checkpoint) {
+                        next_checkpoint = now + checkpointing.interval;
+                        checkpoint = ShardResult{options, shard, tree.nodes()};
+                    }
+                }
+                if (checkpoint) {
+                    checkpointing.save(std::move(*checkpoint));
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!failure) {
+                    failure = std::current_exception();
+                }
+            }
+            progressed.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (std::size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    return {options, shard, tree.take()};
+}
+
+RunSummary merge_shards(const std::vector<ShardResult>& shards) {
+    if (shards.empty()) {
+        throw std::invalid_argument("no shards to merge");
+    }
+    const auto& options = shards.front().options;
+    std::vector<const SummaryNode*> nodes;
+    for (const auto& shard : shards) {
+        if (!(shard.options == options)) {
+            throw std::invalid_argument("shards come from runs with different options");
+        }
+        for (const auto& node : shard.nodes) {
+            nodes.push_back(&node);
+        }
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const SummaryNode* lhs, const SummaryNode* rhs) {
+        return lhs->first_block < rhs->first_block;
+    });
+
+    // Nodes must be aligned tree nodes tiling every block exactly once
+    int covered = 0;
+    SummaryTree tree;
+    for (const auto* node : nodes) {
+        if (node->first_block != covered || !aligned_node(*node)) {
+            throw std::invalid_argument("shards overlap or leave blocks uncovered");
+        }
+        covered += node->blocks;
+        tree.add(*node);
+    }
+    if (covered != summary_blocks(options.games)) {
+        throw std::invalid_argument("shards overlap or leave blocks uncovered");
+    }
+
+    RunSummary total;
+    for (const auto& node : tree.take()) {
+        total.merge(node.summary);
+    }
+    return total;
+}
+
+RunSummary run_batch(const BatchOptions& options, std::size_t threads) {
+    return merge_shards({run_shard(options, ShardSpec{}, threads)});
+}
+
+void print_report(std::ostream& out, const RunSummary& summary) {
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::fixed << std::setprecision(1);
+    out << "Games played: " << summary.games << '\n';
+    out << "Games finished: " << summary.finished << '\n';
+    if (summary.games == 0) {
+        out.flags(flags);
+        out.precision(precision);
+        return;
+    }
+
+    out << "Turns per game: mean " << summary.turns.mean() << ", p10 " << summary.turns.quantile(0.1) << ", p50 "
+        << summary.turns.quantile(0.5) << ", p90 " << summary.turns.quantile(0.9) << " (" << summary.turns.bucket_width()
+        << "-turn buckets)\n";
+
+    out << "Legs per game:";
+    const auto& legs = summary.legs.buckets();
+    for (std::size_t leg = 0; leg < legs.size(); ++leg) {
+        if (legs[leg] > 0) {
+            out << ' ' << leg << (leg + 1 == legs.size() ? "+" : "") << '='
+                << 100.0 * static_cast<double>(legs[leg]) / static_cast<double>(summary.games) << '%';
+        }
+    }
+    out << '\n';
+
+    out << "Final money (p10 / p50 / p90):\n";
+    for (int seat = 0; seat < kMaxPlayers; ++seat) {
+        const auto& sketch = summary.money[seat];
+        if (sketch.count() == 0) {
+            continue;
+        }
+        out << "  P" << seat << ": " << sketch.quantile(0.1) << " / " << sketch.quantile(0.5) << " / "
+            << sketch.quantile(0.9) << '\n';
+    }
+
+    if (summary.finished > 0) {
+        const auto frequencies = [&out, &summary](const char* label, const auto& counts) {
+            out << label;
+            for (int camel = 0; camel < kCamelCount; ++camel) {
+                out << ' ' << kCamelSymbols[camel] << '='
+                    << 100.0 * static_cast<double>(counts[camel]) / static_cast<double>(summary.finished) << '%';
+            }
+            out << '\n';
+        };
+        frequencies("Race winner:", summary.winners);
+        frequencies("Race loser:", summary.losers);
+    }
+
+    for (int policy = 0; policy < kPolicyCount; ++policy) {
+        const auto& counts = summary.actions[policy];
+        std::uint64_t total = 0;
+        for (const auto count : counts) {
+            total += count;
+        }
+        if (total == 0) {
+            continue;
+        }
+        out << "Actions (" << policy_name(static_cast<Policy>(policy)) << "):";
+        for (int type = 0; type < kActionTypeCount; ++type) {
+            out << ' ' << kActionNames[type] << '='
+                << 100.0 * static_cast<double>(counts[type]) / static_cast<double>(total) << '%';
+        }
+        out << '\n';
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+}  // namespace camelup::sim
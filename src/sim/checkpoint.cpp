@@ -0,0 +1,79 @@
+#include "camelup/sim/checkpoint.hpp"
+
+#include <utility>
+
+#include "camelup/sim/shard_file.hpp"
+#include "camelup/util/trace.hpp"
+
+namespace camelup::sim {
+
+CheckpointWriter::CheckpointWriter(std::string path) : path_(std::move(path)), thread_([this]() { run(); }) {}
+
+CheckpointWriter::~CheckpointWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+}
+
+void CheckpointWriter::submit(ShardResult checkpoint) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_) {
+            ++stats_.superseded;
+        }
+        pending_ = std::move(checkpoint);
+    }
+    changed_.notify_all();
+}
+
+void CheckpointWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this]() { return !pending_ && !writing_; });
+    if (failure_) {
+        std::rethrow_exception(failure_);
+    }
+}
+
+CheckpointWriter::Stats CheckpointWriter::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void CheckpointWriter::run() {
+    util::trace::set_thread_name("checkpoint writer");
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        changed_.wait(lock, [this]() { return stopping_ || pending_; });
+        if (!pending_) {
+            return;
+        }
+        auto checkpoint = std::move(*pending_);
+        pending_.reset();
+        writing_ = true;
+        lock.unlock();
+
+        std::exception_ptr failure;
+        try {
+            CAMELUP_TRACE_SPAN("checkpoint", "io");
+            save_shard(path_, checkpoint);
+        } catch (...) {
+            failure = std::current_exception();
+        }
+
+        lock.lock();
+        writing_ = false;
+        if (failure) {
+            if (!failure_) {
+                failure_ = failure;
+            }
+        } else {
+            ++stats_.written;
+        }
+        changed_.notify_all();
+    }
+}
+
+}  // namespace camelup::sim
@@ -0,0 +1,421 @@
+#include "camelup/sim/differential.hpp"
+
+#include <algorithm>  // count_if, find, max, min
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "camelup/engine.hpp"
+#include "camelup/persistent_state.hpp"
+#include "camelup/reference_engine.hpp"
+#include "camelup/snapshot/action_notation.hpp"
+
+namespace camelup::sim {
+
+namespace {
+
+// Keeps the chooser independent of the dice the engine draws
+constexpr std::uint32_t kChooserSalt = 0x9E3779B9U;
+
+// Seeds tried for an engine whose next draw is a given roll, each one hits with odds of at
+// least 1 in 15
+constexpr std::uint32_t kForcedRollSeeds = 1U << 16;
+
+// An engine whose next draw from `state` is `roll`, so a replayed roll runs through the same
+// roll handling of its apply path as the original did, only with the recorded outcome
+Engine engine_drawing(const GameState& state, DieRoll roll) {
+    for (std::uint32_t seed = 0; seed < kForcedRollSeeds; ++seed) {
+        Engine probe(seed);
+        if (probe.draw_roll(state) == roll) {
+            return Engine(seed);
+        }
+    }
+    throw std::runtime_error("no engine seed draws " + snapshot::to_notation(roll));
+}
+
+using ApplyHook = std::function<void(GameState&, const Action&, ApplyPath)>;
+
+// Apply `action` through `path` and then `after_apply`, returning the outcome of a roll
+DieRoll apply_optimised(Engine& engine, GameState& state, const Action& action, ApplyPath path,
+                        const ApplyHook& after_apply) {
+    DieRoll rolled;
+    switch (path) {
+        case ApplyPath::Unchecked:
+            engine.apply_unchecked(state, action, &rolled);
+            break;
+        case ApplyPath::TryApply:
+            if (const auto error = engine.try_apply(state, action, &rolled); error != ApplyError::None) {
+                throw std::runtime_error(apply_error_message(error));
+            }
+            break;
+        case ApplyPath::ApplyAction:
+            state = engine.apply_action(state, action, &rolled);
+            break;
+        case ApplyPath::KnownRoll:
+            if (action.type() != ActionType::RollDie) {
+                engine.apply_unchecked(state, action);
+                break;
+            }
+            rolled = engine.draw_roll(state);
+            Engine::apply_roll_in_place(state, rolled);
+            break;
+        case ApplyPath::Persistent:
+            state = PersistentState(state).apply(engine, action, &rolled).materialise();
+            break;
+    }
+    if (after_apply) {
+        after_apply(state, action, path);
+    }
+    return rolled;
+}
+
+std::string actions_text(const std::vector<Action>& actions) {
+    std::string text;
+    for (const auto& action : actions) {
+        text += (text.empty() ? "" : " ") + snapshot::to_notation(action);
+    }
+    return text;
+}
+
+std::string difference_in(const char* field, std::size_t index) {
+    return std::string(field) + "[" + std::to_string(index) + "]";
+}
+
+template <typename Array>
+std::string first_difference_in(const char* field, const Array& expected, const Array& actual) {
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        if (expected[i] != actual[i]) {
+            return difference_in(field, i);
+        }
+    }
+    return {};
+}
+
+// One game through both engines, recording every action taken
+class Lockstep {
+public:
+    Lockstep(const DifferentialOptions& options, std::int32_t seed, int players, std::uint32_t game)
+        : engine_(static_cast<std::uint32_t>(seed)),
+          optimised_(engine_.new_game(players)),
+          expected_(optimised_),
+          after_apply_(options.after_apply) {
+        record_.game = game;
+        record_.seed = seed;
+        record_.players = static_cast<std::uint8_t>(players);
+    }
+
+    [[nodiscard]] bool terminal() const noexcept { return optimised_.terminal; }
+    [[nodiscard]] const std::vector<Action>& legal() const noexcept { return legal_; }
+    [[nodiscard]] std::uint64_t actions() const noexcept { return record_.actions.size(); }
+    [[nodiscard]] bool die_available(CamelId camel) const noexcept {
+        return camel < kCamelCount && optimised_.die_available[camel];
+    }
+
+    // Both legal action lists, false once they differ
+    bool compare_legal() {
+        engine_.legal_actions(optimised_, legal_);
+        const auto reference_legal = reference::legal_actions(expected_);
+        if (legal_ == reference_legal) {
+            return true;
+        }
+        diverge(optimised_, "legal actions: reference " + actions_text(reference_legal) + ", optimised " +
+                                actions_text(legal_));
+        return false;
+    }
+
+    // Apply a legal action to both through `path`, false once the states differ
+    // A roll with a `known` outcome draws it from an engine forced to roll it.
+    bool step(const Action& action, ApplyPath path, const DieRoll* known) {
+        const GameState before = optimised_;
+        record_.actions.push_back(action);
+        paths_.push_back(path);
+        DieRoll rolled;
+        try {
+            if (known != nullptr && action.type() == ActionType::RollDie) {
+                Engine forced = engine_drawing(optimised_, *known);
+                rolled = apply_optimised(forced, optimised_, action, path, after_apply_);
+            } else {
+                rolled = apply_optimised(engine_, optimised_, action, path, after_apply_);
+            }
+        } catch (const std::exception& ex) {
+            diverge(before, std::string("optimised engine threw: ") + ex.what());
+            return false;
+        }
+        if (action.type() == ActionType::RollDie) {
+            record_.rolls.push_back(rolled);
+        }
+        expected_ = reference::apply(expected_, action, rolled);
+        if (auto what = first_difference(expected_, optimised_); !what.empty()) {
+            diverge(before, std::move(what));
+            return false;
+        }
+        return true;
+    }
+
+    std::optional<Divergence> divergence;
+
+private:
+    Engine engine_;
+    GameState optimised_;
+    GameState expected_;
+    GameRecord record_;
+    std::vector<ApplyPath> paths_;
+    std::vector<Action> legal_;
+    const ApplyHook& after_apply_;
+
+    void diverge(const GameState& before, std::string what) {
+        record_.terminal = before.terminal;
+        divergence = Divergence{record_, paths_, before, std::move(what)};
+    }
+};
+
+struct GameCheck {
+    std::uint64_t actions{0};
+    std::optional<Divergence> divergence;
+};
+
+GameCheck run_game(const DifferentialOptions& options, std::uint32_t game) {
+    const std::int32_t seed = options.seed + static_cast<std::int32_t>(game);
+    const int players = options.players != 0 ? options.players : 2 + static_cast<int>(game % (kMaxPlayers - 1));
+    std::mt19937 chooser(static_cast<std::uint32_t>(seed) ^ kChooserSalt);
+    Lockstep lockstep(options, seed, players, game);
+
+    const auto limit = static_cast<std::uint64_t>(std::max(options.turn_limit, 0));
+    while (!lockstep.terminal() && (limit == 0 || lockstep.actions() < limit)) {
+        if (!lockstep.compare_legal()) {
+            break;
+        }
+        const auto& legal = lockstep.legal();
+        const auto& action = legal[std::uniform_int_distribution<std::size_t>(0, legal.size() - 1)(chooser)];
+        if (!lockstep.step(action, static_cast<ApplyPath>(lockstep.actions() % kApplyPathCount), nullptr)) {
+            break;
+        }
+    }
+    return {lockstep.actions(), std::move(lockstep.divergence)};
+}
+
+// The record without actions first .. first + count - 1, their apply paths and their roll outcomes
+Divergence without(const Divergence& divergence, std::size_t first, std::size_t count) {
+    Divergence candidate = divergence;
+    auto& actions = candidate.record.actions;
+    auto& rolls = candidate.record.rolls;
+    const auto begin = actions.begin() + static_cast<std::ptrdiff_t>(first);
+    const auto end = begin + static_cast<std::ptrdiff_t>(count);
+    const auto is_roll = [](const Action& action) { return action.type() == ActionType::RollDie; };
+    const auto roll_begin = std::min<std::ptrdiff_t>(std::count_if(actions.begin(), begin, is_roll),
+                                                     static_cast<std::ptrdiff_t>(rolls.size()));
+    const auto roll_end = std::min<std::ptrdiff_t>(roll_begin + std::count_if(begin, end, is_roll),
+                                                   static_cast<std::ptrdiff_t>(rolls.size()));
+    rolls.erase(rolls.begin() + roll_begin, rolls.begin() + roll_end);
+    actions.erase(begin, end);
+    const auto path_begin = candidate.paths.begin() + static_cast<std::ptrdiff_t>(first);
+    candidate.paths.erase(path_begin, path_begin + static_cast<std::ptrdiff_t>(count));
+    return candidate;
+}
+
+// Remove runs of actions, halving the run length down to single actions, keeping every
+// removal after which the record still diverges. Runs keep whole rounds of turns together,
+// which single removals cannot since they hand every later action to another player.
+// Removed actions take their apply paths with them, so every kept action replays on its own.
+Divergence shrink(const DifferentialOptions& options, Divergence divergence) {
+    for (std::size_t run = std::max<std::size_t>(divergence.record.actions.size() / 2, 1); run > 0; run /= 2) {
+        for (std::size_t end = divergence.record.actions.size(); end >= run;) {
+            const auto candidate = without(divergence, end - run, run);
+            if (auto smaller = replay_divergence(options, candidate.record, candidate.paths)) {
+                divergence = std::move(*smaller);
+                end = std::min(end - run, divergence.record.actions.size());
+            } else {
+                --end;
+            }
+        }
+    }
+    return divergence;
+}
+
+}  // namespace
+
+const char* apply_path_name(ApplyPath path) noexcept {
+    switch (path) {
+        case ApplyPath::Unchecked:
+            return "apply_unchecked";
+        case ApplyPath::TryApply:
+            return "try_apply";
+        case ApplyPath::ApplyAction:
+            return "apply_action";
+        case ApplyPath::KnownRoll:
+            return "apply_roll_in_place";
+        case ApplyPath::Persistent:
+            return "persistent_state";
+    }
+    return "unknown";
+}
+
+std::optional<Divergence> replay_divergence(const DifferentialOptions& options, const GameRecord& record,
+                                            const std::vector<ApplyPath>& paths) {
+    if (paths.size() != record.actions.size()) {
+        throw std::invalid_argument("replay needs one apply path per recorded action");
+    }
+    Lockstep lockstep(options, record.seed, record.players, record.game);
+    std::size_t roll = 0;
+    for (std::size_t i = 0; i <= record.actions.size(); ++i) {
+        if (lockstep.terminal() || !lockstep.compare_legal()) {
+            return std::move(lockstep.divergence);
+        }
+        if (i == record.actions.size()) {
+            return std::nullopt;
+        }
+        const auto& action = record.actions[i];
+        const auto& legal = lockstep.legal();
+        if (std::find(legal.begin(), legal.end(), action) == legal.end()) {
+            return std::nullopt;
+        }
+        const DieRoll* known = nullptr;
+        if (action.type() == ActionType::RollDie) {
+            if (roll == record.rolls.size() || !lockstep.die_available(record.rolls[roll].camel)) {
+                return std::nullopt;
+            }
+            known = &record.rolls[roll++];
+        }
+        if (!lockstep.step(action, paths[i], known)) {
+            return std::move(lockstep.divergence);
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<Divergence> check_game(const DifferentialOptions& options, std::uint32_t game) {
+    auto divergence = run_game(options, game).divergence;
+    if (divergence && options.shrink) {
+        divergence = shrink(options, std::move(*divergence));
+    }
+    return divergence;
+}
+
+DifferentialReport check_games(const DifferentialOptions& options, std::uint32_t first_game, std::size_t count,
+                               std::size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, std::max<std::size_t>(count, 1));
+
+    DifferentialReport report;
+    std::atomic<std::size_t> next{0};
+    // Games past the lowest divergence found so far are not started
+    std::atomic<std::size_t> stop{count};
+    std::mutex mutex;
+    std::exception_ptr failure;
+    const auto worker = [&] {
+        try {
+            for (std::size_t index = next++; index < stop.load(); index = next++) {
+                auto check = run_game(options, first_game + static_cast<std::uint32_t>(index));
+                if (check.divergence && options.shrink) {
+                    check.divergence = shrink(options, std::move(*check.divergence));
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                ++report.games;
+                report.actions += check.actions;
+                if (check.divergence &&
+                    (!report.divergence || check.divergence->record.game < report.divergence->record.game)) {
+                    report.divergence = std::move(check.divergence);
+                    stop = std::min(stop.load(), index);
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!failure) {
+                failure = std::current_exception();
+            }
+            stop = 0;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (std::size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    return report;
+}
+
+std::string first_difference(const GameState& expected, const GameState& actual) {
+    if (auto what = first_difference_in("board", expected.board, actual.board); !what.empty()) {
+        return what;
+    }
+    if (auto what = first_difference_in("money", expected.money, actual.money); !what.empty()) {
+        return what;
+    }
+    if (auto what = first_difference_in("die_available", expected.die_available, actual.die_available);
+        !what.empty()) {
+        return what;
+    }
+    if (auto what = first_difference_in("desert_tiles", expected.desert_tiles, actual.desert_tiles); !what.empty()) {
+        return what;
+    }
+    if (auto what = first_difference_in("desert_tile_owner", expected.desert_tile_owner, actual.desert_tile_owner);
+        !what.empty()) {
+        return what;
+    }
+    if (auto what = first_difference_in("desert_legal_tiles", expected.desert_legal_tiles, actual.desert_legal_tiles);
+        !what.empty()) {
+        return what;
+    }
+    if (auto what =
+            first_difference_in("leg_tickets_remaining", expected.leg_tickets_remaining, actual.leg_tickets_remaining);
+        !what.empty()) {
+        return what;
+    }
+    if (auto what = first_difference_in("leg_ticket_values", expected.leg_ticket_values, actual.leg_ticket_values);
+        !what.empty()) {
+        return what;
+    }
+    if (auto what =
+            first_difference_in("player_leg_tickets", expected.player_leg_tickets, actual.player_leg_tickets);
+        !what.empty()) {
+        return what;
+    }
+    if (expected.winner_bet_stack != actual.winner_bet_stack) {
+        return "winner_bet_stack";
+    }
+    if (expected.loser_bet_stack != actual.loser_bet_stack) {
+        return "loser_bet_stack";
+    }
+    if (auto what = first_difference_in("winner_bet_card_available", expected.winner_bet_card_available,
+                                        actual.winner_bet_card_available);
+        !what.empty()) {
+        return what;
+    }
+    if (auto what = first_difference_in("loser_bet_card_available", expected.loser_bet_card_available,
+                                        actual.loser_bet_card_available);
+        !what.empty()) {
+        return what;
+    }
+    if (expected.current_player != actual.current_player) {
+        return "current_player";
+    }
+    if (expected.player_count != actual.player_count) {
+        return "player_count";
+    }
+    if (expected.leg_number != actual.leg_number) {
+        return "leg_number";
+    }
+    if (expected.terminal != actual.terminal) {
+        return "terminal";
+    }
+    return {};
+}
+
+}  // namespace camelup::sim
@@ -0,0 +1,143 @@
+#include "camelup/sim/game_history.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#include "camelup/sim/game_record.hpp"
+
+namespace camelup::sim {
+
+namespace {
+
+std::size_t block_bytes(const PersistentState::Tickets& tickets) {
+    return sizeof(tickets) + tickets.held.capacity() * sizeof(PersistentState::HeldTicket);
+}
+
+std::size_t block_bytes(const PersistentState::Bets& bets) {
+    return sizeof(bets) + (bets.winner_stack.capacity() + bets.loser_stack.capacity()) * sizeof(FinalBetCard);
+}
+
+}  // namespace
+
+GameHistory::GameHistory(const GameState& start, std::size_t capacity, std::size_t snapshot_interval)
+    : capacity_(capacity), snapshot_interval_(snapshot_interval), state_(start), replayer_(0) {
+    if (snapshot_interval == 0 || capacity == 0 || capacity % snapshot_interval != 0) {
+        throw std::invalid_argument("history capacity must be a non-zero multiple of the snapshot interval");
+    }
+    ring_.resize(capacity);
+    snapshots_.emplace_back(start);
+}
+
+void GameHistory::apply(Engine& engine, const Action& action) {
+    if (state_.terminal) {
+        throw std::invalid_argument("the game is already finished");
+    }
+    GameState next = state_;
+    DieRoll rolled;
+    if (const auto error = engine.try_apply(next, action, &rolled); error != ApplyError::None) {
+        throw std::invalid_argument(apply_error_message(error));
+    }
+
+    // A new action after undo replaces the redo line
+    count_ = turn_ - first_turn_;
+    snapshots_.erase(snapshots_.begin() + static_cast<std::ptrdiff_t>(count_ / snapshot_interval_ + 1),
+                     snapshots_.end());
+    if (count_ == capacity_) {
+        head_ = (head_ + snapshot_interval_) % capacity_;
+        count_ -= snapshot_interval_;
+        first_turn_ += snapshot_interval_;
+        snapshots_.pop_front();
+    }
+
+    const bool roll = action.type() == ActionType::RollDie;
+    ring_[(head_ + count_) % capacity_] = Step{pack_action(action), roll ? pack_roll(rolled) : std::uint8_t{0}};
+    ++count_;
+    ++turn_;
+    state_ = std::move(next);
+    if (count_ % snapshot_interval_ == 0) {
+        // Neighbouring snapshots share the ticket and bet blocks neither turn changed
+        snapshots_.push_back(snapshots_.back().derive(state_));
+    }
+}
+
+std::optional<Action> GameHistory::action_at(std::size_t turn) const {
+    if (turn < first_turn_ || turn >= last_turn()) {
+        return std::nullopt;
+    }
+    return unpack_action(step_at(turn).action);
+}
+
+std::optional<DieRoll> GameHistory::roll_at(std::size_t turn) const {
+    const auto action = action_at(turn);
+    if (!action || action->type() != ActionType::RollDie) {
+        return std::nullopt;
+    }
+    return unpack_roll(step_at(turn).roll);
+}
+
+bool GameHistory::undo() {
+    if (!can_undo()) {
+        return false;
+    }
+    seek(turn_ - 1);
+    return true;
+}
+
+bool GameHistory::redo() {
+    if (!can_redo()) {
+        return false;
+    }
+    seek(turn_ + 1);
+    return true;
+}
+
+void GameHistory::seek(std::size_t turn) {
+    if (turn < first_turn_ || turn > last_turn()) {
+        throw std::invalid_argument("turn is not kept in the history");
+    }
+    const std::size_t snapshot = (turn - first_turn_) / snapshot_interval_;
+    std::size_t from = first_turn_ + snapshot * snapshot_interval_;
+    // Moving forward within the same stretch continues from the current state
+    if (turn_ >= from && turn_ <= turn) {
+        from = turn_;
+    } else {
+        state_ = snapshots_[snapshot].materialise();
+    }
+    for (std::size_t t = from; t < turn; ++t) {
+        replay_step(step_at(t));
+    }
+    turn_ = turn;
+}
+
+std::size_t GameHistory::memory_bytes() const {
+    std::size_t bytes = ring_.capacity() * sizeof(Step) + snapshots_.size() * sizeof(PersistentState);
+    const PersistentState::Tickets* tickets = nullptr;
+    const PersistentState::Bets* bets = nullptr;
+    for (const auto& snapshot : snapshots_) {
+        // Only neighbours share blocks, so counting changes along the deque counts each once
+        if (&snapshot.tickets() != tickets) {
+            tickets = &snapshot.tickets();
+            bytes += block_bytes(*tickets);
+        }
+        if (&snapshot.bets() != bets) {
+            bets = &snapshot.bets();
+            bytes += block_bytes(*bets);
+        }
+    }
+    return bytes;
+}
+
+const GameHistory::Step& GameHistory::step_at(std::size_t turn) const {
+    return ring_[(head_ + turn - first_turn_) % capacity_];
+}
+
+void GameHistory::replay_step(const Step& step) {
+    const auto action = unpack_action(step.action);
+    if (action.type() == ActionType::RollDie) {
+        Engine::apply_roll_in_place(state_, unpack_roll(step.roll));
+    } else {
+        replayer_.apply_unchecked(state_, action);
+    }
+}
+
+}  // namespace camelup::sim
@@ -0,0 +1,183 @@
+#include "camelup/sim/game_record.hpp"
+
+#include <algorithm>  // equal
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <variant>
+
+#include "camelup/engine.hpp"
+#include "camelup/sim/record_codec.hpp"
+#include "camelup/util/binary_io.hpp"
+
+namespace camelup::sim {
+
+std::uint8_t pack_action(const Action& action) {
+    int argument = 0;
+    switch (action.type()) {
+        case ActionType::RollDie:
+            break;
+        case ActionType::PlaceDesertTile: {
+            const auto payload = std::get<PlaceDesertTilePayload>(action.payload);
+            argument = payload.tile * 2 + (payload.move_delta < 0 ? 1 : 0);
+            break;
+        }
+        case ActionType::TakeLegTicket:
+            argument = std::get<TakeLegTicketPayload>(action.payload).camel;
+            break;
+        case ActionType::BetWinner:
+            argument = std::get<BetWinnerPayload>(action.payload).camel;
+            break;
+        case ActionType::BetLoser:
+            argument = std::get<BetLoserPayload>(action.payload).camel;
+            break;
+    }
+    return static_cast<std::uint8_t>(static_cast<int>(action.type()) | argument << 3);
+}
+
+Action unpack_action(std::uint8_t packed) {
+    const int argument = packed >> 3;
+    const auto camel = static_cast<CamelId>(argument);
+    switch (packed & 7U) {
+        case static_cast<int>(ActionType::RollDie):
+            return Action::roll_die();
+        case static_cast<int>(ActionType::PlaceDesertTile):
+            return Action::place_desert_tile(argument / 2, argument % 2 == 0 ? 1 : -1);
+        case static_cast<int>(ActionType::TakeLegTicket):
+            return Action::take_leg_ticket(camel);
+        case static_cast<int>(ActionType::BetWinner):
+            return Action::bet_winner(camel);
+        case static_cast<int>(ActionType::BetLoser):
+            return Action::bet_loser(camel);
+        default:
+            throw std::runtime_error("corrupt game record action");
+    }
+}
+
+std::uint8_t pack_roll(DieRoll roll) {
+    return static_cast<std::uint8_t>(roll.camel * 3 + roll.distance - 1);
+}
+
+DieRoll unpack_roll(std::uint8_t packed) {
+    if (packed >= kCamelCount * 3) {
+        throw std::runtime_error("corrupt game record roll");
+    }
+    return DieRoll{static_cast<CamelId>(packed / 3), packed % 3 + 1};
+}
+
+namespace {
+
+void put_le(std::vector<std::uint8_t>& out, std::uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+    }
+}
+
+std::uint32_t get_le(const std::uint8_t*& cursor, const std::uint8_t* end, int bytes) {
+    if (end - cursor < bytes) {
+        throw std::runtime_error("truncated game record");
+    }
+    std::uint32_t value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        value |= static_cast<std::uint32_t>(cursor[i]) << (8 * i);
+    }
+    cursor += bytes;
+    return value;
+}
+
+}  // namespace
+
+GameState replay(const GameRecord& record, const std::optional<GameState>& start) {
+    Engine engine(static_cast<std::uint32_t>(record.seed));
+    GameState state = start ? *start : engine.new_game(record.players);
+    std::size_t roll = 0;
+    for (const auto& action : record.actions) {
+        if (action.type() != ActionType::RollDie) {
+            if (const auto error = engine.try_apply(state, action); error != ApplyError::None) {
+                throw std::runtime_error(std::string("game record does not replay: ") + apply_error_message(error));
+            }
+            continue;
+        }
+        if (roll == record.rolls.size()) {
+            throw std::runtime_error("game record has fewer rolls than roll actions");
+        }
+        state = Engine::apply_roll(state, record.rolls[roll++]);
+    }
+    return state;
+}
+
+void append_record(std::vector<std::uint8_t>& out, const GameRecord& record) {
+    if (record.actions.size() > 0xFFFF || record.rolls.size() > record.actions.size()) {
+        throw std::invalid_argument("game record too long for the shard format");
+    }
+    put_le(out, record.game, 4);
+    put_le(out, static_cast<std::uint32_t>(record.seed), 4);
+    out.push_back(record.players);
+    out.push_back(record.terminal ? 1 : 0);
+    put_le(out, static_cast<std::uint32_t>(record.actions.size()), 2);
+    put_le(out, static_cast<std::uint32_t>(record.rolls.size()), 2);
+    for (const auto& action : record.actions) {
+        out.push_back(pack_action(action));
+    }
+    for (const auto& roll : record.rolls) {
+        out.push_back(pack_roll(roll));
+    }
+}
+
+GameRecord read_record(const std::uint8_t*& cursor, const std::uint8_t* end) {
+    GameRecord record;
+    record.game = get_le(cursor, end, 4);
+    record.seed = static_cast<std::int32_t>(get_le(cursor, end, 4));
+    record.players = static_cast<std::uint8_t>(get_le(cursor, end, 1));
+    record.terminal = get_le(cursor, end, 1) != 0;
+    const auto actions = get_le(cursor, end, 2);
+    const auto rolls = get_le(cursor, end, 2);
+    if (end - cursor < static_cast<std::ptrdiff_t>(actions + rolls)) {
+        throw std::runtime_error("truncated game record");
+    }
+    record.actions.reserve(actions);
+    for (std::uint32_t i = 0; i < actions; ++i) {
+        record.actions.push_back(unpack_action(*cursor++));
+    }
+    record.rolls.reserve(rolls);
+    for (std::uint32_t i = 0; i < rolls; ++i) {
+        record.rolls.push_back(unpack_roll(*cursor++));
+    }
+    return record;
+}
+
+std::vector<GameRecord> load_record_shard(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("failed to open record shard: " + path);
+    }
+    char magic[sizeof(kRecordShardMagic)];
+    if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kRecordShardMagic)) {
+        throw std::runtime_error("not a camelup record shard: " + path);
+    }
+    if (util::read_u64(in) != kRecordShardVersion) {
+        throw std::runtime_error("unsupported record shard version: " + path);
+    }
+
+    std::vector<GameRecord> records;
+    std::vector<GameRecord> batch;
+    std::vector<std::uint8_t> payload;
+    while (in.peek() != std::char_traits<char>::eof()) {
+        const auto count = util::read_u64(in);
+        const auto bytes = util::read_u64(in);
+        if (bytes > (std::uint64_t{1} << 32)) {
+            throw std::runtime_error("corrupt record shard batch: " + path);
+        }
+        payload.resize(static_cast<std::size_t>(bytes));
+        if (!in.read(reinterpret_cast<char*>(payload.data()), static_cast<std::streamsize>(payload.size()))) {
+            throw std::runtime_error("truncated record shard: " + path);
+        }
+        if (decode_records(payload.data(), payload.size(), batch) != payload.size() || batch.size() != count) {
+            throw std::runtime_error("corrupt record shard batch: " + path);
+        }
+        records.insert(records.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+    }
+    return records;
+}
+
+}  // namespace camelup::sim
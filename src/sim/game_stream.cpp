@@ -0,0 +1,81 @@
+#include "camelup/sim/game_stream.hpp"
+
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "camelup/engine.hpp"
+#include "camelup/sim/policy.hpp"
+
+namespace camelup::sim {
+
+namespace {
+
+util::Generator<GameStep> interleave(BatchOptions options, int width) {
+    std::vector<util::Generator<GameStep>> lanes;
+    lanes.reserve(static_cast<std::size_t>(width));
+    int next_game = 0;
+    while (next_game < options.games && static_cast<int>(lanes.size()) < width) {
+        lanes.push_back(game_steps(options, next_game++));
+    }
+    while (!lanes.empty()) {
+        for (std::size_t lane = 0; lane < lanes.size();) {
+            if (const GameStep* step = lanes[lane].next()) {
+                co_yield *step;
+                ++lane;
+            } else if (next_game < options.games) {
+                lanes[lane] = game_steps(options, next_game++);
+            } else {
+                lanes.erase(lanes.begin() + static_cast<std::ptrdiff_t>(lane));
+            }
+        }
+    }
+}
+
+}  // namespace
+
+util::Generator<GameStep> game_steps(BatchOptions options, int game) {
+    // Seeded exactly like play_game
+    const int game_seed = options.seed + game;
+    Engine engine(static_cast<std::uint32_t>(game_seed));
+    GameState state = options.start ? *options.start : engine.new_game(options.players);
+    std::mt19937 chooser_rng(static_cast<std::uint32_t>(game_seed ^ 0x9e3779b9U));
+
+    std::vector<Action> legal;
+    GameStep step;
+    step.game = game;
+    step.state = &state;
+    for (; !state.terminal && step.turn < options.turn_limit; ++step.turn) {
+        engine.legal_actions(state, legal);
+        const Action& action = choose_action(state, legal, options.policy, chooser_rng);
+        const bool roll = action.type() == ActionType::RollDie;
+        // Drawn as apply_unchecked would draw it, the engine RNG only serves rolls
+        // A start with every die spent closes its leg first, as the roll itself would
+        if (roll) {
+            Engine::settle_spent_leg(state);
+        }
+        step.roll = roll ? engine.draw_roll(state) : DieRoll{};
+        step.action = &action;
+        co_yield step;
+        if (roll) {
+            Engine::apply_roll_in_place(state, step.roll);
+        } else {
+            engine.apply_unchecked(state, action);
+        }
+    }
+    step.action = nullptr;
+    step.roll = DieRoll{};
+    co_yield step;
+}
+
+util::Generator<GameStep> interleaved_steps(BatchOptions options, int width) {
+    // Checked here rather than in the coroutine, which would only throw on the first step
+    if (width <= 0) {
+        throw std::invalid_argument("interleaved game streams need a positive width");
+    }
+    return interleave(std::move(options), width);
+}
+
+}  // namespace camelup::sim
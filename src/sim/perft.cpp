@@ -0,0 +1,261 @@
+#include "camelup/sim/perft.hpp"
+
+#include <algorithm>  // max, min, none_of
+#include <array>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "camelup/engine.hpp"
+#include "camelup/sim/policy_memo.hpp"
+#include "camelup/util/trace.hpp"
+
+namespace camelup::sim {
+
+namespace {
+
+// Plies expanded on the calling thread before the subtrees below are handed out
+constexpr int kSplitPlies = 2;
+
+// (state, depth) pairs already counted, sharded so threads rarely share a lock
+class SeenStates {
+public:
+    // True the first time the state is seen at this depth
+    bool insert(const GameState& state, int ply) {
+        const auto key = policy_memo::state_hash(state) + static_cast<std::uint64_t>(ply) * 0x9E3779B97F4A7C15ULL;
+        auto& shard = shards_[key % kShards];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.keys.insert(key).second;
+    }
+
+private:
+    static constexpr std::size_t kShards = 64;
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_set<std::uint64_t> keys;
+    };
+
+    std::array<Shard, kShards> shards_;
+};
+
+struct Subtree {
+    GameState state;
+    int ply{0};
+};
+
+// Depth-first expansion with one scratch state and legal buffer per ply, so after the first
+// few nodes copying a state reuses the vectors' capacity instead of allocating
+class Expander {
+public:
+    Expander(int depth, SeenStates* seen)
+        : depth_(depth), seen_(seen), scratch_(depth + 1), settled_(depth + 1), legal_(depth + 1) {}
+
+    PerftCounts counts;
+
+    // Expand `state` at `ply`, handing each child at `split_ply` to `defer` instead
+    template <typename Defer>
+    void expand(const GameState& state, int ply, int split_ply, Defer&& defer) {
+        auto& legal = legal_[ply];
+        engine_.legal_actions(state, legal);
+        auto& child = scratch_[ply + 1];
+        for (const auto& action : legal) {
+            if (action.type() != ActionType::RollDie) {
+                child = state;
+                engine_.apply_unchecked(child, action);
+                visit(child, ply + 1, action.type(), split_ply, defer);
+                continue;
+            }
+            // A position with every die spent closes its leg before rolling, as the engine does
+            const GameState* roller = &state;
+            if (std::none_of(state.die_available.begin(), state.die_available.end(), [](bool die) { return die; })) {
+                auto& settled = settled_[ply];
+                settled = state;
+                Engine::settle_spent_leg(settled);
+                roller = &settled;
+            }
+            for (CamelId camel = 0; camel < static_cast<CamelId>(kCamelCount); ++camel) {
+                for (int distance = 1; distance <= 3 && roller->die_available[camel]; ++distance) {
+                    child = *roller;
+                    Engine::apply_roll_in_place(child, DieRoll{camel, distance});
+                    visit(child, ply + 1, ActionType::RollDie, split_ply, defer);
+                }
+            }
+        }
+    }
+
+    void expand(const GameState& state, int ply) {
+        expand(state, ply, -1, [](const GameState&, int) {});
+    }
+
+private:
+    int depth_;
+    SeenStates* seen_;
+    Engine engine_;
+    std::vector<GameState> scratch_;
+    std::vector<GameState> settled_;  // spent-leg states closed before their rolls
+    std::vector<std::vector<Action>> legal_;
+
+    template <typename Defer>
+    void visit(const GameState& child, int ply, ActionType type, int split_ply, Defer& defer) {
+        if (ply == depth_) {
+            ++counts.moves[static_cast<std::size_t>(type)];
+        }
+        if (seen_ != nullptr && !seen_->insert(child, ply)) {
+            return;
+        }
+        if (child.terminal) {
+            ++counts.terminal;
+        }
+        if (ply == depth_) {
+            ++counts.nodes;
+        } else if (!child.terminal) {
+            if (ply == split_ply) {
+                defer(child, ply);
+            } else {
+                expand(child, ply, split_ply, defer);
+            }
+        }
+    }
+};
+
+void add(PerftCounts& total, const PerftCounts& part) {
+    total.nodes += part.nodes;
+    total.terminal += part.terminal;
+    for (std::size_t type = 0; type < total.moves.size(); ++type) {
+        total.moves[type] += part.moves[type];
+    }
+}
+
+// One deque per thread: the owner takes its newest subtree, thieves take the oldest
+class StealingQueues {
+public:
+    explicit StealingQueues(std::size_t threads) : queues_(threads) {}
+
+    void push(std::size_t owner, Subtree subtree) {
+        auto& queue = queues_[owner];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.subtrees.push_back(std::move(subtree));
+    }
+
+    // Nothing is pushed once workers start, so all queues empty means the work is done
+    std::optional<Subtree> take(std::size_t owner) {
+        {
+            auto& queue = queues_[owner];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.subtrees.empty()) {
+                Subtree subtree = std::move(queue.subtrees.back());
+                queue.subtrees.pop_back();
+                return subtree;
+            }
+        }
+        for (std::size_t offset = 1; offset < queues_.size(); ++offset) {
+            auto& queue = queues_[(owner + offset) % queues_.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.subtrees.empty()) {
+                Subtree subtree = std::move(queue.subtrees.front());
+                queue.subtrees.pop_front();
+                return subtree;
+            }
+        }
+        return std::nullopt;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Subtree> subtrees;
+    };
+
+    std::vector<Queue> queues_;
+};
+
+}  // namespace
+
+PerftCounts perft(const GameState& root, const PerftOptions& options) {
+    if (options.depth < 0) {
+        throw std::invalid_argument("perft depth must not be negative");
+    }
+    PerftCounts total;
+    if (options.depth == 0) {
+        total.nodes = 1;
+        total.terminal = root.terminal ? 1 : 0;
+        return total;
+    }
+    if (root.terminal) {
+        total.terminal = 1;
+        return total;
+    }
+
+    std::size_t threads = options.threads;
+    if (threads == 0) {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    std::optional<SeenStates> seen;
+    if (options.dedupe) {
+        seen.emplace();
+        seen->insert(root, 0);
+    }
+    SeenStates* const seen_states = seen ? &*seen : nullptr;
+
+    // Shallow trees and single threads need no split
+    const int split_ply = std::min(kSplitPlies, options.depth - 1);
+    if (threads == 1 || split_ply == 0) {
+        Expander expander(options.depth, seen_states);
+        expander.expand(root, 0);
+        return expander.counts;
+    }
+
+    StealingQueues queues(threads);
+    std::size_t next_owner = 0;
+    {
+        Expander splitter(options.depth, seen_states);
+        splitter.expand(root, 0, split_ply, [&](const GameState& state, int ply) {
+            queues.push(next_owner, Subtree{state, ply});
+            next_owner = (next_owner + 1) % threads;
+        });
+        total = splitter.counts;
+    }
+
+    std::mutex mutex;
+    std::exception_ptr failure;
+    const auto worker = [&](std::size_t index) {
+        util::trace::set_thread_name("perft worker");
+        try {
+            Expander expander(options.depth, seen_states);
+            while (auto subtree = queues.take(index)) {
+                CAMELUP_TRACE_SPAN("perft_subtree", "sim");
+                expander.expand(subtree->state, subtree->ply);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            add(total, expander.counts);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!failure) {
+                failure = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (std::size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(worker, i);
+    }
+    worker(0);
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    return total;
+}
+
+}  // namespace camelup::sim
@@ -0,0 +1,101 @@
+#include "camelup/sim/policy.hpp"
+
+#include <algorithm>  // find
+#include <stdexcept>
+
+#include "camelup/analysis/action_values.hpp"
+#include "camelup/analysis/leg_odds.hpp"
+#include "camelup/analysis/race_odds.hpp"
+#include "camelup/sim/policy_memo.hpp"
+#include "camelup/util/profile.hpp"
+
+namespace camelup::sim {
+
+namespace {
+
+constexpr std::uint32_t kGreedyRaceSeed = 0x5EED;
+
+std::size_t choose_index(const GameState& state, const std::vector<Action>& legal_actions, Policy policy,
+                         std::mt19937& chooser_rng) {
+    switch (policy) {
+        case Policy::RollOnly:
+            for (std::size_t i = 0; i < legal_actions.size(); ++i) {
+                if (legal_actions[i].type() == ActionType::RollDie) {
+                    return i;
+                }
+            }
+            return 0;
+        case Policy::FirstLegal:
+            return 0;
+        case Policy::RandomLegal:
+            return std::uniform_int_distribution<std::size_t>(0, legal_actions.size() - 1)(chooser_rng);
+        case Policy::Greedy: {
+            const auto ranked = analysis::rank_actions(state, analysis::leg_odds(state),
+                                                       analysis::race_odds(state, kGreedyRaceSamples, kGreedyRaceSeed));
+            const auto best = std::find(legal_actions.begin(), legal_actions.end(), ranked.front().action);
+            if (best == legal_actions.end()) {
+                throw std::runtime_error("greedy choice is not among the legal actions");
+            }
+            return static_cast<std::size_t>(best - legal_actions.begin());
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+bool parse_policy(std::string_view value, Policy& out) {
+    if (value == "roll") {
+        out = Policy::RollOnly;
+        return true;
+    }
+    if (value == "first") {
+        out = Policy::FirstLegal;
+        return true;
+    }
+    if (value == "random") {
+        out = Policy::RandomLegal;
+        return true;
+    }
+    if (value == "greedy") {
+        out = Policy::Greedy;
+        return true;
+    }
+    return false;
+}
+
+const char* policy_name(Policy policy) {
+    switch (policy) {
+        case Policy::RollOnly:
+            return "roll";
+        case Policy::FirstLegal:
+            return "first";
+        case Policy::RandomLegal:
+            return "random";
+        case Policy::Greedy:
+            return "greedy";
+    }
+    return "unknown";
+}
+
+const Action& choose_action(const GameState& state, const std::vector<Action>& legal_actions, Policy policy,
+                            std::mt19937& chooser_rng) {
+    CAMELUP_PROFILE_SCOPE(util::profile::Phase::PolicySelect);
+    if (legal_actions.empty()) {
+        throw std::runtime_error("no legal actions available");
+    }
+    if (!deterministic_policy(policy) || !policy_memo::enabled()) {
+        return legal_actions[choose_index(state, legal_actions, policy, chooser_rng)];
+    }
+
+    // A remembered index past the end can only come from a hash collision, choose afresh then
+    const auto hash = policy_memo::state_hash(state) ^ static_cast<std::uint64_t>(policy);
+    if (const auto remembered = policy_memo::find(hash); remembered && *remembered < legal_actions.size()) {
+        return legal_actions[*remembered];
+    }
+    const auto index = choose_index(state, legal_actions, policy, chooser_rng);
+    policy_memo::insert(hash, index);
+    return legal_actions[index];
+}
+
+}  // namespace camelup::sim
@@ -0,0 +1,160 @@
+#include "camelup/sim/policy_memo.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace camelup::sim::policy_memo {
+
+namespace {
+
+// Written by their own thread only, stats() reads the generation and counters
+struct ThreadMemo {
+    std::atomic<std::uint64_t> generation{0};
+    std::unordered_map<std::uint64_t, std::uint32_t> chosen;
+    std::atomic<std::uint64_t> hits{0};
+    std::atomic<std::uint64_t> misses{0};
+    std::atomic<std::uint64_t> clears{0};
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadMemo>> memos;  // kept after their thread exits
+};
+
+// Never destroyed, threads may still exit after static destruction has started
+Registry& registry() {
+    static auto* instance = new Registry;
+    return *instance;
+}
+
+std::atomic<bool> enabled_flag{false};
+std::atomic<std::uint64_t> current_generation{0};
+std::atomic<std::size_t> capacity{kDefaultEntriesPerThread};
+
+// Tables from an older generation are reset by their owner on first use
+ThreadMemo& local_memo() {
+    thread_local std::shared_ptr<ThreadMemo> memo = [] {
+        auto created = std::make_shared<ThreadMemo>();
+        auto& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.memos.push_back(created);
+        return created;
+    }();
+    const auto generation = current_generation.load(std::memory_order_relaxed);
+    if (memo->generation.load(std::memory_order_relaxed) != generation) {
+        memo->chosen.clear();
+        memo->hits.store(0, std::memory_order_relaxed);
+        memo->misses.store(0, std::memory_order_relaxed);
+        memo->clears.store(0, std::memory_order_relaxed);
+        memo->generation.store(generation, std::memory_order_relaxed);
+    }
+    return *memo;
+}
+
+std::uint64_t mix(std::uint64_t hash, std::uint64_t value) noexcept {
+    hash ^= value + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2);
+    hash ^= hash >> 31;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    return hash ^ (hash >> 29);
+}
+
+}  // namespace
+
+std::uint64_t state_hash(const GameState& state) noexcept {
+    std::uint64_t hash = 0;
+    for (int tile = 0; tile < kBoardTiles; ++tile) {
+        // Stacks bottom to top in 3 bits a camel behind a marker bit, so empty tiles count too
+        std::uint64_t stack = 1;
+        for (const auto camel : state.board[tile]) {
+            stack = stack << 3 | camel;
+        }
+        hash = mix(hash, stack);
+    }
+    std::uint64_t dice = 0;
+    for (CamelId camel = 0; camel < static_cast<CamelId>(kCamelCount); ++camel) {
+        dice = dice << 1 | (state.die_available[camel] ? 1U : 0U);
+        hash = mix(hash, static_cast<std::uint64_t>(state.leg_tickets_remaining[camel]));
+        for (const int value : state.leg_ticket_values[camel]) {
+            hash = mix(hash, static_cast<std::uint64_t>(value));
+        }
+    }
+    hash = mix(hash, dice);
+    for (int player = 0; player < state.player_count; ++player) {
+        hash = mix(hash, static_cast<std::uint64_t>(state.money[player]));
+        hash = mix(hash, static_cast<std::uint64_t>(state.desert_tiles[player].tile) << 2 |
+                             (state.desert_tiles[player].move_delta < 0 ? 1U : 0U));
+        hash = mix(hash, state.player_leg_tickets[player].size());
+        for (const auto& ticket : state.player_leg_tickets[player]) {
+            hash = mix(hash, static_cast<std::uint64_t>(ticket.value) << 3 | ticket.camel);
+        }
+    }
+    for (const auto* stack : {&state.winner_bet_stack, &state.loser_bet_stack}) {
+        hash = mix(hash, stack->size());
+        for (const auto& card : *stack) {
+            hash = mix(hash, static_cast<std::uint64_t>(card.player) << 3 | card.camel);
+        }
+    }
+    const std::uint64_t turn = static_cast<std::uint64_t>(state.current_player) |
+                               static_cast<std::uint64_t>(state.player_count) << 8 |
+                               static_cast<std::uint64_t>(state.leg_number) << 16 | (state.terminal ? 1ULL << 63 : 0);
+    return mix(hash, turn);
+}
+
+void enable(std::size_t entries_per_thread) {
+    if (entries_per_thread == 0) {
+        throw std::invalid_argument("policy memo needs at least one entry per thread");
+    }
+    capacity.store(entries_per_thread, std::memory_order_relaxed);
+    current_generation.fetch_add(1, std::memory_order_relaxed);
+    enabled_flag.store(true, std::memory_order_release);
+}
+
+void disable() noexcept {
+    enabled_flag.store(false, std::memory_order_release);
+}
+
+bool enabled() noexcept {
+    return enabled_flag.load(std::memory_order_relaxed);
+}
+
+std::optional<std::size_t> find(std::uint64_t hash) {
+    auto& memo = local_memo();
+    const auto found = memo.chosen.find(hash);
+    if (found == memo.chosen.end()) {
+        memo.misses.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+    memo.hits.fetch_add(1, std::memory_order_relaxed);
+    return found->second;
+}
+
+void insert(std::uint64_t hash, std::size_t index) {
+    auto& memo = local_memo();
+    if (memo.chosen.size() >= capacity.load(std::memory_order_relaxed)) {
+        memo.chosen.clear();
+        memo.clears.fetch_add(1, std::memory_order_relaxed);
+    }
+    memo.chosen[hash] = static_cast<std::uint32_t>(index);
+}
+
+Stats stats() {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    Stats totals;
+    const auto generation = current_generation.load(std::memory_order_relaxed);
+    for (const auto& memo : reg.memos) {
+        if (memo->generation.load(std::memory_order_relaxed) != generation) {
+            continue;
+        }
+        totals.hits += memo->hits.load(std::memory_order_relaxed);
+        totals.misses += memo->misses.load(std::memory_order_relaxed);
+        totals.clears += memo->clears.load(std::memory_order_relaxed);
+    }
+    return totals;
+}
+
+}  // namespace camelup::sim::policy_memo
@@ -0,0 +1,260 @@
+#include "camelup/sim/record_codec.hpp"
+
+#include <stdexcept>
+#include <variant>
+
+namespace camelup::sim {
+
+namespace {
+
+constexpr std::uint8_t kNextGame = 1U << 0;
+constexpr std::uint8_t kSameBase = 1U << 1;
+constexpr std::uint8_t kSamePlayers = 1U << 2;
+constexpr std::uint8_t kTerminal = 1U << 3;
+
+constexpr unsigned kEscape = 15;
+constexpr unsigned kEndOfGame = 0;
+constexpr std::size_t kMaxRun = 15;
+
+// Non-roll action codes
+constexpr unsigned kTicketCode = 30;
+constexpr unsigned kWinnerCode = kTicketCode + kCamelCount;
+constexpr unsigned kLoserCode = kWinnerCode + kCamelCount;
+constexpr unsigned kActionCodes = kLoserCode + kCamelCount;
+
+unsigned action_code(const Action& action) {
+    switch (action.type()) {
+        case ActionType::PlaceDesertTile: {
+            const auto payload = std::get<PlaceDesertTilePayload>(action.payload);
+            if (payload.tile < 1 || payload.tile >= kBoardTiles - 1) {
+                throw std::invalid_argument("desert tile outside the record codec range");
+            }
+            return static_cast<unsigned>((payload.tile - 1) * 2 + (payload.move_delta < 0 ? 1 : 0));
+        }
+        case ActionType::TakeLegTicket:
+            return kTicketCode + std::get<TakeLegTicketPayload>(action.payload).camel;
+        case ActionType::BetWinner:
+            return kWinnerCode + std::get<BetWinnerPayload>(action.payload).camel;
+        case ActionType::BetLoser:
+            return kLoserCode + std::get<BetLoserPayload>(action.payload).camel;
+        case ActionType::RollDie:
+            break;
+    }
+    throw std::invalid_argument("rolls have no action code");
+}
+
+Action action_from_code(unsigned code) {
+    if (code < kTicketCode) {
+        return Action::place_desert_tile(static_cast<int>(code / 2) + 1, code % 2 == 0 ? 1 : -1);
+    }
+    if (code < kWinnerCode) {
+        return Action::take_leg_ticket(static_cast<CamelId>(code - kTicketCode));
+    }
+    if (code < kLoserCode) {
+        return Action::bet_winner(static_cast<CamelId>(code - kWinnerCode));
+    }
+    if (code < kActionCodes) {
+        return Action::bet_loser(static_cast<CamelId>(code - kLoserCode));
+    }
+    throw std::runtime_error("corrupt action in record block");
+}
+
+std::uint64_t zigzag(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+std::int64_t unzigzag(std::uint64_t value) {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+void put_varint(std::vector<std::uint8_t>& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+// Nibbles fill the low half of a byte first
+class NibbleWriter {
+public:
+    explicit NibbleWriter(std::vector<std::uint8_t>& out) : out_(out) {}
+
+    void put(unsigned nibble) {
+        if (high_) {
+            out_.back() = static_cast<std::uint8_t>(out_.back() | nibble << 4);
+        } else {
+            out_.push_back(static_cast<std::uint8_t>(nibble));
+        }
+        high_ = !high_;
+    }
+
+private:
+    std::vector<std::uint8_t>& out_;
+    bool high_{false};
+};
+
+class Reader {
+public:
+    Reader(const std::uint8_t* data, std::size_t size) : begin_(data), cursor_(data), end_(data + size) {}
+
+    std::uint8_t byte() {
+        if (cursor_ == end_) {
+            throw std::runtime_error("truncated record block");
+        }
+        return *cursor_++;
+    }
+
+    std::uint64_t varint() {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const std::uint8_t next = byte();
+            value |= static_cast<std::uint64_t>(next & 0x7F) << shift;
+            if ((next & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw std::runtime_error("corrupt varint in record block");
+    }
+
+    unsigned nibble() {
+        if (high_) {
+            high_ = false;
+            return cursor_[-1] >> 4;
+        }
+        high_ = true;
+        return byte() & 0x0F;
+    }
+
+    // Skip the unused half of the last nibble byte
+    void align() { high_ = false; }
+
+    [[nodiscard]] std::size_t consumed() const noexcept { return static_cast<std::size_t>(cursor_ - begin_); }
+
+private:
+    const std::uint8_t* begin_;
+    const std::uint8_t* cursor_;
+    const std::uint8_t* end_;
+    bool high_{false};
+};
+
+}  // namespace
+
+void encode_records(const std::vector<GameRecord>& records, std::vector<std::uint8_t>& out) {
+    put_varint(out, records.size());
+    std::int64_t previous_game = -1;
+    std::int64_t previous_base = 0;
+    std::uint8_t previous_players = 2;
+    for (const auto& record : records) {
+        const std::int64_t game = record.game;
+        const std::int64_t base = static_cast<std::int64_t>(record.seed) - game;
+        std::uint8_t flags = 0;
+        flags |= game == previous_game + 1 ? kNextGame : 0;
+        flags |= base == previous_base ? kSameBase : 0;
+        flags |= record.players == previous_players ? kSamePlayers : 0;
+        flags |= record.terminal ? kTerminal : 0;
+        out.push_back(flags);
+        if ((flags & kNextGame) == 0) {
+            put_varint(out, zigzag(game - (previous_game + 1)));
+        }
+        if ((flags & kSameBase) == 0) {
+            put_varint(out, zigzag(base - previous_base));
+        }
+        if ((flags & kSamePlayers) == 0) {
+            out.push_back(record.players);
+        }
+        previous_game = game;
+        previous_base = base;
+        previous_players = record.players;
+
+        NibbleWriter nibbles(out);
+        std::size_t roll = 0;
+        const auto& actions = record.actions;
+        for (std::size_t i = 0; i < actions.size();) {
+            if (actions[i].type() == ActionType::RollDie) {
+                if (roll == record.rolls.size()) {
+                    throw std::invalid_argument("game record has fewer rolls than roll actions");
+                }
+                const auto& outcome = record.rolls[roll++];
+                nibbles.put(static_cast<unsigned>(outcome.camel * 3 + outcome.distance - 1));
+                ++i;
+                continue;
+            }
+            std::size_t run = 1;
+            while (run < kMaxRun && i + run < actions.size() && actions[i + run].type() != ActionType::RollDie) {
+                ++run;
+            }
+            nibbles.put(kEscape);
+            nibbles.put(static_cast<unsigned>(run));
+            for (const std::size_t last = i + run; i < last; ++i) {
+                const unsigned code = action_code(actions[i]);
+                nibbles.put(code & 0x0F);
+                nibbles.put(code >> 4);
+            }
+        }
+        if (roll != record.rolls.size()) {
+            throw std::invalid_argument("game record has more rolls than roll actions");
+        }
+        nibbles.put(kEscape);
+        nibbles.put(kEndOfGame);
+    }
+}
+
+std::size_t decode_records(const std::uint8_t* data, std::size_t size, std::vector<GameRecord>& out) {
+    Reader in(data, size);
+    const auto count = in.varint();
+    // Every record takes at least two bytes, which bounds a corrupt count
+    if (count > size) {
+        throw std::runtime_error("corrupt record count in record block");
+    }
+    out.resize(static_cast<std::size_t>(count));
+
+    std::int64_t previous_game = -1;
+    std::int64_t previous_base = 0;
+    std::uint8_t previous_players = 2;
+    for (auto& record : out) {
+        const std::uint8_t flags = in.byte();
+        std::int64_t game = previous_game + 1;
+        if ((flags & kNextGame) == 0) {
+            game += unzigzag(in.varint());
+        }
+        std::int64_t base = previous_base;
+        if ((flags & kSameBase) == 0) {
+            base += unzigzag(in.varint());
+        }
+        const std::uint8_t players = (flags & kSamePlayers) != 0 ? previous_players : in.byte();
+        record.game = static_cast<std::uint32_t>(game);
+        record.seed = static_cast<std::int32_t>(base + game);
+        record.players = players;
+        record.terminal = (flags & kTerminal) != 0;
+        previous_game = game;
+        previous_base = base;
+        previous_players = players;
+
+        record.actions.clear();
+        record.rolls.clear();
+        while (true) {
+            const unsigned nibble = in.nibble();
+            if (nibble != kEscape) {
+                if (nibble >= kCamelCount * 3) {
+                    throw std::runtime_error("corrupt roll in record block");
+                }
+                record.actions.push_back(Action::roll_die());
+                record.rolls.push_back(DieRoll{static_cast<CamelId>(nibble / 3), static_cast<int>(nibble % 3) + 1});
+                continue;
+            }
+            const unsigned run = in.nibble();
+            if (run == kEndOfGame) {
+                break;
+            }
+            for (unsigned i = 0; i < run; ++i) {
+                const unsigned low = in.nibble();
+                record.actions.push_back(action_from_code(low | in.nibble() << 4));
+            }
+        }
+        in.align();
+    }
+    return in.consumed();
+}
+
+}  // namespace camelup::sim
@@ -0,0 +1,242 @@
+#include "camelup/sim/self_play.hpp"
+
+#include <algorithm>  // max
+#include <cstdio>     // snprintf
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#include "camelup/sim/record_codec.hpp"
+#include "camelup/util/binary_io.hpp"
+#include "camelup/util/trace.hpp"
+
+namespace camelup::sim {
+
+namespace {
+
+// Spin briefly, then yield, then sleep, so a stalled peer costs little CPU
+void back_off(int attempt) {
+    if (attempt < 16) {
+        return;
+    }
+    if (attempt < 64) {
+        std::this_thread::yield();
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+std::string shard_path(const std::string& prefix, std::uint64_t index) {
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), "-%05llu.rec", static_cast<unsigned long long>(index));
+    return prefix + suffix;
+}
+
+}  // namespace
+
+SelfPlayPipeline::SelfPlayPipeline(SelfPlayOptions options)
+    : options_(std::move(options)),
+      queue_(std::max<std::size_t>(options_.queue_capacity, 1)),
+      started_(std::chrono::steady_clock::now()) {
+    if (options_.batch.games < 0) {
+        throw std::invalid_argument("game count must not be negative");
+    }
+    if (options_.output_prefix.empty()) {
+        throw std::invalid_argument("self-play needs an output prefix");
+    }
+    options_.batch_records = std::max<std::size_t>(options_.batch_records, 1);
+    options_.shard_records = std::max(options_.shard_records, options_.batch_records);
+    std::size_t producers = options_.producers;
+    if (producers == 0) {
+        producers = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    producers_running_.store(producers);
+    writer_ = std::thread([this]() { run_writer(); });
+    producers_.reserve(producers);
+    for (std::size_t i = 0; i < producers; ++i) {
+        producers_.emplace_back([this]() { run_producer(); });
+    }
+}
+
+SelfPlayPipeline::~SelfPlayPipeline() {
+    try {
+        wait();
+    } catch (...) {
+    }
+}
+
+SelfPlayStats SelfPlayPipeline::stats() const {
+    SelfPlayStats stats;
+    stats.games = games_.load(std::memory_order_relaxed);
+    stats.finished = finished_.load(std::memory_order_relaxed);
+    stats.turns = turns_.load(std::memory_order_relaxed);
+    stats.bytes = bytes_.load(std::memory_order_relaxed);
+    stats.producer_waits = producer_waits_.load(std::memory_order_relaxed);
+    stats.queue_capacity = queue_.capacity();
+    stats.max_queue_depth = max_depth_.load(std::memory_order_relaxed);
+    if (stats.games > 0) {
+        stats.mean_queue_depth =
+            static_cast<double>(depth_sum_.load(std::memory_order_relaxed)) / static_cast<double>(stats.games);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats.shards = shard_paths_.size();
+    }
+    const double finished_seconds = seconds_.load(std::memory_order_relaxed);
+    stats.seconds = finished_seconds > 0.0
+                        ? finished_seconds
+                        : std::chrono::duration<double>(std::chrono::steady_clock::now() - started_).count();
+    return stats;
+}
+
+SelfPlayStats SelfPlayPipeline::wait() {
+    if (!joined_) {
+        for (auto& producer : producers_) {
+            producer.join();
+        }
+        writer_.join();
+        joined_ = true;
+        seconds_.store(std::chrono::duration<double>(std::chrono::steady_clock::now() - started_).count());
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (failure_) {
+            std::rethrow_exception(failure_);
+        }
+    }
+    return stats();
+}
+
+std::vector<std::string> SelfPlayPipeline::shard_paths() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return shard_paths_;
+}
+
+void SelfPlayPipeline::fail(std::exception_ptr failure) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!failure_) {
+        failure_ = std::move(failure);
+    }
+    aborted_.store(true);
+}
+
+void SelfPlayPipeline::run_producer() {
+    util::trace::set_thread_name("self-play producer");
+    try {
+        while (!aborted_.load(std::memory_order_relaxed)) {
+            const int game = next_game_.fetch_add(1, std::memory_order_relaxed);
+            if (game >= options_.batch.games) {
+                break;
+            }
+            GameRecord record;
+            play_game(options_.batch, game, {}, &record);
+            for (int attempt = 0; !queue_.try_push(record); ++attempt) {
+                if (aborted_.load(std::memory_order_relaxed)) {
+                    break;
+                }
+                if (attempt == 0) {
+                    producer_waits_.fetch_add(1, std::memory_order_relaxed);
+                }
+                back_off(attempt);
+            }
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+    producers_running_.fetch_sub(1, std::memory_order_release);
+}
+
+void SelfPlayPipeline::run_writer() {
+    util::trace::set_thread_name("record writer");
+    try {
+        std::ofstream out;
+        std::uint64_t shard_count = 0;
+        std::uint64_t in_shard = 0;
+        std::vector<GameRecord> batch;
+        std::vector<std::uint8_t> payload;
+
+        // Closing flushes what the stream still buffers, so a full disk can show up only here
+        const auto close_shard = [&]() {
+            if (!out.is_open()) {
+                return;
+            }
+            out.close();
+            if (!out) {
+                throw std::runtime_error("failed to close record shard");
+            }
+        };
+
+        const auto write_batch = [&]() {
+            if (batch.empty()) {
+                return;
+            }
+            CAMELUP_TRACE_SPAN("record_batch_write", "io");
+            if (!out.is_open()) {
+                const auto path = shard_path(options_.output_prefix, shard_count++);
+                out.open(path, std::ios::binary | std::ios::trunc);
+                if (!out) {
+                    throw std::runtime_error("failed to open record shard: " + path);
+                }
+                out.write(kRecordShardMagic, sizeof(kRecordShardMagic));
+                util::write_u64(out, kRecordShardVersion);
+                bytes_.fetch_add(sizeof(kRecordShardMagic) + 8, std::memory_order_relaxed);
+                std::lock_guard<std::mutex> lock(mutex_);
+                shard_paths_.push_back(path);
+            }
+            payload.clear();
+            encode_records(batch, payload);
+            util::write_u64(out, batch.size());
+            util::write_u64(out, payload.size());
+            out.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+            if (!out) {
+                throw std::runtime_error("failed to write record shard");
+            }
+            bytes_.fetch_add(16 + payload.size(), std::memory_order_relaxed);
+            in_shard += batch.size();
+            batch.clear();
+            if (in_shard >= options_.shard_records) {
+                close_shard();
+                in_shard = 0;
+            }
+        };
+
+        for (int attempt = 0; !aborted_.load(std::memory_order_relaxed);) {
+            const std::size_t depth = queue_.size_approx();
+            auto record = queue_.try_pop();
+            if (!record) {
+                // Producers publish their last push before leaving, so one more pop settles it
+                if (producers_running_.load(std::memory_order_acquire) == 0) {
+                    record = queue_.try_pop();
+                    if (!record) {
+                        break;
+                    }
+                } else {
+                    back_off(attempt++);
+                    continue;
+                }
+            }
+            attempt = 0;
+
+            depth_sum_.fetch_add(depth, std::memory_order_relaxed);
+            if (depth > max_depth_.load(std::memory_order_relaxed)) {
+                max_depth_.store(depth, std::memory_order_relaxed);
+            }
+            turns_.fetch_add(record->actions.size(), std::memory_order_relaxed);
+            if (record->terminal) {
+                finished_.fetch_add(1, std::memory_order_relaxed);
+            }
+            games_.fetch_add(1, std::memory_order_relaxed);
+            batch.push_back(std::move(*record));
+            if (batch.size() >= options_.batch_records) {
+                write_batch();
+            }
+        }
+        write_batch();
+        close_shard();
+    } catch (...) {
+        fail(std::current_exception());
+    }
+}
+
+}  // namespace camelup::sim
@@ -0,0 +1,164 @@
+#include "camelup/sim/shard_file.hpp"
+
+#include <algorithm>  // equal
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "camelup/snapshot/state_snapshot.hpp"
+#include "camelup/util/binary_io.hpp"
+
+namespace camelup::sim {
+
+namespace {
+
+void write_summary(std::ostream& out, const RunSummary& summary) {
+    util::write_u64(out, summary.games);
+    util::write_u64(out, summary.finished);
+    summary.turns.write(out);
+    summary.legs.write(out);
+    for (const auto& sketch : summary.money) {
+        sketch.write(out);
+    }
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        util::write_u64(out, summary.winners[camel]);
+        util::write_u64(out, summary.losers[camel]);
+    }
+    for (const auto& counts : summary.actions) {
+        for (const auto count : counts) {
+            util::write_u64(out, count);
+        }
+    }
+}
+
+RunSummary read_summary(std::istream& in) {
+    RunSummary summary;
+    summary.games = util::read_u64(in);
+    summary.finished = util::read_u64(in);
+    summary.turns = Histogram::read(in);
+    summary.legs = Histogram::read(in);
+    for (auto& sketch : summary.money) {
+        sketch = KllSketch::read(in);
+    }
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        summary.winners[camel] = util::read_u64(in);
+        summary.losers[camel] = util::read_u64(in);
+    }
+    for (auto& counts : summary.actions) {
+        for (auto& count : counts) {
+            count = util::read_u64(in);
+        }
+    }
+    return summary;
+}
+
+int read_int(std::istream& in) {
+    return static_cast<int>(static_cast<std::int64_t>(util::read_u64(in)));
+}
+
+void write_int(std::ostream& out, int value) {
+    util::write_u64(out, static_cast<std::uint64_t>(static_cast<std::int64_t>(value)));
+}
+
+}  // namespace
+
+void write_shard(std::ostream& out, const ShardResult& shard) {
+    out.write(kShardFileMagic, sizeof(kShardFileMagic));
+    util::write_u64(out, kShardFileVersion);
+
+    const auto& options = shard.options;
+    write_int(out, options.seed);
+    write_int(out, options.players);
+    write_int(out, options.games);
+    write_int(out, options.turn_limit);
+    write_int(out, static_cast<int>(options.policy));
+    util::write_u64(out, options.start ? 1 : 0);
+    if (options.start) {
+        const auto snapshot = snapshot::encode(*options.start);
+        out.write(reinterpret_cast<const char*>(snapshot.data()), static_cast<std::streamsize>(snapshot.size()));
+    }
+
+    write_int(out, shard.shard.index);
+    write_int(out, shard.shard.count);
+    util::write_u64(out, shard.nodes.size());
+    for (const auto& node : shard.nodes) {
+        write_int(out, node.first_block);
+        write_int(out, node.blocks);
+        write_summary(out, node.summary);
+    }
+}
+
+ShardResult read_shard(std::istream& in) {
+    char magic[sizeof(kShardFileMagic)];
+    if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kShardFileMagic)) {
+        throw std::runtime_error("not a camelup shard file");
+    }
+    if (util::read_u64(in) != kShardFileVersion) {
+        throw std::runtime_error("unsupported shard file version");
+    }
+
+    ShardResult shard;
+    auto& options = shard.options;
+    options.seed = read_int(in);
+    options.players = read_int(in);
+    options.games = read_int(in);
+    options.turn_limit = read_int(in);
+    const int policy = read_int(in);
+    if (policy < 0 || policy >= kPolicyCount) {
+        throw std::runtime_error("corrupt shard file policy");
+    }
+    options.policy = static_cast<Policy>(policy);
+    if (util::read_u64(in) != 0) {
+        snapshot::StateSnapshot snapshot{};
+        if (!in.read(reinterpret_cast<char*>(snapshot.data()), static_cast<std::streamsize>(snapshot.size()))) {
+            throw std::runtime_error("unexpected end of binary stream");
+        }
+        options.start = snapshot::decode(snapshot);
+    }
+
+    shard.shard.index = read_int(in);
+    shard.shard.count = read_int(in);
+    const auto nodes = util::read_u64(in);
+    if (nodes > static_cast<std::uint64_t>(summary_blocks(options.games))) {
+        throw std::runtime_error("corrupt shard file node count");
+    }
+    shard.nodes.reserve(static_cast<std::size_t>(nodes));
+    for (std::uint64_t i = 0; i < nodes; ++i) {
+        SummaryNode node;
+        node.first_block = read_int(in);
+        node.blocks = read_int(in);
+        node.summary = read_summary(in);
+        shard.nodes.push_back(std::move(node));
+    }
+    return shard;
+}
+
+void save_shard(const std::string& path, const ShardResult& shard) {
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("failed to open shard file: " + temporary);
+        }
+        write_shard(out, shard);
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("failed to write shard file: " + temporary);
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        throw std::runtime_error("failed to replace shard file " + path + ": " + error.message());
+    }
+}
+
+ShardResult load_shard(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("failed to open shard file: " + path);
+    }
+    return read_shard(in);
+}
+
+}  // namespace camelup::sim
@@ -0,0 +1,235 @@
+#include "camelup/sim/sketch.hpp"
+
+#include <algorithm>  // max, min, sort
+#include <stdexcept>
+#include <utility>
+
+#include "camelup/util/binary_io.hpp"
+
+namespace camelup::sim {
+
+Histogram::Histogram(std::size_t buckets, int bucket_width) : bucket_width_(bucket_width), buckets_(buckets, 0) {
+    if (buckets == 0 || bucket_width <= 0) {
+        throw std::invalid_argument("histogram needs at least one bucket of positive width");
+    }
+}
+
+void Histogram::record(int value) {
+    const auto bucket = static_cast<std::size_t>(std::max(0, value) / bucket_width_);
+    ++buckets_[std::min(bucket, buckets_.size() - 1)];
+    ++count_;
+    sum_ += value;
+}
+
+void Histogram::merge(const Histogram& other) {
+    if (other.bucket_width_ != bucket_width_ || other.buckets_.size() != buckets_.size()) {
+        throw std::invalid_argument("histograms with different buckets cannot be merged");
+    }
+    for (std::size_t i = 0; i < buckets_.size(); ++i) {
+        buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+}
+
+double Histogram::mean() const noexcept {
+    return count_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_);
+}
+
+int Histogram::quantile(double rank) const {
+    if (count_ == 0) {
+        throw std::runtime_error("quantile of an empty histogram");
+    }
+    const auto target = std::max<std::uint64_t>(
+        1, static_cast<std::uint64_t>(std::min(1.0, std::max(0.0, rank)) * static_cast<double>(count_)));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < buckets_.size(); ++i) {
+        seen += buckets_[i];
+        if (seen >= target) {
+            return static_cast<int>(i) * bucket_width_;
+        }
+    }
+    return static_cast<int>(buckets_.size() - 1) * bucket_width_;
+}
+
+void Histogram::write(std::ostream& out) const {
+    util::write_u64(out, static_cast<std::uint64_t>(bucket_width_));
+    util::write_u64(out, buckets_.size());
+    for (const auto bucket : buckets_) {
+        util::write_u64(out, bucket);
+    }
+    util::write_u64(out, count_);
+    util::write_u64(out, static_cast<std::uint64_t>(sum_));
+}
+
+Histogram Histogram::read(std::istream& in) {
+    const auto width = util::read_u64(in);
+    const auto size = util::read_u64(in);
+    if (width == 0 || width > (1U << 30) || size == 0 || size > (1U << 20)) {
+        throw std::runtime_error("corrupt histogram");
+    }
+    Histogram histogram(static_cast<std::size_t>(size), static_cast<int>(width));
+    for (auto& bucket : histogram.buckets_) {
+        bucket = util::read_u64(in);
+    }
+    histogram.count_ = util::read_u64(in);
+    histogram.sum_ = static_cast<std::int64_t>(util::read_u64(in));
+    return histogram;
+}
+
+KllSketch::KllSketch(int k) : k_(k), levels_(1) {
+    if (k < 8) {
+        throw std::invalid_argument("KLL sketch needs k of at least 8");
+    }
+}
+
+void KllSketch::update(double value) {
+    if (count_ == 0) {
+        min_ = value;
+        max_ = value;
+    } else {
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+    ++count_;
+    levels_[0].push_back(value);
+    if (levels_[0].size() > capacity(0)) {
+        compress();
+    }
+}
+
+void KllSketch::merge(const KllSketch& other) {
+    if (other.k_ != k_) {
+        throw std::invalid_argument("KLL sketches with different k cannot be merged");
+    }
+    if (other.count_ == 0) {
+        return;
+    }
+    if (count_ == 0) {
+        min_ = other.min_;
+        max_ = other.max_;
+    } else {
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+    count_ += other.count_;
+    if (levels_.size() < other.levels_.size()) {
+        levels_.resize(other.levels_.size());
+    }
+    for (std::size_t level = 0; level < other.levels_.size(); ++level) {
+        levels_[level].insert(levels_[level].end(), other.levels_[level].begin(), other.levels_[level].end());
+    }
+    compress();
+}
+
+std::size_t KllSketch::retained() const noexcept {
+    std::size_t total = 0;
+    for (const auto& level : levels_) {
+        total += level.size();
+    }
+    return total;
+}
+
+double KllSketch::quantile(double rank) const {
+    if (count_ == 0) {
+        throw std::runtime_error("quantile of an empty sketch");
+    }
+    std::vector<std::pair<double, std::uint64_t>> weighted;
+    weighted.reserve(retained());
+    for (std::size_t level = 0; level < levels_.size(); ++level) {
+        for (const double value : levels_[level]) {
+            weighted.emplace_back(value, std::uint64_t{1} << level);
+        }
+    }
+    std::sort(weighted.begin(), weighted.end());
+
+    const auto target = std::max<std::uint64_t>(
+        1, static_cast<std::uint64_t>(std::min(1.0, std::max(0.0, rank)) * static_cast<double>(count_)));
+    std::uint64_t seen = 0;
+    for (const auto& [value, weight] : weighted) {
+        seen += weight;
+        if (seen >= target) {
+            return value;
+        }
+    }
+    return max_;
+}
+
+void KllSketch::write(std::ostream& out) const {
+    util::write_u64(out, static_cast<std::uint64_t>(k_));
+    util::write_u64(out, count_);
+    util::write_f64(out, min_);
+    util::write_f64(out, max_);
+    util::write_u64(out, keep_odd_);
+    util::write_u64(out, levels_.size());
+    for (const auto& level : levels_) {
+        util::write_u64(out, level.size());
+        for (const double value : level) {
+            util::write_f64(out, value);
+        }
+    }
+}
+
+KllSketch KllSketch::read(std::istream& in) {
+    const auto k = util::read_u64(in);
+    if (k < 8 || k > (1U << 20)) {
+        throw std::runtime_error("corrupt KLL sketch");
+    }
+    KllSketch sketch(static_cast<int>(k));
+    sketch.count_ = util::read_u64(in);
+    sketch.min_ = util::read_f64(in);
+    sketch.max_ = util::read_f64(in);
+    sketch.keep_odd_ = util::read_u64(in);
+    const auto levels = util::read_u64(in);
+    if (levels == 0 || levels > 64) {
+        throw std::runtime_error("corrupt KLL sketch");
+    }
+    sketch.levels_.assign(static_cast<std::size_t>(levels), {});
+    for (auto& level : sketch.levels_) {
+        const auto size = util::read_u64(in);
+        if (size > 2 * k + 1) {
+            throw std::runtime_error("corrupt KLL sketch");
+        }
+        level.resize(static_cast<std::size_t>(size));
+        for (auto& value : level) {
+            value = util::read_f64(in);
+        }
+    }
+    return sketch;
+}
+
+// Capacities shrink by 2/3 per level below the top, never under eight items
+std::size_t KllSketch::capacity(std::size_t level) const noexcept {
+    std::size_t cap = static_cast<std::size_t>(k_);
+    for (std::size_t depth = levels_.size() - 1 - level; depth > 0 && cap > 8; --depth) {
+        cap = cap * 2 / 3;
+    }
+    return std::max<std::size_t>(cap, 8);
+}
+
+void KllSketch::compress() {
+    std::size_t level = 0;
+    while (level < levels_.size()) {
+        if (levels_[level].size() <= capacity(level)) {
+            ++level;
+            continue;
+        }
+        if (level + 1 == levels_.size()) {
+            levels_.emplace_back();
+        }
+        auto& items = levels_[level];
+        std::sort(items.begin(), items.end());
+        // An odd item out stays behind at full weight
+        const std::size_t paired = items.size() & ~std::size_t{1};
+        const std::size_t first = (keep_odd_ >> level) & 1U;
+        keep_odd_ ^= std::uint64_t{1} << level;
+        auto& above = levels_[level + 1];
+        for (std::size_t i = first; i < paired; i += 2) {
+            above.push_back(items[i]);
+        }
+        // Levels below only gain capacity when a top level appears, so the walk goes on upwards
+        items.erase(items.begin(), items.begin() + static_cast<std::ptrdiff_t>(paired));
+    }
+}
+
+}  // namespace camelup::sim
@@ -0,0 +1,100 @@
+#include "camelup/snapshot/action_notation.hpp"
+
+#include <charconv>
+#include <stdexcept>
+#include <variant>
+
+namespace camelup::snapshot {
+
+namespace {
+
+constexpr char kCamelLetters[kCamelCount] = {'B', 'G', 'Y', 'O', 'W'};
+
+CamelId parse_camel(std::string_view text) {
+    if (text.size() == 1) {
+        for (int camel = 0; camel < kCamelCount; ++camel) {
+            if (kCamelLetters[camel] == text.front()) {
+                return static_cast<CamelId>(camel);
+            }
+        }
+    }
+    throw std::invalid_argument("unknown camel in action '" + std::string(text) + "'");
+}
+
+}  // namespace
+
+std::string to_notation(const Action& action) {
+    switch (action.type()) {
+        case ActionType::RollDie:
+            return "roll";
+        case ActionType::PlaceDesertTile: {
+            const auto payload = std::get<PlaceDesertTilePayload>(action.payload);
+            return "desert:" + std::to_string(payload.tile) + (payload.move_delta < 0 ? "-" : "+");
+        }
+        case ActionType::TakeLegTicket:
+            return std::string("ticket:") + kCamelLetters[std::get<TakeLegTicketPayload>(action.payload).camel];
+        case ActionType::BetWinner:
+            return std::string("winner:") + kCamelLetters[std::get<BetWinnerPayload>(action.payload).camel];
+        case ActionType::BetLoser:
+            return std::string("loser:") + kCamelLetters[std::get<BetLoserPayload>(action.payload).camel];
+    }
+    return "unknown";
+}
+
+std::string to_notation(const DieRoll& roll) {
+    return std::string("roll:") + kCamelLetters[roll.camel] + std::to_string(roll.distance);
+}
+
+Action action_from_notation(std::string_view token) {
+    const auto colon = token.find(':');
+    const auto kind = token.substr(0, colon);
+    const auto argument = colon == std::string_view::npos ? std::string_view{} : token.substr(colon + 1);
+
+    if (kind == "roll") {
+        DieRoll ignored;
+        if (!argument.empty() && !parse_roll(token, ignored)) {
+            throw std::invalid_argument("malformed roll outcome '" + std::string(token) + "'");
+        }
+        return Action::roll_die();
+    }
+    if (kind == "desert") {
+        if (argument.size() < 2 || (argument.back() != '+' && argument.back() != '-')) {
+            throw std::invalid_argument("desert action must look like desert:5+ or desert:5-");
+        }
+        int tile = 0;
+        const auto digits = argument.substr(0, argument.size() - 1);
+        const auto [ptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), tile);
+        if (ec != std::errc{} || ptr != digits.data() + digits.size()) {
+            throw std::invalid_argument("bad desert tile number");
+        }
+        return Action::place_desert_tile(tile, argument.back() == '-' ? -1 : 1);
+    }
+    if (kind == "ticket") {
+        return Action::take_leg_ticket(parse_camel(argument));
+    }
+    if (kind == "winner") {
+        return Action::bet_winner(parse_camel(argument));
+    }
+    if (kind == "loser") {
+        return Action::bet_loser(parse_camel(argument));
+    }
+    throw std::invalid_argument("unknown action '" + std::string(token) + "'");
+}
+
+bool parse_roll(std::string_view token, DieRoll& roll) {
+    if (token.size() != 7 || token.substr(0, 5) != "roll:") {
+        return false;
+    }
+    const int distance = token[6] - '0';
+    if (distance < 1 || distance > 3) {
+        return false;
+    }
+    try {
+        roll = {parse_camel(token.substr(5, 1)), distance};
+    } catch (const std::invalid_argument&) {
+        return false;
+    }
+    return true;
+}
+
+}  // namespace camelup::snapshot
@@ -0,0 +1,635 @@
+#include "camelup/snapshot/state_snapshot.hpp"
+
+#include <algorithm>  // find
+#include <charconv>
+#include <cstdlib>    // abs
+#include <stdexcept>
+#include <vector>
+
+#include "camelup/rules/legal_actions.hpp"
+
+namespace camelup::snapshot {
+
+namespace {
+
+constexpr char kCamelLetters[kCamelCount] = {'B', 'G', 'Y', 'O', 'W'};
+constexpr int kNotationFields = 11;
+
+// Sequential LSB-first bit packing into the snapshot bytes
+class BitWriter {
+public:
+    explicit BitWriter(StateSnapshot& bytes) : bytes_(bytes) {}
+
+    void put(std::uint32_t value, int bits) {
+        if (position_ + bits > static_cast<int>(kSnapshotBytes * 8)) {
+            throw std::length_error("state does not fit in snapshot");
+        }
+        for (int bit = 0; bit < bits; ++bit, ++position_) {
+            if ((value >> bit) & 1U) {
+                bytes_[position_ >> 3] = static_cast<std::uint8_t>(bytes_[position_ >> 3] | (1U << (position_ & 7)));
+            }
+        }
+    }
+
+private:
+    StateSnapshot& bytes_;
+    int position_{0};
+};
+
+class BitReader {
+public:
+    explicit BitReader(const StateSnapshot& bytes) : bytes_(bytes) {}
+
+    std::uint32_t get(int bits) {
+        if (position_ + bits > static_cast<int>(kSnapshotBytes * 8)) {
+            throw std::invalid_argument("snapshot ends inside a field");
+        }
+        std::uint32_t value = 0;
+        for (int bit = 0; bit < bits; ++bit, ++position_) {
+            value |= static_cast<std::uint32_t>((bytes_[position_ >> 3] >> (position_ & 7)) & 1U) << bit;
+        }
+        return value;
+    }
+
+private:
+    const StateSnapshot& bytes_;
+    int position_{0};
+};
+
+int ticket_value_index(int value) {
+    for (int idx = 0; idx < kLegTicketCount; ++idx) {
+        if (kLegTicketDefaults[idx] == value) {
+            return idx;
+        }
+    }
+    throw std::invalid_argument("leg ticket value has no snapshot encoding");
+}
+
+// Initialise every field that is not stored, before stored fields are filled in
+GameState blank_state(int player_count) {
+    GameState state;
+    state.player_count = player_count;
+    state.money.fill(kStartingMoney);
+    state.desert_tile_owner.fill(-1);
+    for (auto& values : state.leg_ticket_values) {
+        values = kLegTicketDefaults;
+    }
+    return state;
+}
+
+// Rebuild fields that are implied by stored ones
+void rebuild_derived_fields(GameState& state) {
+    state.desert_tile_owner.fill(-1);
+    for (int player = 0; player < state.player_count; ++player) {
+        const int tile = state.desert_tiles[player].tile;
+        if (tile >= 0) {
+            state.desert_tile_owner[tile] = player;
+        }
+    }
+
+    for (int player = 0; player < kMaxPlayers; ++player) {
+        const bool active_player = player < state.player_count;
+        state.winner_bet_card_available[player].fill(active_player);
+        state.loser_bet_card_available[player].fill(active_player);
+    }
+    for (const auto& card : state.winner_bet_stack) {
+        state.winner_bet_card_available[card.player][card.camel] = false;
+    }
+    for (const auto& card : state.loser_bet_stack) {
+        state.loser_bet_card_available[card.player][card.camel] = false;
+    }
+
+    rules::refresh_desert_legality(state);
+}
+
+void check_player_count(int player_count) {
+    if (player_count < 2 || player_count > kMaxPlayers) {
+        throw std::invalid_argument("player count out of range");
+    }
+}
+
+void check_bet_card(const FinalBetCard& card, int player_count) {
+    if (card.player >= player_count || card.camel >= kCamelCount) {
+        throw std::invalid_argument("bet card refers to unknown player or camel");
+    }
+}
+
+// Held tickets of each camel are the top of its supply: 5, then 3, then 2, however they were shared out
+void check_held_tickets(const GameState& state) {
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        std::array<int, kLegTicketCount> held{};
+        for (int player = 0; player < state.player_count; ++player) {
+            for (const auto& ticket : state.player_leg_tickets[player]) {
+                if (ticket.camel == camel) {
+                    ++held[ticket_value_index(ticket.value)];
+                }
+            }
+        }
+        const int taken = kLegTicketCount - state.leg_tickets_remaining[camel];
+        for (int idx = 0; idx < kLegTicketCount; ++idx) {
+            if (held[idx] != (idx < taken ? 1 : 0)) {
+                throw std::invalid_argument("held leg tickets disagree with leg tickets remaining");
+            }
+        }
+    }
+}
+
+// Desert tiles never share or touch a tile with another one, and camels never rest on them
+void check_desert_tiles(const GameState& state) {
+    for (int player = 0; player < state.player_count; ++player) {
+        const int tile = state.desert_tiles[player].tile;
+        if (tile < 0) {
+            continue;
+        }
+        if (!state.board[tile].empty()) {
+            throw std::invalid_argument("desert tile is on a tile with camels");
+        }
+        for (int other = player + 1; other < state.player_count; ++other) {
+            const int other_tile = state.desert_tiles[other].tile;
+            if (other_tile >= 0 && std::abs(other_tile - tile) <= 1) {
+                throw std::invalid_argument("desert tiles share or touch a tile");
+            }
+        }
+    }
+}
+
+// Split on a single separator, keeping empty pieces
+std::vector<std::string_view> split(std::string_view text, char separator) {
+    std::vector<std::string_view> parts;
+    std::size_t start = 0;
+    while (true) {
+        const auto end = text.find(separator, start);
+        parts.push_back(text.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start));
+        if (end == std::string_view::npos) {
+            return parts;
+        }
+        start = end + 1;
+    }
+}
+
+int parse_int(std::string_view text, const char* field) {
+    int value = 0;
+    const auto* end = text.data() + text.size();
+    const auto [ptr, ec] = std::from_chars(text.data(), end, value);
+    if (text.empty() || ec != std::errc{} || ptr != end) {
+        throw std::invalid_argument(std::string("bad number in ") + field + " field");
+    }
+    return value;
+}
+
+CamelId parse_camel(char letter) {
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        if (kCamelLetters[camel] == letter) {
+            return static_cast<CamelId>(camel);
+        }
+    }
+    throw std::invalid_argument(std::string("unknown camel letter '") + letter + "'");
+}
+
+void append_bet_stack(std::string& out, const std::vector<FinalBetCard>& stack) {
+    if (stack.empty()) {
+        out += '-';
+        return;
+    }
+    for (const auto& card : stack) {
+        out += static_cast<char>('0' + card.player);
+        out += kCamelLetters[card.camel];
+    }
+}
+
+std::vector<FinalBetCard> parse_bet_stack(std::string_view text, int player_count) {
+    std::vector<FinalBetCard> stack;
+    if (text == "-") {
+        return stack;
+    }
+    if (text.size() % 2 != 0) {
+        throw std::invalid_argument("bet stack must be player digit and camel letter pairs");
+    }
+    for (std::size_t i = 0; i < text.size(); i += 2) {
+        if (text[i] < '0' || text[i] > '9') {
+            throw std::invalid_argument("bet stack player must be a digit");
+        }
+        const FinalBetCard card{static_cast<PlayerId>(text[i] - '0'), parse_camel(text[i + 1])};
+        check_bet_card(card, player_count);
+        stack.push_back(card);
+    }
+    return stack;
+}
+
+}  // namespace
+
+StateSnapshot encode(const GameState& state) {
+    check_player_count(state.player_count);
+    if (state.current_player >= state.player_count) {
+        throw std::invalid_argument("current player out of range");
+    }
+    if (state.leg_number < 1 || state.leg_number > 256) {
+        throw std::length_error("leg number does not fit in snapshot");
+    }
+
+    StateSnapshot bytes{};
+    BitWriter out(bytes);
+    out.put(kSnapshotVersion, 4);
+    out.put(static_cast<std::uint32_t>(state.player_count - 2), 3);
+    out.put(state.current_player, 3);
+    out.put(state.terminal ? 1U : 0U, 1);
+    out.put(static_cast<std::uint32_t>(state.leg_number - 1), 8);
+
+    std::array<int, kCamelCount> camel_tile{};
+    std::array<int, kCamelCount> camel_height{};
+    camel_tile.fill(-1);
+    for (int tile = 0; tile < kBoardTiles; ++tile) {
+        const auto& stack = state.board[tile];
+        for (std::size_t idx = 0; idx < stack.size(); ++idx) {
+            if (stack[idx] >= kCamelCount || camel_tile[stack[idx]] >= 0) {
+                throw std::invalid_argument("board must hold each camel exactly once");
+            }
+            camel_tile[stack[idx]] = tile;
+            camel_height[stack[idx]] = static_cast<int>(idx);
+        }
+    }
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        if (camel_tile[camel] < 0) {
+            throw std::invalid_argument("board must hold each camel exactly once");
+        }
+        out.put(static_cast<std::uint32_t>(camel_tile[camel]), 5);
+        out.put(static_cast<std::uint32_t>(camel_height[camel]), 3);
+    }
+
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        out.put(state.die_available[camel] ? 1U : 0U, 1);
+    }
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        const int remaining = state.leg_tickets_remaining[camel];
+        if (remaining < 0 || remaining > kLegTicketCount || state.leg_ticket_values[camel] != kLegTicketDefaults) {
+            throw std::invalid_argument("leg ticket supply has no snapshot encoding");
+        }
+        out.put(static_cast<std::uint32_t>(remaining), 2);
+    }
+
+    for (int player = 0; player < state.player_count; ++player) {
+        const auto& placement = state.desert_tiles[player];
+        if (placement.tile < -1 || placement.tile >= kBoardTiles ||
+            (placement.move_delta != 1 && placement.move_delta != -1)) {
+            throw std::invalid_argument("desert tile has no snapshot encoding");
+        }
+        out.put(static_cast<std::uint32_t>(placement.tile + 1), 5);
+        out.put(placement.move_delta < 0 ? 1U : 0U, 1);
+
+        const int money = state.money[player];
+        if (money < -128 || money > 127) {
+            throw std::length_error("money does not fit in snapshot");
+        }
+        out.put(static_cast<std::uint32_t>(money) & 0xFFU, 8);
+    }
+
+    std::size_t held_count = 0;
+    for (int player = 0; player < state.player_count; ++player) {
+        held_count += state.player_leg_tickets[player].size();
+    }
+    if (held_count > 15) {
+        throw std::length_error("too many held leg tickets for snapshot");
+    }
+    out.put(static_cast<std::uint32_t>(held_count), 4);
+    for (int player = 0; player < state.player_count; ++player) {
+        for (const auto& ticket : state.player_leg_tickets[player]) {
+            if (ticket.camel >= kCamelCount) {
+                throw std::invalid_argument("leg ticket refers to unknown camel");
+            }
+            out.put(static_cast<std::uint32_t>(player), 3);
+            out.put(ticket.camel, 3);
+            out.put(static_cast<std::uint32_t>(ticket_value_index(ticket.value)), 2);
+        }
+    }
+
+    if (state.winner_bet_stack.size() > 63 || state.loser_bet_stack.size() > 63) {
+        throw std::length_error("too many bet cards for snapshot");
+    }
+    out.put(static_cast<std::uint32_t>(state.winner_bet_stack.size()), 6);
+    out.put(static_cast<std::uint32_t>(state.loser_bet_stack.size()), 6);
+    for (const auto* stack : {&state.winner_bet_stack, &state.loser_bet_stack}) {
+        for (const auto& card : *stack) {
+            check_bet_card(card, state.player_count);
+            out.put(card.player, 3);
+            out.put(card.camel, 3);
+        }
+    }
+    return bytes;
+}
+
+GameState decode(const StateSnapshot& snapshot) {
+    BitReader in(snapshot);
+    if (in.get(4) != kSnapshotVersion) {
+        throw std::invalid_argument("unsupported snapshot version");
+    }
+
+    GameState state = blank_state(static_cast<int>(in.get(3)) + 2);
+    state.current_player = static_cast<PlayerId>(in.get(3));
+    if (state.current_player >= state.player_count) {
+        throw std::invalid_argument("current player out of range");
+    }
+    state.terminal = in.get(1) != 0;
+    state.leg_number = static_cast<int>(in.get(8)) + 1;
+
+    std::array<std::array<int, kCamelCount>, kBoardTiles> slots{};
+    for (auto& tile_slots : slots) {
+        tile_slots.fill(-1);
+    }
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        const auto tile = in.get(5);
+        const auto height = in.get(3);
+        if (tile >= static_cast<std::uint32_t>(kBoardTiles) || height >= static_cast<std::uint32_t>(kCamelCount) ||
+            slots[tile][height] >= 0) {
+            throw std::invalid_argument("snapshot camel positions are inconsistent");
+        }
+        slots[tile][height] = camel;
+    }
+    for (int tile = 0; tile < kBoardTiles; ++tile) {
+        for (int height = 0; height < kCamelCount && slots[tile][height] >= 0; ++height) {
+            state.board[tile].push_back(static_cast<CamelId>(slots[tile][height]));
+        }
+    }
+    std::size_t placed = 0;
+    for (const auto& stack : state.board) {
+        placed += stack.size();
+    }
+    if (placed != static_cast<std::size_t>(kCamelCount)) {
+        throw std::invalid_argument("snapshot stack heights have gaps");
+    }
+
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        state.die_available[camel] = in.get(1) != 0;
+    }
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        state.leg_tickets_remaining[camel] = static_cast<int>(in.get(2));
+        if (state.leg_tickets_remaining[camel] > kLegTicketCount) {
+            throw std::invalid_argument("snapshot leg ticket supply out of range");
+        }
+    }
+
+    for (int player = 0; player < state.player_count; ++player) {
+        const int tile = static_cast<int>(in.get(5)) - 1;
+        const int move_delta = in.get(1) != 0 ? -1 : 1;
+        // Tiles are never placed on the start or the finish tile
+        if (tile == 0 || tile >= kBoardTiles - 1) {
+            throw std::invalid_argument("snapshot desert tile out of range");
+        }
+        state.desert_tiles[player] = {tile, move_delta};
+        state.money[player] = static_cast<std::int8_t>(in.get(8));
+    }
+
+    const auto held_count = in.get(4);
+    for (std::uint32_t i = 0; i < held_count; ++i) {
+        const auto player = in.get(3);
+        const auto camel = in.get(3);
+        const auto value_index = in.get(2);
+        if (player >= static_cast<std::uint32_t>(state.player_count) || camel >= static_cast<std::uint32_t>(kCamelCount) ||
+            value_index >= static_cast<std::uint32_t>(kLegTicketCount)) {
+            throw std::invalid_argument("snapshot leg ticket out of range");
+        }
+        state.player_leg_tickets[player].push_back({static_cast<CamelId>(camel), kLegTicketDefaults[value_index]});
+    }
+
+    const auto winner_count = in.get(6);
+    const auto loser_count = in.get(6);
+    for (auto [stack, count] : {std::pair{&state.winner_bet_stack, winner_count},
+                                std::pair{&state.loser_bet_stack, loser_count}}) {
+        stack->reserve(count);
+        for (std::uint32_t i = 0; i < count; ++i) {
+            const FinalBetCard card{static_cast<PlayerId>(in.get(3)), static_cast<CamelId>(in.get(3))};
+            check_bet_card(card, state.player_count);
+            stack->push_back(card);
+        }
+    }
+
+    // Shard and checkpoint files restore their start state from here, so the same positions
+    // from_notation refuses are refused too
+    check_held_tickets(state);
+    check_desert_tiles(state);
+    rebuild_derived_fields(state);
+    return state;
+}
+
+std::string to_notation(const GameState& state) {
+    check_player_count(state.player_count);
+    std::string out;
+
+    int empty_run = 0;
+    bool first_token = true;
+    const auto flush_empty = [&out, &empty_run, &first_token]() {
+        if (empty_run == 0) {
+            return;
+        }
+        out += first_token ? "" : "/";
+        out += std::to_string(empty_run);
+        empty_run = 0;
+        first_token = false;
+    };
+    for (int tile = 0; tile < kBoardTiles; ++tile) {
+        if (state.board[tile].empty()) {
+            ++empty_run;
+            continue;
+        }
+        flush_empty();
+        out += first_token ? "" : "/";
+        for (const auto camel : state.board[tile]) {
+            out += kCamelLetters[camel];
+        }
+        first_token = false;
+    }
+    flush_empty();
+
+    out += ' ';
+    bool any_die = false;
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        if (state.die_available[camel]) {
+            out += kCamelLetters[camel];
+            any_die = true;
+        }
+    }
+    if (!any_die) {
+        out += '-';
+    }
+
+    out += ' ';
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        out += std::to_string(state.leg_tickets_remaining[camel]);
+    }
+
+    out += ' ';
+    for (int player = 0; player < state.player_count; ++player) {
+        out += player > 0 ? "," : "";
+        const auto& placement = state.desert_tiles[player];
+        if (placement.tile < 0) {
+            out += '-';
+        } else {
+            out += std::to_string(placement.tile);
+            out += placement.move_delta < 0 ? '-' : '+';
+        }
+    }
+
+    out += ' ';
+    for (int player = 0; player < state.player_count; ++player) {
+        out += player > 0 ? "," : "";
+        out += std::to_string(state.money[player]);
+    }
+
+    out += ' ';
+    for (int player = 0; player < state.player_count; ++player) {
+        out += player > 0 ? "," : "";
+        const auto& tickets = state.player_leg_tickets[player];
+        if (tickets.empty()) {
+            out += '-';
+        }
+        for (const auto& ticket : tickets) {
+            out += kCamelLetters[ticket.camel];
+            out += std::to_string(ticket.value);
+        }
+    }
+
+    out += ' ';
+    append_bet_stack(out, state.winner_bet_stack);
+    out += ' ';
+    append_bet_stack(out, state.loser_bet_stack);
+
+    out += ' ';
+    out += std::to_string(state.current_player);
+    out += ' ';
+    out += std::to_string(state.leg_number);
+    out += ' ';
+    out += state.terminal ? 'T' : '-';
+    return out;
+}
+
+GameState from_notation(std::string_view notation) {
+    std::vector<std::string_view> fields;
+    for (const auto piece : split(notation, ' ')) {
+        if (!piece.empty()) {
+            fields.push_back(piece);
+        }
+    }
+    if (fields.size() != kNotationFields) {
+        throw std::invalid_argument("notation must have 11 space separated fields");
+    }
+
+    const auto money_fields = split(fields[4], ',');
+    const int player_count = static_cast<int>(money_fields.size());
+    check_player_count(player_count);
+    GameState state = blank_state(player_count);
+
+    int tile = 0;
+    for (const auto token : split(fields[0], '/')) {
+        if (token.empty()) {
+            throw std::invalid_argument("empty board token");
+        }
+        if (token.front() >= '0' && token.front() <= '9') {
+            tile += parse_int(token, "board");
+            continue;
+        }
+        if (tile >= kBoardTiles) {
+            throw std::invalid_argument("board runs past the final tile");
+        }
+        for (const char letter : token) {
+            state.board[tile].push_back(parse_camel(letter));
+        }
+        ++tile;
+    }
+    if (tile != kBoardTiles) {
+        throw std::invalid_argument("board must describe exactly 17 tiles");
+    }
+    std::array<bool, kCamelCount> seen{};
+    for (const auto& stack : state.board) {
+        for (const auto camel : stack) {
+            if (seen[camel]) {
+                throw std::invalid_argument("camel appears twice on board");
+            }
+            seen[camel] = true;
+        }
+    }
+    for (const bool present : seen) {
+        if (!present) {
+            throw std::invalid_argument("board is missing a camel");
+        }
+    }
+
+    if (fields[1] != "-") {
+        for (const char letter : fields[1]) {
+            state.die_available[parse_camel(letter)] = true;
+        }
+    }
+
+    if (fields[2].size() != static_cast<std::size_t>(kCamelCount)) {
+        throw std::invalid_argument("tickets field needs one digit per camel");
+    }
+    for (int camel = 0; camel < kCamelCount; ++camel) {
+        const int remaining = fields[2][camel] - '0';
+        if (remaining < 0 || remaining > kLegTicketCount) {
+            throw std::invalid_argument("leg tickets remaining out of range");
+        }
+        state.leg_tickets_remaining[camel] = remaining;
+    }
+
+    const auto desert_fields = split(fields[3], ',');
+    const auto held_fields = split(fields[5], ',');
+    if (static_cast<int>(desert_fields.size()) != player_count || static_cast<int>(held_fields.size()) != player_count) {
+        throw std::invalid_argument("per player fields disagree on player count");
+    }
+    for (int player = 0; player < player_count; ++player) {
+        const auto desert = desert_fields[player];
+        if (desert != "-") {
+            if (desert.size() < 2 || (desert.back() != '+' && desert.back() != '-')) {
+                throw std::invalid_argument("desert tile must be tile number followed by + or -");
+            }
+            const int desert_tile = parse_int(desert.substr(0, desert.size() - 1), "desert");
+            if (desert_tile <= 0 || desert_tile >= kBoardTiles - 1) {
+                throw std::invalid_argument("desert tile out of range");
+            }
+            state.desert_tiles[player] = {desert_tile, desert.back() == '-' ? -1 : 1};
+        }
+
+        state.money[player] = parse_int(money_fields[player], "money");
+
+        const auto held = held_fields[player];
+        if (held == "-") {
+            continue;
+        }
+        std::size_t pos = 0;
+        while (pos < held.size()) {
+            const CamelId camel = parse_camel(held[pos++]);
+            const auto digits_start = pos;
+            while (pos < held.size() && held[pos] >= '0' && held[pos] <= '9') {
+                ++pos;
+            }
+            const int value = parse_int(held.substr(digits_start, pos - digits_start), "held");
+            const auto* const known = std::find(kLegTicketDefaults.begin(), kLegTicketDefaults.end(), value);
+            if (known == kLegTicketDefaults.end()) {
+                throw std::invalid_argument("held leg ticket value must be 5, 3 or 2");
+            }
+            state.player_leg_tickets[player].push_back({camel, value});
+        }
+    }
+    check_held_tickets(state);
+    check_desert_tiles(state);
+
+    state.winner_bet_stack = parse_bet_stack(fields[6], player_count);
+    state.loser_bet_stack = parse_bet_stack(fields[7], player_count);
+
+    const int current_player = parse_int(fields[8], "player");
+    if (current_player < 0 || current_player >= player_count) {
+        throw std::invalid_argument("current player out of range");
+    }
+    state.current_player = static_cast<PlayerId>(current_player);
+    state.leg_number = parse_int(fields[9], "leg");
+    if (state.leg_number < 1) {
+        throw std::invalid_argument("leg number must be at least 1");
+    }
+    if (fields[10] != "-" && fields[10] != "T") {
+        throw std::invalid_argument("status must be '-' or 'T'");
+    }
+    state.terminal = fields[10] == "T";
+
+    rebuild_derived_fields(state);
+    return state;
+}
+
+}  // namespace camelup::snapshot
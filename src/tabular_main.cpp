@@ -0,0 +1,240 @@
+#include <algorithm>  // max, min
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "camelup/analysis/leg_odds.hpp"
+#include "camelup/analysis/race_odds.hpp"
+#include "camelup/analysis/tabular_eval.hpp"
+#include "camelup/packed_camels.hpp"
+#include "camelup/sim/batch.hpp"
+#include "camelup/sim/policy.hpp"
+
+namespace {
+
+// Evaluations timed in total, enough to make the clock resolution irrelevant
+constexpr int kTimedEvaluations = 2000000;
+
+bool parse_int_arg(const char* value, int& out) {
+    char* end = nullptr;
+    const long parsed = std::strtol(value, &end, 10);
+    if (end == value || *end != '\0') {
+        return false;
+    }
+    out = static_cast<int>(parsed);
+    return true;
+}
+
+void print_usage() {
+    std::cout << "Usage: camelup_tabular [--seed N] [--games N] [--players N] [--turn-limit N]\n"
+              << "                       [--policy roll|first|random|greedy] [--out PATH] [--table PATH]\n"
+              << "                       [--holdout GAMES] [--positions N] [--mc-samples N]\n";
+}
+
+// States a game passes through just before each die roll, with its final state
+struct PlayedGame {
+    std::vector<camelup::GameState> states;
+    camelup::GameState final_state;
+};
+
+PlayedGame play(const camelup::sim::BatchOptions& options, int game) {
+    PlayedGame played;
+    const auto outcome = camelup::sim::play_game(
+        options, game, [&](const camelup::GameState& state, const camelup::Action& action, int) {
+            if (action.type() == camelup::ActionType::RollDie) {
+                played.states.push_back(state);
+            }
+        });
+    played.final_state = outcome.final_state;
+    return played;
+}
+
+// Mean and worst absolute error of one probability column against its reference
+struct ErrorStats {
+    double total{0.0};
+    double squared{0.0};
+    double worst{0.0};
+    std::uint64_t count{0};
+
+    void add(const std::array<double, camelup::kCamelCount>& estimate,
+             const std::array<double, camelup::kCamelCount>& reference) {
+        for (int camel = 0; camel < camelup::kCamelCount; ++camel) {
+            const double error = std::fabs(estimate[camel] - reference[camel]);
+            total += error;
+            squared += error * error;
+            worst = std::max(worst, error);
+            ++count;
+        }
+    }
+};
+
+void print_error(const char* name, const ErrorStats& table, const ErrorStats& uniform) {
+    const double n = static_cast<double>(std::max<std::uint64_t>(table.count, 1));
+    std::cout << "  " << std::left << std::setw(8) << name << std::right << std::fixed << std::setprecision(4)
+              << "MAE " << table.total / n << "  RMSE " << std::sqrt(table.squared / n) << "  max " << table.worst
+              << "  (uniform MAE " << uniform.total / n << ")\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    camelup::sim::BatchOptions options;
+    // Random play reaches varied positions, but needs room to finish its games
+    options.policy = camelup::sim::Policy::RandomLegal;
+    options.turn_limit = 5000;
+    int games = 20000;
+    int holdout = 40;
+    int positions = 400;
+    int mc_samples = 4000;
+    std::string out_path = "camelup.tab";
+    std::string table_path;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--policy") {
+            if (!camelup::sim::parse_policy(argv[++i], options.policy)) {
+                print_usage();
+                return 1;
+            }
+            continue;
+        }
+        if (arg == "--out") {
+            out_path = argv[++i];
+            continue;
+        }
+        if (arg == "--table") {
+            table_path = argv[++i];
+            continue;
+        }
+
+        int parsed = 0;
+        if (!parse_int_arg(argv[++i], parsed) || parsed < 0) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--seed") {
+            options.seed = parsed;
+        } else if (arg == "--games") {
+            games = parsed;
+        } else if (arg == "--players") {
+            options.players = parsed;
+        } else if (arg == "--turn-limit") {
+            options.turn_limit = parsed;
+        } else if (arg == "--holdout") {
+            holdout = parsed;
+        } else if (arg == "--positions") {
+            positions = parsed;
+        } else if (arg == "--mc-samples") {
+            mc_samples = std::max(parsed, 1);
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+    if (options.players < 2 || options.players > camelup::kMaxPlayers) {
+        print_usage();
+        return 1;
+    }
+
+    try {
+        // Training games are 0 .. games-1, held-out games follow them
+        if (table_path.empty()) {
+            const auto start = std::chrono::steady_clock::now();
+            camelup::analysis::TabularTrainer trainer;
+            for (int game = 0; game < games; ++game) {
+                const auto played = play(options, game);
+                trainer.add_game(played.states, played.final_state);
+            }
+            trainer.write(out_path);
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Trained on " << trainer.games() << " finished games, " << trainer.samples()
+                      << " positions (" << seconds << " s), wrote " << out_path << '\n';
+            table_path = out_path;
+        }
+
+        const camelup::analysis::TabularEvaluator evaluator(table_path);
+        std::cout << "Table " << table_path << ": " << evaluator.file_bytes() << " bytes, " << evaluator.games()
+                  << " games, " << evaluator.samples() << " positions\n";
+
+        std::vector<camelup::GameState> held_out;
+        for (int game = games; game < games + holdout; ++game) {
+            auto played = play(options, game);
+            held_out.insert(held_out.end(), played.states.begin(), played.states.end());
+        }
+        // Spread the positions evenly over the held-out games
+        const std::size_t stride = std::max<std::size_t>(1, held_out.size() / std::max(positions, 1));
+        std::vector<camelup::GameState> sampled;
+        for (std::size_t i = 0; i < held_out.size() && sampled.size() < static_cast<std::size_t>(positions);
+             i += stride) {
+            sampled.push_back(held_out[i]);
+        }
+        if (sampled.empty()) {
+            std::cout << "No held-out positions\n";
+            return 0;
+        }
+
+        ErrorStats winner, loser, leg;
+        ErrorStats uniform_winner, uniform_loser, uniform_leg;
+        std::array<double, camelup::kCamelCount> uniform{};
+        uniform.fill(1.0 / camelup::kCamelCount);
+        for (std::size_t i = 0; i < sampled.size(); ++i) {
+            const auto& state = sampled[i];
+            const auto odds = evaluator.evaluate(state);
+            const auto race = camelup::analysis::race_odds(state, mc_samples, static_cast<std::uint32_t>(i + 1));
+            const auto exact = camelup::analysis::leg_odds(state);
+            std::array<double, camelup::kCamelCount> leader{};
+            for (int camel = 0; camel < camelup::kCamelCount; ++camel) {
+                leader[camel] = exact.first[camel] + exact.race_winner[camel];
+            }
+            winner.add(odds.winner, race.winner);
+            loser.add(odds.loser, race.loser);
+            leg.add(odds.leg, leader);
+            uniform_winner.add(uniform, race.winner);
+            uniform_loser.add(uniform, race.loser);
+            uniform_leg.add(uniform, leader);
+        }
+        std::cout << "Held out: " << holdout << " games, " << sampled.size()
+                  << " positions, race odds from " << mc_samples << " rollouts, leg leader exact\n";
+        print_error("winner", winner, uniform_winner);
+        print_error("loser", loser, uniform_loser);
+        print_error("leg", leg, uniform_leg);
+
+        // Time the packed path alone, inputs converted up front as a search would hold them
+        struct Packed {
+            camelup::PackedCamels camels;
+            std::uint8_t dice;
+            camelup::DesertDeltas desert;
+        };
+        std::vector<Packed> packed;
+        for (const auto& state : sampled) {
+            packed.push_back({camelup::PackedCamels::from_board(state.board), camelup::analysis::dice_mask(state),
+                              camelup::desert_deltas(state)});
+        }
+        const int repeats = std::max(1, kTimedEvaluations / static_cast<int>(packed.size()));
+        double checksum = 0.0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int repeat = 0; repeat < repeats; ++repeat) {
+            for (const auto& input : packed) {
+                checksum += evaluator.evaluate(input.camels, input.dice, input.desert).winner[0];
+            }
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double evaluations = static_cast<double>(repeats) * static_cast<double>(packed.size());
+        std::cout << "Evaluation: " << std::setprecision(1) << seconds * 1e9 / evaluations << " ns per position"
+                  << " (checksum " << std::setprecision(3) << checksum / evaluations << ")\n";
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "camelup_tabular failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
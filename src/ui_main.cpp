@@ -1,15 +1,28 @@
+#include <array>
+#include <cstdint>
 #include <cstdlib>
 #include <exception>
+#include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "camelup/actions.hpp"
+#include "camelup/analysis/live_analysis.hpp"
 #include "camelup/engine.hpp"
+#include "camelup/sim/game_history.hpp"
 #include "camelup/types.hpp"
 
 namespace {
 
+constexpr const char* kPrompt =
+    "Command: index, r=roll, a=auto-roll, o=odds, u=undo, n=redo, j N=jump to turn, m=main line, q=quit: ";
+
+// Actions listed in the live odds panel
+constexpr std::size_t kLiveTopActions = 3;
+
 char camel_symbol(camelup::CamelId camel) {
     switch (static_cast<camelup::Camel>(camel)) {
         case camelup::Camel::Blue:
@@ -197,10 +210,13 @@ int find_roll_action_index(const std::vector<camelup::Action>& actions) {
     return -1;
 }
 
-void print_status(const camelup::GameState& state, int turn) {
+void print_status(const camelup::sim::GameHistory& history, bool what_if) {
+    const auto& state = history.state();
     std::cout << "\n===== Camel Up v1 UI =====\n";
-    std::cout << "Turn: " << turn << " | Leg: " << state.leg_number
+    std::cout << "Turn: " << history.turn() << " | Leg: " << state.leg_number
               << " | Current player: P" << static_cast<int>(state.current_player) << '\n';
+    std::cout << "History: turns " << history.first_turn() << ".." << history.last_turn() << " ("
+              << history.memory_bytes() / 1024 << " KiB)" << (what_if ? " | what-if line, m=main line" : "") << '\n';
 
     std::cout << "Money: ";
     for (int p = 0; p < state.player_count; ++p) {
@@ -235,6 +251,40 @@ void print_status(const camelup::GameState& state, int turn) {
     print_final_bets(state);
 }
 
+void print_camel_odds(const char* label, const std::array<double, camelup::kCamelCount>& odds) {
+    std::cout << label;
+    for (camelup::CamelId camel = 0; camel < static_cast<camelup::CamelId>(camelup::kCamelCount); ++camel) {
+        std::cout << ' ' << camel_symbol(camel) << std::setw(4) << static_cast<int>(odds[camel] * 100.0 + 0.5) << '%';
+    }
+}
+
+void print_live_panel(const camelup::analysis::LiveSnapshot& snapshot) {
+    std::cout << "Live odds (exact leg, ";
+    if (snapshot.race.samples == 0) {
+        std::cout << "race pending)\n";
+    } else {
+        std::cout << "race " << snapshot.race.samples << " rollouts +/-" << std::fixed << std::setprecision(1)
+                  << snapshot.race_ci_width * 50.0 << "%" << (snapshot.final ? "" : ", refining") << ")\n";
+    }
+    print_camel_odds("  Leg 1st: ", snapshot.leg.first);
+    print_camel_odds("  | 2nd:", snapshot.leg.second);
+    std::cout << '\n';
+    if (snapshot.race.samples > 0) {
+        print_camel_odds("  Race win:", snapshot.race.winner);
+        print_camel_odds("  | lose:", snapshot.race.loser);
+        std::cout << '\n';
+    }
+    for (std::size_t i = 0; i < snapshot.actions.size() && i < kLiveTopActions; ++i) {
+        std::cout << (i == 0 ? "  Best EV: " : ", ") << action_label(snapshot.actions[i].action) << ' '
+                  << std::showpos << std::fixed << std::setprecision(2) << snapshot.actions[i].expected_value
+                  << std::noshowpos;
+    }
+    if (!snapshot.actions.empty()) {
+        std::cout << '\n';
+    }
+    std::cout << std::defaultfloat;
+}
+
 bool parse_int_arg(const char* value, int& out) {
     char* end = nullptr;
     const long parsed = std::strtol(value, &end, 10);
@@ -246,7 +296,7 @@ bool parse_int_arg(const char* value, int& out) {
 }
 
 void print_usage() {
-    std::cout << "Usage: camelup_ui [--seed N] [--players N] [--turn-limit N] [--auto]\n";
+    std::cout << "Usage: camelup_ui [--seed N] [--players N] [--turn-limit N] [--auto] [--no-live]\n";
 }
 
 }  // namespace
@@ -256,6 +306,7 @@ int main(int argc, char** argv) {
     int players = 2;
     int turn_limit = 200;
     bool auto_mode = false;
+    bool live_odds = true;
 
     for (int i = 1; i < argc; ++i) {
         const std::string arg = argv[i];
@@ -263,6 +314,10 @@ int main(int argc, char** argv) {
             auto_mode = true;
             continue;
         }
+        if (arg == "--no-live") {
+            live_odds = false;
+            continue;
+        }
         if (arg == "--seed" || arg == "--players" || arg == "--turn-limit") {
             if (i + 1 >= argc) {
                 print_usage();
@@ -288,19 +343,44 @@ int main(int argc, char** argv) {
     }
 
     camelup::Engine engine(static_cast<std::uint32_t>(seed));
-    camelup::GameState state;
+    std::optional<camelup::sim::GameHistory> history;
     try {
-        state = engine.new_game(players);
+        history.emplace(engine.new_game(players));
     } catch (const std::exception& ex) {
         std::cerr << "Failed to create game: " << ex.what() << '\n';
         return 1;
     }
+    // The line a what-if branch left, restored by m
+    std::optional<camelup::sim::GameHistory> main_line;
+
+    // The prompt and the live odds panel share the console, panels for a state no longer
+    // shown are dropped under the same lock
+    std::mutex console;
+    std::uint64_t shown_generation = 0;  // zero while nothing is being analysed
+    camelup::GameState analysed;
+    std::optional<camelup::analysis::LiveAnalysis> live;
+    if (live_odds && !auto_mode) {
+        live.emplace([&](const camelup::analysis::LiveSnapshot& snapshot) {
+            std::lock_guard<std::mutex> lock(console);
+            if (snapshot.generation != shown_generation) {
+                return;
+            }
+            std::cout << '\n';
+            print_live_panel(snapshot);
+            std::cout << kPrompt << std::flush;
+        });
+    }
 
-    int turn = 0;
-    while (!state.terminal && turn < turn_limit) {
-        print_status(state, turn);
+    while (true) {
+        const auto& state = history->state();
+        const bool finished = state.terminal || history->turn() >= static_cast<std::size_t>(turn_limit);
+        if (finished && auto_mode) {
+            break;
+        }
+        std::unique_lock<std::mutex> console_lock(console);
+        print_status(*history, main_line.has_value());
         const auto legal_actions = engine.legal_actions(state);
-        if (legal_actions.empty()) {
+        if (legal_actions.empty() && !state.terminal) {
             std::cout << "No legal actions available\n";
             break;
         }
@@ -311,14 +391,63 @@ int main(int argc, char** argv) {
         if (auto_mode) {
             chosen_index = roll_index >= 0 ? roll_index : 0;
         } else {
-            print_legal_actions(legal_actions);
-            std::cout << "Command: index, r=roll, a=auto-roll, q=quit: ";
+            if (finished) {
+                std::cout << (state.terminal ? "Game finished" : "Turn limit reached")
+                          << ", history commands still work\n";
+            } else {
+                print_legal_actions(legal_actions);
+            }
+            std::cout << kPrompt << std::flush;
+            // Analysis starts once the state is on screen, the worker prints its panels below the prompt
+            // Commands that leave the state alone keep the analysis already running
+            if (live && (shown_generation == 0 || analysed != state)) {
+                shown_generation = live->analyse(state);
+                analysed = state;
+            }
+            console_lock.unlock();
+
             std::string input;
-            if (!std::getline(std::cin, input)) {
+            const bool read = static_cast<bool>(std::getline(std::cin, input));
+            console_lock.lock();
+            if (!read || input == "q") {
                 break;
             }
-            if (input == "q") {
-                break;
+            if (input == "o") {
+                if (const auto snapshot = live ? live->latest() : std::nullopt) {
+                    print_live_panel(*snapshot);
+                } else {
+                    std::cout << (live ? "No odds yet\n" : "Live odds are off (--no-live)\n");
+                }
+                continue;
+            }
+            if (input == "u" || input == "n") {
+                if (!(input == "u" ? history->undo() : history->redo())) {
+                    std::cout << "Nothing to " << (input == "u" ? "undo" : "redo") << '\n';
+                }
+                continue;
+            }
+            if (input.rfind("j ", 0) == 0) {
+                int target = 0;
+                if (!parse_int_arg(input.c_str() + 2, target) || target < static_cast<int>(history->first_turn()) ||
+                    target > static_cast<int>(history->last_turn())) {
+                    std::cout << "Turn must be " << history->first_turn() << ".." << history->last_turn() << '\n';
+                    continue;
+                }
+                history->seek(static_cast<std::size_t>(target));
+                continue;
+            }
+            if (input == "m") {
+                if (!main_line) {
+                    std::cout << "Not on a what-if line\n";
+                    continue;
+                }
+                history = std::move(main_line);
+                main_line.reset();
+                continue;
+            }
+            if (finished) {
+                std::cout << "No actions after the end, undo or jump back first\n";
+                continue;
             }
             if (input == "a") {
                 auto_mode = true;
@@ -339,14 +468,29 @@ int main(int argc, char** argv) {
             }
         }
 
-        state = engine.apply_action(state, legal_actions[static_cast<std::size_t>(chosen_index)]);
-        ++turn;
+        // The analysis of the state being left is dropped before the action lands
+        if (live) {
+            live->cancel();
+            shown_generation = 0;
+        }
+        // Playing from an earlier turn starts a what-if line, the first branch keeps the line it left
+        if (history->can_redo() && !main_line) {
+            main_line = history;
+            std::cout << "What-if line from turn " << history->turn() << '\n';
+        }
+        history->apply(engine, legal_actions[static_cast<std::size_t>(chosen_index)]);
     }
 
-    print_status(state, turn);
-    if (state.terminal) {
+    // Joins the worker before the final status so no panel follows it
+    if (live) {
+        live->cancel();
+        shown_generation = 0;
+    }
+    live.reset();
+    print_status(*history, main_line.has_value());
+    if (history->state().terminal) {
         std::cout << "Game finished: a camel reached tile " << camelup::kBoardTiles - 1 << ".\n";
-    } else if (turn >= turn_limit) {
+    } else if (history->turn() >= static_cast<std::size_t>(turn_limit)) {
         std::cout << "Stopped at turn limit.\n";
     } else {
         std::cout << "Exited before terminal state.\n";
@@ -0,0 +1,166 @@
+#include "camelup/util/profile.hpp"
+
+#include <algorithm>  // find
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+namespace camelup::util::profile {
+
+namespace {
+
+struct ThreadCounters {
+    std::array<std::atomic<std::uint64_t>, kPhaseCount> count{};
+    std::array<std::atomic<std::uint64_t>, kPhaseCount> nanoseconds{};
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadCounters*> live;
+    Profile retired{};
+};
+
+// Never destroyed, threads may still exit after static destruction has started
+Registry& registry() {
+    static auto* instance = new Registry;
+    return *instance;
+}
+
+std::atomic<bool> enabled_flag{false};
+
+void add_into(Profile& totals, const ThreadCounters& counters) {
+    for (std::size_t phase = 0; phase < kPhaseCount; ++phase) {
+        totals[phase].count += counters.count[phase].load(std::memory_order_relaxed);
+        totals[phase].nanoseconds += counters.nanoseconds[phase].load(std::memory_order_relaxed);
+    }
+}
+
+// Registers the thread's counters on first use and folds them into the retired totals at exit
+struct ThreadSlot {
+    ThreadCounters counters;
+
+    ThreadSlot() {
+        auto& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.live.push_back(&counters);
+    }
+    ~ThreadSlot() {
+        auto& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        add_into(reg.retired, counters);
+        reg.live.erase(std::find(reg.live.begin(), reg.live.end(), &counters));
+    }
+};
+
+ThreadCounters& local_counters() {
+    thread_local ThreadSlot slot;
+    return slot.counters;
+}
+
+}  // namespace
+
+const char* phase_name(Phase phase) {
+    switch (phase) {
+        case Phase::LegalActions:
+            return "legal_actions";
+        case Phase::PolicySelect:
+            return "policy_select";
+        case Phase::ApplyRollDie:
+            return "apply_roll_die";
+        case Phase::ApplyPlaceDesertTile:
+            return "apply_place_desert_tile";
+        case Phase::ApplyTakeLegTicket:
+            return "apply_take_leg_ticket";
+        case Phase::ApplyBetWinner:
+            return "apply_bet_winner";
+        case Phase::ApplyBetLoser:
+            return "apply_bet_loser";
+        case Phase::RollDie:
+            return "roll_die";
+        case Phase::MoveCamelStack:
+            return "move_camel_stack";
+        case Phase::LegEnd:
+            return "leg_end";
+        case Phase::GamePayouts:
+            return "game_payouts";
+    }
+    return "unknown";
+}
+
+void set_enabled(bool enabled) noexcept {
+    enabled_flag.store(enabled, std::memory_order_relaxed);
+}
+
+bool enabled() noexcept {
+    return enabled_flag.load(std::memory_order_relaxed);
+}
+
+Profile collect() {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    Profile totals = reg.retired;
+    for (const auto* counters : reg.live) {
+        add_into(totals, *counters);
+    }
+    return totals;
+}
+
+// Counts recorded concurrently with a reset may survive it
+void reset() {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.retired = {};
+    for (auto* counters : reg.live) {
+        for (std::size_t phase = 0; phase < kPhaseCount; ++phase) {
+            counters->count[phase].store(0, std::memory_order_relaxed);
+            counters->nanoseconds[phase].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void print_table(std::ostream& out, const Profile& profile) {
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::left << std::setw(26) << "phase" << std::right << std::setw(14) << "calls" << std::setw(14)
+        << "total_ms" << std::setw(12) << "ns_per_call" << '\n';
+    for (std::size_t phase = 0; phase < kPhaseCount; ++phase) {
+        const auto& totals = profile[phase];
+        if (totals.count == 0) {
+            continue;
+        }
+        out << std::left << std::setw(26) << phase_name(static_cast<Phase>(phase)) << std::right << std::setw(14)
+            << totals.count << std::setw(14) << std::fixed << std::setprecision(3)
+            << static_cast<double>(totals.nanoseconds) / 1e6 << std::setw(12) << std::setprecision(1)
+            << static_cast<double>(totals.nanoseconds) / static_cast<double>(totals.count) << '\n';
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void write_json(std::ostream& out, const Profile& profile) {
+    out << '{';
+    for (std::size_t phase = 0; phase < kPhaseCount; ++phase) {
+        if (phase > 0) {
+            out << ',';
+        }
+        out << '"' << phase_name(static_cast<Phase>(phase)) << "\":{\"count\":" << profile[phase].count
+            << ",\"ns\":" << profile[phase].nanoseconds << '}';
+    }
+    out << '}';
+}
+
+namespace detail {
+
+void record(Phase phase, std::uint64_t nanoseconds) noexcept {
+    auto& counters = local_counters();
+    const auto index = static_cast<std::size_t>(phase);
+    auto& count = counters.count[index];
+    auto& total = counters.nanoseconds[index];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    total.store(total.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+}
+
+}  // namespace detail
+
+}  // namespace camelup::util::profile
@@ -0,0 +1,212 @@
+#include "camelup/util/trace.hpp"
+
+#include <algorithm>  // min
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace camelup::util::trace {
+
+namespace {
+
+struct Event {
+    const char* name{nullptr};
+    const char* category{nullptr};
+    std::int64_t start_ns{0};
+    std::int64_t duration_ns{0};
+};
+
+// Written by its own thread only, head is published with release so a reader sees whole events
+struct ThreadBuffer {
+    std::uint32_t tid{0};
+    std::string name;
+    std::atomic<std::uint64_t> generation{0};  // the recording `events` was sized for
+    std::vector<Event> events;
+    std::atomic<std::uint64_t> head{0};
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;  // kept after their thread exits
+};
+
+// Never destroyed, threads may still exit after static destruction has started
+Registry& registry() {
+    static auto* instance = new Registry;
+    return *instance;
+}
+
+std::atomic<bool> enabled_flag{false};
+std::atomic<std::uint64_t> current_generation{0};
+std::atomic<std::size_t> capacity{kDefaultEventsPerThread};
+std::atomic<std::int64_t> epoch_ns{0};
+
+std::int64_t steady_ns() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+ThreadBuffer& local_buffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+        auto created = std::make_shared<ThreadBuffer>();
+        auto& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        created->tid = static_cast<std::uint32_t>(reg.buffers.size() + 1);
+        reg.buffers.push_back(created);
+        return created;
+    }();
+    return *buffer;
+}
+
+// Drop spans of the previous recording and size the ring once, throws std::bad_alloc
+void begin_generation(ThreadBuffer& buffer, std::uint64_t generation) {
+    buffer.head.store(0, std::memory_order_relaxed);
+    buffer.events.assign(capacity.load(std::memory_order_relaxed), Event{});
+    buffer.generation.store(generation, std::memory_order_release);
+}
+
+void write_escaped(std::ostream& out, const std::string& text) {
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << (static_cast<unsigned char>(c) < 0x20 ? ' ' : c);
+    }
+}
+
+}  // namespace
+
+void start(std::size_t events_per_thread) {
+    if (events_per_thread == 0) {
+        throw std::invalid_argument("trace needs at least one event per thread");
+    }
+    capacity.store(events_per_thread, std::memory_order_relaxed);
+    epoch_ns.store(steady_ns(), std::memory_order_relaxed);
+    // Buffers from an older generation are cleared by their owner, here for the calling thread
+    // and on set_thread_name or the first span for the others
+    const auto generation = current_generation.fetch_add(1, std::memory_order_relaxed) + 1;
+    begin_generation(local_buffer(), generation);
+    enabled_flag.store(true, std::memory_order_release);
+}
+
+void stop() noexcept {
+    enabled_flag.store(false, std::memory_order_release);
+}
+
+bool enabled() noexcept {
+    return enabled_flag.load(std::memory_order_relaxed);
+}
+
+void set_thread_name(const std::string& name) {
+    auto& buffer = local_buffer();
+    buffer.name = name;
+    const auto generation = current_generation.load(std::memory_order_relaxed);
+    if (enabled() && buffer.generation.load(std::memory_order_relaxed) != generation) {
+        begin_generation(buffer, generation);
+    }
+}
+
+Stats stats() {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    Stats totals;
+    const auto generation = current_generation.load(std::memory_order_relaxed);
+    for (const auto& buffer : reg.buffers) {
+        if (buffer->generation.load(std::memory_order_acquire) != generation) {
+            continue;
+        }
+        const auto head = buffer->head.load(std::memory_order_acquire);
+        totals.recorded += head;
+        totals.dropped += head - std::min<std::uint64_t>(head, buffer->events.size());
+    }
+    return totals;
+}
+
+void write_json(std::ostream& out) {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    const auto generation = current_generation.load(std::memory_order_relaxed);
+    const auto epoch = epoch_ns.load(std::memory_order_relaxed);
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    const auto separate = [&out, &first]() {
+        if (!first) {
+            out << ",\n";
+        }
+        first = false;
+    };
+    out << std::fixed << std::setprecision(3);
+    for (const auto& buffer : reg.buffers) {
+        if (!buffer->name.empty()) {
+            separate();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"args\":{\"name\":\"";
+            write_escaped(out, buffer->name);
+            out << "\"}}";
+        }
+        if (buffer->generation.load(std::memory_order_acquire) != generation) {
+            continue;
+        }
+        // Oldest kept event first, timestamps in microseconds since start()
+        const auto head = buffer->head.load(std::memory_order_acquire);
+        const auto size = static_cast<std::uint64_t>(buffer->events.size());
+        for (std::uint64_t i = head - std::min(head, size); i < head; ++i) {
+            const auto& event = buffer->events[i % size];
+            separate();
+            out << "{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"ts\":" << static_cast<double>(event.start_ns - epoch) / 1e3
+                << ",\"dur\":" << static_cast<double>(event.duration_ns) / 1e3 << '}';
+        }
+    }
+    out << "],\"displayTimeUnit\":\"ms\"}\n";
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void write_file(const std::string& path) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("failed to open trace file: " + path);
+    }
+    write_json(out);
+    if (!out) {
+        throw std::runtime_error("failed to write trace file: " + path);
+    }
+}
+
+namespace detail {
+
+std::int64_t now_ns() noexcept {
+    return steady_ns();
+}
+
+void record(const char* name, const char* category, std::int64_t start_ns, std::int64_t end_ns) noexcept {
+    ThreadBuffer* buffer = nullptr;
+    try {
+        buffer = &local_buffer();
+        // Threads that did not name themselves since start() size their ring on the first span
+        const auto generation = current_generation.load(std::memory_order_relaxed);
+        if (buffer->generation.load(std::memory_order_relaxed) != generation) {
+            begin_generation(*buffer, generation);
+        }
+    } catch (...) {
+        // No memory for the ring, the span is dropped and the next one tries again
+        return;
+    }
+    const auto head = buffer->head.load(std::memory_order_relaxed);
+    buffer->events[head % buffer->events.size()] = {name, category, start_ns, end_ns - start_ns};
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+}  // namespace detail
+
+}  // namespace camelup::util::trace
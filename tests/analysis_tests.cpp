@@ -0,0 +1,535 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <variant>
+#include <vector>
+
+#include "camelup/actions.hpp"
+#include "camelup/analysis/action_values.hpp"
+#include "camelup/analysis/anytime.hpp"
+#include "camelup/analysis/common_random.hpp"
+#include "camelup/analysis/leg_odds.hpp"
+#include "camelup/analysis/live_analysis.hpp"
+#include "camelup/analysis/odds_cache.hpp"
+#include "camelup/analysis/qmc.hpp"
+#include "camelup/analysis/race_odds.hpp"
+#include "camelup/analysis/tabular_eval.hpp"
+#include "camelup/engine.hpp"
+#include "camelup/snapshot/action_notation.hpp"
+#include "camelup/snapshot/state_snapshot.hpp"
+#include "camelup/util/thread_pool.hpp"
+
+namespace {
+
+bool near(double lhs, double rhs, double tolerance = 1e-9) {
+    return std::fabs(lhs - rhs) <= tolerance;
+}
+
+double sum(const std::array<double, camelup::kCamelCount>& values) {
+    double total = 0.0;
+    for (const double value : values) {
+        total += value;
+    }
+    return total;
+}
+
+// Reference race finishes through the engine, winner on top of the leader and loser at the very back
+void count_finish(const camelup::GameState& finished, std::array<int, camelup::kCamelCount>& winner,
+                  std::array<int, camelup::kCamelCount>& loser) {
+    for (int tile = camelup::kBoardTiles - 1; tile >= 0; --tile) {
+        if (!finished.board[tile].empty()) {
+            ++winner[finished.board[tile].back()];
+            break;
+        }
+    }
+    for (const auto& stack : finished.board) {
+        if (!stack.empty()) {
+            ++loser[stack.front()];
+            break;
+        }
+    }
+}
+
+void assert_engine_race_odds(const camelup::GameState& state, int samples, std::uint32_t seed,
+                             camelup::analysis::RaceSampler sampler) {
+    std::array<int, camelup::kCamelCount> winner{};
+    std::array<int, camelup::kCamelCount> loser{};
+    camelup::Engine engine(seed);
+    camelup::analysis::QmcDiceSampler qmc(camelup::analysis::kQmcReplicatePoints, seed);
+    for (int sample = 0; sample < samples; ++sample) {
+        if (sampler == camelup::analysis::RaceSampler::Qmc) {
+            count_finish(qmc.play_out(state, sample), winner, loser);
+            continue;
+        }
+        auto rollout = state;
+        while (!rollout.terminal) {
+            rollout = engine.apply_action(rollout, camelup::Action::roll_die());
+        }
+        count_finish(rollout, winner, loser);
+    }
+    const auto odds = camelup::analysis::race_odds(state, samples, seed, sampler);
+    for (int camel = 0; camel < camelup::kCamelCount; ++camel) {
+        assert(odds.winner[camel] == static_cast<double>(winner[camel]) / samples);
+        assert(odds.loser[camel] == static_cast<double>(loser[camel]) / samples);
+    }
+}
+
+// Reference leg enumeration through the engine itself
+void engine_leg_odds(const camelup::GameState& state, double weight, camelup::analysis::LegOdds& odds) {
+    int available = 0;
+    for (const bool die : state.die_available) {
+        available += die ? 1 : 0;
+    }
+    for (camelup::CamelId camel = 0; camel < static_cast<camelup::CamelId>(camelup::kCamelCount); ++camel) {
+        if (!state.die_available[camel]) {
+            continue;
+        }
+        for (int distance = 1; distance <= 3; ++distance) {
+            const double branch = weight / (available * 3);
+            const auto next = camelup::Engine::apply_roll(state, {camel, distance});
+            if (next.terminal) {
+                odds.race_end += branch;
+            } else if (next.leg_number != state.leg_number) {
+                std::vector<camelup::CamelId> order;
+                for (int tile = camelup::kBoardTiles - 1; tile >= 0; --tile) {
+                    for (auto it = next.board[tile].rbegin(); it != next.board[tile].rend(); ++it) {
+                        order.push_back(*it);
+                    }
+                }
+                odds.first[order[0]] += branch;
+                odds.second[order[1]] += branch;
+            } else {
+                engine_leg_odds(next, branch, odds);
+            }
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    camelup::Engine engine(21);
+    const auto state = engine.new_game(3);
+
+    {
+        const auto odds = camelup::analysis::leg_odds(state);
+        // Five dice left: 5! orders times 3^5 distances, no camel can finish from tiles 1..3
+        assert(odds.outcomes == 120U * 243U);
+        assert(near(odds.race_end, 0.0));
+        assert(near(sum(odds.first), 1.0));
+        assert(near(sum(odds.second), 1.0));
+        for (int player = 0; player < state.player_count; ++player) {
+            assert(near(odds.desert_coins[player], 0.0));
+        }
+    }
+
+    {
+        // Single die left with Blue two tiles from the finish: distances 2 and 3 end the race
+        const auto late = camelup::snapshot::from_notation("10/G/Y/O/W/B/2 B 33333 -,- 3,3 -,- - - 0 4 -");
+        const auto odds = camelup::analysis::leg_odds(late);
+        assert(odds.outcomes == 3U);
+        assert(near(odds.race_end, 2.0 / 3.0));
+        assert(near(odds.race_winner[camelup::Camel::Blue], 2.0 / 3.0));
+        assert(near(odds.first[camelup::Camel::Blue], 1.0 / 3.0));
+        assert(near(odds.second[camelup::Camel::White], 1.0 / 3.0));
+    }
+
+    {
+        // Oasis directly in front of a lone camel pays its owner on one distance in three
+        auto placed = camelup::snapshot::from_notation("10/G/Y/O/W/B/2 B 33333 -,15+ 3,3 -,- - - 0 4 -");
+        const auto odds = camelup::analysis::leg_odds(placed);
+        assert(near(odds.desert_coins[1], 1.0 / 3.0));
+        assert(near(odds.desert_coins[0], 0.0));
+        double landings = 0.0;
+        for (const double tile : odds.landings) {
+            landings += tile;
+        }
+        assert(near(landings, 1.0));
+
+        // One coin on a third of the outcomes
+        const auto moments = camelup::analysis::desert_coin_moments(placed, 1);
+        assert(near(moments.mean, 1.0 / 3.0) && near(moments.variance, 2.0 / 9.0));
+    }
+
+    {
+        // Mid-leg position with both desert tile kinds agrees with enumerating through the engine
+        const auto mid = camelup::snapshot::from_notation("3/BG/2/Y/1/O/W/7 GYW 33333 5-,7+ 3,3 -,- - - 0 2 -");
+        camelup::analysis::LegOdds reference;
+        engine_leg_odds(mid, 1.0, reference);
+        const auto odds = camelup::analysis::leg_odds(mid);
+        assert(near(odds.race_end, reference.race_end));
+        for (int camel = 0; camel < camelup::kCamelCount; ++camel) {
+            assert(near(odds.first[camel], reference.first[camel]));
+            assert(near(odds.second[camel], reference.second[camel]));
+        }
+        assert(odds.desert_coins[0] > 0.0 && odds.desert_coins[1] > 0.0);
+        for (camelup::PlayerId player = 0; player < 2; ++player) {
+            const auto moments = camelup::analysis::desert_coin_moments(mid, player);
+            assert(near(moments.mean, odds.desert_coins[player]) && moments.variance > 0.0);
+        }
+    }
+
+    {
+        const auto odds = camelup::analysis::race_odds(state, 200, 5);
+        assert(odds.samples == 200);
+        assert(near(sum(odds.winner), 1.0));
+        assert(near(sum(odds.loser), 1.0));
+
+        // Same seed gives the same estimate
+        const auto again = camelup::analysis::race_odds(state, 200, 5);
+        assert(again.winner == odds.winner);
+    }
+
+    {
+        const auto leg = camelup::analysis::leg_odds(state);
+        const auto race = camelup::analysis::race_odds(state, 200, 5);
+        const auto ranked = camelup::analysis::rank_actions(state, leg, race);
+        assert(ranked.size() == engine.legal_actions(state).size());
+        for (std::size_t i = 1; i < ranked.size(); ++i) {
+            assert(ranked[i - 1].expected_value >= ranked[i].expected_value);
+        }
+        // Something beats the one coin for rolling at the start of a leg
+        assert(ranked.front().expected_value > 1.0);
+
+        const auto roll = camelup::analysis::evaluate_action(state, camelup::Action::roll_die(), leg, race);
+        assert(near(roll.expected_value, 1.0));
+    }
+
+    {
+        // Parallel analysis values actions exactly like rank_actions and adds their spread
+        const auto leg = camelup::analysis::leg_odds(state);
+        const auto race = camelup::analysis::race_odds(state, 200, 5);
+        const auto ranked = camelup::analysis::rank_actions(state, leg, race);
+        camelup::util::ThreadPool pool(3);
+        const auto analysed = camelup::analysis::analyse_actions(state, leg, race, pool);
+        assert(analysed.size() == ranked.size());
+        int desert = 0;
+        for (std::size_t i = 0; i < ranked.size(); ++i) {
+            const auto& estimate = analysed[i];
+            assert(estimate.action == ranked[i].action && near(estimate.expected_value, ranked[i].expected_value));
+            assert(estimate.exact && estimate.variance >= 0.0);
+            switch (estimate.action.type()) {
+                case camelup::ActionType::RollDie:
+                    assert(estimate.variance == 0.0);
+                    break;
+                case camelup::ActionType::BetWinner: {
+                    const double p = race.winner[std::get<camelup::BetWinnerPayload>(estimate.action.payload).camel];
+                    assert(near(estimate.variance, 81.0 * p * (1.0 - p)));
+                    break;
+                }
+                case camelup::ActionType::PlaceDesertTile:
+                    ++desert;
+                    assert(estimate.variance > 0.0);
+                    break;
+                default:
+                    break;
+            }
+        }
+        assert(desert > 0);
+
+        // Past the deadline only desert tiles fall back to the landing estimate
+        const auto rushed = camelup::analysis::analyse_actions(state, leg, race, pool,
+                                                               std::chrono::steady_clock::now());
+        assert(rushed.size() == analysed.size());
+        for (const auto& estimate : rushed) {
+            const bool is_desert = estimate.action.type() == camelup::ActionType::PlaceDesertTile;
+            assert(estimate.exact == !is_desert);
+            if (!is_desert) {
+                const auto same = std::find_if(analysed.begin(), analysed.end(),
+                                               [&](const auto& other) { return other.action == estimate.action; });
+                assert(same->expected_value == estimate.expected_value && same->variance == estimate.variance);
+            } else {
+                assert(estimate.expected_value >= 0.0 && estimate.variance == estimate.expected_value);
+            }
+        }
+    }
+
+    {
+        // Refining in batches continues the same stream as one fixed-count run
+        camelup::analysis::RaceOddsEstimator estimator(state, 5);
+        estimator.refine(120);
+        estimator.refine(80);
+        const auto odds = estimator.interim();
+        assert(odds.samples == 200);
+        assert(odds.winner == camelup::analysis::race_odds(state, 200, 5).winner);
+
+        const auto wider = camelup::analysis::wilson_interval(10, 20, 1.96);
+        const auto narrower = camelup::analysis::wilson_interval(100, 200, 1.96);
+        assert(wider.low < 0.5 && wider.high > 0.5);
+        assert(narrower.width() < wider.width());
+        assert(camelup::analysis::wilson_interval(0, 0, 1.96).width() == 1.0);
+    }
+
+    {
+        camelup::analysis::AnytimeBudget budget;
+        budget.max_samples = 300;
+        budget.batch_samples = 50;
+        camelup::analysis::RaceOddsEstimator capped(state, 9);
+        auto report = camelup::analysis::run_anytime(capped, budget);
+        assert(report.reason == camelup::analysis::AnytimeStop::SampleBudget);
+        assert(report.samples == 300 && capped.samples() == 300);
+
+        budget.max_samples = 1000000;
+        budget.target_ci_width = 0.2;
+        camelup::analysis::RaceOddsEstimator targeted(state, 9);
+        report = camelup::analysis::run_anytime(targeted, budget);
+        assert(report.reason == camelup::analysis::AnytimeStop::TargetWidth);
+        assert(report.ci_width <= 0.2 && report.samples < 1000000);
+
+        camelup::analysis::RaceOddsEstimator timed(state, 9);
+        const auto timed_report = camelup::analysis::run_anytime(
+            timed, camelup::analysis::budget_within(std::chrono::milliseconds(5), 100000000));
+        assert(timed_report.reason == camelup::analysis::AnytimeStop::Deadline);
+
+        std::atomic<bool> cancel{true};
+        camelup::analysis::RaceOddsEstimator cancelled(state, 9);
+        report = camelup::analysis::run_anytime(cancelled, camelup::analysis::AnytimeBudget{}, &cancel);
+        assert(report.reason == camelup::analysis::AnytimeStop::Cancelled);
+        assert(report.samples == 0);
+    }
+
+    {
+        // The anytime search agrees with the one-shot ranking on exact actions and settles on a move
+        camelup::analysis::AnytimeActionSearch search(state, 5);
+        assert(!search.decided(1.96));
+        const auto report = camelup::analysis::run_anytime(
+            search, camelup::analysis::budget_within(std::chrono::seconds(10), 20000));
+        assert(report.reason == camelup::analysis::AnytimeStop::Decided);
+
+        const auto leg = camelup::analysis::leg_odds(state);
+        const auto race = camelup::analysis::race_odds(state, search.samples(), 5);
+        const auto ranked = camelup::analysis::rank_actions(state, leg, race);
+        const auto interim = search.interim();
+        assert(interim.size() == ranked.size());
+        for (std::size_t i = 0; i < ranked.size(); ++i) {
+            assert(camelup::snapshot::to_notation(interim[i].action) ==
+                   camelup::snapshot::to_notation(ranked[i].action));
+            assert(near(interim[i].expected_value, ranked[i].expected_value));
+        }
+    }
+
+    {
+        std::mt19937 rng(3);
+        const auto stream = camelup::analysis::draw_dice_stream(rng);
+        assert(static_cast<int>(stream.size()) == camelup::analysis::kDiceStreamLegs);
+        for (const auto& leg : stream) {
+            std::array<bool, camelup::kCamelCount> seen{};
+            for (int i = 0; i < camelup::kCamelCount; ++i) {
+                seen[leg.order[i]] = true;
+                assert(leg.distance[i] >= 1 && leg.distance[i] <= 3);
+            }
+            assert(std::all_of(seen.begin(), seen.end(), [](bool camel) { return camel; }));
+        }
+        const auto mirror = camelup::analysis::antithetic(stream);
+        assert(mirror[0].order[0] == stream[0].order[camelup::kCamelCount - 1]);
+        assert(mirror[0].distance[2] == 4 - stream[0].distance[2]);
+
+        // Playing out is a pure function of the stream
+        const auto finished = camelup::analysis::play_out(state, stream);
+        assert(finished.terminal);
+        assert(finished == camelup::analysis::play_out(state, stream));
+        assert(camelup::analysis::simulate_action(state, camelup::Action::roll_die(), stream) ==
+               finished.money[state.current_player] - state.money[state.current_player]);
+    }
+
+    {
+        // Identical candidates on shared dice have no gap noise at all, independent dice do
+        const std::vector<camelup::Action> twins = {camelup::Action::roll_die(), camelup::Action::roll_die()};
+        camelup::analysis::SimulationOptions options;
+        options.rollouts = 20;
+        auto values = camelup::analysis::compare_actions(state, twins, options);
+        assert(values[0].expected_value == values[1].expected_value);
+        assert(values[1].gap_std_error == 0.0);
+        options.common_dice = false;
+        values = camelup::analysis::compare_actions(state, twins, options);
+        assert(values[1].gap_std_error > 0.0);
+
+        options.common_dice = true;
+        options.antithetic = true;
+        const auto ranked = camelup::analysis::rank_actions_simulated(state, options);
+        assert(ranked.size() == engine.legal_actions(state).size());
+        for (std::size_t i = 1; i < ranked.size(); ++i) {
+            assert(ranked[i - 1].expected_value >= ranked[i].expected_value);
+        }
+    }
+
+    {
+        std::array<double, camelup::analysis::kQmcDimensionsPerLeg> low{};
+        const auto first = camelup::analysis::dice_from_point(low.data());
+        assert(first.order[0] == 0 && first.order[4] == 4 && first.distance[2] == 1);
+        std::array<double, camelup::analysis::kQmcDimensionsPerLeg> high{};
+        high.fill(0.999);
+        const auto last = camelup::analysis::dice_from_point(high.data());
+        assert(last.order[0] == 4 && last.distance[2] == 3);
+
+        bool threw = false;
+        try {
+            (void)camelup::analysis::lattice_generator(100, 9);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        assert(threw);
+
+        // A full replicate hits every distance bucket evenly in each coordinate
+        camelup::analysis::QmcDiceSampler sampler(256, 11);
+        std::array<int, 3> buckets{};
+        for (int i = 0; i < 256; ++i) {
+            ++buckets[sampler.stream(i)[0].distance[0] - 1];
+        }
+        for (const int bucket : buckets) {
+            assert(bucket == 85 || bucket == 86);
+        }
+        assert(sampler.play_out(state, 300) == camelup::analysis::play_out(state, sampler.stream(300)));
+
+        const auto random = camelup::analysis::race_odds(state, 2000, 5);
+        const auto qmc = camelup::analysis::race_odds(state, 2000, 5, camelup::analysis::RaceSampler::Qmc);
+        assert(qmc.samples == 2000);
+        assert(near(sum(qmc.winner), 1.0) && near(sum(qmc.loser), 1.0));
+        assert(qmc.winner == camelup::analysis::race_odds(state, 2000, 5, camelup::analysis::RaceSampler::Qmc).winner);
+        for (int camel = 0; camel < camelup::kCamelCount; ++camel) {
+            assert(near(qmc.winner[camel], random.winner[camel], 0.06));
+            assert(near(qmc.loser[camel], random.loser[camel], 0.06));
+        }
+
+        // Packed rollouts follow the engine's own rollouts draw for draw
+        assert_engine_race_odds(state, 500, 5, camelup::analysis::RaceSampler::Random);
+        assert_engine_race_odds(state, 500, 5, camelup::analysis::RaceSampler::Qmc);
+        auto desert_state = state;
+        desert_state = engine.apply_action(desert_state, camelup::Action::place_desert_tile(5, -1));
+        desert_state = engine.apply_action(desert_state, camelup::Action::place_desert_tile(8, 1));
+        assert_engine_race_odds(desert_state, 500, 6, camelup::analysis::RaceSampler::Random);
+        assert_engine_race_odds(desert_state, 500, 6, camelup::analysis::RaceSampler::Qmc);
+
+        // Intervals come from replicate spread once two replicates are complete
+        camelup::analysis::RaceOddsEstimator estimator(state, 5, camelup::analysis::RaceSampler::Qmc);
+        estimator.refine(camelup::analysis::kQmcReplicatePoints * 4);
+        const auto interval = estimator.winner_interval(camelup::Camel::Blue, 1.96);
+        assert(interval.low <= estimator.interim().winner[camelup::Camel::Blue]);
+        assert(interval.high >= estimator.interim().winner[camelup::Camel::Blue]);
+        assert(estimator.ci_width(1.96) > 0.0 && estimator.ci_width(1.96) < 0.2);
+    }
+
+    {
+        camelup::analysis::OddsCache cache(64);
+        const auto first = cache.leg_odds(state);
+        auto with_money = state;
+        with_money.money[0] += 10;
+        const auto second = cache.leg_odds(with_money);
+        assert(first.first == second.first);
+        assert(cache.stats().hits == 1);
+        assert(cache.stats().misses == 1);
+
+        auto moved = camelup::Engine::apply_roll(state, {camelup::Camel::Blue, 1});
+        assert(!(camelup::analysis::odds_key(moved) == camelup::analysis::odds_key(state)));
+    }
+
+    {
+        // Live analysis publishes exact leg odds, then race stages until the final one, and a
+        // new state replaces the running analysis
+        std::mutex mutex;
+        std::condition_variable published;
+        std::vector<camelup::analysis::LiveSnapshot> snapshots;
+        camelup::analysis::LiveAnalysisOptions options;
+        options.first_race_samples = 64;
+        options.stage_growth = 4;
+        options.max_race_samples = 1024;
+        camelup::analysis::LiveAnalysis live(
+            [&](const camelup::analysis::LiveSnapshot& snapshot) {
+                std::lock_guard<std::mutex> lock(mutex);
+                snapshots.push_back(snapshot);
+                published.notify_all();
+            },
+            options);
+        const auto wait_final = [&](std::uint64_t generation) {
+            std::unique_lock<std::mutex> lock(mutex);
+            return published.wait_for(lock, std::chrono::seconds(60), [&] {
+                return !snapshots.empty() && snapshots.back().generation == generation && snapshots.back().final;
+            });
+        };
+
+        const auto moved = camelup::Engine::apply_roll(state, {camelup::Camel::Blue, 1});
+        live.analyse(state);
+        const auto generation = live.analyse(moved);
+        assert(generation == live.generation() && wait_final(generation));
+        std::vector<int> samples;
+        for (const auto& snapshot : snapshots) {
+            if (snapshot.generation == generation) {
+                samples.push_back(snapshot.race.samples);
+            }
+        }
+        assert((samples == std::vector<int>{0, 64, 256, 1024}));
+        const auto& last = snapshots.back();
+        assert(last.leg.first == camelup::analysis::leg_odds(moved).first);
+        assert(last.actions.size() == camelup::Engine().legal_actions(moved).size());
+        assert(last.race_ci_width > 0.0 && last.race_ci_width < 0.2);
+        assert(live.latest() && live.latest()->generation == generation && live.latest()->final);
+
+        live.cancel();
+        assert(!live.latest() && live.generation() == generation + 1);
+    }
+
+    {
+        // Tables trained on a few roll-only games load back through mmap and give distributions
+        camelup::analysis::TabularTrainer trainer;
+        camelup::Engine trainer_engine(8);
+        for (int game = 0; game < 40; ++game) {
+            std::vector<camelup::GameState> states;
+            auto played = trainer_engine.new_game(2);
+            while (!played.terminal) {
+                states.push_back(played);
+                played = trainer_engine.apply_action(played, camelup::Action::roll_die());
+            }
+            assert(trainer.add_game(states, played));
+            assert(!trainer.add_game(states, states.back()));
+        }
+        assert(trainer.games() == 40 && trainer.samples() > 40);
+
+        const auto path = (std::filesystem::temp_directory_path() / "camelup_analysis_tests.tab").string();
+        trainer.write(path);
+        {
+            const camelup::analysis::TabularEvaluator evaluator(path);
+            assert(evaluator.games() == 40 && evaluator.samples() == trainer.samples());
+            const auto odds = evaluator.evaluate(state);
+            assert(near(sum(odds.winner), 1.0) && near(sum(odds.loser), 1.0) && near(sum(odds.leg), 1.0));
+            const auto packed = camelup::PackedCamels::from_board(state.board);
+            const auto desert = camelup::desert_deltas(state);
+            const auto fast = evaluator.evaluate(packed, camelup::analysis::dice_mask(state), desert);
+            assert(fast.winner == odds.winner && fast.leg == odds.leg);
+
+            // A camel's own die is part of its cell
+            const auto leader = packed.leader();
+            assert(camelup::analysis::tabular_cell(packed, 0x1F, desert, leader) !=
+                   camelup::analysis::tabular_cell(packed, 0x1F & ~(1U << leader), desert, leader));
+        }
+
+        std::filesystem::resize_file(path, sizeof(camelup::analysis::TabularHeader) + 10);
+        bool threw = false;
+        try {
+            const camelup::analysis::TabularEvaluator truncated(path);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << "not a table, just some bytes padding the header";
+        threw = false;
+        try {
+            const camelup::analysis::TabularEvaluator foreign(path);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+        std::filesystem::remove(path);
+    }
+
+    return 0;
+}
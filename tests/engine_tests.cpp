@@ -1,11 +1,21 @@
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
+#include <random>
+#include <sstream>
 #include <stdexcept>
+#include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "camelup/actions.hpp"
 #include "camelup/engine.hpp"
+#include "camelup/packed_camels.hpp"
+#include "camelup/persistent_state.hpp"
+#include "camelup/rules/legal_actions.hpp"
+#include "camelup/util/profile.hpp"
 
 namespace {
 
@@ -185,6 +195,7 @@ int main() {
         const auto camel = modified.board[source_tile][source_idx];
         modified.board[source_tile].erase(modified.board[source_tile].begin() + source_idx);
         modified.board[7].push_back(camel);
+        camelup::rules::refresh_desert_legality(modified);
         const auto modified_legal = engine.legal_actions(modified);
         assert(!has_desert_placement_on_tile(modified_legal, 4));
         assert(!has_desert_placement_on_tile(modified_legal, 5));
@@ -197,6 +208,7 @@ int main() {
         const auto current_player = modified.current_player;
         modified.desert_tile_owner[8] = current_player;
         modified.desert_tiles[current_player] = {8, 1};
+        camelup::rules::refresh_desert_legality(modified);
         const auto modified_legal = engine.legal_actions(modified);
         assert(has_desert_placement_on_tile(modified_legal, 7));
         assert(has_desert_placement_on_tile(modified_legal, 8));
@@ -229,6 +241,7 @@ int main() {
         auto modified = state;
         modified.desert_tile_owner[4] = 0;
         modified.desert_tiles[0] = {4, 1};
+        camelup::rules::refresh_desert_legality(modified);
         const auto after_move = engine.apply_action(modified, camelup::Action::place_desert_tile(7, -1));
         assert(after_move.desert_tile_owner[4] == -1);
         assert(after_move.desert_tile_owner[7] == 0);
@@ -251,6 +264,7 @@ int main() {
         auto modified = state;
         modified.desert_tile_owner[5] = 1;
         modified.desert_tiles[1] = {5, 1};
+        camelup::rules::refresh_desert_legality(modified);
         bool threw = false;
         try {
             static_cast<void>(engine.apply_action(modified, camelup::Action::place_desert_tile(4, 1)));
@@ -534,5 +548,210 @@ int main() {
     state = engine.apply_action(state, camelup::Action::roll_die());
     assert(state.leg_number == 2);
 
+    {
+        // In-place try_apply and apply_unchecked agree with apply_action, including the dice they draw,
+        // and try_apply leaves the state untouched when it refuses an action
+        camelup::Engine copying(31);
+        camelup::Engine checked(31);
+        camelup::Engine unchecked(31);
+        std::mt19937 rng(8);
+        for (int game = 0; game < 50; ++game) {
+            auto reference = copying.new_game(2 + game % 7);
+            auto in_place = checked.new_game(2 + game % 7);
+            auto trusted = unchecked.new_game(2 + game % 7);
+            while (!reference.terminal) {
+                const auto legal = copying.legal_actions(reference);
+                const auto action = legal[std::uniform_int_distribution<std::size_t>(0, legal.size() - 1)(rng)];
+                reference = copying.apply_action(reference, action);
+                camelup::DieRoll checked_roll{};
+                camelup::DieRoll unchecked_roll{};
+                assert(checked.try_apply(in_place, action, &checked_roll) == camelup::ApplyError::None);
+                unchecked.apply_unchecked(trusted, action, &unchecked_roll);
+                assert(in_place == reference && trusted == reference);
+                assert(checked_roll.camel == unchecked_roll.camel && checked_roll.distance == unchecked_roll.distance);
+            }
+        }
+
+        auto state = engine.new_game(3);
+        state.leg_tickets_remaining[camelup::Camel::Blue] = 0;
+        state.winner_bet_card_available[state.current_player][camelup::Camel::Green] = false;
+        state.loser_bet_card_available[state.current_player][camelup::Camel::Orange] = false;
+        const auto before = state;
+        const std::pair<camelup::Action, camelup::ApplyError> refused[] = {
+            {camelup::Action::place_desert_tile(0, 1), camelup::ApplyError::IllegalDesertTile},
+            {camelup::Action::take_leg_ticket(camelup::Camel::Blue), camelup::ApplyError::IllegalLegTicket},
+            {camelup::Action::bet_winner(camelup::Camel::Green), camelup::ApplyError::IllegalWinnerBet},
+            {camelup::Action::bet_loser(camelup::Camel::Orange), camelup::ApplyError::IllegalLoserBet},
+        };
+        for (const auto& [action, expected] : refused) {
+            assert(engine.try_apply(state, action) == expected);
+            assert(state == before);
+            bool threw = false;
+            try {
+                static_cast<void>(engine.apply_action(state, action));
+            } catch (const std::invalid_argument& error) {
+                threw = std::string(error.what()) == camelup::apply_error_message(expected);
+            }
+            assert(threw);
+        }
+    }
+
+    {
+        // Persistent states materialise to the engine's states and share every block an action leaves alone
+        camelup::Engine tree_engine(12);
+        camelup::Engine reference_engine(12);
+        std::mt19937 rng(3);
+        for (int game = 0; game < 30; ++game) {
+            auto reference = reference_engine.new_game(2 + game % 7);
+            camelup::PersistentState node(tree_engine.new_game(2 + game % 7));
+            assert(node.materialise() == reference);
+            while (!reference.terminal) {
+                const auto legal = reference_engine.legal_actions(reference);
+                const auto action = legal[std::uniform_int_distribution<std::size_t>(0, legal.size() - 1)(rng)];
+                reference = reference_engine.apply_action(reference, action);
+                const auto child = node.apply(tree_engine, action);
+                assert(child.materialise() == reference && child == camelup::PersistentState(reference));
+
+                const bool leg_ended = child.leg_number() != node.leg_number() || child.terminal();
+                const auto type = action.type();
+                if (!leg_ended) {
+                    assert((&child.tickets() == &node.tickets()) == (type != camelup::ActionType::TakeLegTicket));
+                }
+                const bool bet = type == camelup::ActionType::BetWinner || type == camelup::ActionType::BetLoser;
+                assert(bet || child.terminal() || &child.bets() == &node.bets());
+                if (type == camelup::ActionType::PlaceDesertTile) {
+                    const auto& place = std::get<camelup::PlaceDesertTilePayload>(action.payload);
+                    const auto placed = child.desert_tile(node.current_player());
+                    assert(placed.tile == place.tile && placed.move_delta == place.move_delta);
+                }
+                node = child;
+            }
+        }
+    }
+
+    {
+        // Incrementally kept desert masks match the placement rule on randomised games
+        camelup::Engine random_engine(2024);
+        std::mt19937 rng(99);
+        for (int game = 0; game < 100; ++game) {
+            auto current = random_engine.new_game(2 + game % 7);
+            while (!current.terminal) {
+                for (int player = 0; player < camelup::kMaxPlayers; ++player) {
+                    for (int tile = 0; tile < camelup::kBoardTiles; ++tile) {
+                        const bool in_mask = (current.desert_legal_tiles[player] >> tile) & 1u;
+                        assert(in_mask == camelup::rules::is_legal_desert_tile_placement(
+                                              current, tile, static_cast<camelup::PlayerId>(player)));
+                    }
+                }
+                auto refreshed = current;
+                camelup::rules::refresh_desert_legality(refreshed);
+                assert(refreshed == current);
+
+                // Half the turns roll so games finish, the rest favour desert placements
+                const auto legal = random_engine.legal_actions(current);
+                const auto pick = std::uniform_int_distribution<std::size_t>(0, legal.size() - 1)(rng);
+                const bool roll = std::bernoulli_distribution(0.5)(rng);
+                current = random_engine.apply_action(current, roll ? camelup::Action::roll_die() : legal[pick]);
+            }
+        }
+    }
+
+    {
+        // Packed camel moves match the engine's stacks, desert tiles included
+        camelup::Engine random_engine(77);
+        std::mt19937 rng(5);
+        for (int game = 0; game < 200; ++game) {
+            auto current = random_engine.new_game(2 + game % 7);
+            while (!current.terminal) {
+                const auto packed = camelup::PackedCamels::from_board(current.board);
+                std::array<std::vector<camelup::CamelId>, camelup::kBoardTiles> round_trip;
+                packed.to_board(round_trip);
+                assert(round_trip == current.board);
+
+                const auto legal = random_engine.legal_actions(current);
+                const auto pick = std::uniform_int_distribution<std::size_t>(0, legal.size() - 1)(rng);
+                if (legal[pick].type() != camelup::ActionType::RollDie) {
+                    current = random_engine.apply_action(current, legal[pick]);
+                    continue;
+                }
+                camelup::CamelId camel = 0;
+                do {
+                    camel = static_cast<camelup::CamelId>(std::uniform_int_distribution<int>(0, 4)(rng));
+                } while (!current.die_available[camel]);
+                const camelup::DieRoll roll{camel, std::uniform_int_distribution<int>(1, 3)(rng)};
+
+                auto moved = packed;
+                const int landing = moved.move(roll.camel, roll.distance, camelup::desert_deltas(current));
+                assert(landing == std::min(packed.tile(roll.camel) + roll.distance, camelup::kBoardTiles - 1));
+                current = camelup::Engine::apply_roll(current, roll);
+                assert(moved == camelup::PackedCamels::from_board(current.board));
+                assert(moved.finished() == current.terminal);
+            }
+        }
+
+        // A mirage straight back onto the starting tile slides the carried camels underneath
+        auto state = camelup::Engine(3).new_game(2);
+        for (auto& stack : state.board) {
+            stack.clear();
+        }
+        state.board[1] = {camelup::Camel::Blue, camelup::Camel::Green, camelup::Camel::Yellow};
+        state.board[3] = {camelup::Camel::Orange, camelup::Camel::White};
+        state.desert_tile_owner[2] = 0;
+        state.desert_tiles[0] = {2, -1};
+        auto packed = camelup::PackedCamels::from_board(state.board);
+        assert(packed.move(camelup::Camel::Green, 1, camelup::desert_deltas(state)) == 2);
+        std::array<std::vector<camelup::CamelId>, camelup::kBoardTiles> board;
+        packed.to_board(board);
+        assert((board[1] == std::vector<camelup::CamelId>{camelup::Camel::Green, camelup::Camel::Yellow,
+                                                          camelup::Camel::Blue}));
+        assert(packed.leader() == camelup::Camel::White && packed.last() == camelup::Camel::Green);
+
+        bool threw = false;
+        state.board[3].pop_back();
+        try {
+            (void)camelup::PackedCamels::from_board(state.board);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+
+    if constexpr (camelup::util::profile::kCompiledIn) {
+        // Phase counters follow the engine calls and survive the recording thread
+        namespace profile = camelup::util::profile;
+        profile::reset();
+        profile::set_enabled(true);
+        std::thread worker([] {
+            camelup::Engine worker_engine(8);
+            auto game = worker_engine.new_game(3);
+            while (!game.terminal) {
+                game = worker_engine.apply_action(game, camelup::Action::roll_die());
+            }
+        });
+        worker.join();
+        profile::set_enabled(false);
+
+        const auto totals = profile::collect();
+        const auto count = [&totals](profile::Phase phase) { return totals[static_cast<std::size_t>(phase)].count; };
+        assert(count(profile::Phase::ApplyRollDie) > 0);
+        assert(count(profile::Phase::MoveCamelStack) == count(profile::Phase::ApplyRollDie));
+        // The opening setup rolls every die once more
+        assert(count(profile::Phase::RollDie) == count(profile::Phase::ApplyRollDie) + camelup::kCamelCount);
+        assert(count(profile::Phase::GamePayouts) == 1);
+        assert(count(profile::Phase::LegEnd) >= 1);
+        assert(count(profile::Phase::LegalActions) == 0);
+
+        // Disabled scopes record nothing
+        (void)engine.apply_action(engine.new_game(2), camelup::Action::roll_die());
+        assert(profile::collect()[static_cast<std::size_t>(profile::Phase::ApplyRollDie)].count ==
+               count(profile::Phase::ApplyRollDie));
+
+        std::ostringstream json;
+        profile::write_json(json, totals);
+        assert(json.str().find("\"game_payouts\":{\"count\":1,") != std::string::npos);
+        profile::reset();
+        assert(profile::collect()[static_cast<std::size_t>(profile::Phase::GamePayouts)].count == 0);
+    }
+
     return 0;
 }
@@ -0,0 +1,130 @@
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "camelup/data/feature_dataset.hpp"
+#include "camelup/engine.hpp"
+
+namespace {
+
+std::string temp_path(const char* name) {
+    return std::string("camelup_") + name + ".bin";
+}
+
+// Whether a view refuses a copy of the file at `path` with `bytes` written at `offset`
+bool view_rejects_patch(const std::string& path, std::size_t offset, const void* bytes, std::size_t size) {
+    std::vector<char> contents;
+    {
+        std::ifstream in(path, std::ios::binary);
+        contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    std::memcpy(contents.data() + offset, bytes, size);
+    const std::string patched = path + ".patched";
+    {
+        std::ofstream out(patched, std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    }
+    bool rejected = false;
+    try {
+        camelup::data::FeatureDatasetView view(patched);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    std::remove(patched.c_str());
+    return rejected;
+}
+
+}  // namespace
+
+int main() {
+    const std::string path = temp_path("feature_dataset_tests");
+
+    // Small row groups so the test crosses several groups and ends on a partial one
+    std::vector<camelup::GameState> recorded;
+    std::vector<camelup::GameState> finals;
+    {
+        camelup::data::FeatureDatasetWriter writer(path, 16);
+        for (std::uint32_t game = 0; game < 3; ++game) {
+            camelup::Engine engine(100 + game);
+            auto state = engine.new_game(3);
+            std::uint16_t turn = 0;
+            while (!state.terminal && turn < 200) {
+                writer.record_turn(state, game, turn);
+                recorded.push_back(state);
+                state = engine.apply_action(state, camelup::Action::roll_die());
+                ++turn;
+            }
+            writer.finish_game(state);
+            for (std::uint16_t i = 0; i < turn; ++i) {
+                finals.push_back(state);
+            }
+        }
+        // Rows of an unfinished game carry no labels and are not written
+        camelup::Engine engine(5);
+        writer.record_turn(engine.new_game(2), 99, 0);
+        writer.close();
+        assert(writer.rows_written() == recorded.size());
+    }
+
+    {
+        camelup::data::FeatureDatasetView view(path);
+        assert(view.row_count() == recorded.size());
+        assert(view.rows_per_group() == 16);
+        assert(view.column_count() == camelup::data::feature_columns().size());
+        assert(view.find_column("no_such_column") < 0);
+
+        const int tile_col = view.find_column("camel_tile");
+        const int money_col = view.find_column("money");
+        const int winner_col = view.find_column("race_winner");
+        assert(tile_col >= 0 && money_col >= 0 && winner_col >= 0);
+
+        for (std::uint64_t i = 0; i < view.row_count(); ++i) {
+            const auto& state = recorded[i];
+            const auto expected = camelup::data::extract_features(state);
+            const auto row = view.row(i);
+            for (int camel = 0; camel < camelup::kCamelCount; ++camel) {
+                assert(row.camel_tile[camel] == expected.camel_tile[camel]);
+                assert(row.camel_height[camel] == expected.camel_height[camel]);
+                assert(view.value<std::int8_t>(tile_col, i, camel) == expected.camel_tile[camel]);
+            }
+            assert(row.die_mask == expected.die_mask);
+            assert(row.current_player == state.current_player);
+            assert(view.value<std::int16_t>(money_col, i, 1) == state.money[1]);
+
+            const auto& final_state = finals[i];
+            assert(row.final_money[0] == final_state.money[0]);
+            assert(final_state.terminal);
+            const auto winner = view.value<std::uint8_t>(winner_col, i);
+            assert(winner == final_state.board[camelup::kBoardTiles - 1].back());
+        }
+    }
+
+    {
+        // Corrupt headers and column tables are rejected before anything is read through them
+        using camelup::data::FeatureColumnDesc;
+        using camelup::data::FeatureDatasetHeader;
+        const std::uint32_t zero = 0;
+        assert(view_rejects_patch(path, offsetof(FeatureDatasetHeader, rows_per_group), &zero, sizeof(zero)));
+        const std::uint32_t columns = 1U << 30;
+        assert(view_rejects_patch(path, offsetof(FeatureDatasetHeader, column_count), &columns, sizeof(columns)));
+        const std::uint32_t data_offset = 1U << 30;
+        assert(view_rejects_patch(path, offsetof(FeatureDatasetHeader, data_offset), &data_offset,
+                                  sizeof(data_offset)));
+        const std::uint64_t group_bytes = std::uint64_t{1} << 40;
+        assert(view_rejects_patch(path, offsetof(FeatureDatasetHeader, group_bytes), &group_bytes,
+                                  sizeof(group_bytes)));
+        const std::uint32_t group_offset = 1U << 30;
+        assert(view_rejects_patch(path, sizeof(FeatureDatasetHeader) + offsetof(FeatureColumnDesc, group_offset),
+                                  &group_offset, sizeof(group_offset)));
+    }
+
+    std::remove(path.c_str());
+    return 0;
+}
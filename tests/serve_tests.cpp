@@ -0,0 +1,250 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "camelup/engine.hpp"
+#include "camelup/serve/server.hpp"
+#include "camelup/snapshot/state_snapshot.hpp"
+#include "camelup/util/trace.hpp"
+
+namespace {
+
+bool starts_with(const std::string& text, const std::string& prefix) {
+    return text.compare(0, prefix.size(), prefix) == 0;
+}
+
+std::vector<std::string> lines_of(const std::string& text) {
+    std::vector<std::string> lines;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+// Connect once the listener is up
+int connect_socket(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = -1;
+    for (int attempt = 0; attempt < 200; ++attempt) {
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+            break;
+        }
+        ::close(fd);
+        fd = -1;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(fd >= 0);
+    return fd;
+}
+
+// Read until the server closes the connection
+std::string read_all(int fd) {
+    std::string received;
+    char buffer[4096];
+    ssize_t got = 0;
+    while ((got = ::read(fd, buffer, sizeof(buffer))) > 0) {
+        received.append(buffer, static_cast<std::size_t>(got));
+    }
+    return received;
+}
+
+// Local stand-in for a frontend: connect, send every request, read until the server closes
+std::string run_socket_client(const std::string& path, const std::string& requests) {
+    const int fd = connect_socket(path);
+    const ssize_t sent = ::send(fd, requests.data(), requests.size(), 0);
+    assert(sent == static_cast<ssize_t>(requests.size()));
+    ::shutdown(fd, SHUT_WR);
+    const auto received = read_all(fd);
+    ::close(fd);
+    return received;
+}
+
+}  // namespace
+
+int main() {
+    camelup::Engine engine(9);
+    const auto state = engine.new_game(2);
+    const auto position = camelup::snapshot::to_notation(state);
+
+    camelup::serve::ServerOptions options;
+    options.threads = 4;
+    options.race_samples = 100;
+    camelup::serve::Server server(options);
+
+    {
+        const auto legal = server.handle("legal | " + position);
+        assert(starts_with(legal, "ok roll desert:"));
+        assert(legal.find("ticket:B") != std::string::npos);
+
+        const auto applied = server.handle("apply ticket:G | " + position);
+        assert(starts_with(applied, "ok "));
+        const auto after = camelup::snapshot::from_notation(applied.substr(3));
+        assert(after.player_leg_tickets[0].size() == 1);
+        assert(after.current_player == 1);
+
+        const auto rolled = server.handle("apply roll:W3 | " + position);
+        assert(camelup::snapshot::from_notation(rolled.substr(3)) ==
+               camelup::Engine::apply_roll(state, {camelup::Camel::White, 3}));
+        // Random rolls are reproducible for identical requests
+        assert(server.handle("apply roll | " + position) == server.handle("apply roll | " + position));
+
+        assert(starts_with(server.handle("leg | " + position), "ok first "));
+        assert(starts_with(server.handle("race 50 | " + position), "ok winner "));
+        const auto best = server.handle("best | " + position);
+        assert(starts_with(best, "ok ") && best.find(" roll=1") != std::string::npos);
+        const auto timed = server.handle("best 20 | " + position);
+        assert(starts_with(timed, "ok ") && timed.find(" samples ") != std::string::npos);
+        assert(starts_with(server.handle("best 0 | " + position), "error "));
+
+        assert(starts_with(server.handle("legal"), "error "));
+        assert(starts_with(server.handle("fly | " + position), "error "));
+        assert(starts_with(server.handle("apply desert:0+ | " + position), "error "));
+        assert(starts_with(server.handle("legal | not a position"), "error "));
+    }
+
+    {
+        // Pipelined requests come back in request order even when they finish out of order
+        std::string requests;
+        std::vector<std::string> expected;
+        auto current = state;
+        for (int i = 0; i < 40; ++i) {
+            const auto current_position = camelup::snapshot::to_notation(current);
+            if (i % 3 == 0) {
+                requests += "leg | " + current_position + "\n";
+                expected.push_back("ok first ");
+            } else if (i % 3 == 1) {
+                requests += "legal | " + current_position + "\n";
+                expected.push_back("ok roll");
+            } else {
+                requests += "bogus\n";
+                expected.push_back("error ");
+            }
+            const auto next = engine.apply_action(current, camelup::Action::roll_die());
+            if (!next.terminal) {
+                current = next;
+            }
+        }
+
+        std::istringstream in(requests);
+        std::ostringstream out;
+        server.serve(in, out);
+        const auto responses = lines_of(out.str());
+        assert(responses.size() == expected.size());
+        for (std::size_t i = 0; i < responses.size(); ++i) {
+            assert(starts_with(responses[i], expected[i]));
+        }
+
+        // One slot per connection answers the same way, one request at a time
+        auto single = options;
+        single.max_in_flight = 1;
+        camelup::serve::Server single_server(single);
+        std::istringstream single_in(requests);
+        std::ostringstream single_out;
+        single_server.serve(single_in, single_out);
+        assert(lines_of(single_out.str()) == responses);
+
+        single.max_in_flight = 0;
+        bool rejected = false;
+        try {
+            camelup::serve::Server unusable(single);
+        } catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        assert(rejected);
+    }
+
+    {
+        // Warm cache: repeating leg queries hits the memo
+        const auto before = server.cache_stats();
+        for (int i = 0; i < 20; ++i) {
+            static_cast<void>(server.handle("leg | " + position));
+        }
+        const auto after = server.cache_stats();
+        assert(after.hits - before.hits == 20);
+        const auto leg_latency = server.latency(camelup::serve::QueryKind::Leg);
+        assert(leg_latency.count >= 21);
+    }
+
+    {
+        const std::string path = "camelup_serve_tests.sock";
+        std::thread listener([&server, &path]() { server.serve_unix_socket(path); });
+        const auto received = run_socket_client(path, "legal | " + position + "\nleg | " + position + "\nnope\n");
+        // Each accept joins the threads of connections that have closed
+        for (int client = 0; client < 5; ++client) {
+            assert(lines_of(run_socket_client(path, "legal | " + position + "\n")).size() == 1);
+        }
+        assert(server.connection_threads() <= 1);
+        server.stop();
+        listener.join();
+
+        const auto responses = lines_of(received);
+        assert(responses.size() == 3);
+        assert(responses[0] == server.handle("legal | " + position));
+        assert(starts_with(responses[1], "ok first "));
+        assert(starts_with(responses[2], "error "));
+    }
+
+    {
+        // stop() ends connections whose client stays silent, so the server can be destroyed
+        const std::string path = "camelup_serve_tests_idle.sock";
+        int idle = -1;
+        {
+            camelup::serve::Server idle_server(options);
+            std::thread listener([&idle_server, &path]() { idle_server.serve_unix_socket(path); });
+            idle = connect_socket(path);
+            while (idle_server.connection_threads() == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            idle_server.stop();
+            listener.join();
+        }
+        assert(read_all(idle).empty());
+        ::close(idle);
+    }
+
+    {
+        // Traced requests land on the worker threads, each ring keeps only its newest spans
+        camelup::util::trace::start(4);
+        std::istringstream in("leg | " + position + "\nrace 30 | " + position + "\n");
+        std::ostringstream out;
+        camelup::serve::Server traced(options);
+        traced.serve(in, out);
+        for (int i = 0; i < 10; ++i) {
+            CAMELUP_TRACE_SPAN("ring", "test");
+        }
+        camelup::util::trace::stop();
+        CAMELUP_TRACE_SPAN("after_stop", "test");
+
+        const auto stats = camelup::util::trace::stats();
+        assert(stats.recorded >= 12 && stats.dropped >= 6);
+        std::ostringstream json;
+        camelup::util::trace::write_json(json);
+        const auto trace = json.str();
+        assert(starts_with(trace, "{\"traceEvents\":["));
+        assert(trace.find("\"name\":\"request\",\"cat\":\"serve\",\"ph\":\"X\"") != std::string::npos);
+        assert(trace.find("\"args\":{\"name\":\"pool worker\"}") != std::string::npos);
+        assert(trace.find("after_stop") == std::string::npos);
+        int ring_spans = 0;
+        for (auto at = trace.find("\"ring\""); at != std::string::npos; at = trace.find("\"ring\"", at + 1)) {
+            ++ring_spans;
+        }
+        assert(ring_spans == 4);
+    }
+
+    return 0;
+}
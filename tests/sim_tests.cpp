@@ -0,0 +1,630 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "camelup/engine.hpp"
+#include "camelup/reference_engine.hpp"
+#include "camelup/rules/legal_actions.hpp"
+#include "camelup/sim/batch.hpp"
+#include "camelup/sim/checkpoint.hpp"
+#include "camelup/sim/differential.hpp"
+#include "camelup/sim/game_history.hpp"
+#include "camelup/sim/game_record.hpp"
+#include "camelup/sim/game_stream.hpp"
+#include "camelup/sim/perft.hpp"
+#include "camelup/sim/policy.hpp"
+#include "camelup/sim/policy_memo.hpp"
+#include "camelup/sim/record_codec.hpp"
+#include "camelup/sim/self_play.hpp"
+#include "camelup/sim/shard_file.hpp"
+#include "camelup/sim/sketch.hpp"
+#include "camelup/snapshot/state_snapshot.hpp"
+#include "camelup/util/mpsc_queue.hpp"
+
+namespace {
+
+template <typename Fn>
+bool throws_runtime_error(Fn&& fn) {
+    try {
+        fn();
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+template <typename Fn>
+bool throws_invalid_argument(Fn&& fn) {
+    try {
+        fn();
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+int main() {
+    {
+        camelup::sim::Histogram histogram(4, 10);
+        for (const int value : {0, 5, 12, 29, 35, 400}) {
+            histogram.record(value);
+        }
+        assert(histogram.count() == 6);
+        assert((histogram.buckets() == std::vector<std::uint64_t>{2, 1, 1, 2}));
+        assert(std::fabs(histogram.mean() - 481.0 / 6.0) < 1e-12);
+        assert(histogram.quantile(0.0) == 0 && histogram.quantile(0.5) == 10 && histogram.quantile(1.0) == 30);
+
+        camelup::sim::Histogram other(4, 10);
+        other.record(15);
+        histogram.merge(other);
+        assert(histogram.buckets()[1] == 2 && histogram.count() == 7);
+        assert(throws_invalid_argument([&]() { histogram.merge(camelup::sim::Histogram(5, 10)); }));
+    }
+
+    {
+        // Ranks stay within a few k-ths of the truth while memory stays small
+        std::vector<double> values(100000);
+        std::iota(values.begin(), values.end(), 0.0);
+        std::mt19937 rng(3);
+        std::shuffle(values.begin(), values.end(), rng);
+
+        camelup::sim::KllSketch sketch;
+        camelup::sim::KllSketch first_half;
+        camelup::sim::KllSketch second_half;
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            sketch.update(values[i]);
+            (i < values.size() / 2 ? first_half : second_half).update(values[i]);
+        }
+        first_half.merge(second_half);
+        assert(sketch.count() == 100000 && first_half.count() == 100000);
+        assert(sketch.min() == 0.0 && sketch.max() == 99999.0);
+        assert(sketch.retained() < 2000);
+        for (const auto* estimate : {&sketch, &first_half}) {
+            for (const double rank : {0.01, 0.1, 0.5, 0.9, 0.99}) {
+                assert(std::fabs(estimate->quantile(rank) - rank * 100000.0) < 2000.0);
+            }
+        }
+
+        // Same inputs, same sketch
+        camelup::sim::KllSketch again;
+        for (const double value : values) {
+            again.update(value);
+        }
+        assert(again == sketch);
+
+        assert(throws_invalid_argument([&]() { sketch.merge(camelup::sim::KllSketch(64)); }));
+        bool threw = false;
+        try {
+            (void)camelup::sim::KllSketch().quantile(0.5);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+
+    {
+        camelup::sim::Policy policy = camelup::sim::Policy::RollOnly;
+        assert(camelup::sim::parse_policy("random", policy) && policy == camelup::sim::Policy::RandomLegal);
+        assert(camelup::sim::parse_policy("greedy", policy) && policy == camelup::sim::Policy::Greedy);
+        assert(!camelup::sim::parse_policy("smart", policy) && policy == camelup::sim::Policy::Greedy);
+        assert(std::string_view(camelup::sim::policy_name(camelup::sim::Policy::FirstLegal)) == "first");
+        assert(std::string_view(camelup::sim::policy_name(camelup::sim::Policy::Greedy)) == "greedy");
+    }
+
+    {
+        // The policy memo hits on rollouts from one position and never changes a game
+        camelup::Engine engine(8);
+        auto late = engine.new_game(3);
+        while (late.leg_number < 3 && !late.terminal) {
+            late = engine.apply_action(late, camelup::Action::roll_die());
+        }
+        auto other = late;
+        other.money[1] += 1;
+        assert(camelup::sim::policy_memo::state_hash(late) == camelup::sim::policy_memo::state_hash(late));
+        assert(camelup::sim::policy_memo::state_hash(late) != camelup::sim::policy_memo::state_hash(other));
+
+        camelup::sim::BatchOptions options;
+        options.seed = 5;
+        options.games = 3;
+        options.turn_limit = 4;
+        options.start = late;
+        for (const auto policy : {camelup::sim::Policy::FirstLegal, camelup::sim::Policy::Greedy}) {
+            options.policy = policy;
+            camelup::sim::policy_memo::disable();
+            std::vector<camelup::GameState> plain;
+            for (int game = 0; game < options.games; ++game) {
+                plain.push_back(camelup::sim::play_game(options, game).final_state);
+            }
+            // Every game opens on the same state, two entries fill up within a game and get cleared
+            for (const std::size_t entries : {camelup::sim::policy_memo::kDefaultEntriesPerThread, std::size_t{2}}) {
+                camelup::sim::policy_memo::enable(entries);
+                for (int game = 0; game < options.games; ++game) {
+                    assert(camelup::sim::play_game(options, game).final_state == plain[game]);
+                }
+                const auto stats = camelup::sim::policy_memo::stats();
+                assert(stats.misses > 0 && stats.hit_rate() < 1.0);
+                assert(entries == 2 ? stats.clears > 0
+                                    : stats.clears == 0 && stats.hits >= static_cast<std::uint64_t>(options.games - 1));
+            }
+        }
+        camelup::sim::policy_memo::disable();
+        assert(throws_invalid_argument([]() { camelup::sim::policy_memo::enable(0); }));
+        assert(!camelup::sim::policy_memo::enabled());
+    }
+
+    {
+        // Perft counts are regression values: a change to move generation or apply shows up here
+        using Counts = camelup::sim::PerftCounts;
+        const auto opening = camelup::Engine(42).new_game(2);
+        const auto late = camelup::snapshot::from_notation("12/B/GY/OW/2 BGYOW 33333 -,-,- 3,3,3 -,-,- - - 0 1 -");
+        const auto run = [](const camelup::GameState& root, int depth, bool dedupe, std::size_t threads) {
+            return camelup::sim::perft(root, camelup::sim::PerftOptions{depth, dedupe, threads});
+        };
+        assert(run(opening, 0, false, 1) == (Counts{1, {}, 0}));
+        assert(run(opening, 1, false, 1) == (Counts{54, {15, 24, 5, 5, 5}, 0}));
+        assert(run(opening, 2, false, 1) == (Counts{2731, {765, 1156, 270, 270, 270}, 0}));
+        for (const std::size_t threads : {1, 3}) {
+            assert(run(opening, 3, false, threads) == (Counts{135584, {36387, 58772, 13655, 13385, 13385}, 0}));
+            assert(run(opening, 3, true, threads) == (Counts{62534, {35901, 57500, 13385, 13115, 13115}, 0}));
+            assert(run(late, 3, false, threads) == (Counts{103153, {29805, 41098, 10750, 10750, 10750}, 13228}));
+            assert(run(late, 3, true, threads) == (Counts{96550, {29652, 40674, 10665, 10665, 10665}, 8609}));
+        }
+        assert(run(late, 1, true, 1) == (Counts{52, {15, 24, 5, 5, 5}, 4}));
+        // Every die spent: rolls close the leg first and draw from the fresh pyramid
+        const auto spent = camelup::snapshot::from_notation("1/B/GY/OW/13 - 21333 -,-,- 3,3,3 B5,-,G5G3 - - 1 2 -");
+        assert(run(spent, 1, false, 1) == (Counts{54, {15, 24, 5, 5, 5}, 0}));
+        assert(run(spent, 2, false, 3) == (Counts{2730, {765, 1156, 269, 270, 270}, 0}));
+        assert(throws_invalid_argument([&]() { (void)run(opening, -1, false, 1); }));
+    }
+
+    {
+        // The optimised engine agrees with the reference rules over whole games on every apply path
+        camelup::sim::DifferentialOptions options;
+        options.seed = 7;
+        const auto report = camelup::sim::check_games(options, 0, 14, 2);
+        assert(report.games == 14 && report.actions > 0 && !report.divergence);
+        assert(!camelup::sim::check_game(options, 20));
+
+        // A bug planted in the roll handling of one apply path is found, shrunk and replayed
+        using camelup::sim::ApplyPath;
+        auto broken = options;
+        broken.after_apply = [](camelup::GameState& state, const camelup::Action& action, ApplyPath path) {
+            if (path == ApplyPath::TryApply && action.type() == camelup::ActionType::RollDie &&
+                state.leg_number >= 2) {
+                state.money[0] += 1;
+            }
+        };
+        broken.shrink = false;
+        const auto full = camelup::sim::check_game(broken, 3);
+        assert(full && full->what == "money[0]");
+        assert(full->paths.size() == full->record.actions.size() && full->paths.back() == ApplyPath::TryApply);
+        broken.shrink = true;
+        const auto shrunk = camelup::sim::check_game(broken, 3);
+        assert(shrunk && shrunk->what == "money[0]");
+        assert(shrunk->record.actions.size() < full->record.actions.size());
+        assert(shrunk->paths.size() == shrunk->record.actions.size() && shrunk->paths.back() == ApplyPath::TryApply);
+        assert(shrunk->record.actions.back().type() == camelup::ActionType::RollDie);
+        const auto replayed = camelup::sim::replay_divergence(broken, shrunk->record, shrunk->paths);
+        assert(replayed && replayed->what == shrunk->what);
+        assert(replayed->record.actions == shrunk->record.actions && replayed->record.rolls == shrunk->record.rolls);
+        // The same record does not diverge once its rolls leave the broken path
+        const std::vector<ApplyPath> known_rolls(shrunk->paths.size(), ApplyPath::KnownRoll);
+        assert(!camelup::sim::replay_divergence(broken, shrunk->record, known_rolls));
+        assert(!camelup::sim::replay_divergence(options, shrunk->record, shrunk->paths));
+        assert(throws_invalid_argument([&]() {
+            (void)camelup::sim::replay_divergence(broken, shrunk->record, std::vector<ApplyPath>{});
+        }));
+
+        const auto state = camelup::Engine(3).new_game(4);
+        assert(camelup::reference::legal_actions(state) == camelup::rules::legal_actions(state));
+        assert(throws_invalid_argument([&]() {
+            (void)camelup::reference::apply(state, camelup::Action::place_desert_tile(0, 1));
+        }));
+        auto spent = state;
+        spent.die_available[2] = false;
+        assert(throws_invalid_argument([&]() {
+            (void)camelup::reference::apply(spent, camelup::Action::roll_die(), camelup::DieRoll{2, 1});
+        }));
+
+        // Fields are named the way they read in GameState
+        assert(camelup::sim::first_difference(state, state).empty());
+        auto changed = state;
+        changed.money[3] += 1;
+        assert(camelup::sim::first_difference(state, changed) == "money[3]");
+        changed.loser_bet_stack.push_back({1, 2});
+        assert(camelup::sim::first_difference(state, changed) == "money[3]");
+        changed.money = state.money;
+        assert(camelup::sim::first_difference(state, changed) == "loser_bet_stack");
+    }
+
+    {
+        // History restores every kept turn exactly and drops whole snapshot stretches when full
+        camelup::Engine engine(5);
+        camelup::sim::GameHistory history(engine.new_game(3), 64, 8);
+        std::vector<camelup::GameState> states{history.state()};
+        std::mt19937 chooser(11);
+        while (!history.state().terminal) {
+            const auto legal = engine.legal_actions(history.state());
+            history.apply(engine, legal[std::uniform_int_distribution<std::size_t>(0, legal.size() - 1)(chooser)]);
+            states.push_back(history.state());
+            assert(history.last_turn() - history.first_turn() <= 64 && history.first_turn() % 8 == 0);
+        }
+        const std::size_t last = history.last_turn();
+        assert(last == states.size() - 1 && history.first_turn() > 0);
+        assert(history.memory_bytes() < 64 * 1024);
+        for (std::size_t turn = last + 1; turn-- > history.first_turn();) {
+            history.seek(turn);
+            assert(history.state() == states[turn] && history.turn() == turn);
+        }
+        assert(!history.undo() && history.redo() && history.state() == states[history.first_turn() + 1]);
+        assert(throws_invalid_argument([&]() { history.seek(history.first_turn() - 1); }));
+        assert(throws_invalid_argument([&]() { history.seek(last + 1); }));
+        assert(!history.action_at(last) && !history.action_at(history.first_turn() - 1));
+
+        // A roll replays with the outcome it got, not a fresh draw
+        history.seek(last - 1);
+        assert(history.action_at(last - 1)->type() == camelup::ActionType::RollDie && history.roll_at(last - 1));
+        assert(history.redo() && history.state() == states[last] && !history.redo());
+
+        // Acting after undo replaces the redo line
+        history.seek(last - 3);
+        const auto action = engine.legal_actions(history.state()).back();
+        history.apply(engine, action);
+        assert(history.last_turn() == last - 2 && history.action_at(last - 3) == action && !history.can_redo());
+        assert(history.state() == engine.apply_action(states[last - 3], action));
+        assert(throws_invalid_argument([&]() { history.apply(engine, camelup::Action::place_desert_tile(0, 1)); }));
+        assert(history.last_turn() == last - 2);
+
+        assert(throws_invalid_argument([]() { camelup::sim::GameHistory(camelup::GameState{}, 60, 8); }));
+    }
+
+    {
+        // Summaries are identical whatever the thread count, blocks merge in order
+        camelup::sim::BatchOptions options;
+        options.seed = 11;
+        options.players = 3;
+        options.games = camelup::sim::kSummaryBlockGames + 37;
+        options.turn_limit = 250;
+        options.policy = camelup::sim::Policy::RandomLegal;
+        const auto single = camelup::sim::run_batch(options, 1);
+        assert(camelup::sim::run_batch(options, 3) == single);
+        assert(camelup::sim::run_batch(options, 2) == single);
+
+        assert(single.games == static_cast<std::uint64_t>(options.games));
+        assert(single.turns.count() == single.games && single.legs.count() == single.games);
+        assert(single.money[2].count() == single.games && single.money[3].count() == 0);
+        std::uint64_t winners = 0;
+        for (const auto count : single.winners) {
+            winners += count;
+        }
+        assert(winners == single.finished && single.finished > 0 && single.finished < single.games);
+
+        // Every turn is one action of the batch policy
+        std::uint64_t actions = 0;
+        for (const auto count : single.actions[static_cast<std::size_t>(camelup::sim::Policy::RandomLegal)]) {
+            actions += count;
+        }
+        std::uint64_t turns = 0;
+        camelup::sim::RunSummary replay;
+        for (int game = 0; game < options.games; ++game) {
+            const auto outcome = camelup::sim::play_game(options, game);
+            turns += static_cast<std::uint64_t>(outcome.turns);
+            replay.record(outcome, options.policy);
+        }
+        assert(actions == turns);
+        assert(replay.games == single.games && replay.winners == single.winners && replay.turns == single.turns);
+    }
+
+    {
+        // Shards merge to the single-process summary for any shard count, also through shard files
+        camelup::sim::BatchOptions options;
+        options.seed = 5;
+        options.games = 5 * camelup::sim::kSummaryBlockGames + 5;  // six blocks, some of seven shards are empty
+        options.turn_limit = 60;
+        const auto single = camelup::sim::run_batch(options, 1);
+        assert(single.money[0].count() == single.games && single.money[0].retained() < single.games);
+
+        std::vector<camelup::sim::ShardResult> seven;
+        for (const int count : {1, 2, 3, 7}) {
+            std::vector<camelup::sim::ShardResult> shards;
+            std::vector<camelup::sim::ShardResult> loaded;
+            for (int index = count - 1; index >= 0; --index) {
+                shards.push_back(camelup::sim::run_shard(options, {index, count}, 2));
+                std::stringstream file;
+                camelup::sim::write_shard(file, shards.back());
+                loaded.push_back(camelup::sim::read_shard(file));
+                assert(loaded.back().options == options && loaded.back().shard == shards.back().shard);
+                assert(loaded.back().nodes == shards.back().nodes);
+            }
+            assert(camelup::sim::merge_shards(shards) == single);
+            assert(camelup::sim::merge_shards(loaded) == single);
+            if (count == 7) {
+                seven = shards;
+            }
+        }
+
+        // Missing, duplicated and foreign shards are rejected
+        auto missing = seven;
+        missing.erase(missing.begin());
+        assert(throws_invalid_argument([&]() { camelup::sim::merge_shards(missing); }));
+        auto duplicated = seven;
+        duplicated.push_back(seven.front());
+        assert(throws_invalid_argument([&]() { camelup::sim::merge_shards(duplicated); }));
+        auto other_seed = options;
+        other_seed.seed = 6;
+        auto foreign = seven;
+        foreign.front() = camelup::sim::run_shard(other_seed, seven.front().shard);
+        assert(throws_invalid_argument([&]() { camelup::sim::merge_shards(foreign); }));
+        assert(throws_invalid_argument([&]() { camelup::sim::run_shard(options, {7, 7}); }));
+
+        // Start positions survive the file round trip, truncated or foreign files do not parse
+        auto from_start = options;
+        from_start.games = 3;
+        from_start.start = camelup::sim::play_game(options, 0).final_state;
+        std::stringstream file;
+        camelup::sim::write_shard(file, camelup::sim::run_shard(from_start, {}));
+        const auto bytes = file.str();
+        std::stringstream round_trip(bytes);
+        assert(camelup::sim::read_shard(round_trip).options == from_start);
+        std::stringstream truncated(bytes.substr(0, bytes.size() - 3));
+        assert(throws_runtime_error([&]() { camelup::sim::read_shard(truncated); }));
+        std::stringstream foreign_file("not a shard");
+        assert(throws_runtime_error([&]() { camelup::sim::read_shard(foreign_file); }));
+
+        // A run resumed from any checkpoint reduces to the uninterrupted summary
+        std::vector<camelup::sim::ShardResult> checkpoints;
+        camelup::sim::Checkpointing checkpointing;
+        checkpointing.interval = std::chrono::milliseconds(0);
+        checkpointing.save = [&checkpoints](camelup::sim::ShardResult checkpoint) {
+            checkpoints.push_back(std::move(checkpoint));
+        };
+        const auto checkpointed = camelup::sim::run_shard(options, {}, 1, checkpointing);
+        assert(camelup::sim::merge_shards({checkpointed}) == single);
+        assert(checkpoints.size() == static_cast<std::size_t>(camelup::sim::summary_blocks(options.games)));
+        for (const auto& checkpoint : checkpoints) {
+            camelup::sim::Checkpointing resume;
+            resume.resume = &checkpoint;
+            assert(camelup::sim::merge_shards({camelup::sim::run_shard(options, {}, 2, resume)}) == single);
+        }
+        camelup::sim::Checkpointing wrong_shard;
+        wrong_shard.resume = &checkpoints.front();
+        assert(throws_invalid_argument([&]() { camelup::sim::run_shard(options, {0, 2}, 1, wrong_shard); }));
+        assert(throws_invalid_argument([&]() { camelup::sim::run_shard(other_seed, {}, 1, wrong_shard); }));
+
+        // The background writer replaces the checkpoint file as a whole
+        const auto path = (std::filesystem::temp_directory_path() / "camelup_sim_tests.checkpoint").string();
+        {
+            camelup::sim::CheckpointWriter writer(path);
+            for (const auto& checkpoint : checkpoints) {
+                writer.submit(checkpoint);
+            }
+            writer.flush();
+            const auto stats = writer.stats();
+            assert(stats.written >= 1 && stats.written + stats.superseded == checkpoints.size());
+            assert(camelup::sim::load_shard(path).nodes == checkpoints.back().nodes);
+            assert(!std::filesystem::exists(path + ".tmp"));
+        }
+        std::filesystem::remove(path);
+    }
+
+    {
+        // Every pushed item pops exactly once, a full queue refuses pushes
+        camelup::util::MpscQueue<int> queue(6);
+        assert(queue.capacity() == 8);
+        constexpr int kProducers = 4;
+        constexpr int kItems = 20000;
+        std::vector<std::thread> producers;
+        for (int producer = 0; producer < kProducers; ++producer) {
+            producers.emplace_back([&queue, producer]() {
+                for (int i = 0; i < kItems; ++i) {
+                    int value = producer * kItems + i;
+                    while (!queue.try_push(value)) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        std::vector<int> seen(kProducers * kItems, 0);
+        std::vector<int> last(kProducers, -1);
+        for (int popped = 0; popped < kProducers * kItems;) {
+            assert(queue.size_approx() <= queue.capacity());
+            if (const auto value = queue.try_pop()) {
+                ++seen[static_cast<std::size_t>(*value)];
+                // Items of one producer keep their order
+                assert(*value % kItems > last[static_cast<std::size_t>(*value / kItems)]);
+                last[static_cast<std::size_t>(*value / kItems)] = *value % kItems;
+                ++popped;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        assert(std::all_of(seen.begin(), seen.end(), [](int count) { return count == 1; }));
+        assert(!queue.try_pop());
+        for (int i = 0; i < 8; ++i) {
+            assert(queue.try_push(i));
+        }
+        int extra = 8;
+        assert(!queue.try_push(extra) && queue.size_approx() == 8);
+    }
+
+    {
+        // Records replay to the played game and survive the byte packing
+        camelup::sim::BatchOptions options;
+        options.seed = 21;
+        options.players = 4;
+        options.turn_limit = 300;
+        options.policy = camelup::sim::Policy::RandomLegal;
+        camelup::sim::GameRecord record;
+        const auto outcome = camelup::sim::play_game(options, 3, {}, &record);
+        assert(record.game == 3 && record.seed == 24 && record.players == 4);
+        assert(record.actions.size() == static_cast<std::size_t>(outcome.turns));
+        assert(record.rolls.size() == outcome.actions[0] && record.terminal == outcome.final_state.terminal);
+        assert(camelup::sim::replay(record) == outcome.final_state);
+        std::vector<std::uint8_t> bytes;
+        camelup::sim::append_record(bytes, record);
+        const std::uint8_t* cursor = bytes.data();
+        assert(camelup::sim::read_record(cursor, bytes.data() + bytes.size()) == record);
+        assert(cursor == bytes.data() + bytes.size());
+        cursor = bytes.data();
+        assert(throws_runtime_error([&]() { camelup::sim::read_record(cursor, bytes.data() + bytes.size() - 1); }));
+
+        // The codec round trips every policy, roll-only games stay under 16 bytes each
+        for (const auto policy : {camelup::sim::Policy::RollOnly, camelup::sim::Policy::FirstLegal,
+                                  camelup::sim::Policy::RandomLegal}) {
+            auto codec_options = options;
+            codec_options.policy = policy;
+            std::vector<camelup::sim::GameRecord> records(200);
+            for (int game = 0; game < 200; ++game) {
+                camelup::sim::play_game(codec_options, game, {}, &records[static_cast<std::size_t>(game)]);
+            }
+            // Out of order games, another batch seed and player count exercise the header deltas
+            std::swap(records[10], records[11]);
+            codec_options.seed = -7;
+            codec_options.players = 2;
+            camelup::sim::play_game(codec_options, 1000, {}, &records[50]);
+
+            std::vector<std::uint8_t> block;
+            camelup::sim::encode_records(records, block);
+            std::vector<camelup::sim::GameRecord> decoded(3);
+            assert(camelup::sim::decode_records(block.data(), block.size(), decoded) == block.size());
+            assert(decoded == records);
+            if (policy == camelup::sim::Policy::RollOnly) {
+                assert(block.size() < 16 * records.size());
+            }
+            assert(throws_runtime_error(
+                [&]() { camelup::sim::decode_records(block.data(), block.size() - 1, decoded); }));
+        }
+        auto broken = record;
+        broken.rolls.pop_back();
+        std::vector<std::uint8_t> block;
+        assert(throws_invalid_argument([&]() { camelup::sim::encode_records({broken}, block); }));
+
+        // The pipeline writes every game once across its shards, whatever order producers finish in
+        camelup::sim::SelfPlayOptions self_play;
+        self_play.batch = options;
+        self_play.batch.games = 300;
+        self_play.output_prefix = (std::filesystem::temp_directory_path() / "camelup_sim_tests_records").string();
+        self_play.producers = 3;
+        self_play.queue_capacity = 4;
+        self_play.batch_records = 16;
+        self_play.shard_records = 100;
+        camelup::sim::SelfPlayPipeline pipeline(self_play);
+        const auto stats = pipeline.wait();
+        assert(stats.games == 300 && stats.shards == 3 && stats.queue_capacity == 4);
+        assert(stats.max_queue_depth <= stats.queue_capacity && stats.games_per_second() > 0.0);
+
+        std::vector<camelup::sim::GameRecord> records;
+        std::uint64_t file_bytes = 0;
+        for (const auto& path : pipeline.shard_paths()) {
+            file_bytes += std::filesystem::file_size(path);
+            auto shard = camelup::sim::load_record_shard(path);
+            records.insert(records.end(), shard.begin(), shard.end());
+            std::filesystem::remove(path);
+        }
+        assert(file_bytes == stats.bytes && records.size() == 300);
+        std::sort(records.begin(), records.end(), [](const auto& lhs, const auto& rhs) { return lhs.game < rhs.game; });
+        std::uint64_t turns = 0;
+        for (int game = 0; game < 300; ++game) {
+            camelup::sim::GameRecord expected;
+            camelup::sim::play_game(self_play.batch, game, {}, &expected);
+            assert(records[static_cast<std::size_t>(game)] == expected);
+            turns += expected.actions.size();
+        }
+        assert(stats.turns == turns);
+    }
+
+    {
+        // Streamed games are the games play_game plays, step by step and interleaved
+        camelup::sim::BatchOptions options;
+        options.seed = 17;
+        options.players = 3;
+        options.games = 7;
+        // Record of one streamed game, checked against play_game
+        const auto stream_game = [](const camelup::sim::BatchOptions& batch, int game) {
+            camelup::sim::GameRecord expected;
+            const auto outcome = camelup::sim::play_game(batch, game, {}, &expected);
+            camelup::sim::GameRecord record;
+            record.game = static_cast<std::uint32_t>(game);
+            record.seed = batch.seed + game;
+            record.players = static_cast<std::uint8_t>(outcome.final_state.player_count);
+            std::optional<camelup::GameState> final_state;
+            for (const auto& step : camelup::sim::game_steps(batch, game)) {
+                assert(step.game == game && step.turn == static_cast<int>(record.actions.size()) && !final_state);
+                if (step.action == nullptr) {
+                    final_state = *step.state;
+                    continue;
+                }
+                record.actions.push_back(*step.action);
+                if (step.action->type() == camelup::ActionType::RollDie) {
+                    record.rolls.push_back(step.roll);
+                }
+            }
+            record.terminal = final_state->terminal;
+            assert(record == expected && *final_state == outcome.final_state);
+            return record;
+        };
+        for (const auto policy :
+             {camelup::sim::Policy::RollOnly, camelup::sim::Policy::FirstLegal, camelup::sim::Policy::RandomLegal}) {
+            options.policy = policy;
+            std::vector<std::vector<camelup::Action>> streamed(static_cast<std::size_t>(options.games));
+            for (int game = 0; game < options.games; ++game) {
+                streamed[static_cast<std::size_t>(game)] = stream_game(options, game).actions;
+            }
+
+            std::vector<std::vector<camelup::Action>> interleaved(streamed.size());
+            std::vector<int> first_games;
+            for (const auto& step : camelup::sim::interleaved_steps(options, 3)) {
+                if (first_games.size() < 3) {
+                    first_games.push_back(step.game);
+                }
+                if (step.action != nullptr) {
+                    interleaved[static_cast<std::size_t>(step.game)].push_back(*step.action);
+                }
+            }
+            assert((first_games == std::vector<int>{0, 1, 2}) && interleaved == streamed);
+        }
+        assert(throws_invalid_argument([&]() { camelup::sim::interleaved_steps(options, 0); }));
+
+        // A turn limit ends the stream early, a terminal start yields only the final step
+        options.turn_limit = 5;
+        int steps = 0;
+        for (const auto& step : camelup::sim::game_steps(options, 0)) {
+            assert((step.action == nullptr) == (step.turn == 5));
+            ++steps;
+        }
+        assert(steps == 6);
+        options.start = camelup::sim::play_game(options, 0).final_state;
+        options.start->terminal = true;
+        steps = 0;
+        for (const auto& step : camelup::sim::game_steps(options, 0)) {
+            assert(step.action == nullptr && *step.state == *options.start);
+            ++steps;
+        }
+        assert(steps == 1);
+
+        // A pasted start with every die spent closes its leg before the first roll, like play_game
+        options.turn_limit = 500;
+        options.policy = camelup::sim::Policy::RollOnly;
+        options.start = camelup::snapshot::from_notation("1/B/GY/OW/13 - 21333 -,-,- 3,3,3 B5,-,G5G3 - - 1 2 -");
+        const auto spent = stream_game(options, 0);
+        assert(!spent.rolls.empty() && spent.terminal);
+    }
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include <cassert>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "camelup/actions.hpp"
+#include "camelup/engine.hpp"
+#include "camelup/snapshot/state_snapshot.hpp"
+
+namespace {
+
+template <typename Fn>
+bool throws_invalid_argument(Fn&& fn) {
+    try {
+        fn();
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+void check_round_trip(const camelup::GameState& state) {
+    const auto snapshot = camelup::snapshot::encode(state);
+    assert(camelup::snapshot::decode(snapshot) == state);
+
+    const auto notation = camelup::snapshot::to_notation(state);
+    const auto parsed = camelup::snapshot::from_notation(notation);
+    assert(parsed == state);
+    assert(camelup::snapshot::to_notation(parsed) == notation);
+}
+
+}  // namespace
+
+int main() {
+    {
+        camelup::Engine engine(11);
+        const auto state = engine.new_game(2);
+        check_round_trip(state);
+
+        // Opening position notation is stable enough to paste around
+        const auto notation = camelup::snapshot::to_notation(state);
+        assert(notation.find(" BGYOW 33333 -,- 3,3 -,- - - 0 1 -") != std::string::npos);
+    }
+
+    {
+        const auto state =
+            camelup::snapshot::from_notation("1/B/GY/OW/13 GO 32130 5+,-,9- 4,-1,7 G5Y3,W5W3W2,Y5 0Y2B 1W 2 3 -");
+        assert(state.player_count == 3);
+        assert(state.board[2].size() == 2 && state.board[2][0] == camelup::Camel::Green);
+        assert(state.die_available[camelup::Camel::Green] && !state.die_available[camelup::Camel::Blue]);
+        assert(state.desert_tile_owner[5] == 0 && state.desert_tile_owner[9] == 2);
+        assert(state.desert_tiles[2].move_delta == -1);
+        assert(state.money[1] == -1);
+        assert(state.player_leg_tickets[0].size() == 2 && state.player_leg_tickets[0][1].value == 3);
+        assert(state.winner_bet_stack.size() == 2 && state.winner_bet_stack[1].player == 2);
+        assert(!state.winner_bet_card_available[0][camelup::Camel::Yellow]);
+        assert(!state.loser_bet_card_available[1][camelup::Camel::White]);
+        assert(state.current_player == 2 && state.leg_number == 3);
+        check_round_trip(state);
+    }
+
+    {
+        // Random legal play across player counts covers tickets, bets and desert tiles
+        int encoded = 0;
+        for (int players = 2; players <= camelup::kMaxPlayers; ++players) {
+            camelup::Engine engine(static_cast<std::uint32_t>(300 + players));
+            std::mt19937 chooser(static_cast<std::uint32_t>(players));
+            auto state = engine.new_game(players);
+            for (int turn = 0; turn < 150 && !state.terminal; ++turn) {
+                const auto legal = engine.legal_actions(state);
+                std::uniform_int_distribution<std::size_t> pick(0, legal.size() - 1);
+                state = engine.apply_action(state, legal[pick(chooser)]);
+                try {
+                    check_round_trip(state);
+                    ++encoded;
+                } catch (const std::length_error&) {
+                    // Very long betting sequences can outgrow the fixed layout, notation still works
+                    assert(camelup::snapshot::from_notation(camelup::snapshot::to_notation(state)) == state);
+                }
+            }
+        }
+        assert(encoded > 0);
+    }
+
+    {
+        camelup::snapshot::StateSnapshot bad{};
+        bad[0] = 0x0F;
+        assert(throws_invalid_argument([&] { static_cast<void>(camelup::snapshot::decode(bad)); }));
+        assert(throws_invalid_argument([] { static_cast<void>(camelup::snapshot::from_notation("1/B/GY/OW/13")); }));
+        assert(throws_invalid_argument(
+            [] { static_cast<void>(camelup::snapshot::from_notation("1/B/GY/OW/12 BGYOW 33333 -,- 3,3 -,- - - 0 1 -")); }));
+        assert(throws_invalid_argument(
+            [] { static_cast<void>(camelup::snapshot::from_notation("1/B/GY/OB/13 BGYOW 33333 -,- 3,3 -,- - - 0 1 -")); }));
+        assert(throws_invalid_argument(
+            [] { static_cast<void>(camelup::snapshot::from_notation("1/B/GY/OW/13 BGYOW 33333 -,- 3,3 -,- - - 5 1 -")); }));
+
+        // States the engine cannot reach are refused rather than handed to it
+        for (const char* unreachable : {
+                 "1/B/GY/OW/13 BGYOW 23333 -,- 3,3 B4,- - - 0 1 -",    // ticket value
+                 "1/B/GY/OW/13 BGYOW 33333 -,- 3,3 B5,- - - 0 1 -",    // held but still in supply
+                 "1/B/GY/OW/13 BGYOW 13333 -,- 3,3 B5,- - - 0 1 -",    // taken but not held
+                 "1/B/GY/OW/13 BGYOW 23333 -,- 3,3 B5,B5 - - 0 1 -",   // held twice
+                 "1/B/GY/OW/13 BGYOW 33333 6+,6- 3,3 -,- - - 0 1 -",   // shared desert tile
+                 "1/B/GY/OW/13 BGYOW 33333 6+,7- 3,3 -,- - - 0 1 -",   // touching desert tiles
+                 "1/B/GY/OW/13 BGYOW 33333 2+,- 3,3 -,- - - 0 1 -",    // desert tile under camels
+                 "1/B/GY/OW/13 BGYOW 33333 -,- 3,3 -,- - - 0 0 -",     // leg number
+             }) {
+            assert(throws_invalid_argument([&] { static_cast<void>(camelup::snapshot::from_notation(unreachable)); }));
+        }
+
+        // Snapshots of the same positions are refused by decode
+        const auto base = camelup::snapshot::from_notation("1/B/GY/OW/13 BGYOW 33333 -,- 3,3 -,- - - 0 1 -");
+        const auto decode_rejects = [](const camelup::GameState& state) {
+            const auto snapshot = camelup::snapshot::encode(state);
+            return throws_invalid_argument([&] { static_cast<void>(camelup::snapshot::decode(snapshot)); });
+        };
+        assert(!decode_rejects(base));
+        for (const auto& [first, second] : {std::pair{0, -1}, std::pair{camelup::kBoardTiles - 1, -1},
+                                            std::pair{6, 6}, std::pair{6, 7}, std::pair{2, -1}}) {
+            auto state = base;
+            state.desert_tiles[0] = {first, 1};
+            state.desert_tiles[1] = {second, -1};
+            assert(decode_rejects(state));
+        }
+        auto overdrawn = base;
+        overdrawn.leg_tickets_remaining[camelup::Camel::Blue] = 2;
+        overdrawn.player_leg_tickets[0] = {{camelup::Camel::Blue, 5}, {camelup::Camel::Blue, 3}};
+        assert(decode_rejects(overdrawn));
+        overdrawn.leg_tickets_remaining[camelup::Camel::Blue] = 0;
+        overdrawn.player_leg_tickets[1] = {{camelup::Camel::Blue, 2}, {camelup::Camel::Blue, 2}};
+        assert(decode_rejects(overdrawn));
+    }
+
+    return 0;
+}